@@ -0,0 +1,19 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+
+// Monotonic clock in ns for the benchmarks, which only run on Linux
+static double BenchNowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// keeps the compiler from dropping a result
+static volatile unsigned long benchSink;
+
+#endif // BENCH_H
@@ -0,0 +1,63 @@
+/*
+ * Nanoseconds per nickname for the escape functions of text_escape.c, with nicknames of typical length and worst
+ * case content (every byte special). The byte-wise loop is the reference without block copy and without UTF-8
+ * validation, so it wins on very short names.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+#include "text_escape.h"
+
+#define ROUNDS 2000000
+
+static const char* names[] = {
+    "Ben",
+    "Little.Ben",
+    "xXx_Gamer_2000_xXx_Clan_Member",
+    "M\xC3\xBCller-L\xC3\xBC" "denscheidt",
+    "\"\"\"\"[b][b][b]\\\\\\\\$$$$````\x01\x02\x03\x04",
+};
+
+// byte-wise JSON escaping as before the block copy
+static size_t EscapeJsonBytewise(const char* in, char* out, size_t outSize)
+{
+    size_t len = 0;
+
+    for (; *in != '\0' && len + 7 < outSize; in++) {
+        unsigned char c = (unsigned char)*in;
+
+        if (c == '"' || c == '\\') {
+            out[len++] = '\\';
+            out[len++] = (char)c;
+        } else if (c < 0x20) {
+            len += (size_t)snprintf(out + len, outSize - len, "\\u%04x", c);
+        } else {
+            out[len++] = (char)c;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static void Run(const char* label, size_t (*escape)(const char*, char*, size_t), const char* name)
+{
+    char   out[512];
+    double start = BenchNowNs();
+
+    for (int i = 0; i < ROUNDS; i++)
+        benchSink += escape(name, out, sizeof(out));
+    printf("  %-10s %6.1f ns\n", label, (BenchNowNs() - start) / ROUNDS);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        printf("name of %zu bytes:\n", strlen(names[i]));
+        Run("json", EscapeJsonString, names[i]);
+        Run("bytewise", EscapeJsonBytewise, names[i]);
+        Run("bbcode", EscapeBBCode, names[i]);
+        Run("shell", EscapeShellArgument, names[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Write syscalls per event of the event loop, for bursts of writes to a file and to a socket. Built twice by
+ * make bench: bench_event_loop uses io_uring where the kernel allows it, bench_event_loop_writev is built with
+ * LH2MQTT_NO_IO_URING and always writes with writev().
+ */
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "bench.h"
+#include "event_loop.h"
+
+#define EVENTS 20000
+
+static volatile int completed;
+static volatile int failed;
+
+static void OnWritten(int fd, int error, void* arg)
+{
+    if (error != 0)
+        failed++;
+    completed++;
+}
+
+// Reads the socket empty, like a broker would
+static void DrainSocket(void* arg)
+{
+    int  fd = *(int*)arg;
+    char buf[65536];
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+}
+
+static void Run(EVENT_LOOP* loop, const char* target, int fd, int burst)
+{
+    EVENT_LOOP_STATS before;
+    EVENT_LOOP_STATS after;
+    char             line[96];
+    double           start;
+
+    EventLoopGetStats(loop, &before);
+    completed = 0;
+    start     = BenchNowNs();
+    for (int sent = 0; sent < EVENTS;) {
+        int end = sent + burst;
+
+        // a burst is queued at once, then the loop writes it before the next one starts
+        for (; sent < end; sent++) {
+            int len = snprintf(line, sizeof(line), "lh2mqtt/1/talk {\"client\":%d,\"status\":\"start\"}\n", sent);
+
+            while (!EventLoopWrite(loop, fd, line, (size_t)len, OnWritten, NULL))
+                usleep(10);
+        }
+        while (completed < sent)
+            sched_yield();
+    }
+    EventLoopGetStats(loop, &after);
+    printf("  %-6s burst %3d: %.3f syscalls/event, %.0f ns/event\n", target, burst,
+           (double)(after.writeSyscalls - before.writeSyscalls) / (double)(after.writes - before.writes), (BenchNowNs() - start) / EVENTS);
+}
+
+int main(void)
+{
+    static const int bursts[] = { 1, 8, 64 };
+    EVENT_LOOP       loop;
+    EVENT_LOOP_STATS stats;
+    PLATFORM_THREAD  reader;
+    int              pair[2];
+    int              file;
+
+    file = open("bench_event_loop.out", O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (file < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0 || !EventLoopStart(&loop)) {
+        fprintf(stderr, "bench_event_loop: setup failed\n");
+        return 1;
+    }
+    fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+    ThreadStart(&reader, DrainSocket, &pair[1]);
+
+    EventLoopGetStats(&loop, &stats);
+    printf("backend %s, %d events per run\n", stats.backend, EVENTS);
+    for (size_t i = 0; i < sizeof(bursts) / sizeof(bursts[0]); i++) {
+        Run(&loop, "file", file, bursts[i]);
+        Run(&loop, "socket", pair[0], bursts[i]);
+    }
+
+    EventLoopStop(&loop);
+    shutdown(pair[0], SHUT_WR);
+    ThreadJoin(&reader);
+    close(pair[0]);
+    close(pair[1]);
+    close(file);
+    unlink("bench_event_loop.out");
+    return failed != 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Cost of the state file for both sides: a poll of the update counter, a consistent copy of a slot with an idle and
+ * with a busy writer, and one speaker change of the writer.
+ */
+
+#include <unistd.h>
+
+#include "bench.h"
+#include "state_file.h"
+
+#define ROUNDS 2000000
+
+static STATE_FILE   writer;
+static volatile int writerStop;
+
+static void BusyWriter(void* arg)
+{
+    for (unsigned int i = 0; !writerStop; i++)
+        StateFileSetSpeaker(&writer, 5, "srv=", (anyID)(1 + i % 2), i % 2 ? "Little.Ben" : "M\xC3\xBCller", "uid=", 1, i);
+}
+
+static void MeasureReads(const char* label, STATE_FILE* reader)
+{
+    STATE_FILE_SERVER slot;
+    int               failed = 0;
+    double            start  = BenchNowNs();
+
+    for (int i = 0; i < ROUNDS; i++)
+        failed += !StateFileRead(reader, 0, &slot);
+    printf("  %-22s %6.1f ns, %d of %d without a copy\n", label, (BenchNowNs() - start) / ROUNDS, failed, ROUNDS);
+}
+
+int main(void)
+{
+    STATE_FILE      reader;
+    PLATFORM_THREAD thread;
+    char            path[64];
+    double          start;
+
+    snprintf(path, sizeof(path), "/tmp/lh2mqtt-bench-state-%d", (int)getpid());
+    if (!StateFileOpen(&writer, path) || !StateFileAttach(&reader, path)) {
+        fprintf(stderr, "bench_state_file: could not open %s\n", path);
+        return 1;
+    }
+
+    start = BenchNowNs();
+    for (int i = 0; i < ROUNDS; i++)
+        StateFileSetSpeaker(&writer, 5, "srv=", (anyID)(1 + i % 2), i % 2 ? "Little.Ben" : "M\xC3\xBCller", "uid=", 1, (uint64)i);
+    printf("  %-22s %6.1f ns\n", "writer: speaker change", (BenchNowNs() - start) / ROUNDS);
+
+    start = BenchNowNs();
+    for (int i = 0; i < ROUNDS; i++)
+        benchSink += StateFileUpdates(&reader);
+    printf("  %-22s %6.1f ns\n", "reader: poll updates", (BenchNowNs() - start) / ROUNDS);
+
+    MeasureReads("reader: idle writer", &reader);
+    writerStop = 0;
+    ThreadStart(&thread, BusyWriter, NULL);
+    MeasureReads("reader: busy writer", &reader);
+    writerStop = 1;
+    ThreadJoin(&thread);
+
+    StateFileDetach(&reader);
+    StateFileClose(&writer);
+    unlink(path);
+    return 0;
+}
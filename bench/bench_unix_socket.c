@@ -0,0 +1,168 @@
+/*
+ * Publish latency of the built-in MQTT client over a Unix domain socket against TCP on 127.0.0.1. Every publish
+ * uses QoS 1 and waits for its PUBACK, so a sample is one round trip. Without arguments a minimal broker stand-in
+ * runs in the process; "bench_unix_socket port /path/to/socket" measures a local broker listening on both.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "bench.h"
+#include "mqtt_client.h"
+
+#define SAMPLES 20000
+#define WARMUP  1000
+
+static int ReadFull(int fd, unsigned char* buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n <= 0)
+            return 0;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Broker stand-in: CONNACK, PUBACK and PINGRESP, one connection after the other
+static void StubBroker(void* arg)
+{
+    int listenFd = *(int*)arg;
+    int fd;
+
+    while ((fd = accept(listenFd, NULL, NULL)) >= 0) {
+        unsigned char header;
+        unsigned char body[4096];
+
+        for (;;) {
+            size_t        length = 0;
+            int           shift  = 0;
+            unsigned char byte;
+
+            if (!ReadFull(fd, &header, 1))
+                break;
+            do {
+                if (!ReadFull(fd, &byte, 1))
+                    goto next;
+                length |= (size_t)(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            if (length > sizeof(body) || !ReadFull(fd, body, length))
+                break;
+
+            if ((header & 0xF0) == 0x10) {
+                static const unsigned char connack[] = { 0x20, 2, 0, 0 };
+                write(fd, connack, sizeof(connack));
+            } else if ((header & 0xF0) == 0x30 && (header & 0x06) != 0) {
+                size_t        topicLen = ((size_t)body[0] << 8) | body[1];
+                unsigned char puback[] = { 0x40, 2, body[2 + topicLen], body[3 + topicLen] };
+                write(fd, puback, sizeof(puback));
+            } else if ((header & 0xF0) == 0xC0) {
+                static const unsigned char pingresp[] = { 0xD0, 0 };
+                write(fd, pingresp, sizeof(pingresp));
+            } else if ((header & 0xF0) == 0xE0) {
+                break;
+            }
+        }
+    next:
+        close(fd);
+    }
+}
+
+static int CompareDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void Measure(const char* label, const char* host, const char* port)
+{
+    static double samples[SAMPLES];
+    MQTT_CLIENT   client;
+    double        total = 0;
+
+    MqttInit(&client);
+    if (!MqttConnect(&client, host, port, "lh2mqtt-bench", "", "", 60)) {
+        printf("  %-6s could not connect to %s\n", label, host);
+        return;
+    }
+    for (int i = -WARMUP; i < SAMPLES; i++) {
+        double start = BenchNowNs();
+
+        if (!MqttPublish(&client, "lh2mqtt/bench/talk", "{\"client\":7,\"status\":\"start\",\"name\":\"Little.Ben\"}", 1)) {
+            printf("  %-6s publish failed\n", label);
+            MqttDisconnect(&client);
+            return;
+        }
+        if (i >= 0) {
+            samples[i] = BenchNowNs() - start;
+            total += samples[i];
+        }
+    }
+    MqttDisconnect(&client);
+    qsort(samples, SAMPLES, sizeof(samples[0]), CompareDouble);
+    printf("  %-6s mean %6.1f us, p50 %6.1f us, p99 %6.1f us\n", label, total / SAMPLES / 1000, samples[SAMPLES / 2] / 1000,
+           samples[SAMPLES * 99 / 100] / 1000);
+}
+
+int main(int argc, char** argv)
+{
+    struct sockaddr_in tcpAddr;
+    struct sockaddr_un unixAddr;
+    socklen_t          len = sizeof(tcpAddr);
+    PLATFORM_THREAD    tcpThread;
+    PLATFORM_THREAD    unixThread;
+    int                tcpFd;
+    int                unixFd;
+    char               port[16];
+    char               host[sizeof(unixAddr.sun_path) + 8];
+
+    if (argc == 3) {
+        snprintf(host, sizeof(host), "%s%s", MQTT_UNIX_PREFIX, argv[2]);
+        printf("local broker, %d QoS 1 publishes each\n", SAMPLES);
+        Measure("tcp", "127.0.0.1", argv[1]);
+        Measure("unix", host, "");
+        return 0;
+    }
+
+    memset(&tcpAddr, 0, sizeof(tcpAddr));
+    tcpAddr.sin_family      = AF_INET;
+    tcpAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    memset(&unixAddr, 0, sizeof(unixAddr));
+    unixAddr.sun_family = AF_UNIX;
+    snprintf(unixAddr.sun_path, sizeof(unixAddr.sun_path), "/tmp/lh2mqtt-bench-%d.sock", (int)getpid());
+
+    tcpFd  = socket(AF_INET, SOCK_STREAM, 0);
+    unixFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (bind(tcpFd, (struct sockaddr*)&tcpAddr, sizeof(tcpAddr)) != 0 || listen(tcpFd, 4) != 0 ||
+        getsockname(tcpFd, (struct sockaddr*)&tcpAddr, &len) != 0 || bind(unixFd, (struct sockaddr*)&unixAddr, sizeof(unixAddr)) != 0 ||
+        listen(unixFd, 4) != 0) {
+        fprintf(stderr, "bench_unix_socket: could not listen\n");
+        return 1;
+    }
+    ThreadStart(&tcpThread, StubBroker, &tcpFd);
+    ThreadStart(&unixThread, StubBroker, &unixFd);
+
+    snprintf(port, sizeof(port), "%u", ntohs(tcpAddr.sin_port));
+    snprintf(host, sizeof(host), "%s%s", MQTT_UNIX_PREFIX, unixAddr.sun_path);
+    printf("broker stand-in, %d QoS 1 publishes each\n", SAMPLES);
+    Measure("tcp", "127.0.0.1", port);
+    Measure("unix", host, "");
+
+    // accept returns once the sockets are shut down
+    shutdown(tcpFd, SHUT_RDWR);
+    shutdown(unixFd, SHUT_RDWR);
+    ThreadJoin(&tcpThread);
+    ThreadJoin(&unixThread);
+    close(tcpFd);
+    close(unixFd);
+    unlink(unixAddr.sun_path);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "active_speakers.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int ActiveSpeakersLess(const ACTIVE_SPEAKER* a, uint64 channelID, anyID clientID)
+{
+    return a->channelID < channelID || (a->channelID == channelID && a->clientID < clientID);
+}
+
+// Speakers are few, a linear search by client beats keeping a second index
+static int ActiveSpeakersIndexOf(const ACTIVE_SPEAKERS* set, anyID clientID)
+{
+    for (int i = 0; i < set->count; i++) {
+        if (set->speakers[i].clientID == clientID)
+            return i;
+    }
+    return -1;
+}
+
+static void ActiveSpeakersRemoveAt(ACTIVE_SPEAKERS* set, int idx)
+{
+    memmove(&set->speakers[idx], &set->speakers[idx + 1], (set->count - idx - 1) * sizeof(ACTIVE_SPEAKER));
+    set->count--;
+}
+
+static int ActiveSpeakersInsert(ACTIVE_SPEAKERS* set, anyID clientID, uint64 channelID)
+{
+    int idx = 0;
+
+    if (set->count == ACTIVE_SPEAKERS_MAX)
+        return 0;
+
+    while (idx < set->count && ActiveSpeakersLess(&set->speakers[idx], channelID, clientID))
+        idx++;
+    memmove(&set->speakers[idx + 1], &set->speakers[idx], (set->count - idx) * sizeof(ACTIVE_SPEAKER));
+    set->speakers[idx].channelID = channelID;
+    set->speakers[idx].clientID  = clientID;
+    set->count++;
+    return 1;
+}
+
+void ActiveSpeakersInit(ACTIVE_SPEAKERS* set)
+{
+    memset(set, 0, sizeof(*set));
+}
+
+// Returns 1 and advances the sequence if the client was not talking before
+int ActiveSpeakersAdd(ACTIVE_SPEAKERS* set, anyID clientID, uint64 channelID)
+{
+    if (ActiveSpeakersIndexOf(set, clientID) >= 0 || !ActiveSpeakersInsert(set, clientID, channelID))
+        return 0;
+    set->sequence++;
+    return 1;
+}
+
+// Returns 1 and advances the sequence if the client was talking, channelID receives its channel
+int ActiveSpeakersRemove(ACTIVE_SPEAKERS* set, anyID clientID, uint64* channelID)
+{
+    int idx = ActiveSpeakersIndexOf(set, clientID);
+
+    if (idx < 0)
+        return 0;
+    if (channelID != NULL)
+        *channelID = set->speakers[idx].channelID;
+    ActiveSpeakersRemoveAt(set, idx);
+    set->sequence++;
+    return 1;
+}
+
+// Keeps a speaker who switches channels while talking, returns 1 if the client was talking
+int ActiveSpeakersMove(ACTIVE_SPEAKERS* set, anyID clientID, uint64 newChannelID)
+{
+    int idx = ActiveSpeakersIndexOf(set, clientID);
+
+    if (idx < 0 || set->speakers[idx].channelID == newChannelID)
+        return 0;
+    ActiveSpeakersRemoveAt(set, idx);
+    ActiveSpeakersInsert(set, clientID, newChannelID);
+    set->sequence++;
+    return 1;
+}
+
+// Writes the set grouped by channel like "12:5,7|30:2", returns the length.
+// If the buffer is too small the list is cut off after the last complete speaker.
+size_t ActiveSpeakersFormat(const ACTIVE_SPEAKERS* set, char* out, size_t outSize)
+{
+    size_t len = 0;
+
+    if (outSize == 0)
+        return 0;
+    out[0] = '\0';
+
+    for (int i = 0; i < set->count; i++) {
+        const ACTIVE_SPEAKER* s = &set->speakers[i];
+        int                   n;
+
+        if (i == 0 || set->speakers[i - 1].channelID != s->channelID)
+            n = snprintf(out + len, outSize - len, "%s%llu:%u", i > 0 ? "|" : "", (unsigned long long)s->channelID, (unsigned int)s->clientID);
+        else
+            n = snprintf(out + len, outSize - len, ",%u", (unsigned int)s->clientID);
+
+        if (n < 0 || (size_t)n >= outSize - len) {
+            out[len] = '\0';
+            break;
+        }
+        len += (size_t)n;
+    }
+    return len;
+}
@@ -0,0 +1,37 @@
+#ifndef ACTIVE_SPEAKERS_H
+#define ACTIVE_SPEAKERS_H
+
+#include <stddef.h>
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ACTIVE_SPEAKERS_MAX 128 // simultaneous speakers per server tab
+
+typedef struct {
+    uint64 channelID;
+    anyID  clientID;
+} ACTIVE_SPEAKER;
+
+// Clients currently talking on one server tab, sorted by channel and client,
+// so the speakers of a channel are adjacent and the snapshot is built in one pass.
+typedef struct {
+    ACTIVE_SPEAKER speakers[ACTIVE_SPEAKERS_MAX];
+    int            count;
+    unsigned int   sequence; // incremented for every published change
+} ACTIVE_SPEAKERS;
+
+void   ActiveSpeakersInit(ACTIVE_SPEAKERS* set);
+int    ActiveSpeakersAdd(ACTIVE_SPEAKERS* set, anyID clientID, uint64 channelID);
+int    ActiveSpeakersRemove(ACTIVE_SPEAKERS* set, anyID clientID, uint64* channelID);
+int    ActiveSpeakersMove(ACTIVE_SPEAKERS* set, anyID clientID, uint64 newChannelID);
+size_t ActiveSpeakersFormat(const ACTIVE_SPEAKERS* set, char* out, size_t outSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ACTIVE_SPEAKERS_H
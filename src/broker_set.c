@@ -0,0 +1,231 @@
+#include "broker_set.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Updates the health of a broker after a probe, connect or publish, lock held
+static void BrokerUpdate(BROKER* broker, int ok, uint64 rttMs, uint64 now)
+{
+    if (ok) {
+        broker->healthy   = 1;
+        broker->failures  = 0;
+        broker->backoffMs = BROKER_PROBE_MS;
+        if (rttMs != BROKER_NO_RTT)
+            broker->rttMs = broker->rttMs == BROKER_NO_RTT ? rttMs : (broker->rttMs * 3 + rttMs) / 4;
+    } else {
+        broker->healthy   = 0;
+        broker->rttMs     = BROKER_NO_RTT;
+        broker->backoffMs = broker->backoffMs * 2 < BROKER_RETRY_MAX_MS ? broker->backoffMs * 2 : BROKER_RETRY_MAX_MS;
+        broker->failures++;
+    }
+    broker->nextProbeMs = now + broker->backoffMs;
+}
+
+// Keeps a connection to every broker except the active one and pings it every BROKER_PROBE_MS
+static void BrokerProbeWorker(void* arg)
+{
+    BROKER_SET*  set = (BROKER_SET*)arg;
+    MQTT_CLIENT  probes[BROKER_MAX];
+    unsigned int generation;
+    char         clientId[48];
+
+    for (int i = 0; i < BROKER_MAX; i++) {
+        MqttInit(&probes[i]);
+        probes[i].resolver = set->resolver;
+    }
+
+    MutexLock(&set->lock);
+    generation = set->generation;
+    while (!set->stop) {
+        uint64 now    = GetMonotonicTimeMs();
+        uint64 waitMs = BROKER_PROBE_MS;
+        int    index  = -1;
+        char   host[sizeof(set->brokers[0].host)];
+        char   port[sizeof(set->port)];
+        char   user[sizeof(set->user)];
+        char   password[sizeof(set->password)];
+        int    ok;
+        uint64 rttMs = BROKER_NO_RTT;
+
+        if (generation != set->generation) {
+            for (int i = 0; i < BROKER_MAX; i++)
+                MqttDisconnect(&probes[i]);
+            generation = set->generation;
+        }
+        for (int i = 0; i < set->count && index < 0; i++) {
+            if (i == set->active || !set->probing) {
+                MqttDisconnect(&probes[i]); // the daemon has its own connection to the active broker
+                continue;
+            }
+            if (now >= set->brokers[i].nextProbeMs)
+                index = i;
+            else if (set->brokers[i].nextProbeMs - now < waitMs)
+                waitMs = set->brokers[i].nextProbeMs - now;
+        }
+        if (index < 0) {
+            CondWaitTimeout(&set->cond, &set->lock, waitMs);
+            continue;
+        }
+        snprintf(host, sizeof(host), "%s", set->brokers[index].host);
+        snprintf(port, sizeof(port), "%s", set->port);
+        snprintf(user, sizeof(user), "%s", set->user);
+        snprintf(password, sizeof(password), "%s", set->password);
+        MutexUnlock(&set->lock);
+
+        ok = probes[index].fd >= 0;
+        if (!ok) {
+            snprintf(clientId, sizeof(clientId), "lh2mqttd-%d-probe%d", (int)getpid(), index);
+            ok = MqttConnect(&probes[index], host, port, clientId, user, password, BROKER_PROBE_MS / 1000 * 4);
+        }
+        if (ok) {
+            uint64 start = GetMonotonicTimeMs();
+            ok    = MqttPing(&probes[index]);
+            rttMs = GetMonotonicTimeMs() - start;
+        }
+
+        MutexLock(&set->lock);
+        if (generation == set->generation)
+            BrokerUpdate(&set->brokers[index], ok, ok ? rttMs : BROKER_NO_RTT, GetMonotonicTimeMs());
+    }
+    MutexUnlock(&set->lock);
+
+    for (int i = 0; i < BROKER_MAX; i++)
+        MqttDisconnect(&probes[i]);
+}
+
+// Starts the probe worker, returns 0 if it could not be started. The brokers are only used by the daemon's own
+// publishes then.
+int BrokerSetStart(BROKER_SET* set, RESOLVER* resolver)
+{
+    memset(set, 0, sizeof(*set));
+    set->active   = -1;
+    set->resolver = resolver;
+    MutexInit(&set->lock);
+    CondInit(&set->cond);
+    set->running = ThreadStart(&set->thread, BrokerProbeWorker, set);
+    return set->running;
+}
+
+void BrokerSetStop(BROKER_SET* set)
+{
+    if (set->running) {
+        MutexLock(&set->lock);
+        set->stop = 1;
+        CondSignal(&set->cond);
+        MutexUnlock(&set->lock);
+        ThreadJoin(&set->thread);
+        set->running = 0;
+    }
+    CondDestroy(&set->cond);
+    MutexDestroy(&set->lock);
+}
+
+// Takes a new broker list, hosts separated by commas, the first one is preferred while the RTTs are unknown.
+// probing is 0 for TLS brokers.
+void BrokerSetConfigure(BROKER_SET* set, const char* hosts, const char* port, const char* user, const char* password, int probing)
+{
+    uint64 now = GetMonotonicTimeMs();
+
+    MutexLock(&set->lock);
+    set->count  = 0;
+    set->active = -1;
+    while (*hosts != '\0' && set->count < BROKER_MAX) {
+        size_t  len = strcspn(hosts, ",");
+        BROKER* broker;
+
+        // surrounding blanks are not part of the name
+        while (len > 0 && (*hosts == ' ' || *hosts == '\t')) {
+            hosts++;
+            len--;
+        }
+        while (len > 0 && (hosts[len - 1] == ' ' || hosts[len - 1] == '\t'))
+            len--;
+        if (len > 0 && len < sizeof(broker->host)) {
+            broker = &set->brokers[set->count++];
+            memset(broker, 0, sizeof(*broker));
+            memcpy(broker->host, hosts, len);
+            broker->healthy     = 1;
+            broker->rttMs       = BROKER_NO_RTT;
+            broker->backoffMs   = BROKER_PROBE_MS;
+            broker->nextProbeMs = now;
+        }
+        hosts += len;
+        hosts += strspn(hosts, " \t");
+        if (*hosts == ',')
+            hosts++;
+    }
+    snprintf(set->port, sizeof(set->port), "%s", port);
+    snprintf(set->user, sizeof(set->user), "%s", user);
+    snprintf(set->password, sizeof(set->password), "%s", password);
+    set->probing = probing;
+    set->generation++;
+    CondSignal(&set->cond);
+    MutexUnlock(&set->lock);
+}
+
+// Returns the broker to publish to and copies its name, -1 if the list is empty. The active broker is kept while it
+// is healthy, unless a standby is clearly faster. Without any healthy broker the list is tried round robin.
+int BrokerSetSelect(BROKER_SET* set, char* host, size_t hostSize)
+{
+    int best   = -1;
+    int choose = -1;
+
+    MutexLock(&set->lock);
+    for (int i = 0; i < set->count; i++) {
+        const BROKER* broker = &set->brokers[i];
+
+        if (!broker->healthy)
+            continue;
+        // known RTTs win over unknown ones, ties keep the order of the list
+        if (best < 0 || (broker->rttMs != BROKER_NO_RTT && (set->brokers[best].rttMs == BROKER_NO_RTT || broker->rttMs < set->brokers[best].rttMs)))
+            best = i;
+    }
+    if (set->active >= 0 && set->brokers[set->active].healthy) {
+        const BROKER* active = &set->brokers[set->active];
+        const BROKER* other  = best >= 0 ? &set->brokers[best] : NULL;
+
+        choose = set->active;
+        if (other != NULL && other != active && other->rttMs != BROKER_NO_RTT && active->rttMs != BROKER_NO_RTT
+            && other->rttMs * 100 < active->rttMs * BROKER_SWITCH_PCT && other->rttMs + BROKER_SWITCH_MIN_MS <= active->rttMs)
+            choose = best;
+    } else if (best >= 0) {
+        choose = best;
+    } else if (set->count > 0) {
+        choose = (set->active + 1) % set->count;
+    }
+    if (choose != set->active) {
+        if (set->active >= 0) {
+            set->failovers++;
+            printf("lh2mqttd: switching from %s to %s\n", set->brokers[set->active].host, set->brokers[choose].host);
+        }
+        set->active = choose;
+        CondSignal(&set->cond);
+    }
+    if (choose >= 0)
+        snprintf(host, hostSize, "%s", set->brokers[choose].host);
+    MutexUnlock(&set->lock);
+    return choose;
+}
+
+// Result of the daemon's own connect, ping or publish on a broker, rttMs is BROKER_NO_RTT without a sample
+void BrokerSetReport(BROKER_SET* set, int index, int ok, uint64 rttMs)
+{
+    MutexLock(&set->lock);
+    if (index >= 0 && index < set->count)
+        BrokerUpdate(&set->brokers[index], ok, rttMs, GetMonotonicTimeMs());
+    MutexUnlock(&set->lock);
+}
+
+void BrokerSetGetStats(BROKER_SET* set, BROKER_STATS* stats)
+{
+    MutexLock(&set->lock);
+    stats->count     = set->count;
+    stats->active    = set->active;
+    stats->failovers = set->failovers;
+    for (int i = 0; i < set->count; i++) {
+        stats->healthy[i] = set->brokers[i].healthy;
+        stats->rttMs[i]   = set->brokers[i].rttMs;
+    }
+    MutexUnlock(&set->lock);
+}
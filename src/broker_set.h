@@ -0,0 +1,68 @@
+#ifndef BROKER_SET_H
+#define BROKER_SET_H
+
+#include "platform.h"
+#include "mqtt_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BROKER_MAX           4
+#define BROKER_PROBE_MS      15000  // RTT probe interval, a quarter of the keepalive
+#define BROKER_RETRY_MAX_MS  120000 // unreachable brokers are probed less often, up to this interval
+#define BROKER_SWITCH_PCT    50     // a standby takes over once its RTT is below this share of the active RTT
+#define BROKER_SWITCH_MIN_MS 10     // ... and at least this much lower, so jitter does not flip the brokers
+#define BROKER_NO_RTT        ((uint64)-1)
+
+typedef struct {
+    char         host[128];
+    int          healthy; // last probe, connect or publish succeeded
+    uint64       rttMs;   // smoothed PINGREQ round trip, BROKER_NO_RTT = no sample yet
+    uint64       nextProbeMs;
+    uint64       backoffMs;
+    unsigned int failures;
+} BROKER;
+
+// The brokers of HOST (comma separated). The daemon publishes to the active one, the probe worker keeps a
+// connection to every other broker and pings it, so a failover does not wait for a connect timeout and a faster
+// broker is preferred once it is known to be healthy. TLS brokers (CAFILE) are sent with mosquitto_pub, they are not
+// probed and only fail over when publishing fails.
+typedef struct {
+    BROKER          brokers[BROKER_MAX];
+    int             count;
+    int             active; // -1 = not chosen yet
+    unsigned int    failovers;
+    char            port[16];
+    char            user[128];
+    char            password[128];
+    int             probing;
+    unsigned int    generation; // changed by BrokerSetConfigure, probes of the old list are discarded
+    RESOLVER*       resolver;
+    PLATFORM_THREAD thread;
+    PLATFORM_MUTEX  lock;
+    PLATFORM_COND   cond;
+    int             running;
+    int             stop;
+} BROKER_SET;
+
+typedef struct {
+    int          count;
+    int          active;
+    unsigned int failovers;
+    int          healthy[BROKER_MAX];
+    uint64       rttMs[BROKER_MAX]; // BROKER_NO_RTT = no sample yet
+} BROKER_STATS;
+
+int  BrokerSetStart(BROKER_SET* set, RESOLVER* resolver);
+void BrokerSetStop(BROKER_SET* set);
+void BrokerSetConfigure(BROKER_SET* set, const char* hosts, const char* port, const char* user, const char* password, int probing);
+int  BrokerSetSelect(BROKER_SET* set, char* host, size_t hostSize);
+void BrokerSetReport(BROKER_SET* set, int index, int ok, uint64 rttMs);
+void BrokerSetGetStats(BROKER_SET* set, BROKER_STATS* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BROKER_SET_H
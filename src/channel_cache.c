@@ -0,0 +1,241 @@
+#include "channel_cache.h"
+#include "slab.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHANNEL_CACHE_MIN_CAPACITY 64
+
+static unsigned int ChannelCacheHash(uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    uint64 key = (serverConnectionHandlerID << 32) ^ channelID;
+
+    // 64 bit finalizer (splitmix64)
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (unsigned int)key;
+}
+
+static CHANNEL_CACHE_ENTRY* ChannelCacheFind(const CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    if (cache->capacity == 0 || channelID == 0)
+        return NULL;
+
+    unsigned int mask = cache->capacity - 1;
+    unsigned int i    = ChannelCacheHash(serverConnectionHandlerID, channelID) & mask;
+
+    for (;;) {
+        CHANNEL_CACHE_ENTRY* e = &cache->entries[i];
+        if (e->channelID == 0 && !e->deleted)
+            return NULL;
+        if (e->channelID == channelID && e->serverConnectionHandlerID == serverConnectionHandlerID)
+            return e;
+        i = (i + 1) & mask;
+    }
+}
+
+static void ChannelCacheResize(CHANNEL_CACHE* cache, unsigned int capacity)
+{
+    CHANNEL_CACHE_ENTRY* old         = cache->entries;
+    unsigned int         oldCapacity = cache->capacity;
+
+    cache->entries    = (CHANNEL_CACHE_ENTRY*)calloc(capacity, sizeof(CHANNEL_CACHE_ENTRY));
+    cache->capacity   = capacity;
+    cache->count      = 0;
+    cache->tombstones = 0;
+
+    if (cache->entries == NULL) {
+        // keep the old table, it is still consistent
+        cache->entries  = old;
+        cache->capacity = oldCapacity;
+        for (unsigned int i = 0; i < oldCapacity; i++) {
+            if (old[i].channelID != 0)
+                cache->count++;
+            else if (old[i].deleted)
+                cache->tombstones++;
+        }
+        return;
+    }
+
+    for (unsigned int i = 0; i < oldCapacity; i++) {
+        if (old[i].channelID == 0)
+            continue;
+
+        unsigned int mask = capacity - 1;
+        unsigned int j    = ChannelCacheHash(old[i].serverConnectionHandlerID, old[i].channelID) & mask;
+        while (cache->entries[j].channelID != 0)
+            j = (j + 1) & mask;
+        cache->entries[j] = old[i];
+        cache->count++;
+    }
+    free(old);
+}
+
+void ChannelCacheInit(CHANNEL_CACHE* cache)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->generation = 1;
+}
+
+void ChannelCacheFree(CHANNEL_CACHE* cache)
+{
+    for (unsigned int i = 0; i < cache->capacity; i++)
+        SlabFree(cache->entries[i].path);
+    free(cache->entries);
+    ChannelCacheInit(cache);
+}
+
+// Inserts or updates a channel, e.g. on connect or from onNewChannelEvent
+void ChannelCacheSet(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID, uint64 parentID, const char* name)
+{
+    CHANNEL_CACHE_ENTRY* e = ChannelCacheFind(cache, serverConnectionHandlerID, channelID);
+
+    if (channelID == 0)
+        return;
+
+    if (e != NULL) {
+        if (e->parentID != parentID || strcmp(e->name, name) != 0) {
+            e->parentID = parentID;
+            snprintf(e->name, sizeof(e->name), "%s", name);
+            cache->generation++; // paths of all sub channels are stale now
+        }
+        return;
+    }
+
+    if ((cache->count + cache->tombstones + 1) * 4 > cache->capacity * 3) {
+        unsigned int capacity = cache->capacity ? cache->capacity : CHANNEL_CACHE_MIN_CAPACITY;
+        while ((cache->count + 1) * 2 > capacity)
+            capacity *= 2;
+        ChannelCacheResize(cache, capacity);
+        if (cache->capacity == 0 || (cache->count + cache->tombstones + 1) >= cache->capacity)
+            return; // out of memory
+    }
+
+    unsigned int mask = cache->capacity - 1;
+    unsigned int i    = ChannelCacheHash(serverConnectionHandlerID, channelID) & mask;
+    while (cache->entries[i].channelID != 0)
+        i = (i + 1) & mask;
+
+    e = &cache->entries[i];
+    if (e->deleted)
+        cache->tombstones--;
+    memset(e, 0, sizeof(*e));
+    e->serverConnectionHandlerID = serverConnectionHandlerID;
+    e->channelID                 = channelID;
+    e->parentID                  = parentID;
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    cache->count++;
+}
+
+// Returns 0 if the channel is not cached
+int ChannelCacheMove(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID, uint64 newParentID)
+{
+    CHANNEL_CACHE_ENTRY* e = ChannelCacheFind(cache, serverConnectionHandlerID, channelID);
+
+    if (e == NULL)
+        return 0;
+    if (e->parentID != newParentID) {
+        e->parentID = newParentID;
+        cache->generation++;
+    }
+    return 1;
+}
+
+// Returns 0 if the channel is not cached
+int ChannelCacheRename(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID, const char* name)
+{
+    CHANNEL_CACHE_ENTRY* e = ChannelCacheFind(cache, serverConnectionHandlerID, channelID);
+
+    if (e == NULL)
+        return 0;
+    if (strcmp(e->name, name) != 0) {
+        snprintf(e->name, sizeof(e->name), "%s", name);
+        cache->generation++;
+    }
+    return 1;
+}
+
+static void ChannelCacheRemoveEntry(CHANNEL_CACHE* cache, CHANNEL_CACHE_ENTRY* e)
+{
+    SlabFree(e->path);
+    memset(e, 0, sizeof(*e));
+    e->deleted = 1;
+    cache->count--;
+    cache->tombstones++;
+}
+
+void ChannelCacheRemove(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    CHANNEL_CACHE_ENTRY* e = ChannelCacheFind(cache, serverConnectionHandlerID, channelID);
+
+    if (e != NULL)
+        ChannelCacheRemoveEntry(cache, e);
+}
+
+int ChannelCacheContains(const CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    return ChannelCacheFind(cache, serverConnectionHandlerID, channelID) != NULL;
+}
+
+// Returns the first channel on the way up to the root which is not cached yet, 0 if the complete chain is cached
+uint64 ChannelCacheFirstMissing(const CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    for (int depth = 0; channelID != 0 && depth < CHANNEL_MAX_DEPTH; depth++) {
+        const CHANNEL_CACHE_ENTRY* e = ChannelCacheFind(cache, serverConnectionHandlerID, channelID);
+        if (e == NULL)
+            return channelID;
+        channelID = e->parentID;
+    }
+    return 0;
+}
+
+// Returns the full channel path, NULL if the channel or one of its parents is not cached.
+// The path is built once by walking the cached parents and stays valid until a channel is renamed or moved,
+// so repeated lookups are a single hash probe regardless of the tree depth.
+const char* ChannelCacheGetPath(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    CHANNEL_CACHE_ENTRY* e = ChannelCacheFind(cache, serverConnectionHandlerID, channelID);
+    CHANNEL_CACHE_ENTRY* chain[CHANNEL_MAX_DEPTH];
+    char                 path[CHANNEL_PATH_LEN];
+    size_t               len   = 0;
+    int                  depth = 0;
+
+    if (e == NULL)
+        return NULL;
+    if (e->path != NULL && e->pathGeneration == cache->generation)
+        return e->path;
+
+    for (CHANNEL_CACHE_ENTRY* p = e; p != NULL; depth++) {
+        if (depth == CHANNEL_MAX_DEPTH)
+            return NULL;
+        chain[depth] = p;
+        if (p->parentID == 0)
+            break;
+        p = ChannelCacheFind(cache, serverConnectionHandlerID, p->parentID);
+        if (p == NULL)
+            return NULL;
+    }
+
+    path[0] = '\0';
+    while (depth >= 0) {
+        int n = snprintf(path + len, sizeof(path) - len, "%s%s", len > 0 ? "/" : "", chain[depth]->name);
+        if (n < 0 || (size_t)n >= sizeof(path) - len) {
+            path[len] = '\0'; // path too long, cut off at the last complete channel name
+            break;
+        }
+        len += (size_t)n;
+        depth--;
+    }
+
+    SlabFree(e->path);
+    e->path = (char*)SlabAlloc(len + 1);
+    if (e->path == NULL)
+        return NULL;
+    memcpy(e->path, path, len + 1);
+    e->pathGeneration = cache->generation;
+    return e->path;
+}
@@ -0,0 +1,46 @@
+#ifndef CHANNEL_CACHE_H
+#define CHANNEL_CACHE_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHANNEL_NAME_LEN  (TS3_MAX_SIZE_CHANNEL_NAME * 4 + 1) // channel name in UTF-8
+#define CHANNEL_PATH_LEN  1024
+#define CHANNEL_MAX_DEPTH 64 // guards against parent loops while walking the tree
+
+typedef struct {
+    uint64       serverConnectionHandlerID;
+    uint64       channelID; // 0 = empty slot
+    uint64       parentID;  // 0 = root channel
+    char         name[CHANNEL_NAME_LEN];
+    char*        path;           // full path like "Lobby/Ops/Night", built on first lookup
+    unsigned int pathGeneration; // path is valid while equal to cache generation
+    int          deleted;        // tombstone for open addressing
+} CHANNEL_CACHE_ENTRY;
+
+typedef struct {
+    CHANNEL_CACHE_ENTRY* entries;
+    unsigned int         capacity; // power of two
+    unsigned int         count;
+    unsigned int         tombstones;
+    unsigned int         generation; // bumped when a rename or move invalidates stored paths
+} CHANNEL_CACHE;
+
+void        ChannelCacheInit(CHANNEL_CACHE* cache);
+void        ChannelCacheFree(CHANNEL_CACHE* cache);
+void        ChannelCacheSet(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID, uint64 parentID, const char* name);
+int         ChannelCacheMove(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID, uint64 newParentID);
+int         ChannelCacheRename(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID, const char* name);
+void        ChannelCacheRemove(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID);
+int         ChannelCacheContains(const CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID);
+uint64      ChannelCacheFirstMissing(const CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID);
+const char* ChannelCacheGetPath(CHANNEL_CACHE* cache, uint64 serverConnectionHandlerID, uint64 channelID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHANNEL_CACHE_H
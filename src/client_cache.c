@@ -0,0 +1,249 @@
+#include "client_cache.h"
+
+#include <string.h>
+
+static unsigned int ClientCacheHash(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    uint64 key = (serverConnectionHandlerID << 16) ^ clientID;
+
+    // 64 bit finalizer (splitmix64), spreads consecutive client IDs over all buckets
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (unsigned int)(key & (CLIENT_CACHE_BUCKETS - 1));
+}
+
+static void LruUnlink(CLIENT_CACHE* cache, int idx)
+{
+    CLIENT_CACHE_ENTRY* e = &cache->entries[idx];
+
+    if (e->lruPrev != CLIENT_CACHE_NONE)
+        cache->entries[e->lruPrev].lruNext = e->lruNext;
+    else
+        cache->lruHead = e->lruNext;
+
+    if (e->lruNext != CLIENT_CACHE_NONE)
+        cache->entries[e->lruNext].lruPrev = e->lruPrev;
+    else
+        cache->lruTail = e->lruPrev;
+
+    e->lruPrev = e->lruNext = CLIENT_CACHE_NONE;
+}
+
+static void LruPushFront(CLIENT_CACHE* cache, int idx)
+{
+    CLIENT_CACHE_ENTRY* e = &cache->entries[idx];
+
+    e->lruPrev = CLIENT_CACHE_NONE;
+    e->lruNext = cache->lruHead;
+    if (cache->lruHead != CLIENT_CACHE_NONE)
+        cache->entries[cache->lruHead].lruPrev = idx;
+    cache->lruHead = idx;
+    if (cache->lruTail == CLIENT_CACHE_NONE)
+        cache->lruTail = idx;
+}
+
+// Removes entry from its hash chain and LRU list and puts it back on the free list
+static void ClientCacheRemoveIndex(CLIENT_CACHE* cache, int idx)
+{
+    CLIENT_CACHE_ENTRY* e      = &cache->entries[idx];
+    unsigned int        bucket = ClientCacheHash(e->serverConnectionHandlerID, e->clientID);
+    int*                link   = &cache->buckets[bucket];
+
+    while (*link != CLIENT_CACHE_NONE && *link != idx)
+        link = &cache->entries[*link].hashNext;
+    if (*link == idx)
+        *link = e->hashNext;
+
+    LruUnlink(cache, idx);
+    ClientCacheReleaseEntry(cache->strings, e);
+
+    e->used         = 0;
+    e->hashNext     = cache->freeList;
+    cache->freeList = idx;
+    cache->count--;
+}
+
+static int ClientCacheFindIndex(const CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID)
+{
+    int idx = cache->buckets[ClientCacheHash(serverConnectionHandlerID, clientID)];
+
+    while (idx != CLIENT_CACHE_NONE) {
+        const CLIENT_CACHE_ENTRY* e = &cache->entries[idx];
+        if (e->clientID == clientID && e->serverConnectionHandlerID == serverConnectionHandlerID)
+            return idx;
+        idx = e->hashNext;
+    }
+    return CLIENT_CACHE_NONE;
+}
+
+void ClientCacheInit(CLIENT_CACHE* cache, STRING_POOL* strings)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->strings = strings;
+
+    for (int i = 0; i < CLIENT_CACHE_BUCKETS; i++)
+        cache->buckets[i] = CLIENT_CACHE_NONE;
+
+    // chain all entries into the free list
+    for (int i = 0; i < CLIENT_CACHE_CAPACITY; i++) {
+        cache->entries[i].hashNext = (i + 1 < CLIENT_CACHE_CAPACITY) ? i + 1 : CLIENT_CACHE_NONE;
+        cache->entries[i].lruPrev  = CLIENT_CACHE_NONE;
+        cache->entries[i].lruNext  = CLIENT_CACHE_NONE;
+    }
+    cache->freeList = 0;
+    cache->lruHead  = CLIENT_CACHE_NONE;
+    cache->lruTail  = CLIENT_CACHE_NONE;
+}
+
+// Drops the string references of all cached clients
+void ClientCacheFree(CLIENT_CACHE* cache)
+{
+    for (int i = 0; i < CLIENT_CACHE_CAPACITY; i++) {
+        if (cache->entries[i].used)
+            ClientCacheReleaseEntry(cache->strings, &cache->entries[i]);
+    }
+    ClientCacheInit(cache, cache->strings);
+}
+
+// Returns the cached entry and marks it as most recently used, NULL if client is not cached
+CLIENT_CACHE_ENTRY* ClientCacheLookup(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID)
+{
+    int idx = ClientCacheFindIndex(cache, serverConnectionHandlerID, clientID);
+
+    if (idx == CLIENT_CACHE_NONE) {
+        cache->misses++;
+        return NULL;
+    }
+
+    if (cache->lruHead != idx) {
+        LruUnlink(cache, idx);
+        LruPushFront(cache, idx);
+    }
+    cache->hits++;
+    return &cache->entries[idx];
+}
+
+// Returns the cached entry without touching the LRU order or the hit counters, e.g. for updates from events
+CLIENT_CACHE_ENTRY* ClientCacheFind(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID)
+{
+    int idx = ClientCacheFindIndex(cache, serverConnectionHandlerID, clientID);
+
+    return idx != CLIENT_CACHE_NONE ? &cache->entries[idx] : NULL;
+}
+
+// Returns a cleared entry for the given client, evicting the least recently used one if the cache is full.
+// An already existing entry for the client is cleared and reused.
+CLIENT_CACHE_ENTRY* ClientCacheInsert(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID)
+{
+    unsigned int bucket = ClientCacheHash(serverConnectionHandlerID, clientID);
+    int          idx;
+
+    ClientCacheInvalidate(cache, serverConnectionHandlerID, clientID);
+
+    if (cache->freeList == CLIENT_CACHE_NONE) {
+        ClientCacheRemoveIndex(cache, cache->lruTail);
+        cache->evictions++;
+    }
+
+    idx             = cache->freeList;
+    cache->freeList = cache->entries[idx].hashNext;
+
+    CLIENT_CACHE_ENTRY* e = &cache->entries[idx];
+    memset(e, 0, sizeof(*e));
+    e->serverConnectionHandlerID = serverConnectionHandlerID;
+    e->clientID                  = clientID;
+    e->used                      = 1;
+    e->hashNext                  = cache->buckets[bucket];
+    cache->buckets[bucket]       = idx;
+    LruPushFront(cache, idx);
+    cache->count++;
+
+    return e;
+}
+
+// Stores a completely filled client record, e.g. collected by the connect snapshot, replacing an existing entry.
+// The cache takes its own string references, the caller still has to release those of data.
+CLIENT_CACHE_ENTRY* ClientCacheStore(CLIENT_CACHE* cache, const CLIENT_CACHE_ENTRY* data)
+{
+    CLIENT_CACHE_ENTRY* e        = ClientCacheInsert(cache, data->serverConnectionHandlerID, data->clientID);
+    int                 hashNext = e->hashNext;
+    int                 lruPrev  = e->lruPrev;
+    int                 lruNext  = e->lruNext;
+
+    *e          = *data;
+    e->hashNext = hashNext;
+    e->lruPrev  = lruPrev;
+    e->lruNext  = lruNext;
+    e->used     = 1;
+
+    StringPoolRetain(cache->strings, e->name);
+    StringPoolRetain(cache->strings, e->nameAnonymized);
+    StringPoolRetain(cache->strings, e->uniqueIdentifier);
+    return e;
+}
+
+void ClientCacheInvalidate(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID)
+{
+    int idx = ClientCacheFindIndex(cache, serverConnectionHandlerID, clientID);
+
+    if (idx != CLIENT_CACHE_NONE)
+        ClientCacheRemoveIndex(cache, idx);
+}
+
+// Keeps the channel of a cached client up to date, newChannelID 0 means the client left the server
+void ClientCacheUpdateChannel(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID)
+{
+    int idx = ClientCacheFindIndex(cache, serverConnectionHandlerID, clientID);
+
+    if (idx == CLIENT_CACHE_NONE)
+        return;
+
+    if (newChannelID == 0)
+        ClientCacheRemoveIndex(cache, idx);
+    else
+        cache->entries[idx].channelID = newChannelID;
+}
+
+void ClientCacheAddServerGroup(CLIENT_CACHE_ENTRY* entry, uint64 serverGroupID)
+{
+    for (int i = 0; i < entry->serverGroupCount; i++) {
+        if (entry->serverGroups[i] == serverGroupID)
+            return;
+    }
+    if (entry->serverGroupCount < CLIENT_MAX_SERVER_GROUPS)
+        entry->serverGroups[entry->serverGroupCount++] = serverGroupID;
+}
+
+void ClientCacheRemoveServerGroup(CLIENT_CACHE_ENTRY* entry, uint64 serverGroupID)
+{
+    for (int i = 0; i < entry->serverGroupCount; i++) {
+        if (entry->serverGroups[i] == serverGroupID) {
+            entry->serverGroups[i] = entry->serverGroups[--entry->serverGroupCount];
+            return;
+        }
+    }
+}
+
+// Drops the string references of a client record, e.g. a temporary one filled from the client lib
+void ClientCacheReleaseEntry(STRING_POOL* strings, CLIENT_CACHE_ENTRY* entry)
+{
+    StringPoolRelease(strings, entry->name);
+    StringPoolRelease(strings, entry->nameAnonymized);
+    StringPoolRelease(strings, entry->uniqueIdentifier);
+    entry->name             = STRING_HANDLE_NONE;
+    entry->nameAnonymized   = STRING_HANDLE_NONE;
+    entry->uniqueIdentifier = STRING_HANDLE_NONE;
+}
+
+// Server group answers (onServerGroupByClientIDEvent) only carry the database ID, which may belong to several connected clients
+void ClientCacheAddServerGroupByDatabaseID(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, uint64 databaseID, uint64 serverGroupID)
+{
+    for (int i = 0; i < CLIENT_CACHE_CAPACITY; i++) {
+        CLIENT_CACHE_ENTRY* e = &cache->entries[i];
+        if (e->used && e->serverConnectionHandlerID == serverConnectionHandlerID && e->databaseID == databaseID)
+            ClientCacheAddServerGroup(e, serverGroupID);
+    }
+}
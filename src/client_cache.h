@@ -0,0 +1,71 @@
+#ifndef CLIENT_CACHE_H
+#define CLIENT_CACHE_H
+
+#include "teamspeak/public_definitions.h"
+#include "string_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Upper bound of cached clients, oldest (least recently used) entries are evicted first
+#define CLIENT_CACHE_CAPACITY 512
+#define CLIENT_CACHE_BUCKETS  1024 // power of two, >= CLIENT_CACHE_CAPACITY
+
+#define CLIENT_NAME_LEN (TS3_MAX_SIZE_CLIENT_NICKNAME * 4 + 1) // nickname in UTF-8, for buffers when reading it
+
+#define CLIENT_MAX_SERVER_GROUPS 16
+
+#define CLIENT_CACHE_NONE (-1)
+
+typedef struct {
+    uint64 serverConnectionHandlerID;
+    anyID  clientID;
+    uint64        channelID;
+    STRING_HANDLE name; // strings are interned, an entry holds one reference per handle
+    STRING_HANDLE nameAnonymized;
+    STRING_HANDLE uniqueIdentifier;
+    uint64        databaseID;
+    uint64        serverGroups[CLIENT_MAX_SERVER_GROUPS];
+    int           serverGroupCount;
+    uint64        channelGroupID;
+
+    // internal: hash chain and LRU list, stored as indices into the entry array
+    int hashNext;
+    int lruPrev;
+    int lruNext;
+    int used;
+} CLIENT_CACHE_ENTRY;
+
+typedef struct {
+    CLIENT_CACHE_ENTRY entries[CLIENT_CACHE_CAPACITY];
+    int                buckets[CLIENT_CACHE_BUCKETS];
+    int                lruHead; // most recently used
+    int                lruTail; // least recently used, next to be evicted
+    int                freeList;
+    int                count;
+    STRING_POOL*       strings;
+
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+} CLIENT_CACHE;
+
+void                ClientCacheInit(CLIENT_CACHE* cache, STRING_POOL* strings);
+void                ClientCacheFree(CLIENT_CACHE* cache);
+CLIENT_CACHE_ENTRY* ClientCacheLookup(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID);
+CLIENT_CACHE_ENTRY* ClientCacheFind(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID);
+CLIENT_CACHE_ENTRY* ClientCacheInsert(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID);
+CLIENT_CACHE_ENTRY* ClientCacheStore(CLIENT_CACHE* cache, const CLIENT_CACHE_ENTRY* data);
+void                ClientCacheInvalidate(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID);
+void                ClientCacheUpdateChannel(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID);
+void                ClientCacheAddServerGroup(CLIENT_CACHE_ENTRY* entry, uint64 serverGroupID);
+void                ClientCacheRemoveServerGroup(CLIENT_CACHE_ENTRY* entry, uint64 serverGroupID);
+void                ClientCacheReleaseEntry(STRING_POOL* strings, CLIENT_CACHE_ENTRY* entry);
+void                ClientCacheAddServerGroupByDatabaseID(CLIENT_CACHE* cache, uint64 serverConnectionHandlerID, uint64 databaseID, uint64 serverGroupID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CLIENT_CACHE_H
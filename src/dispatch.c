@@ -0,0 +1,180 @@
+#include "dispatch.h"
+#include "slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int DispatchLaneOf(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    uint64 key = (serverConnectionHandlerID << 16) ^ clientID;
+
+    // 64 bit finalizer (splitmix64), like the talk session table
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (unsigned int)(key % DISPATCH_LANES);
+}
+
+static void DispatchWorker(void* arg)
+{
+    DISPATCH_LANE* lane = (DISPATCH_LANE*)arg;
+
+    MutexLock(&lane->lock);
+    for (;;) {
+        DISPATCH_JOB job;
+        uint64       wait;
+
+        while (lane->count == 0 && !lane->stop)
+            CondWait(&lane->cond, &lane->lock);
+        // queued jobs are still run when stopping, unless the deadline passed
+        if (lane->count == 0 || (lane->stop && lane->deadlineMs != 0 && GetMonotonicTimeMs() >= lane->deadlineMs))
+            break;
+
+        job        = lane->jobs[lane->head];
+        lane->head = (lane->head + 1) % DISPATCH_LANE_LEN;
+        lane->count--;
+
+        wait = GetMonotonicTimeMs() - job.queuedMs;
+        lane->waitSumMs += wait;
+        if (wait > lane->waitMaxMs)
+            lane->waitMaxMs = wait;
+        MutexUnlock(&lane->lock);
+
+        if (!lane->func(job.command, job.topic, job.message, job.serverConnectionHandlerID)) {
+            // aborted at the deadline, back to the front of the queue so it is spilled with the rest
+            MutexLock(&lane->lock);
+            if (lane->count < DISPATCH_LANE_LEN) {
+                lane->head             = (lane->head + DISPATCH_LANE_LEN - 1) % DISPATCH_LANE_LEN;
+                lane->jobs[lane->head] = job;
+                lane->count++;
+            } else {
+                lane->dropped++;
+                SlabFree(job.command);
+            }
+            break;
+        }
+        SlabFree(job.command);
+
+        MutexLock(&lane->lock);
+        lane->done++;
+        LatencyRecord(&lane->latency, GetMonotonicTimeMs() - job.queuedMs);
+    }
+    MutexUnlock(&lane->lock);
+    SlabThreadFlush();
+}
+
+// Starts one worker per lane, returns the number of running lanes.
+// Jobs of a lane whose worker could not be started are run directly by DispatchSubmit.
+int DispatchStart(DISPATCHER* dispatcher, DISPATCH_FUNC func)
+{
+    int started = 0;
+
+    memset(dispatcher, 0, sizeof(*dispatcher));
+
+    for (int i = 0; i < DISPATCH_LANE_COUNT; i++) {
+        DISPATCH_LANE* lane = &dispatcher->lanes[i];
+
+        MutexInit(&lane->lock);
+        CondInit(&lane->cond);
+        lane->func    = func;
+        lane->running = ThreadStart(&lane->thread, DispatchWorker, lane);
+        if (lane->running)
+            started++;
+    }
+    return started;
+}
+
+// Runs the queued jobs until deadlineMs (monotonic, 0 = no deadline), then ends the workers. Jobs which were not run
+// are handed to spill (may be NULL) in their queued order. The job running at the deadline must be aborted by func.
+void DispatchStop(DISPATCHER* dispatcher, uint64 deadlineMs, DISPATCH_SPILL_FUNC spill, void* arg)
+{
+    // all lanes drain in parallel
+    for (int i = 0; i < DISPATCH_LANE_COUNT; i++) {
+        DISPATCH_LANE* lane = &dispatcher->lanes[i];
+
+        if (lane->running) {
+            MutexLock(&lane->lock);
+            lane->stop       = 1;
+            lane->deadlineMs = deadlineMs;
+            CondSignal(&lane->cond);
+            MutexUnlock(&lane->lock);
+        }
+    }
+    for (int i = 0; i < DISPATCH_LANE_COUNT; i++) {
+        DISPATCH_LANE* lane = &dispatcher->lanes[i];
+
+        if (lane->running) {
+            ThreadJoin(&lane->thread);
+            lane->running = 0;
+        }
+        for (; lane->count > 0; lane->count--) {
+            DISPATCH_JOB* job = &lane->jobs[lane->head];
+            if (spill != NULL)
+                spill(job->topic, job->message, arg);
+            SlabFree(job->command);
+            lane->head = (lane->head + 1) % DISPATCH_LANE_LEN;
+        }
+        CondDestroy(&lane->cond);
+        MutexDestroy(&lane->lock);
+    }
+}
+
+// Queues a job on the lane of (server tab, client), clientID 0 for events of the server tab itself. With priority
+// set it goes to the priority lane. Returns 0 if the lane is full and the job was dropped.
+int DispatchSubmit(DISPATCHER* dispatcher, uint64 serverConnectionHandlerID, anyID clientID, int priority, const char* command, const char* topic, const char* message)
+{
+    DISPATCH_LANE* lane        = &dispatcher->lanes[priority ? DISPATCH_PRIORITY_LANE : DispatchLaneOf(serverConnectionHandlerID, clientID)];
+    size_t         commandSize = strlen(command) + 1;
+    size_t         topicSize   = strlen(topic) + 1;
+    size_t         messageSize = strlen(message) + 1;
+    DISPATCH_JOB   job;
+
+    if (!lane->running) {
+        lane->func(command, topic, message, serverConnectionHandlerID);
+        return 1;
+    }
+
+    job.serverConnectionHandlerID = serverConnectionHandlerID;
+    job.queuedMs                  = GetMonotonicTimeMs();
+    job.command                   = (char*)SlabAlloc(commandSize + topicSize + messageSize);
+    if (job.command == NULL)
+        return 0;
+    job.topic   = job.command + commandSize;
+    job.message = job.topic + topicSize;
+    memcpy(job.command, command, commandSize);
+    memcpy(job.topic, topic, topicSize);
+    memcpy(job.message, message, messageSize);
+
+    MutexLock(&lane->lock);
+    if (lane->count == DISPATCH_LANE_LEN) {
+        lane->dropped++;
+        MutexUnlock(&lane->lock);
+        SlabFree(job.command);
+        return 0;
+    }
+    lane->jobs[(lane->head + lane->count) % DISPATCH_LANE_LEN] = job;
+    lane->count++;
+    if (lane->count > lane->maxDepth)
+        lane->maxDepth = lane->count;
+    CondSignal(&lane->cond);
+    MutexUnlock(&lane->lock);
+    return 1;
+}
+
+void DispatchGetStats(DISPATCHER* dispatcher, int lane, DISPATCH_LANE_STATS* stats)
+{
+    DISPATCH_LANE* l = &dispatcher->lanes[lane];
+
+    MutexLock(&l->lock);
+    stats->depth      = l->count;
+    stats->maxDepth   = l->maxDepth;
+    stats->done       = l->done;
+    stats->dropped    = l->dropped;
+    stats->waitAvgMs  = l->done > 0 ? l->waitSumMs / l->done : 0;
+    stats->waitMaxMs  = l->waitMaxMs;
+    stats->headWaitMs = l->count > 0 ? GetMonotonicTimeMs() - l->jobs[l->head].queuedMs : 0;
+    stats->p99Ms      = LatencyPercentile(&l->latency, 99);
+    MutexUnlock(&l->lock);
+}
@@ -0,0 +1,78 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "platform.h"
+#include "latency.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISPATCH_LANES         4                    // worker threads running publishes in parallel
+#define DISPATCH_LANE_LEN      256                  // queued jobs per lane
+#define DISPATCH_PRIORITY_LANE DISPATCH_LANES       // extra lane for priority jobs, bulk jobs never queue there
+#define DISPATCH_LANE_COUNT    (DISPATCH_LANES + 1) // including the priority lane
+
+// Runs one job on a lane worker, the same signature as ExecuteCommandInBackground. Returns 0 if the job was aborted
+// because of the stop deadline, it is spilled then.
+typedef int (*DISPATCH_FUNC)(const char* command, const char* topic, const char* message, uint64 serverConnectionHandlerID);
+
+// Receives the jobs which were not run before the stop deadline
+typedef void (*DISPATCH_SPILL_FUNC)(const char* topic, const char* message, void* arg);
+
+typedef struct {
+    uint64 serverConnectionHandlerID;
+    uint64 queuedMs;
+    char*  command; // one allocation for command, topic and message
+    char*  topic;
+    char*  message;
+} DISPATCH_JOB;
+
+typedef struct {
+    PLATFORM_THREAD   thread;
+    PLATFORM_MUTEX    lock;
+    PLATFORM_COND     cond;
+    DISPATCH_FUNC     func;
+    int               running;
+    int               stop;
+    uint64            deadlineMs; // with stop, no job is started after this point, 0 = run all queued jobs
+    DISPATCH_JOB      jobs[DISPATCH_LANE_LEN]; // ring buffer
+    unsigned int      head;
+    unsigned int      count;
+
+    unsigned int      maxDepth;
+    uint64            done;
+    uint64            dropped;   // lane was full
+    uint64            waitSumMs; // head-of-line wait, from queueing until the worker picks the job
+    uint64            waitMaxMs;
+    LATENCY_HISTOGRAM latency; // from queueing until the job finished
+} DISPATCH_LANE;
+
+// Events of one key (server tab, client) always run on the same lane, in the order they were queued.
+// Different keys are spread over the lanes and run in parallel. Priority jobs run on a lane of their own, so they
+// never wait behind bulk jobs.
+typedef struct {
+    DISPATCH_LANE lanes[DISPATCH_LANE_COUNT];
+} DISPATCHER;
+
+typedef struct {
+    unsigned int depth;
+    unsigned int maxDepth;
+    uint64       done;
+    uint64       dropped;
+    uint64       waitAvgMs;
+    uint64       waitMaxMs;
+    uint64       headWaitMs; // how long the oldest queued job is waiting right now
+    uint64       p99Ms;      // queueing until finished, within a factor of two
+} DISPATCH_LANE_STATS;
+
+int  DispatchStart(DISPATCHER* dispatcher, DISPATCH_FUNC func);
+void DispatchStop(DISPATCHER* dispatcher, uint64 deadlineMs, DISPATCH_SPILL_FUNC spill, void* arg);
+int  DispatchSubmit(DISPATCHER* dispatcher, uint64 serverConnectionHandlerID, anyID clientID, int priority, const char* command, const char* topic, const char* message);
+void DispatchGetStats(DISPATCHER* dispatcher, int lane, DISPATCH_LANE_STATS* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISPATCH_H
@@ -0,0 +1,663 @@
+#include "event_loop.h"
+#include "slab.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EVENT_WHEEL_MASK (EVENT_WHEEL_SLOTS - 1)
+#define EVENT_WAIT_INFINITE ((uint64)-1)
+
+#ifndef _WIN32
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <sys/uio.h>
+
+#define EVENT_WAKE_TAG UINT32_MAX // epoll data of the eventfd, watches use their index
+#define EVENT_RING_ENTRIES 64     // at least EVENT_MAX_STREAMS, every stream has one writev in flight at most
+#endif
+
+// Hashed timer wheel: a timer hangs in the slot of its expiry tick, timers further away than one
+// revolution share the slot and are skipped until their tick has come. Insert and cancel are O(1).
+static void TimerLink(EVENT_TIMER** head, EVENT_TIMER* timer)
+{
+    timer->next = *head;
+    if (*head != NULL)
+        (*head)->pprev = &timer->next;
+    *head        = timer;
+    timer->pprev = head;
+}
+
+static void TimerUnlink(EVENT_TIMER* timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+    timer->next  = NULL;
+    timer->pprev = NULL;
+}
+
+// Takes a pending timer out of the wheel or out of the list of timers being fired
+static void TimerRemove(EVENT_LOOP* loop, EVENT_TIMER* timer)
+{
+    // fired timers have already left the count, they are the only ones not after the current tick
+    if (timer->expires > loop->tick)
+        loop->timerCount--;
+    TimerUnlink(timer);
+}
+
+static uint64 EventLoopCurrentTick(const EVENT_LOOP* loop)
+{
+    return (GetMonotonicTimeMs() - loop->startMs) / EVENT_TICK_MS;
+}
+
+// Fires all timers up to tick target, the lock is released while a callback runs
+static void EventLoopRunTimers(EVENT_LOOP* loop, uint64 target)
+{
+    uint64 t = loop->tick + 1;
+
+    // after a long sleep every slot is visited once, expires <= t still holds for all due timers
+    if (target - loop->tick > EVENT_WHEEL_SLOTS)
+        t = target - EVENT_WHEEL_SLOTS + 1;
+
+    for (; t <= target; t++) {
+        EVENT_TIMER* fired = NULL;
+        EVENT_TIMER* timer = loop->wheel[t & EVENT_WHEEL_MASK];
+
+        loop->tick = t;
+        while (timer != NULL) {
+            EVENT_TIMER* next = timer->next;
+            if (timer->expires <= t) {
+                TimerUnlink(timer);
+                loop->timerCount--;
+                // a timer cancelled by an earlier callback of this tick simply leaves the fired list
+                TimerLink(&fired, timer);
+            }
+            timer = next;
+        }
+
+        while (fired != NULL) {
+            EVENT_TIMER_FUNC func;
+            void*            arg;
+
+            timer = fired;
+            func  = timer->func;
+            arg   = timer->arg;
+            TimerUnlink(timer);
+
+            MutexUnlock(&loop->lock);
+            func(arg);
+            MutexLock(&loop->lock);
+        }
+    }
+    loop->tick = target;
+}
+
+// Milliseconds until the next timer is due, found by walking the wheel for at most one revolution
+static uint64 EventLoopNextTimeout(const EVENT_LOOP* loop)
+{
+    uint64 now = GetMonotonicTimeMs() - loop->startMs;
+    uint64 due;
+
+    if (loop->timerCount == 0)
+        return EVENT_WAIT_INFINITE;
+
+    due = loop->tick + EVENT_WHEEL_SLOTS;
+    for (uint64 t = loop->tick + 1; t <= loop->tick + EVENT_WHEEL_SLOTS; t++) {
+        const EVENT_TIMER* timer;
+        for (timer = loop->wheel[t & EVENT_WHEEL_MASK]; timer != NULL; timer = timer->next) {
+            if (timer->expires <= t)
+                break;
+        }
+        if (timer != NULL) {
+            due = t;
+            break;
+        }
+    }
+    return due * EVENT_TICK_MS > now ? due * EVENT_TICK_MS - now : 0;
+}
+
+void EventTimerInit(EVENT_TIMER* timer, EVENT_TIMER_FUNC func, void* arg)
+{
+    memset(timer, 0, sizeof(*timer));
+    timer->func = func;
+    timer->arg  = arg;
+}
+
+// (Re)starts the timer, it fires once after at least delayMs. May be called from any thread and from callbacks.
+void EventTimerStart(EVENT_LOOP* loop, EVENT_TIMER* timer, uint64 delayMs)
+{
+    uint64 ticks = (delayMs + EVENT_TICK_MS - 1) / EVENT_TICK_MS;
+
+    MutexLock(&loop->lock);
+    if (timer->pprev != NULL)
+        TimerRemove(loop, timer);
+    timer->expires = EventLoopCurrentTick(loop) + (ticks > 0 ? ticks : 1);
+    TimerLink(&loop->wheel[timer->expires & EVENT_WHEEL_MASK], timer);
+    loop->timerCount++;
+    MutexUnlock(&loop->lock);
+
+    EventLoopWake(loop);
+}
+
+// A callback which is already running is not waited for
+void EventTimerCancel(EVENT_LOOP* loop, EVENT_TIMER* timer)
+{
+    MutexLock(&loop->lock);
+    if (timer->pprev != NULL)
+        TimerRemove(loop, timer);
+    MutexUnlock(&loop->lock);
+}
+
+int EventTimerPending(EVENT_LOOP* loop, EVENT_TIMER* timer)
+{
+    int pending;
+
+    MutexLock(&loop->lock);
+    pending = timer->pprev != NULL;
+    MutexUnlock(&loop->lock);
+    return pending;
+}
+
+#ifdef _WIN32
+// -------------------- Windows --------------------
+
+static int EventLoopOpen(EVENT_LOOP* loop)
+{
+    loop->wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    return loop->wakeEvent != NULL;
+}
+
+static void EventLoopClose(EVENT_LOOP* loop)
+{
+    CloseHandle(loop->wakeEvent);
+    loop->wakeEvent = NULL;
+}
+
+static void EventLoopWait(EVENT_LOOP* loop, uint64 timeoutMs)
+{
+    WaitForSingleObject(loop->wakeEvent, timeoutMs < INFINITE ? (DWORD)timeoutMs : INFINITE);
+}
+
+void EventLoopWake(EVENT_LOOP* loop)
+{
+    if (loop->running)
+        SetEvent(loop->wakeEvent);
+}
+
+// No socket events on Windows yet, only timers are available there
+int EventLoopWatch(EVENT_LOOP* loop, int fd, unsigned int events, EVENT_IO_FUNC func, void* arg)
+{
+    (void)loop;
+    (void)fd;
+    (void)events;
+    (void)func;
+    (void)arg;
+    return 0;
+}
+
+void EventLoopUnwatch(EVENT_LOOP* loop, int fd)
+{
+    (void)loop;
+    (void)fd;
+}
+
+int EventLoopWrite(EVENT_LOOP* loop, int fd, const void* data, size_t size, EVENT_WRITE_FUNC func, void* arg)
+{
+    (void)loop;
+    (void)fd;
+    (void)data;
+    (void)size;
+    (void)func;
+    (void)arg;
+    return 0;
+}
+
+static int EventLoopProcessWrites(EVENT_LOOP* loop, EVENT_WRITE_REQ** done)
+{
+    (void)loop;
+    (void)done;
+    return 0;
+}
+
+static void EventStreamDrain(EVENT_LOOP* loop, EVENT_STREAM* stream, EVENT_WRITE_REQ** done)
+{
+    (void)loop;
+    (void)stream;
+    (void)done;
+}
+
+#else
+// -------------------- Linux / Unix --------------------
+
+static int EventLoopOpen(EVENT_LOOP* loop)
+{
+    struct epoll_event ev;
+
+    loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    loop->wakeFd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop->epollFd < 0 || loop->wakeFd < 0)
+        goto fail;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.u32 = EVENT_WAKE_TAG;
+    if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &ev) != 0)
+        goto fail;
+
+    // optional, without io_uring the writes fall back to writev() on the loop thread
+    IoRingInit(&loop->ring, EVENT_RING_ENTRIES, loop->wakeFd);
+    return 1;
+
+fail:
+    if (loop->epollFd >= 0)
+        close(loop->epollFd);
+    if (loop->wakeFd >= 0)
+        close(loop->wakeFd);
+    loop->epollFd = -1;
+    loop->wakeFd  = -1;
+    return 0;
+}
+
+static void EventLoopClose(EVENT_LOOP* loop)
+{
+    IoRingFree(&loop->ring);
+    close(loop->epollFd);
+    close(loop->wakeFd);
+    loop->epollFd = -1;
+    loop->wakeFd  = -1;
+}
+
+static void EventLoopWait(EVENT_LOOP* loop, uint64 timeoutMs)
+{
+    struct epoll_event evs[16];
+    int                n;
+
+    n = epoll_wait(loop->epollFd, evs, 16, timeoutMs == EVENT_WAIT_INFINITE ? -1 : (timeoutMs < 60000 ? (int)timeoutMs : 60000));
+    for (int i = 0; i < n; i++) {
+        EVENT_WATCH  watch;
+        unsigned int events = 0;
+
+        if (evs[i].data.u32 == EVENT_WAKE_TAG) {
+            uint64_t value;
+            while (read(loop->wakeFd, &value, sizeof(value)) == sizeof(value))
+                ;
+            continue;
+        }
+
+        // the watch may have been removed by another thread in the meantime
+        MutexLock(&loop->lock);
+        watch = loop->watches[evs[i].data.u32];
+        MutexUnlock(&loop->lock);
+        if (watch.fd < 0)
+            continue;
+
+        if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            events |= EVENT_READ;
+        if (evs[i].events & EPOLLOUT)
+            events |= EVENT_WRITE;
+        watch.func(watch.fd, events, watch.arg);
+    }
+}
+
+void EventLoopWake(EVENT_LOOP* loop)
+{
+    uint64_t one = 1;
+
+    // EAGAIN means the counter is full, so a wakeup is pending anyway
+    if (loop->running && write(loop->wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        printf("PLUGIN: ERROR: event loop wakeup failed: %d\n", errno);
+}
+
+// Calls func on the loop thread whenever fd is readable or writable (level triggered), returns 0 on error
+int EventLoopWatch(EVENT_LOOP* loop, int fd, unsigned int events, EVENT_IO_FUNC func, void* arg)
+{
+    struct epoll_event ev;
+    int                idx = -1;
+
+    MutexLock(&loop->lock);
+    for (int i = 0; i < EVENT_MAX_WATCHES; i++) {
+        if (loop->watches[i].fd < 0) {
+            idx = i;
+            break;
+        }
+    }
+    if (idx < 0 || !loop->running) {
+        MutexUnlock(&loop->lock);
+        return 0;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = ((events & EVENT_READ) ? EPOLLIN : 0) | ((events & EVENT_WRITE) ? EPOLLOUT : 0);
+    ev.data.u32 = (uint32_t)idx;
+    if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        MutexUnlock(&loop->lock);
+        return 0;
+    }
+    loop->watches[idx].fd     = fd;
+    loop->watches[idx].events = events;
+    loop->watches[idx].func   = func;
+    loop->watches[idx].arg    = arg;
+    MutexUnlock(&loop->lock);
+    return 1;
+}
+
+// Must be called before fd is closed
+void EventLoopUnwatch(EVENT_LOOP* loop, int fd)
+{
+    MutexLock(&loop->lock);
+    for (int i = 0; i < EVENT_MAX_WATCHES; i++) {
+        if (loop->watches[i].fd == fd) {
+            epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, fd, NULL);
+            loop->watches[i].fd = -1;
+            break;
+        }
+    }
+    MutexUnlock(&loop->lock);
+}
+
+// Queues a copy of data for fd, func (may be NULL) is called on the loop thread when it was written completely or failed.
+// Writes of one fd keep their order, fd must stay open until the last callback. Returns 0 on error.
+int EventLoopWrite(EVENT_LOOP* loop, int fd, const void* data, size_t size, EVENT_WRITE_FUNC func, void* arg)
+{
+    EVENT_WRITE_REQ* w      = (EVENT_WRITE_REQ*)SlabAlloc(sizeof(EVENT_WRITE_REQ) + size);
+    EVENT_STREAM*    stream = NULL;
+
+    if (w == NULL)
+        return 0;
+    memset(w, 0, sizeof(*w));
+    w->func = func;
+    w->arg  = arg;
+    w->fd   = fd;
+    w->size = size;
+    w->data = (char*)(w + 1);
+    memcpy(w->data, data, size);
+
+    MutexLock(&loop->lock);
+    for (int i = 0; i < EVENT_MAX_STREAMS && loop->running && !loop->stop; i++) {
+        if (loop->streams[i].fd == fd) {
+            stream = &loop->streams[i];
+            break;
+        }
+        if (stream == NULL && loop->streams[i].fd < 0)
+            stream = &loop->streams[i];
+    }
+    if (stream == NULL) {
+        MutexUnlock(&loop->lock);
+        SlabFree(w);
+        return 0;
+    }
+    stream->fd = fd;
+    if (stream->tail != NULL)
+        stream->tail->next = w;
+    else
+        stream->head = w;
+    stream->tail = w;
+    loop->writes++;
+    MutexUnlock(&loop->lock);
+
+    EventLoopWake(loop);
+    return 1;
+}
+
+// Accounts the result of a stream's writev, requests which are finished move to the done list
+static void EventStreamCompleted(EVENT_STREAM* stream, int result, EVENT_WRITE_REQ** done)
+{
+    int    count = stream->inFlight;
+    size_t n     = result > 0 ? (size_t)result : 0;
+
+    stream->inFlight = 0;
+    // nothing written yet, the next flush tries again
+    if (result == -EAGAIN || result == -EINTR)
+        return;
+
+    while (stream->head != NULL && count > 0) {
+        EVENT_WRITE_REQ* w    = stream->head;
+        size_t           rest = w->size - w->done;
+
+        if (result >= 0 && n < rest) {
+            w->done += n; // partial write, the rest goes with the next writev
+            break;
+        }
+        n -= result >= 0 ? rest : 0;
+        w->error     = result < 0 ? -result : 0;
+        stream->head = w->next;
+        w->next      = *done;
+        *done        = w;
+        count--;
+    }
+    if (stream->head == NULL) {
+        stream->tail = NULL;
+        stream->fd   = -1;
+    }
+}
+
+// Covers the queued requests of a stream with its iovec, up to EVENT_MAX_IOV. Returns their count.
+static int EventStreamPrepare(EVENT_STREAM* stream)
+{
+    int count = 0;
+
+    for (EVENT_WRITE_REQ* w = stream->head; w != NULL && count < EVENT_MAX_IOV; w = w->next) {
+        stream->iov[count].base = w->data + w->done;
+        stream->iov[count].len  = w->size - w->done;
+        count++;
+    }
+    stream->inFlight = count;
+    return count;
+}
+
+static void EventStreamWritev(EVENT_LOOP* loop, EVENT_STREAM* stream, int count, EVENT_WRITE_REQ** done)
+{
+    ssize_t written = writev(stream->fd, (const struct iovec*)stream->iov, count);
+
+    loop->writeSyscalls++;
+    EventStreamCompleted(stream, written < 0 ? -errno : (int)written, done);
+}
+
+// Writes what is queued with writev() on the calling thread until it is out or the fd takes no more
+static void EventStreamDrain(EVENT_LOOP* loop, EVENT_STREAM* stream, EVENT_WRITE_REQ** done)
+{
+    while (stream->fd >= 0 && stream->head != NULL && stream->inFlight == 0) {
+        EVENT_WRITE_REQ* head = stream->head;
+        size_t           sent = head->done;
+
+        EventStreamWritev(loop, stream, EventStreamPrepare(stream), done);
+        if (stream->head == head && head->done == sent)
+            break;
+    }
+}
+
+// Reaps completions and starts one writev per stream which has data and nothing in flight.
+// With io_uring all of them go to the kernel with a single system call. Returns 1 if a stream has to be retried.
+static int EventLoopProcessWrites(EVENT_LOOP* loop, EVENT_WRITE_REQ** done)
+{
+    uint64 userData;
+    int    result;
+    int    retry = 0;
+
+    while (loop->ring.fd >= 0 && IoRingReap(&loop->ring, &userData, &result)) {
+        if (userData < EVENT_MAX_STREAMS)
+            EventStreamCompleted(&loop->streams[userData], result, done);
+    }
+    // after a failed submission the ring is only kept until the writes submitted before it completed
+    if (loop->ringFailed && loop->ring.fd >= 0) {
+        int busy = 0;
+
+        for (int i = 0; i < EVENT_MAX_STREAMS; i++)
+            busy |= loop->streams[i].inFlight > 0;
+        if (!busy)
+            IoRingFree(&loop->ring);
+    }
+
+    for (int i = 0; i < EVENT_MAX_STREAMS; i++) {
+        EVENT_STREAM* stream = &loop->streams[i];
+        int           count;
+
+        if (stream->fd < 0 || stream->head == NULL || stream->inFlight > 0)
+            continue;
+
+        count           = EventStreamPrepare(stream);
+        stream->ringSeq = loop->ring.fd >= 0 ? *loop->ring.sqTail : 0;
+        if (loop->ring.fd >= 0 && !loop->ringFailed && IoRingWritev(&loop->ring, stream->fd, stream->iov, count, (uint64)i))
+            continue;
+
+        EventStreamWritev(loop, stream, count, done);
+        if (stream->head != NULL)
+            retry = 1;
+    }
+
+    if (loop->ring.fd >= 0 && loop->ring.prepared > 0) {
+        if (IoRingSubmit(&loop->ring) < 0) {
+            // io_uring refused. The writes which never reached the kernel are taken back and go out with writev(),
+            // the ones submitted before are still in flight and must not be written a second time.
+            unsigned int unsubmitted = *loop->ring.sqTail - loop->ring.prepared;
+
+            printf("PLUGIN: ERROR: io_uring submit failed, falling back to writev\n");
+            for (int i = 0; i < EVENT_MAX_STREAMS; i++) {
+                EVENT_STREAM* stream = &loop->streams[i];
+
+                if (stream->inFlight > 0 && (int)(stream->ringSeq - unsubmitted) >= 0)
+                    stream->inFlight = 0;
+            }
+            IoRingDiscard(&loop->ring);
+            loop->ringFailed = 1;
+            return 1;
+        }
+        loop->writeSyscalls++;
+        if (loop->ring.prepared > 0)
+            retry = 1;
+    }
+    return retry;
+}
+
+#endif
+
+// Runs the write callbacks, lock not held
+static void EventWritesDone(EVENT_WRITE_REQ* done)
+{
+    while (done != NULL) {
+        EVENT_WRITE_REQ* next = done->next;
+        if (done->func != NULL)
+            done->func(done->fd, done->error, done->arg);
+        SlabFree(done);
+        done = next;
+    }
+}
+
+void EventLoopGetStats(EVENT_LOOP* loop, EVENT_LOOP_STATS* stats)
+{
+    MutexLock(&loop->lock);
+#ifdef _WIN32
+    stats->backend = "timers only";
+#else
+    stats->backend = loop->ring.fd >= 0 && !loop->ringFailed ? "epoll+io_uring" : "epoll+writev";
+#endif
+    stats->timers        = loop->timerCount;
+    stats->writes        = loop->writes;
+    stats->writeSyscalls = loop->writeSyscalls;
+    MutexUnlock(&loop->lock);
+}
+
+static void EventLoopThread(void* arg)
+{
+    EVENT_LOOP* loop = (EVENT_LOOP*)arg;
+
+    MutexLock(&loop->lock);
+    while (!loop->stop) {
+        EVENT_WRITE_REQ* done = NULL;
+        uint64           timeout;
+        int              retry;
+
+        EventLoopRunTimers(loop, EventLoopCurrentTick(loop));
+        retry = EventLoopProcessWrites(loop, &done);
+        if (done != NULL) {
+            MutexUnlock(&loop->lock);
+            EventWritesDone(done);
+            MutexLock(&loop->lock);
+        }
+
+        timeout = EventLoopNextTimeout(loop);
+        // a socket which was not writable is tried again with the next tick
+        if (retry && timeout > EVENT_TICK_MS)
+            timeout = EVENT_TICK_MS;
+
+        MutexUnlock(&loop->lock);
+        EventLoopWait(loop, timeout);
+        MutexLock(&loop->lock);
+    }
+    MutexUnlock(&loop->lock);
+    SlabThreadFlush();
+}
+
+// Returns 0 if the loop could not be started
+int EventLoopStart(EVENT_LOOP* loop)
+{
+    memset(loop, 0, sizeof(*loop));
+    for (int i = 0; i < EVENT_MAX_WATCHES; i++)
+        loop->watches[i].fd = -1;
+    for (int i = 0; i < EVENT_MAX_STREAMS; i++)
+        loop->streams[i].fd = -1;
+    loop->ring.fd = -1;
+    loop->startMs = GetMonotonicTimeMs();
+
+    if (!EventLoopOpen(loop))
+        return 0;
+    MutexInit(&loop->lock);
+    loop->running = 1;
+    if (!ThreadStart(&loop->thread, EventLoopThread, loop)) {
+        loop->running = 0;
+        MutexDestroy(&loop->lock);
+        EventLoopClose(loop);
+        return 0;
+    }
+    return 1;
+}
+
+// Ends the loop thread, pending timers are dropped without firing
+void EventLoopStop(EVENT_LOOP* loop)
+{
+    if (!loop->running)
+        return;
+
+    MutexLock(&loop->lock);
+    loop->stop = 1;
+    MutexUnlock(&loop->lock);
+    EventLoopWake(loop);
+    ThreadJoin(&loop->thread);
+    loop->running = 0;
+
+    for (int i = 0; i < EVENT_WHEEL_SLOTS; i++) {
+        while (loop->wheel[i] != NULL)
+            TimerUnlink(loop->wheel[i]);
+    }
+    loop->timerCount = 0;
+
+    // queued writes get a last writev() here, what the fd does not take then is cancelled. A writev still in flight
+    // in io_uring may read its buffers until the ring is closed.
+    for (int i = 0; i < EVENT_MAX_STREAMS; i++) {
+        EVENT_STREAM*    stream = &loop->streams[i];
+        EVENT_WRITE_REQ* done   = NULL;
+
+        EventStreamDrain(loop, stream, &done);
+        while (stream->head != NULL) {
+            EVENT_WRITE_REQ* w = stream->head;
+            stream->head   = w->next;
+            if (stream->inFlight > 0) {
+                stream->inFlight--;
+                continue; // left allocated on purpose
+            }
+            w->error = ECANCELED;
+            w->next  = done;
+            done     = w;
+        }
+        stream->tail = NULL;
+        stream->fd   = -1;
+        EventWritesDone(done);
+    }
+    MutexDestroy(&loop->lock);
+    EventLoopClose(loop);
+}
@@ -0,0 +1,114 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "platform.h"
+#include "io_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVENT_WHEEL_SLOTS  256 // power of two
+#define EVENT_TICK_MS      10  // timer resolution
+#define EVENT_MAX_WATCHES  32
+#define EVENT_MAX_STREAMS  16 // file descriptors with queued writes
+#define EVENT_MAX_IOV      64 // writes combined into one writev
+
+#define EVENT_READ  1
+#define EVENT_WRITE 2
+
+typedef void (*EVENT_TIMER_FUNC)(void* arg);
+typedef void (*EVENT_IO_FUNC)(int fd, unsigned int events, void* arg);
+typedef void (*EVENT_WRITE_FUNC)(int fd, int error, void* arg); // error is 0 or an errno value
+
+// Timer memory belongs to the caller, so starting and cancelling never allocates
+typedef struct EVENT_TIMER {
+    struct EVENT_TIMER*  next;
+    struct EVENT_TIMER** pprev; // NULL while not pending
+    uint64               expires; // tick
+    EVENT_TIMER_FUNC     func;
+    void*                arg;
+} EVENT_TIMER;
+
+typedef struct {
+    int           fd; // -1 if unused
+    unsigned int  events;
+    EVENT_IO_FUNC func;
+    void*         arg;
+} EVENT_WATCH;
+
+typedef struct EVENT_WRITE_REQ {
+    struct EVENT_WRITE_REQ* next;
+    EVENT_WRITE_FUNC        func;
+    void*                   arg;
+    int                     fd;
+    int                     error;
+    size_t                  size;
+    size_t                  done;
+    char*                   data; // copy, allocated together with the request
+} EVENT_WRITE_REQ;
+
+// Writes of one file descriptor, they are written in order and only one writev is in flight at a time
+typedef struct {
+    int              fd; // -1 if unused
+    EVENT_WRITE_REQ* head;
+    EVENT_WRITE_REQ* tail;
+    int              inFlight; // requests covered by the submitted writev
+    unsigned int     ringSeq;  // position of that writev in the io_uring submission queue
+    IO_RING_BUF      iov[EVENT_MAX_IOV];
+} EVENT_STREAM;
+
+typedef struct {
+    const char*  backend;
+    unsigned int timers;
+    uint64       writes;
+    uint64       writeSyscalls;
+} EVENT_LOOP_STATS;
+
+// One thread for all timers and file descriptors of the plugin (epoll on Linux, timers only on Windows).
+// Callbacks run on the loop thread without any lock held and must not block.
+typedef struct {
+    PLATFORM_THREAD thread;
+    PLATFORM_MUTEX  lock;
+    int             running;
+    int             stop;
+#ifdef _WIN32
+    HANDLE          wakeEvent;
+#else
+    int             epollFd;
+    int             wakeFd; // eventfd
+#endif
+    uint64          startMs;
+    uint64          tick; // last processed tick
+    EVENT_TIMER*    wheel[EVENT_WHEEL_SLOTS];
+    unsigned int    timerCount;
+    EVENT_WATCH     watches[EVENT_MAX_WATCHES];
+
+    // writes are submitted in batches through io_uring where available, otherwise with writev()
+    IO_RING         ring;
+    int             ringFailed; // io_uring refused a submission, new writes use writev()
+    EVENT_STREAM    streams[EVENT_MAX_STREAMS];
+    uint64          writes;
+    uint64          writeSyscalls;
+} EVENT_LOOP;
+
+int  EventLoopStart(EVENT_LOOP* loop);
+void EventLoopStop(EVENT_LOOP* loop);
+void EventLoopWake(EVENT_LOOP* loop);
+
+void EventTimerInit(EVENT_TIMER* timer, EVENT_TIMER_FUNC func, void* arg);
+void EventTimerStart(EVENT_LOOP* loop, EVENT_TIMER* timer, uint64 delayMs);
+void EventTimerCancel(EVENT_LOOP* loop, EVENT_TIMER* timer);
+int  EventTimerPending(EVENT_LOOP* loop, EVENT_TIMER* timer);
+
+int  EventLoopWatch(EVENT_LOOP* loop, int fd, unsigned int events, EVENT_IO_FUNC func, void* arg);
+void EventLoopUnwatch(EVENT_LOOP* loop, int fd);
+
+int  EventLoopWrite(EVENT_LOOP* loop, int fd, const void* data, size_t size, EVENT_WRITE_FUNC func, void* arg);
+void EventLoopGetStats(EVENT_LOOP* loop, EVENT_LOOP_STATS* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,84 @@
+#include "group_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GROUP_CACHE_MIN_CAPACITY 32
+
+static int GroupCacheCompare(const GROUP_CACHE_ENTRY* e, uint64 serverConnectionHandlerID, int kind, uint64 groupID)
+{
+    if (e->serverConnectionHandlerID != serverConnectionHandlerID)
+        return e->serverConnectionHandlerID < serverConnectionHandlerID ? -1 : 1;
+    if (e->kind != kind)
+        return e->kind < kind ? -1 : 1;
+    if (e->groupID != groupID)
+        return e->groupID < groupID ? -1 : 1;
+    return 0;
+}
+
+// Returns the index of the group or the position where it has to be inserted, *found tells which one
+static unsigned int GroupCacheSearch(const GROUP_CACHE* cache, uint64 serverConnectionHandlerID, int kind, uint64 groupID, int* found)
+{
+    unsigned int lo = 0;
+    unsigned int hi = cache->count;
+
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        int          cmp = GroupCacheCompare(&cache->entries[mid], serverConnectionHandlerID, kind, groupID);
+        if (cmp == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *found = 0;
+    return lo;
+}
+
+void GroupCacheInit(GROUP_CACHE* cache)
+{
+    memset(cache, 0, sizeof(*cache));
+}
+
+void GroupCacheFree(GROUP_CACHE* cache)
+{
+    free(cache->entries);
+    GroupCacheInit(cache);
+}
+
+// Inserts or renames a group, e.g. from onServerGroupListEvent
+void GroupCacheSet(GROUP_CACHE* cache, uint64 serverConnectionHandlerID, int kind, uint64 groupID, const char* name)
+{
+    int          found;
+    unsigned int idx = GroupCacheSearch(cache, serverConnectionHandlerID, kind, groupID, &found);
+
+    if (!found) {
+        if (cache->count == cache->capacity) {
+            unsigned int       capacity = cache->capacity ? cache->capacity * 2 : GROUP_CACHE_MIN_CAPACITY;
+            GROUP_CACHE_ENTRY* entries  = (GROUP_CACHE_ENTRY*)realloc(cache->entries, capacity * sizeof(GROUP_CACHE_ENTRY));
+            if (entries == NULL)
+                return;
+            cache->entries  = entries;
+            cache->capacity = capacity;
+        }
+        memmove(&cache->entries[idx + 1], &cache->entries[idx], (cache->count - idx) * sizeof(GROUP_CACHE_ENTRY));
+        cache->entries[idx].serverConnectionHandlerID = serverConnectionHandlerID;
+        cache->entries[idx].kind                      = kind;
+        cache->entries[idx].groupID                   = groupID;
+        cache->count++;
+    }
+    snprintf(cache->entries[idx].name, sizeof(cache->entries[idx].name), "%s", name);
+}
+
+// Returns NULL if the group name is not known yet
+const char* GroupCacheGetName(const GROUP_CACHE* cache, uint64 serverConnectionHandlerID, int kind, uint64 groupID)
+{
+    int          found;
+    unsigned int idx = GroupCacheSearch(cache, serverConnectionHandlerID, kind, groupID, &found);
+
+    return found ? cache->entries[idx].name : NULL;
+}
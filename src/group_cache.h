@@ -0,0 +1,40 @@
+#ifndef GROUP_CACHE_H
+#define GROUP_CACHE_H
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_rare_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GROUP_NAME_LEN (TS3_MAX_SIZE_GROUP_NAME * 4 + 1) // group name in UTF-8
+
+#define GROUP_KIND_SERVER  0
+#define GROUP_KIND_CHANNEL 1
+
+typedef struct {
+    uint64 serverConnectionHandlerID;
+    uint64 groupID;
+    int    kind; // GROUP_KIND_SERVER or GROUP_KIND_CHANNEL
+    char   name[GROUP_NAME_LEN];
+} GROUP_CACHE_ENTRY;
+
+// Group names of all server tabs, sorted by (server, kind, group) for binary search.
+// Servers have a few dozen groups which rarely change, so inserts may be linear.
+typedef struct {
+    GROUP_CACHE_ENTRY* entries;
+    unsigned int       capacity;
+    unsigned int       count;
+} GROUP_CACHE;
+
+void        GroupCacheInit(GROUP_CACHE* cache);
+void        GroupCacheFree(GROUP_CACHE* cache);
+void        GroupCacheSet(GROUP_CACHE* cache, uint64 serverConnectionHandlerID, int kind, uint64 groupID, const char* name);
+const char* GroupCacheGetName(const GROUP_CACHE* cache, uint64 serverConnectionHandlerID, int kind, uint64 groupID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GROUP_CACHE_H
@@ -2,17 +2,24 @@
 #define INI_STRUCTS_H
 
 #define PATH_LEN 256
-#define HOST_LEN 64
+#define HOST_LEN 256
 #define PORT_LEN 8
 #define USER_LEN 64
 #define PASSWORD_LEN 64
 #define QOS_LEN 8
 #define CAFILE_LEN 256
 #define TOPIC_LEN 128
+#define MESSAGE_LEN 256
+#define INTERVAL_LEN 8
+#define INTERVAL_LEN 8
 #define COLOR_LEN 16
 #define PREFIX_LEN 64
 #define LOG_LEN 8
 #define LANG_LEN 8
+#define NAME_LEN 32
+#define CLIENTS_LEN 256
+
+#define BROKER_SECTIONS 4 // [BROKER1] .. [BROKER4]
 
 #ifndef BOOL
     typedef int BOOL;
@@ -32,6 +39,19 @@ typedef struct {
     char SEND_STOP[LOG_LEN];
     char TOPIC_START[TOPIC_LEN];
     char TOPIC_STOP[TOPIC_LEN];
+    char TOPIC_SNAPSHOT[TOPIC_LEN];
+    char MESSAGE[MESSAGE_LEN];
+    char MESSAGE_STOP[MESSAGE_LEN];
+    char PAYLOAD[LOG_LEN];
+    char TOPIC_SPEAKERS[TOPIC_LEN];
+    char SPEAKERS_INTERVAL[INTERVAL_LEN];
+    char DAEMON[PATH_LEN];
+    char SHUTDOWN_TIMEOUT[INTERVAL_LEN];
+    char RATE_LIMIT[INTERVAL_LEN];
+    char RATE_BURST[INTERVAL_LEN];
+    char RATE_PER_SPEAKER[LOG_LEN];
+    char PRIORITY_CLIENTS[CLIENTS_LEN];
+    char STATE_FILE[PATH_LEN];
 } MQTT_SECTION;
 
 typedef struct {
@@ -45,17 +65,31 @@ typedef struct {
 
 typedef struct {
     char LOG_MQTT_MSG[LOG_LEN];
+    char LOG_FILE[PATH_LEN];
 } LOGGING_SECTION;
 
 typedef struct {
     char LANGUAGE[LANG_LEN];
 } GENERAL_SECTION;
 
+// further broker, gets every MQTT message in addition to [MQTT]
+typedef struct {
+    char NAME[NAME_LEN];
+    char HOST[HOST_LEN];
+    char PORT[PORT_LEN];
+    char USER[USER_LEN];
+    char PASSWORD[PASSWORD_LEN];
+    char QOS[QOS_LEN];
+    char CAFILE[CAFILE_LEN];
+    char TOPIC_PREFIX[TOPIC_LEN];
+} BROKER_SECTION;
+
 typedef struct {
     MQTT_SECTION mqtt;
     CHANNELTAB_SECTION channelTab;
     LOGGING_SECTION logging;
     GENERAL_SECTION general;
+    BROKER_SECTION brokers[BROKER_SECTIONS];
     BOOL needWritingIni;
 } LH2MQTT_INI;
 
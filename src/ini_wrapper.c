@@ -41,9 +41,31 @@ unsigned int WritePrivateProfileStringAWrapper(
 static LH2MQTT_INI iniData;
 static char currentIniFile[512];
 
+// Liefert den Bereich BROKER1 .. BROKER4, sonst NULL
+static BROKER_SECTION* FindBrokerSection(LH2MQTT_INI* cfg, const char* section) {
+    if (strncmp(section, "BROKER", 6) != 0 || section[6] < '1' || section[6] >= '1' + BROKER_SECTIONS || section[7] != '\0')
+        return NULL;
+    return &cfg->brokers[section[6] - '1'];
+}
+
+static void TerminateBrokerSections(LH2MQTT_INI* cfg) {
+    for (int i = 0; i < BROKER_SECTIONS; i++) {
+        BROKER_SECTION* broker = &cfg->brokers[i];
+        broker->NAME[sizeof(broker->NAME)-1] = '\0';
+        broker->HOST[sizeof(broker->HOST)-1] = '\0';
+        broker->PORT[sizeof(broker->PORT)-1] = '\0';
+        broker->USER[sizeof(broker->USER)-1] = '\0';
+        broker->PASSWORD[sizeof(broker->PASSWORD)-1] = '\0';
+        broker->QOS[sizeof(broker->QOS)-1] = '\0';
+        broker->CAFILE[sizeof(broker->CAFILE)-1] = '\0';
+        broker->TOPIC_PREFIX[sizeof(broker->TOPIC_PREFIX)-1] = '\0';
+    }
+}
+
 // Handler für ini_parse um Struktur zu füllen
 static int ini_wrapper_handler(void* user, const char* section, const char* name, const char* value) {
     LH2MQTT_INI* cfg = (LH2MQTT_INI*)user;
+    BROKER_SECTION* broker;
 
     if (strcmp(section, "MQTT") == 0) {
         if (strcmp(name, "PATH") == 0) strncpy(cfg->mqtt.PATH, value, sizeof(cfg->mqtt.PATH));
@@ -57,6 +79,19 @@ static int ini_wrapper_handler(void* user, const char* section, const char* name
         else if (strcmp(name, "SEND_STOP") == 0) strncpy(cfg->mqtt.SEND_STOP, value, sizeof(cfg->mqtt.SEND_STOP));
         else if (strcmp(name, "TOPIC_START") == 0) strncpy(cfg->mqtt.TOPIC_START, value, sizeof(cfg->mqtt.TOPIC_START));
         else if (strcmp(name, "TOPIC_STOP") == 0) strncpy(cfg->mqtt.TOPIC_STOP, value, sizeof(cfg->mqtt.TOPIC_STOP));
+        else if (strcmp(name, "TOPIC_SNAPSHOT") == 0) strncpy(cfg->mqtt.TOPIC_SNAPSHOT, value, sizeof(cfg->mqtt.TOPIC_SNAPSHOT));
+        else if (strcmp(name, "MESSAGE") == 0) strncpy(cfg->mqtt.MESSAGE, value, sizeof(cfg->mqtt.MESSAGE));
+        else if (strcmp(name, "MESSAGE_STOP") == 0) strncpy(cfg->mqtt.MESSAGE_STOP, value, sizeof(cfg->mqtt.MESSAGE_STOP));
+        else if (strcmp(name, "PAYLOAD") == 0) strncpy(cfg->mqtt.PAYLOAD, value, sizeof(cfg->mqtt.PAYLOAD));
+        else if (strcmp(name, "TOPIC_SPEAKERS") == 0) strncpy(cfg->mqtt.TOPIC_SPEAKERS, value, sizeof(cfg->mqtt.TOPIC_SPEAKERS));
+        else if (strcmp(name, "SPEAKERS_INTERVAL") == 0) strncpy(cfg->mqtt.SPEAKERS_INTERVAL, value, sizeof(cfg->mqtt.SPEAKERS_INTERVAL));
+        else if (strcmp(name, "DAEMON") == 0) strncpy(cfg->mqtt.DAEMON, value, sizeof(cfg->mqtt.DAEMON));
+        else if (strcmp(name, "SHUTDOWN_TIMEOUT") == 0) strncpy(cfg->mqtt.SHUTDOWN_TIMEOUT, value, sizeof(cfg->mqtt.SHUTDOWN_TIMEOUT));
+        else if (strcmp(name, "RATE_LIMIT") == 0) strncpy(cfg->mqtt.RATE_LIMIT, value, sizeof(cfg->mqtt.RATE_LIMIT));
+        else if (strcmp(name, "RATE_BURST") == 0) strncpy(cfg->mqtt.RATE_BURST, value, sizeof(cfg->mqtt.RATE_BURST));
+        else if (strcmp(name, "RATE_PER_SPEAKER") == 0) strncpy(cfg->mqtt.RATE_PER_SPEAKER, value, sizeof(cfg->mqtt.RATE_PER_SPEAKER));
+        else if (strcmp(name, "PRIORITY_CLIENTS") == 0) strncpy(cfg->mqtt.PRIORITY_CLIENTS, value, sizeof(cfg->mqtt.PRIORITY_CLIENTS));
+        else if (strcmp(name, "STATE_FILE") == 0) strncpy(cfg->mqtt.STATE_FILE, value, sizeof(cfg->mqtt.STATE_FILE));
     } else if (strcmp(section, "CHANNELTAB") == 0) {
         if (strcmp(name, "SHOW_START") == 0) strncpy(cfg->channelTab.SHOW_START, value, sizeof(cfg->channelTab.SHOW_START));
         else if (strcmp(name, "SHOW_STOP") == 0) strncpy(cfg->channelTab.SHOW_STOP, value, sizeof(cfg->channelTab.SHOW_STOP));
@@ -66,8 +101,18 @@ static int ini_wrapper_handler(void* user, const char* section, const char* name
         else if (strcmp(name, "PREFIX_STOP") == 0) strncpy(cfg->channelTab.PREFIX_STOP, value, sizeof(cfg->channelTab.PREFIX_STOP));
     } else if (strcmp(section, "LOGGING") == 0) {
         if (strcmp(name, "LOG_MQTT_MSG") == 0) strncpy(cfg->logging.LOG_MQTT_MSG, value, sizeof(cfg->logging.LOG_MQTT_MSG));
+        else if (strcmp(name, "LOG_FILE") == 0) strncpy(cfg->logging.LOG_FILE, value, sizeof(cfg->logging.LOG_FILE));
     } else if (strcmp(section, "GENERAL") == 0) {
         if (strcmp(name, "LANGUAGE") == 0) strncpy(cfg->general.LANGUAGE, value, sizeof(cfg->general.LANGUAGE));
+    } else if ((broker = FindBrokerSection(cfg, section)) != NULL) {
+        if (strcmp(name, "NAME") == 0) strncpy(broker->NAME, value, sizeof(broker->NAME));
+        else if (strcmp(name, "HOST") == 0) strncpy(broker->HOST, value, sizeof(broker->HOST));
+        else if (strcmp(name, "PORT") == 0) strncpy(broker->PORT, value, sizeof(broker->PORT));
+        else if (strcmp(name, "USER") == 0) strncpy(broker->USER, value, sizeof(broker->USER));
+        else if (strcmp(name, "PASSWORD") == 0) strncpy(broker->PASSWORD, value, sizeof(broker->PASSWORD));
+        else if (strcmp(name, "QOS") == 0) strncpy(broker->QOS, value, sizeof(broker->QOS));
+        else if (strcmp(name, "CAFILE") == 0) strncpy(broker->CAFILE, value, sizeof(broker->CAFILE));
+        else if (strcmp(name, "TOPIC_PREFIX") == 0) strncpy(broker->TOPIC_PREFIX, value, sizeof(broker->TOPIC_PREFIX));
     }
 
     // Null-terminieren
@@ -82,6 +127,19 @@ static int ini_wrapper_handler(void* user, const char* section, const char* name
     cfg->mqtt.SEND_STOP[sizeof(cfg->mqtt.SEND_STOP)-1] = '\0';
     cfg->mqtt.TOPIC_START[sizeof(cfg->mqtt.TOPIC_START)-1] = '\0';
     cfg->mqtt.TOPIC_STOP[sizeof(cfg->mqtt.TOPIC_STOP)-1] = '\0';
+    cfg->mqtt.TOPIC_SNAPSHOT[sizeof(cfg->mqtt.TOPIC_SNAPSHOT)-1] = '\0';
+    cfg->mqtt.MESSAGE[sizeof(cfg->mqtt.MESSAGE)-1] = '\0';
+    cfg->mqtt.MESSAGE_STOP[sizeof(cfg->mqtt.MESSAGE_STOP)-1] = '\0';
+    cfg->mqtt.PAYLOAD[sizeof(cfg->mqtt.PAYLOAD)-1] = '\0';
+    cfg->mqtt.TOPIC_SPEAKERS[sizeof(cfg->mqtt.TOPIC_SPEAKERS)-1] = '\0';
+    cfg->mqtt.SPEAKERS_INTERVAL[sizeof(cfg->mqtt.SPEAKERS_INTERVAL)-1] = '\0';
+    cfg->mqtt.DAEMON[sizeof(cfg->mqtt.DAEMON)-1] = '\0';
+    cfg->mqtt.SHUTDOWN_TIMEOUT[sizeof(cfg->mqtt.SHUTDOWN_TIMEOUT)-1] = '\0';
+    cfg->mqtt.RATE_LIMIT[sizeof(cfg->mqtt.RATE_LIMIT)-1] = '\0';
+    cfg->mqtt.RATE_BURST[sizeof(cfg->mqtt.RATE_BURST)-1] = '\0';
+    cfg->mqtt.RATE_PER_SPEAKER[sizeof(cfg->mqtt.RATE_PER_SPEAKER)-1] = '\0';
+    cfg->mqtt.PRIORITY_CLIENTS[sizeof(cfg->mqtt.PRIORITY_CLIENTS)-1] = '\0';
+    cfg->mqtt.STATE_FILE[sizeof(cfg->mqtt.STATE_FILE)-1] = '\0';
 
     cfg->channelTab.SHOW_START[sizeof(cfg->channelTab.SHOW_START)-1] = '\0';
     cfg->channelTab.SHOW_STOP[sizeof(cfg->channelTab.SHOW_STOP)-1] = '\0';
@@ -91,9 +149,12 @@ static int ini_wrapper_handler(void* user, const char* section, const char* name
     cfg->channelTab.PREFIX_STOP[sizeof(cfg->channelTab.PREFIX_STOP)-1] = '\0';
 
     cfg->logging.LOG_MQTT_MSG[sizeof(cfg->logging.LOG_MQTT_MSG)-1] = '\0';
+    cfg->logging.LOG_FILE[sizeof(cfg->logging.LOG_FILE)-1] = '\0';
 
     cfg->general.LANGUAGE[sizeof(cfg->general.LANGUAGE)-1] = '\0';
 
+    TerminateBrokerSections(cfg);
+
     return 1;
 }
 
@@ -122,6 +183,7 @@ unsigned int GetPrivateProfileStringAWrapper(
     lpReturnedString[0] = '\0';
 
     LH2MQTT_INI* cfg = &iniData;
+    BROKER_SECTION* broker;
 
     if (strcmp(lpAppName, "MQTT") == 0) {
         if (strcmp(lpKeyName, "PATH") == 0) strncpy(lpReturnedString, cfg->mqtt.PATH, nSize);
@@ -135,6 +197,19 @@ unsigned int GetPrivateProfileStringAWrapper(
         else if (strcmp(lpKeyName, "SEND_STOP") == 0) strncpy(lpReturnedString, cfg->mqtt.SEND_STOP, nSize);
         else if (strcmp(lpKeyName, "TOPIC_START") == 0) strncpy(lpReturnedString, cfg->mqtt.TOPIC_START, nSize);
         else if (strcmp(lpKeyName, "TOPIC_STOP") == 0) strncpy(lpReturnedString, cfg->mqtt.TOPIC_STOP, nSize);
+        else if (strcmp(lpKeyName, "TOPIC_SNAPSHOT") == 0) strncpy(lpReturnedString, cfg->mqtt.TOPIC_SNAPSHOT, nSize);
+        else if (strcmp(lpKeyName, "MESSAGE") == 0) strncpy(lpReturnedString, cfg->mqtt.MESSAGE, nSize);
+        else if (strcmp(lpKeyName, "MESSAGE_STOP") == 0) strncpy(lpReturnedString, cfg->mqtt.MESSAGE_STOP, nSize);
+        else if (strcmp(lpKeyName, "PAYLOAD") == 0) strncpy(lpReturnedString, cfg->mqtt.PAYLOAD, nSize);
+        else if (strcmp(lpKeyName, "TOPIC_SPEAKERS") == 0) strncpy(lpReturnedString, cfg->mqtt.TOPIC_SPEAKERS, nSize);
+        else if (strcmp(lpKeyName, "SPEAKERS_INTERVAL") == 0) strncpy(lpReturnedString, cfg->mqtt.SPEAKERS_INTERVAL, nSize);
+        else if (strcmp(lpKeyName, "DAEMON") == 0) strncpy(lpReturnedString, cfg->mqtt.DAEMON, nSize);
+        else if (strcmp(lpKeyName, "SHUTDOWN_TIMEOUT") == 0) strncpy(lpReturnedString, cfg->mqtt.SHUTDOWN_TIMEOUT, nSize);
+        else if (strcmp(lpKeyName, "RATE_LIMIT") == 0) strncpy(lpReturnedString, cfg->mqtt.RATE_LIMIT, nSize);
+        else if (strcmp(lpKeyName, "RATE_BURST") == 0) strncpy(lpReturnedString, cfg->mqtt.RATE_BURST, nSize);
+        else if (strcmp(lpKeyName, "RATE_PER_SPEAKER") == 0) strncpy(lpReturnedString, cfg->mqtt.RATE_PER_SPEAKER, nSize);
+        else if (strcmp(lpKeyName, "PRIORITY_CLIENTS") == 0) strncpy(lpReturnedString, cfg->mqtt.PRIORITY_CLIENTS, nSize);
+        else if (strcmp(lpKeyName, "STATE_FILE") == 0) strncpy(lpReturnedString, cfg->mqtt.STATE_FILE, nSize);
         else strncpy(lpReturnedString, lpDefault, nSize);
     } else if (strcmp(lpAppName, "CHANNELTAB") == 0) {
         if (strcmp(lpKeyName, "SHOW_START") == 0) strncpy(lpReturnedString, cfg->channelTab.SHOW_START, nSize);
@@ -146,10 +221,21 @@ unsigned int GetPrivateProfileStringAWrapper(
         else strncpy(lpReturnedString, lpDefault, nSize);
     } else if (strcmp(lpAppName, "LOGGING") == 0) {
         if (strcmp(lpKeyName, "LOG_MQTT_MSG") == 0) strncpy(lpReturnedString, cfg->logging.LOG_MQTT_MSG, nSize);
+        else if (strcmp(lpKeyName, "LOG_FILE") == 0) strncpy(lpReturnedString, cfg->logging.LOG_FILE, nSize);
         else strncpy(lpReturnedString, lpDefault, nSize);
     } else if (strcmp(lpAppName, "GENERAL") == 0) {
         if (strcmp(lpKeyName, "LANGUAGE") == 0) strncpy(lpReturnedString, cfg->general.LANGUAGE, nSize);
         else strncpy(lpReturnedString, lpDefault, nSize);
+    } else if ((broker = FindBrokerSection(cfg, lpAppName)) != NULL) {
+        if (strcmp(lpKeyName, "NAME") == 0) strncpy(lpReturnedString, broker->NAME, nSize);
+        else if (strcmp(lpKeyName, "HOST") == 0) strncpy(lpReturnedString, broker->HOST, nSize);
+        else if (strcmp(lpKeyName, "PORT") == 0) strncpy(lpReturnedString, broker->PORT, nSize);
+        else if (strcmp(lpKeyName, "USER") == 0) strncpy(lpReturnedString, broker->USER, nSize);
+        else if (strcmp(lpKeyName, "PASSWORD") == 0) strncpy(lpReturnedString, broker->PASSWORD, nSize);
+        else if (strcmp(lpKeyName, "QOS") == 0) strncpy(lpReturnedString, broker->QOS, nSize);
+        else if (strcmp(lpKeyName, "CAFILE") == 0) strncpy(lpReturnedString, broker->CAFILE, nSize);
+        else if (strcmp(lpKeyName, "TOPIC_PREFIX") == 0) strncpy(lpReturnedString, broker->TOPIC_PREFIX, nSize);
+        else strncpy(lpReturnedString, lpDefault, nSize);
     } else {
         strncpy(lpReturnedString, lpDefault, nSize);
     }
@@ -168,6 +254,7 @@ unsigned int WritePrivateProfileStringAWrapper(
     if (!lpAppName || !lpKeyName || !lpString) return 0;
 
     LH2MQTT_INI* cfg = &iniData;
+    BROKER_SECTION* broker;
 
     if (strcmp(lpAppName, "MQTT") == 0) {
         if (strcmp(lpKeyName, "PATH") == 0) strncpy(cfg->mqtt.PATH, lpString, sizeof(cfg->mqtt.PATH));
@@ -181,6 +268,19 @@ unsigned int WritePrivateProfileStringAWrapper(
         else if (strcmp(lpKeyName, "SEND_STOP") == 0) strncpy(cfg->mqtt.SEND_STOP, lpString, sizeof(cfg->mqtt.SEND_STOP));
         else if (strcmp(lpKeyName, "TOPIC_START") == 0) strncpy(cfg->mqtt.TOPIC_START, lpString, sizeof(cfg->mqtt.TOPIC_START));
         else if (strcmp(lpKeyName, "TOPIC_STOP") == 0) strncpy(cfg->mqtt.TOPIC_STOP, lpString, sizeof(cfg->mqtt.TOPIC_STOP));
+        else if (strcmp(lpKeyName, "TOPIC_SNAPSHOT") == 0) strncpy(cfg->mqtt.TOPIC_SNAPSHOT, lpString, sizeof(cfg->mqtt.TOPIC_SNAPSHOT));
+        else if (strcmp(lpKeyName, "MESSAGE") == 0) strncpy(cfg->mqtt.MESSAGE, lpString, sizeof(cfg->mqtt.MESSAGE));
+        else if (strcmp(lpKeyName, "MESSAGE_STOP") == 0) strncpy(cfg->mqtt.MESSAGE_STOP, lpString, sizeof(cfg->mqtt.MESSAGE_STOP));
+        else if (strcmp(lpKeyName, "PAYLOAD") == 0) strncpy(cfg->mqtt.PAYLOAD, lpString, sizeof(cfg->mqtt.PAYLOAD));
+        else if (strcmp(lpKeyName, "TOPIC_SPEAKERS") == 0) strncpy(cfg->mqtt.TOPIC_SPEAKERS, lpString, sizeof(cfg->mqtt.TOPIC_SPEAKERS));
+        else if (strcmp(lpKeyName, "SPEAKERS_INTERVAL") == 0) strncpy(cfg->mqtt.SPEAKERS_INTERVAL, lpString, sizeof(cfg->mqtt.SPEAKERS_INTERVAL));
+        else if (strcmp(lpKeyName, "DAEMON") == 0) strncpy(cfg->mqtt.DAEMON, lpString, sizeof(cfg->mqtt.DAEMON));
+        else if (strcmp(lpKeyName, "SHUTDOWN_TIMEOUT") == 0) strncpy(cfg->mqtt.SHUTDOWN_TIMEOUT, lpString, sizeof(cfg->mqtt.SHUTDOWN_TIMEOUT));
+        else if (strcmp(lpKeyName, "RATE_LIMIT") == 0) strncpy(cfg->mqtt.RATE_LIMIT, lpString, sizeof(cfg->mqtt.RATE_LIMIT));
+        else if (strcmp(lpKeyName, "RATE_BURST") == 0) strncpy(cfg->mqtt.RATE_BURST, lpString, sizeof(cfg->mqtt.RATE_BURST));
+        else if (strcmp(lpKeyName, "RATE_PER_SPEAKER") == 0) strncpy(cfg->mqtt.RATE_PER_SPEAKER, lpString, sizeof(cfg->mqtt.RATE_PER_SPEAKER));
+        else if (strcmp(lpKeyName, "PRIORITY_CLIENTS") == 0) strncpy(cfg->mqtt.PRIORITY_CLIENTS, lpString, sizeof(cfg->mqtt.PRIORITY_CLIENTS));
+        else if (strcmp(lpKeyName, "STATE_FILE") == 0) strncpy(cfg->mqtt.STATE_FILE, lpString, sizeof(cfg->mqtt.STATE_FILE));
         else return 0;
     } else if (strcmp(lpAppName, "CHANNELTAB") == 0) {
         if (strcmp(lpKeyName, "SHOW_START") == 0) strncpy(cfg->channelTab.SHOW_START, lpString, sizeof(cfg->channelTab.SHOW_START));
@@ -192,10 +292,21 @@ unsigned int WritePrivateProfileStringAWrapper(
         else return 0;
     } else if (strcmp(lpAppName, "LOGGING") == 0) {
         if (strcmp(lpKeyName, "LOG_MQTT_MSG") == 0) strncpy(cfg->logging.LOG_MQTT_MSG, lpString, sizeof(cfg->logging.LOG_MQTT_MSG));
+        else if (strcmp(lpKeyName, "LOG_FILE") == 0) strncpy(cfg->logging.LOG_FILE, lpString, sizeof(cfg->logging.LOG_FILE));
         else return 0;
     } else if (strcmp(lpAppName, "GENERAL") == 0) {
         if (strcmp(lpKeyName, "LANGUAGE") == 0) strncpy(cfg->general.LANGUAGE, lpString, sizeof(cfg->general.LANGUAGE));
         else return 0;
+    } else if ((broker = FindBrokerSection(cfg, lpAppName)) != NULL) {
+        if (strcmp(lpKeyName, "NAME") == 0) strncpy(broker->NAME, lpString, sizeof(broker->NAME));
+        else if (strcmp(lpKeyName, "HOST") == 0) strncpy(broker->HOST, lpString, sizeof(broker->HOST));
+        else if (strcmp(lpKeyName, "PORT") == 0) strncpy(broker->PORT, lpString, sizeof(broker->PORT));
+        else if (strcmp(lpKeyName, "USER") == 0) strncpy(broker->USER, lpString, sizeof(broker->USER));
+        else if (strcmp(lpKeyName, "PASSWORD") == 0) strncpy(broker->PASSWORD, lpString, sizeof(broker->PASSWORD));
+        else if (strcmp(lpKeyName, "QOS") == 0) strncpy(broker->QOS, lpString, sizeof(broker->QOS));
+        else if (strcmp(lpKeyName, "CAFILE") == 0) strncpy(broker->CAFILE, lpString, sizeof(broker->CAFILE));
+        else if (strcmp(lpKeyName, "TOPIC_PREFIX") == 0) strncpy(broker->TOPIC_PREFIX, lpString, sizeof(broker->TOPIC_PREFIX));
+        else return 0;
     } else {
         return 0;
     }
@@ -212,6 +323,19 @@ unsigned int WritePrivateProfileStringAWrapper(
     cfg->mqtt.SEND_STOP[sizeof(cfg->mqtt.SEND_STOP)-1] = '\0';
     cfg->mqtt.TOPIC_START[sizeof(cfg->mqtt.TOPIC_START)-1] = '\0';
     cfg->mqtt.TOPIC_STOP[sizeof(cfg->mqtt.TOPIC_STOP)-1] = '\0';
+    cfg->mqtt.TOPIC_SNAPSHOT[sizeof(cfg->mqtt.TOPIC_SNAPSHOT)-1] = '\0';
+    cfg->mqtt.MESSAGE[sizeof(cfg->mqtt.MESSAGE)-1] = '\0';
+    cfg->mqtt.MESSAGE_STOP[sizeof(cfg->mqtt.MESSAGE_STOP)-1] = '\0';
+    cfg->mqtt.PAYLOAD[sizeof(cfg->mqtt.PAYLOAD)-1] = '\0';
+    cfg->mqtt.TOPIC_SPEAKERS[sizeof(cfg->mqtt.TOPIC_SPEAKERS)-1] = '\0';
+    cfg->mqtt.SPEAKERS_INTERVAL[sizeof(cfg->mqtt.SPEAKERS_INTERVAL)-1] = '\0';
+    cfg->mqtt.DAEMON[sizeof(cfg->mqtt.DAEMON)-1] = '\0';
+    cfg->mqtt.SHUTDOWN_TIMEOUT[sizeof(cfg->mqtt.SHUTDOWN_TIMEOUT)-1] = '\0';
+    cfg->mqtt.RATE_LIMIT[sizeof(cfg->mqtt.RATE_LIMIT)-1] = '\0';
+    cfg->mqtt.RATE_BURST[sizeof(cfg->mqtt.RATE_BURST)-1] = '\0';
+    cfg->mqtt.RATE_PER_SPEAKER[sizeof(cfg->mqtt.RATE_PER_SPEAKER)-1] = '\0';
+    cfg->mqtt.PRIORITY_CLIENTS[sizeof(cfg->mqtt.PRIORITY_CLIENTS)-1] = '\0';
+    cfg->mqtt.STATE_FILE[sizeof(cfg->mqtt.STATE_FILE)-1] = '\0';
 
     cfg->channelTab.SHOW_START[sizeof(cfg->channelTab.SHOW_START)-1] = '\0';
     cfg->channelTab.SHOW_STOP[sizeof(cfg->channelTab.SHOW_STOP)-1] = '\0';
@@ -221,9 +345,12 @@ unsigned int WritePrivateProfileStringAWrapper(
     cfg->channelTab.PREFIX_STOP[sizeof(cfg->channelTab.PREFIX_STOP)-1] = '\0';
 
     cfg->logging.LOG_MQTT_MSG[sizeof(cfg->logging.LOG_MQTT_MSG)-1] = '\0';
+    cfg->logging.LOG_FILE[sizeof(cfg->logging.LOG_FILE)-1] = '\0';
 
     cfg->general.LANGUAGE[sizeof(cfg->general.LANGUAGE)-1] = '\0';
 
+    TerminateBrokerSections(cfg);
+
     cfg->needWritingIni=TRUE;
 
     return 1;
@@ -269,12 +396,37 @@ void WriteCompleteIniFile(const LH2MQTT_INI* cfg)
         fprintf(f, ";   siehe: whereis mosquitto_pub\n");
     #endif
     fprintf(f, "; HOST kann eine IP-Adresse oder ein Hostname (FQDN) sein\n");
+    fprintf(f, "; mehrere Broker durch Komma getrennt: mit DAEMON wird der schnellste erreichbare genutzt, sonst immer der erste\n");
     fprintf(f, ";   also 127.0.0.1 oder meine-broker-fqdn\n");
+    fprintf(f, ";   oder unix:/pfad/zum/socket fuer einen lokalen Broker (ohne TCP, PORT und CAFILE werden ignoriert)\n");
     fprintf(f, "; PORT des Brokers (anzugeben, falls abweichend von 1883)\n");
     fprintf(f, "; USER/PASSWORD/QOS sind optional\n");
     fprintf(f, "; CAFILE: kompletter Pfad und Dateiname des Server-CA-Bundles (SSL)\n");
     fprintf(f, "; SEND_START/SEND_STOP: 1 gibt an, dass die Info via MQTT gesendet wird\n");
     fprintf(f, "; TOPIC_START/TOPIC_STOP: Topic auf dem die Info veroeffentlicht wird\n");
+    fprintf(f, ";   {channel} im Topic wird durch den kompletten Channel-Pfad des Sprechers ersetzt\n");
+    fprintf(f, ";   {server} im Topic wird durch die UID des Servers ersetzt (bei mehreren Server-Tabs)\n");
+    fprintf(f, "; TOPIC_SNAPSHOT: Topic fuer die Uebersicht nach dem Verbinden (leer = aus)\n");
+    fprintf(f, "; MESSAGE: Inhalt der MQTT-Message, Platzhalter:\n");
+    fprintf(f, ";   {name} Name des Sprechers, {channel} Channel-Pfad,\n");
+    fprintf(f, ";   {servergroups} Servergruppen (kommagetrennt), {channelgroup} Channelgruppe\n");
+    fprintf(f, "; MESSAGE_STOP: Inhalt der MQTT-Message bei Sprech-Ende (leer = wie MESSAGE), zusaetzlich:\n");
+    fprintf(f, ";   {duration} Sprechdauer in ms, {bursts} Anzahl der Wortmeldungen seit Betreten des Servers\n");
+    fprintf(f, "; PAYLOAD: text = MESSAGE/MESSAGE_STOP verwenden, json = JSON-Objekt mit allen Angaben zum Sprecher\n");
+    fprintf(f, "; TOPIC_SPEAKERS: Topic fuer die aktuell sprechenden Clients (leer = aus)\n");
+    fprintf(f, ";   Aenderungen gehen an <Topic>/delta, die komplette Liste an <Topic>/snapshot\n");
+    fprintf(f, "; SPEAKERS_INTERVAL: Sekunden zwischen zwei kompletten Listen (0 = nur Aenderungen)\n");
+    fprintf(f, "; DAEMON: Pfad zu lh2mqttd (nur Linux), sendet ausserhalb des TeamSpeak-Clients (leer = aus)\n");
+    fprintf(f, "; SHUTDOWN_TIMEOUT: Sekunden, die beim Beenden noch gesendet wird, der Rest wird beim naechsten Start nachgeholt\n");
+    fprintf(f, "; RATE_LIMIT: hoechstens so viele MQTT-Messages pro Minute und Topic (leer oder 0 = unbegrenzt)\n");
+    fprintf(f, ";   weitere Messages werden unterdrueckt und alle 10 Sekunden als Zusammenfassung\n");
+    fprintf(f, ";   (Anzahl und letzte Message) auf <Topic>/suppressed gesendet\n");
+    fprintf(f, "; RATE_BURST: so viele Messages duerfen kurz hintereinander gesendet werden (Standard 10)\n");
+    fprintf(f, "; RATE_PER_SPEAKER: 1 = das Limit gilt je Topic und Sprecher\n");
+    fprintf(f, "; PRIORITY_CLIENTS: Nicknames oder eindeutige IDs, durch Komma getrennt, deren Messages wie die\n");
+    fprintf(f, ";   eigenen vor allen anderen gesendet werden (z.B. fuer eine On-Air-Lampe)\n");
+    fprintf(f, "; STATE_FILE: Datei, in der der aktuelle Sprecher jedes Servers steht, fuer lokale Programme wie ein Overlay\n");
+    fprintf(f, ";   ohne Broker (leer = aus), Beispiel zum Lesen: lh2mqtt-state\n");
     fprintf(f, ";\n");
     fprintf(f, ";-------------------------------------------------------------------------------\n");
     fprintf(f, "; CHANNELTAB:\n");
@@ -290,6 +442,16 @@ void WriteCompleteIniFile(const LH2MQTT_INI* cfg)
     fprintf(f, "; LOGGING:\n");
     fprintf(f, ";-------------------------------------------------------------------------------\n");
     fprintf(f, "; LOG_MQTT_MSG: 1 gibt an, dass die gesendete MQTT-Message mitgeloggt wird\n");
+    fprintf(f, "; LOG_FILE: Datei, an die jede MQTT-Message als Zeile angehaengt wird (leer = aus)\n");
+    fprintf(f, ";\n");
+    fprintf(f, ";-------------------------------------------------------------------------------\n");
+    fprintf(f, "; BROKER1 bis BROKER4 (optional):\n");
+    fprintf(f, ";-------------------------------------------------------------------------------\n");
+    fprintf(f, "; Weitere Broker, die jede MQTT-Message zusaetzlich zu [MQTT] erhalten.\n");
+    fprintf(f, "; Jeder Broker hat eine eigene Warteschlange, ein langsamer Broker bremst die anderen nicht.\n");
+    fprintf(f, "; NAME: Bezeichnung in Log und Statistik\n");
+    fprintf(f, "; HOST/PORT/USER/PASSWORD/QOS/CAFILE: wie in [MQTT] (leerer HOST = aus)\n");
+    fprintf(f, "; TOPIC_PREFIX: wird jedem Topic fuer diesen Broker vorangestellt (z.B. analytics/)\n");
     fprintf(f, ";\n");
     fprintf(f, ";-------------------------------------------------------------------------------\n");
     fprintf(f, "; Diese Config wird automatisch beim Programmstart von TeamSpeak 3\n");
@@ -304,17 +466,30 @@ void WriteCompleteIniFile(const LH2MQTT_INI* cfg)
 
     // --------- MQTT Section ----------
     fprintf(f, "[MQTT]\n");    
-    WriteIniValueHelper(f, "PATH",        cfg->mqtt.PATH);
-    WriteIniValueHelper(f, "HOST",        cfg->mqtt.HOST);
-    WriteIniValueHelper(f, "PORT",        cfg->mqtt.PORT);
-    WriteIniValueHelper(f, "USER",        cfg->mqtt.USER);
-    WriteIniValueHelper(f, "PASSWORD",    cfg->mqtt.PASSWORD);
-    WriteIniValueHelper(f, "QOS",         cfg->mqtt.QOS);
-    WriteIniValueHelper(f, "CAFILE",      cfg->mqtt.CAFILE);
-    WriteIniValueHelper(f, "SEND_START",  cfg->mqtt.SEND_START);
-    WriteIniValueHelper(f, "SEND_STOP",   cfg->mqtt.SEND_STOP);
-    WriteIniValueHelper(f, "TOPIC_START", cfg->mqtt.TOPIC_START);
-    WriteIniValueHelper(f, "TOPIC_STOP",  cfg->mqtt.TOPIC_STOP);
+    WriteIniValueHelper(f, "PATH",              cfg->mqtt.PATH);
+    WriteIniValueHelper(f, "HOST",              cfg->mqtt.HOST);
+    WriteIniValueHelper(f, "PORT",              cfg->mqtt.PORT);
+    WriteIniValueHelper(f, "USER",              cfg->mqtt.USER);
+    WriteIniValueHelper(f, "PASSWORD",          cfg->mqtt.PASSWORD);
+    WriteIniValueHelper(f, "QOS",               cfg->mqtt.QOS);
+    WriteIniValueHelper(f, "CAFILE",            cfg->mqtt.CAFILE);
+    WriteIniValueHelper(f, "SEND_START",        cfg->mqtt.SEND_START);
+    WriteIniValueHelper(f, "SEND_STOP",         cfg->mqtt.SEND_STOP);
+    WriteIniValueHelper(f, "TOPIC_START",       cfg->mqtt.TOPIC_START);
+    WriteIniValueHelper(f, "TOPIC_STOP",        cfg->mqtt.TOPIC_STOP);
+    WriteIniValueHelper(f, "TOPIC_SNAPSHOT",    cfg->mqtt.TOPIC_SNAPSHOT);
+    WriteIniValueHelper(f, "MESSAGE",           cfg->mqtt.MESSAGE);
+    WriteIniValueHelper(f, "MESSAGE_STOP",      cfg->mqtt.MESSAGE_STOP);
+    WriteIniValueHelper(f, "PAYLOAD",           cfg->mqtt.PAYLOAD);
+    WriteIniValueHelper(f, "TOPIC_SPEAKERS",    cfg->mqtt.TOPIC_SPEAKERS);
+    WriteIniValueHelper(f, "SPEAKERS_INTERVAL", cfg->mqtt.SPEAKERS_INTERVAL);
+    WriteIniValueHelper(f, "DAEMON",            cfg->mqtt.DAEMON);
+    WriteIniValueHelper(f, "SHUTDOWN_TIMEOUT",  cfg->mqtt.SHUTDOWN_TIMEOUT);
+    WriteIniValueHelper(f, "RATE_LIMIT",        cfg->mqtt.RATE_LIMIT);
+    WriteIniValueHelper(f, "RATE_BURST",        cfg->mqtt.RATE_BURST);
+    WriteIniValueHelper(f, "RATE_PER_SPEAKER",  cfg->mqtt.RATE_PER_SPEAKER);
+    WriteIniValueHelper(f, "PRIORITY_CLIENTS",  cfg->mqtt.PRIORITY_CLIENTS);
+    WriteIniValueHelper(f, "STATE_FILE",        cfg->mqtt.STATE_FILE);
     fprintf(f, "\n");
 
     // --------- CHANNELTAB Section ----------
@@ -330,6 +505,7 @@ void WriteCompleteIniFile(const LH2MQTT_INI* cfg)
     // --------- LOGGING Section ----------
     fprintf(f, "[LOGGING]\n");
     WriteIniValueHelper(f, "LOG_MQTT_MSG", cfg->logging.LOG_MQTT_MSG);
+    WriteIniValueHelper(f, "LOG_FILE",     cfg->logging.LOG_FILE);
     fprintf(f, "\n");
 
     // --------- GENERAL Section ----------
@@ -337,6 +513,23 @@ void WriteCompleteIniFile(const LH2MQTT_INI* cfg)
     WriteIniValueHelper(f, "LANGUAGE", cfg->general.LANGUAGE);
     fprintf(f, "\n");
 
+    // --------- BROKER Sections, nur die benutzten ----------
+    for (int i = 0; i < BROKER_SECTIONS; i++) {
+        const BROKER_SECTION* broker = &cfg->brokers[i];
+        if (strlen(broker->HOST) == 0 && strlen(broker->NAME) == 0)
+            continue;
+        fprintf(f, "[BROKER%d]\n", i + 1);
+        WriteIniValueHelper(f, "NAME",         broker->NAME);
+        WriteIniValueHelper(f, "HOST",         broker->HOST);
+        WriteIniValueHelper(f, "PORT",         broker->PORT);
+        WriteIniValueHelper(f, "USER",         broker->USER);
+        WriteIniValueHelper(f, "PASSWORD",     broker->PASSWORD);
+        WriteIniValueHelper(f, "QOS",          broker->QOS);
+        WriteIniValueHelper(f, "CAFILE",       broker->CAFILE);
+        WriteIniValueHelper(f, "TOPIC_PREFIX", broker->TOPIC_PREFIX);
+        fprintf(f, "\n");
+    }
+
     fclose(f);
 }
 #endif // !_WIN32
@@ -0,0 +1,199 @@
+#include "io_ring.h"
+
+#include <string.h>
+
+#if defined(__linux__) && !defined(LH2MQTT_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define IO_RING_AVAILABLE
+#endif
+#endif
+
+#ifdef IO_RING_AVAILABLE
+// -------------------- Linux io_uring --------------------
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+static int IoRingSetup(unsigned int entries, struct io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoRingEnter(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+// Returns 0 if io_uring is not supported or not permitted (e.g. by a seccomp filter), the caller falls back to epoll
+int IoRingInit(IO_RING* ring, unsigned int entries, int eventFd)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    ring->fd = IoRingSetup(entries, &params);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return 0;
+    }
+
+    ring->entries    = params.sq_entries;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize   = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes   = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        IoRingFree(ring);
+        return 0;
+    }
+
+    ring->sqHead  = (unsigned int*)((char*)ring->sqRing + params.sq_off.head);
+    ring->sqTail  = (unsigned int*)((char*)ring->sqRing + params.sq_off.tail);
+    ring->sqMask  = (unsigned int*)((char*)ring->sqRing + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned int*)((char*)ring->sqRing + params.sq_off.array);
+    ring->cqHead  = (unsigned int*)((char*)ring->cqRing + params.cq_off.head);
+    ring->cqTail  = (unsigned int*)((char*)ring->cqRing + params.cq_off.tail);
+    ring->cqMask  = (unsigned int*)((char*)ring->cqRing + params.cq_off.ring_mask);
+    ring->cqes    = (char*)ring->cqRing + params.cq_off.cqes;
+
+    // completions wake up the event loop through its eventfd
+    if (eventFd >= 0 && syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_EVENTFD, &eventFd, 1) != 0) {
+        IoRingFree(ring);
+        return 0;
+    }
+    return 1;
+}
+
+// Requests still in flight are cancelled by the kernel
+void IoRingFree(IO_RING* ring)
+{
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != NULL && ring->cqRing != MAP_FAILED)
+        munmap(ring->cqRing, ring->cqRingSize);
+    if (ring->sqRing != NULL && ring->sqRing != MAP_FAILED)
+        munmap(ring->sqRing, ring->sqRingSize);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+// Queues a writev at the current file position, the buffers must stay valid until its completion.
+// Returns 0 if the submission queue is full.
+int IoRingWritev(IO_RING* ring, int fd, const IO_RING_BUF* bufs, int count, uint64 userData)
+{
+    unsigned int         tail = *ring->sqTail;
+    unsigned int         idx;
+    struct io_uring_sqe* sqe;
+
+    if (tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->entries)
+        return 0;
+
+    idx = tail & *ring->sqMask;
+    sqe = &((struct io_uring_sqe*)ring->sqes)[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_WRITEV;
+    sqe->fd        = fd;
+    sqe->off       = (__u64)-1; // like write(), also for pipes and sockets
+    sqe->addr      = (__u64)(uintptr_t)bufs;
+    sqe->len       = (__u32)count;
+    sqe->user_data = userData;
+
+    ring->sqArray[idx] = idx;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->prepared++;
+    return 1;
+}
+
+// Submits all queued requests with one system call, returns the number submitted or -1
+int IoRingSubmit(IO_RING* ring)
+{
+    int submitted;
+
+    if (ring->prepared == 0)
+        return 0;
+    submitted = IoRingEnter(ring->fd, ring->prepared, 0, 0);
+    if (submitted < 0)
+        return errno == EAGAIN || errno == EBUSY || errno == EINTR ? 0 : -1;
+    ring->prepared -= (unsigned int)submitted;
+    return submitted;
+}
+
+// Takes back the requests queued since the last submission, the kernel never sees them
+void IoRingDiscard(IO_RING* ring)
+{
+    __atomic_store_n(ring->sqTail, *ring->sqTail - ring->prepared, __ATOMIC_RELEASE);
+    ring->prepared = 0;
+}
+
+// Takes one completion without blocking, result is the byte count or -errno. Returns 0 if there is none.
+int IoRingReap(IO_RING* ring, uint64* userData, int* result)
+{
+    unsigned int         head = *ring->cqHead;
+    struct io_uring_cqe* cqe;
+
+    if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        return 0;
+
+    cqe       = &((struct io_uring_cqe*)ring->cqes)[head & *ring->cqMask];
+    *userData = cqe->user_data;
+    *result   = cqe->res;
+    __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+#else
+// -------------------- not available --------------------
+
+int IoRingInit(IO_RING* ring, unsigned int entries, int eventFd)
+{
+    (void)entries;
+    (void)eventFd;
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    return 0;
+}
+
+void IoRingFree(IO_RING* ring)
+{
+    ring->fd = -1;
+}
+
+int IoRingWritev(IO_RING* ring, int fd, const IO_RING_BUF* bufs, int count, uint64 userData)
+{
+    (void)ring;
+    (void)fd;
+    (void)bufs;
+    (void)count;
+    (void)userData;
+    return 0;
+}
+
+int IoRingSubmit(IO_RING* ring)
+{
+    (void)ring;
+    return -1;
+}
+
+void IoRingDiscard(IO_RING* ring)
+{
+    (void)ring;
+}
+
+int IoRingReap(IO_RING* ring, uint64* userData, int* result)
+{
+    (void)ring;
+    (void)userData;
+    (void)result;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef IO_RING_H
+#define IO_RING_H
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Minimal io_uring wrapper for batched writes, without liburing. Available on Linux only,
+// IoRingInit returns 0 everywhere else or if the kernel does not allow io_uring.
+typedef struct {
+    int           fd; // -1 if not available
+    unsigned int  entries;
+    unsigned int  prepared; // queued but not yet submitted
+
+    unsigned int* sqHead;
+    unsigned int* sqTail;
+    unsigned int* sqMask;
+    unsigned int* sqArray;
+    void*         sqes;
+    unsigned int* cqHead;
+    unsigned int* cqTail;
+    unsigned int* cqMask;
+    void*         cqes;
+
+    void*         sqRing;
+    size_t        sqRingSize;
+    void*         cqRing;
+    size_t        cqRingSize;
+    size_t        sqesSize;
+} IO_RING;
+
+// One iovec for IoRingWritev, laid out like struct iovec
+typedef struct {
+    void*  base;
+    size_t len;
+} IO_RING_BUF;
+
+int  IoRingInit(IO_RING* ring, unsigned int entries, int eventFd);
+void IoRingFree(IO_RING* ring);
+int  IoRingWritev(IO_RING* ring, int fd, const IO_RING_BUF* bufs, int count, uint64 userData);
+int  IoRingSubmit(IO_RING* ring);
+void IoRingDiscard(IO_RING* ring);
+int  IoRingReap(IO_RING* ring, uint64* userData, int* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IO_RING_H
@@ -0,0 +1,27 @@
+#include "latency.h"
+
+void LatencyRecord(LATENCY_HISTOGRAM* histogram, uint64 ms)
+{
+    int bucket = 0;
+
+    while (ms > 0 && bucket < LATENCY_BUCKETS - 1) {
+        ms >>= 1;
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+}
+
+// Returns the upper bound of the bucket which holds the percentile in ms, 0 without samples
+uint64 LatencyPercentile(const LATENCY_HISTOGRAM* histogram, unsigned int percent)
+{
+    uint64 rank = (histogram->count * percent + 99) / 100; // samples at or below the percentile
+    uint64 seen = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank && seen > 0)
+            return i == 0 ? 0 : ((uint64)1 << i) - 1;
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_BUCKETS 20 // bucket 0 = 0 ms, bucket i = below 2^i ms, the last one takes everything above
+
+// Latency distribution with power of two buckets, so a percentile is known within a factor of two. Not thread safe,
+// the owner records under its own lock.
+typedef struct {
+    uint64 buckets[LATENCY_BUCKETS];
+    uint64 count;
+} LATENCY_HISTOGRAM;
+
+void   LatencyRecord(LATENCY_HISTOGRAM* histogram, uint64 ms);
+uint64 LatencyPercentile(const LATENCY_HISTOGRAM* histogram, unsigned int percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_H
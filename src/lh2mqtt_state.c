@@ -0,0 +1,77 @@
+/*
+ * lh2mqtt-state - example reader of the state file of the lh2mqtt plugin
+ *
+ * Prints the current speaker of every server tab, with -f again whenever it changes. The plugin writes the file
+ * set in STATE_FILE (see state_file.h), readers map it and copy a slot under its seqlock, so they need no broker,
+ * no lock and no system call per poll, and never block the plugin.
+ *
+ * Usage: lh2mqtt-state [-f] file
+ */
+
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "state_file.h"
+
+#define POLL_MS 50
+
+static void PrintState(const STATE_FILE* file)
+{
+    uint64 now   = GetMonotonicTimeMs();
+    int    found = 0;
+
+    for (int i = 0; i < STATE_FILE_SERVERS; i++) {
+        STATE_FILE_SERVER slot;
+
+        if (!StateFileRead(file, i, &slot))
+            continue;
+        found = 1;
+        if (slot.clientID == 0)
+            printf("server %llu (%s): nobody talks\n", (unsigned long long)slot.serverConnectionHandlerID, slot.serverUid);
+        else
+            printf("server %llu (%s): %s talks for %llu ms, %u talking\n", (unsigned long long)slot.serverConnectionHandlerID, slot.serverUid, slot.speaker,
+                   (unsigned long long)(now - slot.sinceMs), slot.talkers);
+    }
+    if (!found)
+        printf("no server tab\n");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    STATE_FILE  file;
+    int         follow = argc > 2 && strcmp(argv[1], "-f") == 0;
+    const char* path   = argv[argc - 1];
+    uint64      seen;
+
+    if (argc < 2 || (argc > 2 && !follow)) {
+        fprintf(stderr, "usage: %s [-f] file\n", argv[0]);
+        return 2;
+    }
+    if (!StateFileAttach(&file, path)) {
+        fprintf(stderr, "%s: %s is no state file of lh2mqtt\n", argv[0], path);
+        return 1;
+    }
+
+    seen = StateFileUpdates(&file);
+    PrintState(&file);
+    while (follow) {
+        // only the update counter is polled, the slots are copied when it moved
+        uint64 updates = StateFileUpdates(&file);
+
+        if (updates != seen) {
+            seen = updates;
+            PrintState(&file);
+        }
+#ifdef _WIN32
+        Sleep(POLL_MS);
+#else
+        usleep(POLL_MS * 1000);
+#endif
+    }
+    StateFileDetach(&file);
+    return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * lh2mqttd - companion daemon of the lh2mqtt plugin (Linux only)
+ *
+ * Does all broker I/O outside the TeamSpeak client. The plugin appends messages to a shared memory ring
+ * (see shm_ring.h) and the daemon publishes them in order. Plain TCP connections are kept open with the
+ * built-in MQTT client, TLS connections (CAFILE set) are sent with mosquitto_pub.
+ *
+ * Usage: lh2mqttd [shm name]
+ *
+ * The broker host is resolved on a worker thread and cached, see resolver.h. LH2MQTTD_HOSTS may name a file in
+ * /etc/hosts format which is checked before DNS. With several brokers in HOST the daemon fails over between them,
+ * see broker_set.h. A host "unix:/path" is the Unix domain socket of a broker on the same machine, it is always
+ * published to with the built-in client and without TLS.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "broker_set.h"
+#include "mqtt_client.h"
+#include "shm_ring.h"
+
+#define IDLE_WAIT_MS        1000
+#define RETRY_MIN_MS        500
+#define RETRY_MAX_MS        30000
+#define ATTEMPTS_PER_RECORD 3       // a record the broker keeps refusing is dropped after this many tries
+#define ORPHAN_EXIT_MS      60000   // exit when the plugin is gone and everything was sent
+#define KEEPALIVE_SEC       60
+#define EXE_TIMEOUT_MS      30000   // a mosquitto_pub running longer is killed
+#define EXE_POLL_MS         10
+
+// result of a publish attempt, only PUBLISH_FAILED counts towards ATTEMPTS_PER_RECORD
+#define PUBLISH_OK          0
+#define PUBLISH_UNREACHABLE 1 // no connection to any broker, the record waits for it
+#define PUBLISH_FAILED      2 // the broker was reached but the message was not accepted
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void OnSignal(int sig)
+{
+    (void)sig;
+    stopRequested = 1;
+}
+
+// Wait hook of the MQTT client, resolving, connecting and waiting for an acknowledgement can take up to
+// MQTT_TIMEOUT_MS each, longer than the plugin waits for a heartbeat (SHM_RING_DEAD_MS)
+static int KeepHeartbeat(void* arg)
+{
+    ShmRingHeartbeat((SHM_RING*)arg);
+    return !stopRequested;
+}
+
+// Runs mosquitto_pub without a shell, so topic and message need no escaping. The heartbeat goes on while it runs,
+// so the plugin does not take a slow publish for a dead daemon. Killed after EXE_TIMEOUT_MS.
+static int PublishWithExe(SHM_RING* ring, const SHM_RING_CONFIG* config, const char* host, const char* topic, const char* message)
+{
+    const char* argv[20];
+    int         argc = 0;
+    int         status;
+    pid_t       pid;
+    pid_t       done;
+    uint64      deadline;
+
+    argv[argc++] = config->exe;
+    argv[argc++] = "-h";
+    argv[argc++] = host;
+    if (config->port[0] != '\0') {
+        argv[argc++] = "-p";
+        argv[argc++] = config->port;
+    }
+    if (config->user[0] != '\0') {
+        argv[argc++] = "-u";
+        argv[argc++] = config->user;
+        argv[argc++] = "-P";
+        argv[argc++] = config->password;
+    }
+    if (config->qos[0] != '\0') {
+        argv[argc++] = "-q";
+        argv[argc++] = config->qos;
+    }
+    if (config->cafile[0] != '\0') {
+        argv[argc++] = "--cafile";
+        argv[argc++] = config->cafile;
+    }
+    argv[argc++] = "-t";
+    argv[argc++] = topic;
+    argv[argc++] = "-m";
+    argv[argc++] = message;
+    argv[argc]   = NULL;
+
+    pid = fork();
+    if (pid < 0)
+        return 0;
+    if (pid == 0) {
+        execvp(config->exe, (char* const*)argv);
+        _exit(127);
+    }
+    deadline = GetMonotonicTimeMs() + EXE_TIMEOUT_MS;
+    while ((done = waitpid(pid, &status, WNOHANG)) == 0 || (done < 0 && errno == EINTR)) {
+        ShmRingHeartbeat(ring);
+        if (GetMonotonicTimeMs() >= deadline) {
+            printf("lh2mqttd: %s did not finish within %d ms, killed\n", config->exe, EXE_TIMEOUT_MS);
+            kill(pid, SIGKILL);
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+                ;
+            return 0;
+        }
+        usleep(EXE_POLL_MS * 1000);
+    }
+    if (done < 0)
+        return 0;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Publishes to the broker chosen by the broker set, the connection follows when it switches brokers.
+// Returns PUBLISH_OK, PUBLISH_UNREACHABLE or PUBLISH_FAILED.
+static int Publish(SHM_RING* ring, MQTT_CLIENT* client, int* clientBroker, BROKER_SET* brokers, const SHM_RING_CONFIG* config, const char* topic,
+                   const char* message)
+{
+    char clientId[32];
+    char host[sizeof(config->host)];
+    int  index = BrokerSetSelect(brokers, host, sizeof(host));
+    int  ok;
+
+    if (index < 0)
+        return PUBLISH_UNREACHABLE;
+    // a local socket needs no TLS
+    if (config->cafile[0] != '\0' && !MqttIsUnixHost(host)) {
+        ok = PublishWithExe(ring, config, host, topic, message);
+        BrokerSetReport(brokers, index, ok, BROKER_NO_RTT);
+        if (ok)
+            return PUBLISH_OK;
+        return MqttReachable(client, host, config->port[0] != '\0' ? config->port : MQTT_DEFAULT_PORT) ? PUBLISH_FAILED : PUBLISH_UNREACHABLE;
+    }
+
+    if (client->fd >= 0 && *clientBroker != index)
+        MqttDisconnect(client);
+    if (client->fd < 0) {
+        snprintf(clientId, sizeof(clientId), "lh2mqttd-%d", (int)getpid());
+        if (!MqttConnect(client, host, config->port, clientId, config->user, config->password, KEEPALIVE_SEC)) {
+            if (MqttIsUnixHost(host))
+                printf("lh2mqttd: could not connect to %s\n", host);
+            else
+                printf("lh2mqttd: could not connect to %s:%s\n", host, config->port[0] != '\0' ? config->port : MQTT_DEFAULT_PORT);
+            BrokerSetReport(brokers, index, 0, BROKER_NO_RTT);
+            return PUBLISH_UNREACHABLE;
+        }
+        *clientBroker = index;
+        printf("lh2mqttd: connected to %s\n", host);
+    }
+    ok = MqttPublish(client, topic, message, atoi(config->qos));
+    if (!ok)
+        BrokerSetReport(brokers, index, 0, BROKER_NO_RTT);
+    return ok ? PUBLISH_OK : PUBLISH_FAILED;
+}
+
+// Measures the RTT of the active broker, failures make the next publish fail over
+static void PingBroker(MQTT_CLIENT* client, int clientBroker, BROKER_SET* brokers)
+{
+    uint64 start = GetMonotonicTimeMs();
+    int    ok    = MqttPing(client);
+
+    BrokerSetReport(brokers, clientBroker, ok, ok ? GetMonotonicTimeMs() - start : BROKER_NO_RTT);
+}
+
+static void ExportBrokerStats(SHM_RING* ring, BROKER_SET* brokers)
+{
+    SHM_RING_HEADER* h = ring->header;
+    BROKER_STATS     stats;
+
+    BrokerSetGetStats(brokers, &stats);
+    h->activeBroker = stats.active;
+    h->failovers    = stats.failovers;
+    for (int i = 0; i < SHM_RING_BROKERS; i++) {
+        h->brokerHealthy[i] = i < stats.count ? stats.healthy[i] : 0;
+        h->brokerRttMs[i]   = i < stats.count && stats.rttMs[i] != BROKER_NO_RTT ? (int)stats.rttMs[i] : -1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    SHM_RING        ring;
+    SHM_RING_CONFIG config;
+    MQTT_CLIENT     client;
+    RESOLVER        resolver;
+    BROKER_SET      brokers;
+    int             clientBroker = -1; // index of the broker client is connected to
+    char            name[64];
+    unsigned int    generation = 0;
+    unsigned int    attempts   = 0;
+    uint64          retryMs    = RETRY_MIN_MS;
+    uint64          orphanMs   = 0;
+    uint64          retryAtMs  = 0; // the record at the head is not tried again before
+    uint64          now;
+
+    if (argc > 1)
+        snprintf(name, sizeof(name), "%s", argv[1]);
+    else
+        ShmRingName(name, sizeof(name));
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, OnSignal);
+    signal(SIGINT, OnSignal);
+
+    if (!ShmRingAttach(&ring, name)) {
+        fprintf(stderr, "lh2mqttd: ring %s not available or another daemon is attached\n", name);
+        return 1;
+    }
+    memset(&config, 0, sizeof(config));
+    if (!ResolverStart(&resolver, getenv("LH2MQTTD_HOSTS")))
+        printf("lh2mqttd: resolver worker could not be started, resolving on connect\n");
+    MqttInit(&client);
+    client.resolver = &resolver;
+    client.wait     = KeepHeartbeat;
+    client.waitArg  = &ring;
+    if (!BrokerSetStart(&brokers, &resolver))
+        printf("lh2mqttd: probe worker could not be started, standby brokers are not probed\n");
+    printf("lh2mqttd: attached to %s\n", name);
+
+    while (!stopRequested && !__atomic_load_n(&ring.header->closed, __ATOMIC_ACQUIRE)) {
+        const SHM_RING_RECORD* record;
+        const char*            topic;
+        const char*            message;
+
+        // a reloaded plugin configuration takes effect with the next connection
+        if (ShmRingGetConfig(&ring, &config, &generation)) {
+            char host[sizeof(config.host)];
+
+            MqttDisconnect(&client);
+            BrokerSetConfigure(&brokers, config.host, config.port[0] != '\0' ? config.port : MQTT_DEFAULT_PORT, config.user, config.password,
+                               config.cafile[0] == '\0');
+            // resolved in the background, the first message does not wait for DNS if it comes later
+            if (BrokerSetSelect(&brokers, host, sizeof(host)) >= 0 && config.cafile[0] == '\0' && !MqttIsUnixHost(host))
+                ResolverLookup(&resolver, host, config.port[0] != '\0' ? config.port : MQTT_DEFAULT_PORT, NULL, 0, 0);
+        }
+        ExportBrokerStats(&ring, &brokers);
+
+        ShmRingHeartbeat(&ring);
+        // a record waiting for its retry does not hold up the checks below, new records do not shorten the backoff
+        if (config.host[0] != '\0' && GetMonotonicTimeMs() >= retryAtMs && ShmRingPeek(&ring, &record, &topic, &message)) {
+            int result = Publish(&ring, &client, &clientBroker, &brokers, &config, topic, message);
+
+            retryAtMs = 0;
+            if (result == PUBLISH_OK) {
+                ring.header->published++;
+            } else if (result == PUBLISH_UNREACHABLE || ++attempts < ATTEMPTS_PER_RECORD) {
+                // broker unreachable or attempts left, keep the record and try again later
+                retryAtMs = GetMonotonicTimeMs() + retryMs;
+                retryMs   = retryMs * 2 < RETRY_MAX_MS ? retryMs * 2 : RETRY_MAX_MS;
+            } else {
+                printf("lh2mqttd: message to %s dropped after %u attempts\n", topic, attempts);
+                ring.header->failed++;
+            }
+            if (retryAtMs == 0) {
+                ShmRingConsume(&ring, record);
+                attempts = 0;
+                retryMs  = RETRY_MIN_MS;
+                orphanMs = 0;
+                continue;
+            }
+        }
+
+        // an orphaned daemon also gives up on records it cannot send, the next plugin instance takes them over
+        if (!ShmRingProducerAlive(&ring)) {
+            if (orphanMs == 0)
+                orphanMs = GetMonotonicTimeMs();
+            else if (GetMonotonicTimeMs() - orphanMs > ORPHAN_EXIT_MS)
+                break;
+        } else {
+            orphanMs = 0;
+        }
+
+        if (client.fd >= 0 && GetMonotonicTimeMs() - client.lastSendMs > BROKER_PROBE_MS)
+            PingBroker(&client, clientBroker, &brokers);
+        now = GetMonotonicTimeMs();
+        ShmRingWait(&ring, retryAtMs > now && retryAtMs - now < IDLE_WAIT_MS ? retryAtMs - now : IDLE_WAIT_MS);
+    }
+
+    printf("lh2mqttd: exiting\n");
+    MqttDisconnect(&client);
+    BrokerSetStop(&brokers);
+    ResolverStop(&resolver);
+    ShmRingClose(&ring);
+    return 0;
+}
@@ -0,0 +1,428 @@
+#include "mqtt_client.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+#define MQTT_PACKET_MAX  (64 * 1024)
+
+#define MQTT_ATTEMPT_DELAY_MS 250 // RFC 8305 connection attempt delay
+
+void MqttInit(MQTT_CLIENT* client)
+{
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+}
+
+int MqttIsUnixHost(const char* host)
+{
+    return strncmp(host, MQTT_UNIX_PREFIX, strlen(MQTT_UNIX_PREFIX)) == 0;
+}
+
+static int WaitHook(MQTT_CLIENT* client)
+{
+    return client->wait == NULL || client->wait(client->waitArg);
+}
+
+// poll in slices of MQTT_WAIT_SLICE_MS with the wait hook in between. Returns the result of poll, 0 when the
+// deadline passed or the hook gave up.
+static int PollSliced(MQTT_CLIENT* client, struct pollfd* fds, int count, uint64 deadline)
+{
+    for (;;) {
+        uint64 now = GetMonotonicTimeMs();
+        int    n;
+
+        if (now >= deadline || !WaitHook(client))
+            return 0;
+        n = poll(fds, count, (int)(deadline - now < MQTT_WAIT_SLICE_MS ? deadline - now : MQTT_WAIT_SLICE_MS));
+        if (n > 0 || (n < 0 && errno != EINTR))
+            return n;
+    }
+}
+
+// Waits until the socket is readable (POLLIN) or writable (POLLOUT)
+static int WaitSocket(MQTT_CLIENT* client, short events, uint64 deadline)
+{
+    struct pollfd pfd;
+
+    pfd.fd      = client->fd;
+    pfd.events  = events;
+    pfd.revents = 0;
+    return PollSliced(client, &pfd, 1, deadline) > 0;
+}
+
+static int SendAll(MQTT_CLIENT* client, const unsigned char* buf, size_t len)
+{
+    uint64 deadline = GetMonotonicTimeMs() + MQTT_TIMEOUT_MS;
+
+    while (len > 0) {
+        ssize_t n = send(client->fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!WaitSocket(client, POLLOUT, deadline))
+                return 0;
+            continue;
+        }
+        if (n <= 0)
+            return 0;
+        buf += n;
+        len -= (size_t)n;
+    }
+    client->lastSendMs = GetMonotonicTimeMs();
+    return 1;
+}
+
+static int RecvAll(MQTT_CLIENT* client, unsigned char* buf, size_t len, uint64 deadline)
+{
+    while (len > 0) {
+        ssize_t n = recv(client->fd, buf, len, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!WaitSocket(client, POLLIN, deadline))
+                return 0;
+            continue;
+        }
+        if (n <= 0)
+            return 0;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Reads one packet, returns its type byte or -1. Payloads larger than size are skipped.
+static int ReadPacket(MQTT_CLIENT* client, unsigned char* buf, size_t size, size_t* len)
+{
+    unsigned char type;
+    unsigned char b;
+    size_t        remaining  = 0;
+    int           multiplier = 1;
+    uint64        deadline   = GetMonotonicTimeMs() + MQTT_TIMEOUT_MS;
+
+    if (!RecvAll(client, &type, 1, deadline))
+        return -1;
+    do {
+        if (!RecvAll(client, &b, 1, deadline) || multiplier > 128 * 128 * 128)
+            return -1;
+        remaining += (size_t)(b & 0x7F) * multiplier;
+        multiplier *= 128;
+    } while (b & 0x80);
+
+    *len = remaining;
+    while (remaining > 0) {
+        unsigned char skip[256];
+        size_t        chunk = remaining <= size ? remaining : (remaining < sizeof(skip) ? remaining : sizeof(skip));
+        if (!RecvAll(client, remaining <= size ? buf : skip, chunk, deadline))
+            return -1;
+        remaining -= chunk;
+    }
+    return type;
+}
+
+static size_t PutLength(unsigned char* out, size_t remaining)
+{
+    size_t n = 0;
+
+    do {
+        unsigned char b = remaining % 128;
+        remaining /= 128;
+        out[n++] = remaining > 0 ? (unsigned char)(b | 0x80) : b;
+    } while (remaining > 0);
+    return n;
+}
+
+static size_t PutString(unsigned char* out, const char* str)
+{
+    size_t len = strlen(str);
+
+    out[0] = (unsigned char)(len >> 8);
+    out[1] = (unsigned char)(len & 0xFF);
+    memcpy(out + 2, str, len);
+    return len + 2;
+}
+
+// The socket stays non-blocking, every wait goes through PollSliced
+static void SetupSocket(int fd, int tcp)
+{
+    int one = 1;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (tcp)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// A broker on the same host, no loopback TCP and nothing to resolve. connect on a Unix socket does not block.
+static int ConnectUnixSocket(MQTT_CLIENT* client, const char* path)
+{
+    struct sockaddr_un addr;
+    int                fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return 0;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path));
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return 0;
+    if (connect(fd, (const struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return 0;
+    }
+    client->fd = fd;
+    SetupSocket(fd, 0);
+    return 1;
+}
+
+// Happy Eyeballs (RFC 8305): the addresses are tried in the order of the resolver, which alternates IPv6 and IPv4.
+// A new attempt starts every MQTT_ATTEMPT_DELAY_MS, or right away when one fails, while the earlier ones keep
+// running. The first connection wins, so a black-holed address family costs only the attempt delay.
+static int ConnectSocket(MQTT_CLIENT* client, const char* host, const char* port)
+{
+    RESOLVER_ADDR addrs[RESOLVER_MAX_ADDRS];
+    struct pollfd fds[RESOLVER_MAX_ADDRS];
+    int           count;
+    int           active    = 0;
+    int           next      = 0;
+    uint64        now       = GetMonotonicTimeMs();
+    uint64        deadline  = now + MQTT_TIMEOUT_MS;
+    uint64        attemptMs = now;
+
+    if (MqttIsUnixHost(host))
+        return ConnectUnixSocket(client, host + strlen(MQTT_UNIX_PREFIX));
+    if (port == NULL || port[0] == '\0')
+        port = MQTT_DEFAULT_PORT;
+    if (client->resolver != NULL) {
+        // in slices, the wait hook may give up on a slow lookup
+        do
+            count = ResolverLookup(client->resolver, host, port, addrs, RESOLVER_MAX_ADDRS, MQTT_WAIT_SLICE_MS);
+        while (count < 0 && GetMonotonicTimeMs() < deadline && WaitHook(client));
+    } else {
+        count = ResolveHost(NULL, host, port, addrs, RESOLVER_MAX_ADDRS);
+    }
+
+    while (client->fd < 0 && (now = GetMonotonicTimeMs()) < deadline) {
+        uint64 waitMs = deadline - now;
+
+        if (next < count && (now >= attemptMs || active == 0)) {
+            const RESOLVER_ADDR* addr = &addrs[next++];
+            int                  fd   = socket(addr->family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+
+            attemptMs = now + MQTT_ATTEMPT_DELAY_MS;
+            if (fd < 0) {
+                attemptMs = now;
+                continue;
+            }
+            if (connect(fd, (const struct sockaddr*)&addr->addr, addr->len) == 0) {
+                client->fd = fd;
+                break;
+            }
+            if (errno != EINPROGRESS) {
+                close(fd);
+                attemptMs = now;
+                continue;
+            }
+            fds[active].fd     = fd;
+            fds[active].events = POLLOUT;
+            active++;
+            continue;
+        }
+        if (active == 0)
+            break;
+        if (next < count && attemptMs - now < waitMs)
+            waitMs = attemptMs - now;
+        if (PollSliced(client, fds, active, now + waitMs) <= 0) {
+            if (!WaitHook(client))
+                break;
+            continue;
+        }
+
+        for (int i = 0; i < active && client->fd < 0; i++) {
+            int       error = 0;
+            socklen_t len   = sizeof(error);
+
+            if (fds[i].revents == 0)
+                continue;
+            if (getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0) {
+                client->fd = fds[i].fd;
+            } else {
+                // failed, the next address does not have to wait for the delay
+                close(fds[i].fd);
+                attemptMs = 0;
+            }
+            fds[i--] = fds[--active];
+        }
+    }
+    for (int i = 0; i < active; i++) {
+        if (fds[i].fd != client->fd)
+            close(fds[i].fd);
+    }
+    if (client->fd < 0)
+        return 0;
+    SetupSocket(client->fd, 1);
+    return 1;
+}
+
+// Connects with a clean session, returns 0 if the broker could not be reached or refused the connection
+int MqttConnect(MQTT_CLIENT* client, const char* host, const char* port, const char* clientId, const char* user, const char* password, unsigned short keepAliveSec)
+{
+    unsigned char packet[1024];
+    unsigned char body[1024];
+    size_t        len   = 0;
+    size_t        n;
+    unsigned char flags = 0x02; // clean session
+    int           type;
+
+    MqttDisconnect(client);
+    if (strlen(clientId) + strlen(user) + strlen(password) + 32 > sizeof(body))
+        return 0;
+    if (!ConnectSocket(client, host, port))
+        return 0;
+
+    if (user[0] != '\0')
+        flags |= 0x80;
+    if (user[0] != '\0' && password[0] != '\0')
+        flags |= 0x40;
+
+    len += PutString(body + len, "MQTT");
+    body[len++] = 4; // protocol level 3.1.1
+    body[len++] = flags;
+    body[len++] = (unsigned char)(keepAliveSec >> 8);
+    body[len++] = (unsigned char)(keepAliveSec & 0xFF);
+    len += PutString(body + len, clientId);
+    if (flags & 0x80)
+        len += PutString(body + len, user);
+    if (flags & 0x40)
+        len += PutString(body + len, password);
+
+    packet[0] = MQTT_CONNECT;
+    n         = 1 + PutLength(packet + 1, len);
+    memcpy(packet + n, body, len);
+    if (!SendAll(client, packet, n + len))
+        goto fail;
+
+    type = ReadPacket(client, body, sizeof(body), &len);
+    if (type != MQTT_CONNACK || len != 2 || body[1] != 0)
+        goto fail;
+    client->keepAliveSec = keepAliveSec;
+    return 1;
+
+fail:
+    MqttDisconnect(client);
+    return 0;
+}
+
+// Sends one message, with QoS > 0 it returns after the broker acknowledged it. Returns 0 on error, the client is
+// disconnected then.
+int MqttPublish(MQTT_CLIENT* client, const char* topic, const char* payload, int qos)
+{
+    size_t         topicLen   = strlen(topic);
+    size_t         payloadLen = strlen(payload);
+    size_t         remaining  = 2 + topicLen + (qos > 0 ? 2 : 0) + payloadLen;
+    unsigned char  header[16];
+    unsigned char  ack[16];
+    size_t         n;
+    size_t         len;
+    unsigned short id = 0;
+
+    if (client->fd < 0 || remaining > MQTT_PACKET_MAX)
+        return 0;
+    qos = qos > 0 ? 1 : 0;
+
+    header[0] = (unsigned char)(MQTT_PUBLISH | (qos << 1));
+    n         = 1 + PutLength(header + 1, remaining);
+    header[n++] = (unsigned char)(topicLen >> 8);
+    header[n++] = (unsigned char)(topicLen & 0xFF);
+    if (!SendAll(client, header, n) || !SendAll(client, (const unsigned char*)topic, topicLen))
+        goto fail;
+    if (qos > 0) {
+        unsigned char idBytes[2];
+        if (++client->packetId == 0)
+            client->packetId = 1;
+        id         = client->packetId;
+        idBytes[0] = (unsigned char)(id >> 8);
+        idBytes[1] = (unsigned char)(id & 0xFF);
+        if (!SendAll(client, idBytes, 2))
+            goto fail;
+    }
+    if (!SendAll(client, (const unsigned char*)payload, payloadLen))
+        goto fail;
+
+    // other packets (e.g. a late PINGRESP) are skipped while waiting for the acknowledgement
+    while (qos > 0) {
+        int type = ReadPacket(client, ack, sizeof(ack), &len);
+        if (type < 0)
+            goto fail;
+        if ((type & 0xF0) == MQTT_PUBACK && len == 2 && ((ack[0] << 8) | ack[1]) == id)
+            break;
+    }
+    return 1;
+
+fail:
+    MqttDisconnect(client);
+    return 0;
+}
+
+// Keeps an idle connection open, returns 0 if the broker did not answer
+int MqttPing(MQTT_CLIENT* client)
+{
+    unsigned char packet[2] = { MQTT_PINGREQ, 0 };
+    unsigned char buf[16];
+    size_t        len;
+
+    if (client->fd < 0 || !SendAll(client, packet, sizeof(packet)))
+        goto fail;
+    for (;;) {
+        int type = ReadPacket(client, buf, sizeof(buf), &len);
+        if (type < 0)
+            goto fail;
+        if (type == MQTT_PINGRESP)
+            return 1;
+    }
+
+fail:
+    MqttDisconnect(client);
+    return 0;
+}
+
+// Returns 1 if a connection to host can be opened, without speaking MQTT. Tells an unreachable broker from one
+// which refuses a message where only the exit code of mosquitto_pub is known.
+int MqttReachable(MQTT_CLIENT* client, const char* host, const char* port)
+{
+    MQTT_CLIENT probe;
+
+    MqttInit(&probe);
+    probe.resolver = client->resolver;
+    probe.wait     = client->wait;
+    probe.waitArg  = client->waitArg;
+    if (!ConnectSocket(&probe, host, port))
+        return 0;
+    close(probe.fd);
+    return 1;
+}
+
+void MqttDisconnect(MQTT_CLIENT* client)
+{
+    if (client->fd >= 0) {
+        unsigned char packet[2] = { MQTT_DISCONNECT, 0 };
+        send(client->fd, packet, sizeof(packet), MSG_NOSIGNAL);
+        close(client->fd);
+    }
+    client->fd = -1;
+}
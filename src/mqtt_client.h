@@ -0,0 +1,44 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include "platform.h"
+#include "resolver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_DEFAULT_PORT  "1883"
+#define MQTT_TIMEOUT_MS    5000    // connect (including the lookup), send and acknowledgement timeout
+#define MQTT_UNIX_PREFIX   "unix:" // host "unix:/path" connects to the Unix domain socket of a local broker
+#define MQTT_WAIT_SLICE_MS 100     // longest wait between two calls of the wait hook
+
+// Called while the client waits for the network, returns 0 to give up the wait
+typedef int (*MQTT_WAIT_FUNC)(void* arg);
+
+// Minimal blocking MQTT 3.1.1 client for plain TCP or a Unix domain socket, used by lh2mqttd. QoS 2 is sent as QoS 1.
+// While it waits for the network the wait hook is called every MQTT_WAIT_SLICE_MS, e.g. to keep a heartbeat fresh or
+// to give up when the owner shuts down.
+typedef struct {
+    int            fd;       // -1 while disconnected
+    RESOLVER*      resolver; // cached lookups, NULL = resolve on every connect
+    unsigned short packetId;
+    unsigned short keepAliveSec;
+    uint64         lastSendMs;
+    MQTT_WAIT_FUNC wait; // NULL = wait for the timeouts only
+    void*          waitArg;
+} MQTT_CLIENT;
+
+void MqttInit(MQTT_CLIENT* client);
+int  MqttIsUnixHost(const char* host);
+int  MqttConnect(MQTT_CLIENT* client, const char* host, const char* port, const char* clientId, const char* user, const char* password, unsigned short keepAliveSec);
+int  MqttPublish(MQTT_CLIENT* client, const char* topic, const char* payload, int qos);
+int  MqttPing(MQTT_CLIENT* client);
+int  MqttReachable(MQTT_CLIENT* client, const char* host, const char* port);
+void MqttDisconnect(MQTT_CLIENT* client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_CLIENT_H
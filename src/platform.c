@@ -0,0 +1,264 @@
+#include "platform.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    PLATFORM_THREAD_FUNC func;
+    void*                arg;
+} THREAD_START_INFO;
+
+#ifdef _WIN32
+// -------------------- Windows --------------------
+#include <process.h>
+
+uint64 GetMonotonicTimeMs(void)
+{
+    return (uint64)GetTickCount64();
+}
+
+static unsigned __stdcall ThreadMain(void* param)
+{
+    THREAD_START_INFO info = *(THREAD_START_INFO*)param;
+
+    free(param);
+    info.func(info.arg);
+    return 0;
+}
+
+int ThreadStart(PLATFORM_THREAD* thread, PLATFORM_THREAD_FUNC func, void* arg)
+{
+    THREAD_START_INFO* info = (THREAD_START_INFO*)malloc(sizeof(THREAD_START_INFO));
+
+    if (info == NULL)
+        return 0;
+    info->func = func;
+    info->arg  = arg;
+
+    *thread = (HANDLE)_beginthreadex(NULL, 0, ThreadMain, info, 0, NULL);
+    if (*thread == NULL) {
+        free(info);
+        return 0;
+    }
+    return 1;
+}
+
+void ThreadJoin(PLATFORM_THREAD* thread)
+{
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+    *thread = NULL;
+}
+
+void MutexInit(PLATFORM_MUTEX* mutex)
+{
+    InitializeCriticalSection(mutex);
+}
+
+void MutexDestroy(PLATFORM_MUTEX* mutex)
+{
+    DeleteCriticalSection(mutex);
+}
+
+void MutexLock(PLATFORM_MUTEX* mutex)
+{
+    EnterCriticalSection(mutex);
+}
+
+void MutexUnlock(PLATFORM_MUTEX* mutex)
+{
+    LeaveCriticalSection(mutex);
+}
+
+void CondInit(PLATFORM_COND* cond)
+{
+    InitializeConditionVariable(cond);
+}
+
+void CondDestroy(PLATFORM_COND* cond)
+{
+    (void)cond; // nothing to free on Windows
+}
+
+void CondWait(PLATFORM_COND* cond, PLATFORM_MUTEX* mutex)
+{
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+void CondWaitTimeout(PLATFORM_COND* cond, PLATFORM_MUTEX* mutex, uint64 timeoutMs)
+{
+    SleepConditionVariableCS(cond, mutex, timeoutMs < INFINITE ? (DWORD)timeoutMs : INFINITE - 1);
+}
+
+void CondSignal(PLATFORM_COND* cond)
+{
+    WakeConditionVariable(cond);
+}
+
+void CondBroadcast(PLATFORM_COND* cond)
+{
+    WakeAllConditionVariable(cond);
+}
+
+uint64 AtomicLoad64(volatile uint64* value)
+{
+    return (uint64)InterlockedCompareExchange64((volatile LONG64*)value, 0, 0);
+}
+
+int AtomicCompareExchange64(volatile uint64* value, uint64 expected, uint64 desired)
+{
+    return (uint64)InterlockedCompareExchange64((volatile LONG64*)value, (LONG64)desired, (LONG64)expected) == expected;
+}
+
+uint64 AtomicExchange64(volatile uint64* value, uint64 desired)
+{
+    return (uint64)InterlockedExchange64((volatile LONG64*)value, (LONG64)desired);
+}
+
+uint64 AtomicAdd64(volatile uint64* value, uint64 delta)
+{
+    return (uint64)InterlockedExchangeAdd64((volatile LONG64*)value, (LONG64)delta) + delta;
+}
+
+void* AtomicExchangePointer(void* volatile* pointer, void* desired)
+{
+    return InterlockedExchangePointer(pointer, desired);
+}
+
+#else
+// -------------------- Linux / Unix --------------------
+#include <time.h>
+
+uint64 GetMonotonicTimeMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000 + (uint64)ts.tv_nsec / 1000000;
+}
+
+static void* ThreadMain(void* param)
+{
+    THREAD_START_INFO info = *(THREAD_START_INFO*)param;
+
+    free(param);
+    info.func(info.arg);
+    return NULL;
+}
+
+int ThreadStart(PLATFORM_THREAD* thread, PLATFORM_THREAD_FUNC func, void* arg)
+{
+    THREAD_START_INFO* info = (THREAD_START_INFO*)malloc(sizeof(THREAD_START_INFO));
+
+    if (info == NULL)
+        return 0;
+    info->func = func;
+    info->arg  = arg;
+
+    if (pthread_create(thread, NULL, ThreadMain, info) != 0) {
+        free(info);
+        return 0;
+    }
+    return 1;
+}
+
+void ThreadJoin(PLATFORM_THREAD* thread)
+{
+    pthread_join(*thread, NULL);
+}
+
+void MutexInit(PLATFORM_MUTEX* mutex)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void MutexDestroy(PLATFORM_MUTEX* mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+
+void MutexLock(PLATFORM_MUTEX* mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+void MutexUnlock(PLATFORM_MUTEX* mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+// Timed waits use the monotonic clock, so changing the system time does not stretch them
+void CondInit(PLATFORM_COND* cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void CondDestroy(PLATFORM_COND* cond)
+{
+    pthread_cond_destroy(cond);
+}
+
+void CondWait(PLATFORM_COND* cond, PLATFORM_MUTEX* mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+
+void CondWaitTimeout(PLATFORM_COND* cond, PLATFORM_MUTEX* mutex, uint64 timeoutMs)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec  += (time_t)(timeoutMs / 1000);
+    ts.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(cond, mutex, &ts);
+}
+
+void CondSignal(PLATFORM_COND* cond)
+{
+    pthread_cond_signal(cond);
+}
+
+void CondBroadcast(PLATFORM_COND* cond)
+{
+    pthread_cond_broadcast(cond);
+}
+
+uint64 AtomicLoad64(volatile uint64* value)
+{
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+int AtomicCompareExchange64(volatile uint64* value, uint64 expected, uint64 desired)
+{
+    return __atomic_compare_exchange_n(value, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+uint64 AtomicExchange64(volatile uint64* value, uint64 desired)
+{
+    return __atomic_exchange_n(value, desired, __ATOMIC_SEQ_CST);
+}
+
+uint64 AtomicAdd64(volatile uint64* value, uint64 delta)
+{
+    return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+}
+
+void* AtomicExchangePointer(void* volatile* pointer, void* desired)
+{
+    return __atomic_exchange_n(pointer, desired, __ATOMIC_SEQ_CST);
+}
+
+#endif // !_WIN32
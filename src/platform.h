@@ -0,0 +1,59 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _WIN32
+typedef HANDLE             PLATFORM_THREAD;
+typedef CRITICAL_SECTION   PLATFORM_MUTEX;
+typedef CONDITION_VARIABLE PLATFORM_COND;
+#else
+typedef pthread_t       PLATFORM_THREAD;
+typedef pthread_mutex_t PLATFORM_MUTEX;
+typedef pthread_cond_t  PLATFORM_COND;
+#endif
+
+typedef void (*PLATFORM_THREAD_FUNC)(void* arg);
+
+// Milliseconds from a monotonic clock, not affected by changes of the system time
+uint64 GetMonotonicTimeMs(void);
+
+// Returns 0 if the thread could not be started
+int  ThreadStart(PLATFORM_THREAD* thread, PLATFORM_THREAD_FUNC func, void* arg);
+void ThreadJoin(PLATFORM_THREAD* thread);
+
+// Mutexes are recursive on all platforms (like a Windows critical section)
+void MutexInit(PLATFORM_MUTEX* mutex);
+void MutexDestroy(PLATFORM_MUTEX* mutex);
+void MutexLock(PLATFORM_MUTEX* mutex);
+void MutexUnlock(PLATFORM_MUTEX* mutex);
+
+void CondInit(PLATFORM_COND* cond);
+void CondDestroy(PLATFORM_COND* cond);
+void CondWait(PLATFORM_COND* cond, PLATFORM_MUTEX* mutex);
+void CondWaitTimeout(PLATFORM_COND* cond, PLATFORM_MUTEX* mutex, uint64 timeoutMs);
+void CondSignal(PLATFORM_COND* cond);
+void CondBroadcast(PLATFORM_COND* cond);
+
+// Atomic operations with a full barrier, for counters and pointers shared without a lock
+uint64 AtomicLoad64(volatile uint64* value);
+int    AtomicCompareExchange64(volatile uint64* value, uint64 expected, uint64 desired);
+uint64 AtomicExchange64(volatile uint64* value, uint64 desired);
+uint64 AtomicAdd64(volatile uint64* value, uint64 delta);
+void*  AtomicExchangePointer(void* volatile* pointer, void* desired);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PLATFORM_H
@@ -10,6 +10,7 @@
 #endif
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +24,19 @@
 
 #include "plugin.h"
 #include "ini_wrapper.h"
+#include "server_shard.h"
+#include "return_codes.h"
+#include "talk_sessions.h"
+#include "text_escape.h"
+#include "dispatch.h"
+#include "event_loop.h"
+#include "shm_ring.h"
+#include "slab.h"
+#include "sink.h"
+#include "spool.h"
+#include "rate_limit.h"
+#include "state_file.h"
+#include "platform.h"
 
 static struct TS3Functions ts3Functions;
 
@@ -38,7 +52,12 @@ static int LocalTimeSafe(const time_t* t, struct tm* out) {
 #define _strcpy(dest, destSize, src) strcpy_s(dest, destSize, src)
 #define _snprintf(dest, size, fmt, ...) sprintf_s(dest, size, fmt, __VA_ARGS__)
 #else
+#include <errno.h>
+#include <signal.h>
 #include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "mqtt_client.h"
 #define _strcpy(dest, destSize, src) snprintf(dest, destSize, "%s", src)
 #define _snprintf(dest, size, fmt, ...) snprintf(dest, size, fmt, ##__VA_ARGS__)
 #endif
@@ -58,7 +77,12 @@ static int LocalTimeSafe(const time_t* t, struct tm* out) {
 #define RETURNCODE_BUFSIZE 128
 #define BIG_BUFSIZE 1024
 #define TS3LOG_BUFSIZE 2000
-#define SHELL_BUFSIZE 2000
+#define SHELL_BUFSIZE 4096
+
+#define UNIX_HOST_PREFIX "unix:" // HOST=unix:/path is the Unix domain socket of a local broker
+
+#define EXTRA_BROKER_KEEPALIVE_SEC 60   // [BROKERn] connections, see ExtraBrokerPublishDirect
+#define EXTRA_BROKER_RECONNECT_MS  5000 // messages to an unreachable broker are dropped meanwhile
 
 static char* pluginID = NULL;
 
@@ -75,6 +99,19 @@ static char configMqttSendStart[LOG_LEN];
 static char configMqttSendStop[LOG_LEN];
 static char configMqttTopicStart[TOPIC_LEN];
 static char configMqttTopicStop[TOPIC_LEN];
+static char configMqttMessage[MESSAGE_LEN];
+static char configMqttMessageStop[MESSAGE_LEN];
+static char configMqttPayload[LOG_LEN];
+static char configMqttTopicSnapshot[TOPIC_LEN];
+static char configMqttTopicSpeakers[TOPIC_LEN];
+static char configMqttSpeakersInterval[INTERVAL_LEN];
+static char configMqttDaemon[PATH_LEN];
+static char configMqttShutdownTimeout[INTERVAL_LEN];
+static char configMqttRateLimit[INTERVAL_LEN];
+static char configMqttRateBurst[INTERVAL_LEN];
+static char configMqttRatePerSpeaker[LOG_LEN];
+static char configMqttPriorityClients[CLIENTS_LEN];
+static char configMqttStateFile[PATH_LEN];
 
 static char configLhShowStart[LOG_LEN];
 static char configLhShowStop[LOG_LEN];
@@ -84,9 +121,137 @@ static char configLhPrefixStart[PREFIX_LEN];
 static char configLhPrefixStop[PREFIX_LEN];
 
 static char configLogMqttMsg[LOG_LEN];
+static char configLogFile[PATH_LEN];
 
 static char configGeneralLanguage[LANG_LEN];
 
+// client, channel and group caches, one shard per server tab
+static SERVER_SHARD_TABLE shards;
+
+// nicknames and UIDs, cache entries and events only carry handles into it
+static STRING_POOL strings;
+
+// PRIORITY_CLIENTS interned once per configuration load, equal to the name or UID handle of a listed client.
+// Guarded by cacheLock.
+#define PRIORITY_CLIENTS_MAX 32
+static STRING_HANDLE priorityClients[PRIORITY_CLIENTS_MAX];
+static int           priorityClientCount = 0;
+
+// guards the shards above, which are filled by the snapshot worker and patched by the client callbacks
+static PLATFORM_MUTEX cacheLock;
+static BOOL           cacheLockInitialized = FALSE;
+
+// connect snapshot worker, collects the state of a freshly connected server tab off the client thread
+#define SNAPSHOT_QUEUE_LEN 16
+
+static PLATFORM_THREAD snapshotThread;
+static PLATFORM_COND   snapshotCond;
+static BOOL            snapshotRunning = FALSE;
+static BOOL            snapshotStop    = FALSE;
+static uint64          snapshotQueue[SNAPSHOT_QUEUE_LEN];
+static int             snapshotQueueCount = 0;
+static uint64          snapshotBusy       = 0; // server tab currently collected by the worker
+static BOOL            snapshotCancelled  = FALSE;
+static uint64          lastSnapshotDurationMs = 0;
+
+// periodic full list of the active speakers, deltas are published in between
+#define SPEAKERS_INTERVAL_DEFAULT 30 // seconds
+
+// on unload, queued messages are still sent for SHUTDOWN_TIMEOUT, the rest is spooled and sent on the next start
+#define SHUTDOWN_TIMEOUT_DEFAULT 2   // seconds
+#define RELOAD_DRAIN_MS          500 // the same on a reload, the old sinks get this long, see ConfigureSinks
+static char            spoolFileName[BIG_BUFSIZE];
+static volatile uint64 commandDeadlineMs = 0; // running publish commands are killed after this point, 0 = never
+
+// RATE_LIMIT messages per minute and topic, the suppressed ones are summarized on <topic>/suppressed
+#define RATE_BURST_DEFAULT 10
+#define RATE_SUMMARY_MS    10000
+static RATE_LIMITER rateLimiter;
+static EVENT_TIMER  rateLimitTimer;
+
+
+// timers of the plugin run on one event loop thread
+static EVENT_LOOP  eventLoop;
+static BOOL        eventLoopRunning = FALSE;
+static EVENT_TIMER speakersTimer;
+
+// publishes run on worker lanes, all messages of one speaker on the same lane
+static DISPATCHER dispatcher;
+static BOOL       dispatchRunning = FALSE;
+
+// with DAEMON set, messages go through shared memory to lh2mqttd, the dispatcher takes over while it is not running
+#define DAEMON_CHECK_MS     2000
+#define DAEMON_CHECK_MAX_MS 60000
+
+// every output (broker, channel tab, log file) is a sink. The log file and extra brokers have a queue and worker of
+// their own, the broker sink hands its events straight on to lh2mqttd or the publish lanes.
+static SINK_SET sinks;
+static FILE*    logFile      = NULL; // LOG_FILE, only used by the file sink's worker
+static char*    logLines     = NULL; // lines not handed to the event loop yet, see FileSinkFlush
+static size_t   logLinesLen  = 0;
+static size_t   logLinesSize = 0;
+
+#ifndef _WIN32
+// addresses of the [BROKERn] hosts, looked up on a worker so a sink's worker can give up waiting at its deadline
+static RESOLVER brokerResolver;
+static BOOL     brokerResolverStarted = FALSE;
+#endif
+
+static SHM_RING       shmRing;
+static BOOL           shmRingOpen = FALSE;
+static PLATFORM_MUTEX shmRingLock; // the ring has a single producer, pushes of the plugin threads are serialized
+static EVENT_TIMER    daemonTimer;
+static uint64         daemonCheckMs = DAEMON_CHECK_MS;
+
+// lh2mqttd needs a moment to attach after it was started, broker messages wait in the mqtt sink's queue meanwhile
+// instead of starting mosquitto_pub for each of them
+#define DAEMON_WAIT_MS      5000
+#define DAEMON_WAIT_POLL_MS 50
+static EVENT_TIMER daemonWaitTimer;
+static uint64      daemonWaitStartMs = 0;
+
+// STATE_FILE, the current speaker of every server tab for local readers, written under cacheLock
+static STATE_FILE stateFile;
+static BOOL       stateFileOpen = FALSE;
+static char       stateFilePath[PATH_LEN]; // path stateFile was opened with
+
+// ts3plugin_init only reads the configuration and starts the workers, everything slow happens on them
+static uint64          initStartMs     = 0;
+static uint64          initDurationMs  = 0;
+static volatile uint64 firstPublishMs  = 0; // after initStartMs, 0 = nothing published yet
+
+static void SnapshotWorker(void* arg);
+static void OnSpeakersTimer(void* arg);
+static void OnDaemonTimer(void* arg);
+static void OnDaemonWaitTimer(void* arg);
+static void OnRateLimitTimer(void* arg);
+static void OnReturnCodeTimer(void* arg);
+static void PublishSuppressedSummary(const RATE_LIMIT_EVENT* latest, uint64 suppressed, void* arg);
+static void NotePublished(void);
+static void ConfigurePriorityClients(void);
+static void ReleasePriorityClients(void);
+static void UpdateDaemon(void);
+static BOOL DaemonAttached(void);
+static void UpdateStateFile(void);
+static void ConfigureSinks(void);
+static uint64 GetSpeakersIntervalMs(void);
+static uint64 GetShutdownTimeoutMs(void);
+static void SpillSinkEvent(const SINK_OPS* ops, const SINK_EVENT* event, void* arg);
+static void SpillJob(const char* topic, const char* message, void* arg);
+static int ReplaySpooled(const char* topic, const char* message, void* arg);
+static void QueueSnapshot(uint64 serverConnectionHandlerID);
+static void CancelSnapshot(uint64 serverConnectionHandlerID);
+static void PublishMqttMessage(const char* topic, const char* message, uint64 serverConnectionHandlerID, anyID clientID, int priority);
+static BOOL GetBrokerHost(int index, char* host, size_t hostSize);
+static BOOL FormatSpeakerSnapshot(SERVER_SHARD* shard, char* topic, size_t topicSize, char* message, size_t messageSize);
+static void ClientChannelChanged(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID, BOOL leftServer);
+
+static RETURN_CODE_TABLE returnCodes;
+static EVENT_TIMER       returnCodeTimer; // fires at the earliest deadline, see ArmReturnCodeTimer
+
+// talk start time and burst count per speaker, guarded by cacheLock
+static TALK_SESSIONS talkSessions;
+
 #ifdef _WIN32
 /* Helper function to convert wchar_T to Utf-8 encoded strings on Windows */
 static int wcharToUtf8(const wchar_t* str, char** result)
@@ -172,6 +337,45 @@ int ts3plugin_init()
 
     /* Your plugin init code here */
     printf("PLUGIN: init\n");
+    initStartMs    = GetMonotonicTimeMs();
+    firstPublishMs = 0;
+
+    // ts3plugin_init is called again when reloading the configuration, lock and worker are only created once
+    if (!cacheLockInitialized) {
+        SlabInit();
+        MutexInit(&cacheLock);
+        MutexInit(&shmRingLock);
+        CondInit(&snapshotCond);
+        StringPoolInit(&strings);
+        ServerShardInit(&shards, &strings);
+        TalkSessionsInit(&talkSessions); // kept across a reload, so a STOP still finds the session of its START
+        SinkSetInit(&sinks);
+        RateLimitInit(&rateLimiter);
+        ReturnCodeInit(&returnCodes);
+        cacheLockInitialized = TRUE;
+    }
+    // pending return codes stay registered across a reload, the server still answers them
+    if (!snapshotRunning) {
+        snapshotStop    = FALSE;
+        snapshotRunning = ThreadStart(&snapshotThread, SnapshotWorker, NULL);
+        if (!snapshotRunning)
+            printf("PLUGIN: ERROR: snapshot worker could not be started\n");
+    }
+    if (!dispatchRunning) {
+        if (DispatchStart(&dispatcher, ExecuteCommandInBackground) < DISPATCH_LANE_COUNT)
+            printf("PLUGIN: ERROR: not all publish workers could be started, publishing directly\n");
+        dispatchRunning = TRUE;
+    }
+    if (!eventLoopRunning) {
+        EventTimerInit(&speakersTimer, OnSpeakersTimer, NULL);
+        EventTimerInit(&daemonTimer, OnDaemonTimer, NULL);
+        EventTimerInit(&daemonWaitTimer, OnDaemonWaitTimer, NULL);
+        EventTimerInit(&rateLimitTimer, OnRateLimitTimer, NULL);
+        EventTimerInit(&returnCodeTimer, OnReturnCodeTimer, NULL);
+        eventLoopRunning = EventLoopStart(&eventLoop);
+        if (!eventLoopRunning)
+            printf("PLUGIN: ERROR: event loop could not be started\n");
+    }
 
     /* Example on how to query application, resources and configuration paths from client */
     /* Note: Console client returns empty string for app and resources path */
@@ -186,6 +390,7 @@ int ts3plugin_init()
     char* keyName     = NULL;
 
     snprintf(configIniFileName, sizeof(configIniFileName), "%slh2mqtt.ini", pluginPath);
+    snprintf(spoolFileName, sizeof(spoolFileName), "%slh2mqtt.spool", pluginPath);
  
     CreateDefaultIniFile(configIniFileName);
 
@@ -223,6 +428,68 @@ int ts3plugin_init()
     keyName = "TOPIC_STOP";
     ReadIniValue(configIniFileName, sectionName, keyName, configMqttTopicStop, sizeof(configMqttTopicStop), FALSE);
 
+    keyName = "MESSAGE";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttMessage, sizeof(configMqttMessage), FALSE);
+
+    // Adding missing key to older INI-files
+    if (strlen(configMqttMessage) == 0)
+    {
+        BOOL result = WriteIniValue(configIniFileName, sectionName, keyName, "{name}");
+        if (result == TRUE) {
+            snprintf(configMqttMessage, sizeof(configMqttMessage), "%s", "{name}");
+            printf("PLUGIN: missing key added to config file: [%s]%s=%s\n", sectionName, keyName, configMqttMessage);
+
+            char msg[TS3LOG_BUFSIZE];
+            snprintf(msg, sizeof(msg), "Konfigurationsdatei wurde um fehlenden Schluessel ergaenzt: [%s]%s=%s", sectionName, keyName, configMqttMessage);
+            ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", 0);
+        }
+        else
+        {
+            // keep the former behaviour, only the name is sent
+            snprintf(configMqttMessage, sizeof(configMqttMessage), "%s", "{name}");
+            printf("PLUGIN: ERROR: missing key was NOT added to config file, key should be: [%s]%s={name}\n", sectionName, keyName);
+            char msg[TS3LOG_BUFSIZE];
+            snprintf(msg, sizeof(msg), "Konfigurationsdatei konnte NICHT um fehlenden Schluessel ergaenzt werden - soll: [%s]%s={name} in %s", sectionName, keyName, configIniFileName);
+            ts3Functions.logMessage(msg, LogLevel_ERROR, "Plugin lh2mqtt", 0);
+        }
+    }
+
+    keyName = "MESSAGE_STOP";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttMessageStop, sizeof(configMqttMessageStop), FALSE);
+
+    keyName = "PAYLOAD";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttPayload, sizeof(configMqttPayload), FALSE);
+
+    keyName = "TOPIC_SNAPSHOT";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttTopicSnapshot, sizeof(configMqttTopicSnapshot), FALSE);
+
+    keyName = "TOPIC_SPEAKERS";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttTopicSpeakers, sizeof(configMqttTopicSpeakers), FALSE);
+
+    keyName = "SPEAKERS_INTERVAL";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttSpeakersInterval, sizeof(configMqttSpeakersInterval), FALSE);
+
+    keyName = "DAEMON";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttDaemon, sizeof(configMqttDaemon), FALSE);
+
+    keyName = "SHUTDOWN_TIMEOUT";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttShutdownTimeout, sizeof(configMqttShutdownTimeout), FALSE);
+
+    keyName = "RATE_LIMIT";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttRateLimit, sizeof(configMqttRateLimit), FALSE);
+
+    keyName = "RATE_BURST";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttRateBurst, sizeof(configMqttRateBurst), FALSE);
+
+    keyName = "RATE_PER_SPEAKER";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttRatePerSpeaker, sizeof(configMqttRatePerSpeaker), FALSE);
+
+    keyName = "PRIORITY_CLIENTS";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttPriorityClients, sizeof(configMqttPriorityClients), FALSE);
+
+    keyName = "STATE_FILE";
+    ReadIniValue(configIniFileName, sectionName, keyName, configMqttStateFile, sizeof(configMqttStateFile), FALSE);
+
     keyName = "QOS";
     ReadIniValue(configIniFileName, sectionName, keyName, configMqttQos, sizeof(configMqttQos), FALSE);
 
@@ -278,6 +545,9 @@ int ts3plugin_init()
         }
     }
 
+    keyName = "LOG_FILE";
+    ReadIniValue(configIniFileName, sectionName, keyName, configLogFile, sizeof(configLogFile), FALSE);
+
     //-------------------------------
     sectionName = "GENERAL";
 
@@ -317,23 +587,64 @@ int ts3plugin_init()
         ts3Functions.logMessage(msg1a, LogLevel_INFO, "Plugin lh2mqtt", 0);
 
     char msg1b[TS3LOG_BUFSIZE];
-        snprintf(msg1b, sizeof(msg1b), "[INI-MQTT|2] SendStart=%s, SendStop=%s, TopicStart=%s, TopicStop=%s",
-            configMqttSendStart, configMqttSendStop, configMqttTopicStart, configMqttTopicStop);
+        snprintf(msg1b, sizeof(msg1b), "[INI-MQTT|2] SendStart=%s, SendStop=%s, TopicStart=%s, TopicStop=%s, TopicSnapshot=%s, Message=%s, MessageStop=%s, Payload=%s",
+            configMqttSendStart, configMqttSendStop, configMqttTopicStart, configMqttTopicStop, configMqttTopicSnapshot, configMqttMessage, configMqttMessageStop, configMqttPayload);
         ts3Functions.logMessage(msg1b, LogLevel_INFO, "Plugin lh2mqtt", 0);
 
+    char msg1c[TS3LOG_BUFSIZE];
+    snprintf(msg1c, sizeof(msg1c), "[INI-MQTT|3] TopicSpeakers=%s, SpeakersInterval=%s, Daemon=%s, ShutdownTimeout=%s", configMqttTopicSpeakers, configMqttSpeakersInterval, configMqttDaemon, configMqttShutdownTimeout);
+    ts3Functions.logMessage(msg1c, LogLevel_INFO, "Plugin lh2mqtt", 0);
+
+    char msg1d[TS3LOG_BUFSIZE];
+    snprintf(msg1d, sizeof(msg1d), "[INI-MQTT|4] RateLimit=%s, RateBurst=%s, RatePerSpeaker=%s, PriorityClients=%s", configMqttRateLimit, configMqttRateBurst,
+             configMqttRatePerSpeaker, configMqttPriorityClients);
+    ts3Functions.logMessage(msg1d, LogLevel_INFO, "Plugin lh2mqtt", 0);
+
+    char msg1e[TS3LOG_BUFSIZE];
+    snprintf(msg1e, sizeof(msg1e), "[INI-MQTT|5] StateFile=%s", configMqttStateFile);
+    ts3Functions.logMessage(msg1e, LogLevel_INFO, "Plugin lh2mqtt", 0);
+
     char msg2[TS3LOG_BUFSIZE];
     snprintf(msg2, sizeof(msg2), "[INI-CHANNELTAB] ShowStart=%s, ShowStop=%s, ColorStart=%s, ColorStop=%s, PrefixStart=%s, PrefixStop=%s",
         configLhShowStart, configLhShowStop, configLhColorStart, configLhColorStop, configLhPrefixStart, configLhPrefixStop);
     ts3Functions.logMessage(msg2, LogLevel_INFO, "Plugin lh2mqtt", 0);
 
     char msg3[TS3LOG_BUFSIZE];
-    snprintf(msg3, sizeof(msg3), "[INI-LOGGING] LogMqttMsg=%s", configLogMqttMsg);
+    snprintf(msg3, sizeof(msg3), "[INI-LOGGING] LogMqttMsg=%s, LogFile=%s", configLogMqttMsg, configLogFile);
     ts3Functions.logMessage(msg3, LogLevel_INFO, "Plugin lh2mqtt", 0);
 
     char msg4[TS3LOG_BUFSIZE];
     snprintf(msg4, sizeof(msg4), "[INI-GENERAL] Language=%s", configGeneralLanguage);
     ts3Functions.logMessage(msg4, LogLevel_INFO, "Plugin lh2mqtt", 0);
 
+    // (re)arm the periodic speaker lists with the configured interval
+    if (eventLoopRunning) {
+        if (GetSpeakersIntervalMs() > 0)
+            EventTimerStart(&eventLoop, &speakersTimer, GetSpeakersIntervalMs());
+        else
+            EventTimerCancel(&eventLoop, &speakersTimer);
+    }
+    RateLimitConfigure(&rateLimiter, atoi(configMqttRateLimit) > 0 ? (unsigned int)atoi(configMqttRateLimit) : 0,
+                       strlen(configMqttRateBurst) > 0 ? (unsigned int)atoi(configMqttRateBurst) : RATE_BURST_DEFAULT, strcmp(configMqttRatePerSpeaker, "1") == 0);
+    // also runs once after the limit was turned off, to send the last summaries
+    if (eventLoopRunning)
+        EventTimerStart(&eventLoop, &rateLimitTimer, RATE_SUMMARY_MS);
+    ConfigurePriorityClients();
+    UpdateDaemon();
+    UpdateStateFile();
+    ConfigureSinks();
+
+    // messages left over by the last shutdown
+    int spooled = SpoolReplay(spoolFileName, ReplaySpooled, NULL);
+    if (spooled > 0) {
+        char msg5[TS3LOG_BUFSIZE];
+        printf("PLUGIN: replayed %d spooled messages\n", spooled);
+        snprintf(msg5, sizeof(msg5), "%d beim letzten Beenden nicht gesendete Nachrichten werden nachgeholt", spooled);
+        ts3Functions.logMessage(msg5, LogLevel_INFO, "Plugin lh2mqtt", 0);
+    }
+
+    initDurationMs = GetMonotonicTimeMs() - initStartMs;
+    printf("PLUGIN: init took %llu ms\n", (unsigned long long)initDurationMs);
 
     return 0; /* 0 = success, 1 = failure, -2 = failure but client will not show a "failed to load" warning */
               /* -2 is a very special case and should only be used if a plugin displays a dialog (e.g. overlay) asking the user to disable
@@ -347,12 +658,86 @@ void ts3plugin_shutdown()
     /* Your plugin cleanup code here */
     printf("PLUGIN: shutdown\n");
 
+    // the client waits for this function, so nothing below may take longer than the shutdown timeout
+    uint64 deadlineMs = GetMonotonicTimeMs() + GetShutdownTimeoutMs();
+    SPOOL  spool;
+
+    // no new events, the queued ones are drained below. The last states of suppressed messages go out first.
+    RateLimitCollect(&rateLimiter, PublishSuppressedSummary, NULL);
+    SinkClose(&sinks);
+    commandDeadlineMs = deadlineMs;
+
+    // timers go first, their callbacks use the caches and the dispatcher
+    if (eventLoopRunning) {
+        EventLoopStop(&eventLoop);
+        eventLoopRunning = FALSE;
+    }
+
+    if (snapshotRunning) {
+        MutexLock(&cacheLock);
+        snapshotStop = TRUE;
+        CondSignal(&snapshotCond);
+        MutexUnlock(&cacheLock);
+        ThreadJoin(&snapshotThread);
+        snapshotRunning = FALSE;
+    }
+
+    // sinks hand their queued events to the publish lanes, so they go first.
+    // What is not sent until the deadline is spooled.
+    SpoolOpen(&spool, spoolFileName);
+    SinkRemoveAll(&sinks, deadlineMs, SpillSinkEvent, &spool);
+#ifndef _WIN32
+    if (brokerResolverStarted) {
+        ResolverStop(&brokerResolver); // waits for a lookup in progress
+        brokerResolverStarted = FALSE;
+    }
+#endif
+
+    if (dispatchRunning) {
+        DispatchStop(&dispatcher, deadlineMs, SpillJob, &spool);
+        dispatchRunning = FALSE;
+    }
+    SpoolClose(&spool);
+    commandDeadlineMs = 0;
+    if (spool.count > 0)
+        printf("PLUGIN: %u messages not sent until the deadline, spooled to %s\n", spool.count, spoolFileName);
+
+    // the daemon sends what is left in the ring and exits a while later
+    MutexLock(&shmRingLock);
+    if (shmRingOpen) {
+        ShmRingClose(&shmRing);
+        shmRingOpen = FALSE;
+    }
+    MutexUnlock(&shmRingLock);
+
+    MutexLock(&cacheLock);
+    if (stateFileOpen) {
+        StateFileClose(&stateFile);
+        stateFileOpen = FALSE;
+    }
+    ReleasePriorityClients();
+    MutexUnlock(&cacheLock);
+
+    ServerShardRemoveAll(&shards);
+
     /*
 	 * Note:
 	 * If your plugin implements a settings dialog, it must be closed and deleted here, else the
 	 * TeamSpeak client will most likely crash (DLL removed but dialog from DLL code still open).
 	 */
 
+    if (cacheLockInitialized) {
+        ReturnCodeFree(&returnCodes);
+        SinkSetFree(&sinks);
+        RateLimitFree(&rateLimiter);
+        StringPoolFree(&strings);
+        CondDestroy(&snapshotCond);
+        MutexDestroy(&shmRingLock);
+        MutexDestroy(&cacheLock);
+        SlabShutdown();
+        cacheLockInitialized = FALSE;
+    }
+
     /* Free pluginID if we registered it */
     if (pluginID) {
         free(pluginID);
@@ -393,7 +778,7 @@ void ts3plugin_configure(void* handle, void* qParentWidget)
         snprintf(command, sizeof(command), "xdg-open \"%slh2mqtt.ini\"", pluginPath);
     #endif
 
-    ExecuteCommandInBackground(command, "", 0);
+    ExecuteCommandInBackground(command, "", "", 0);
     #ifdef _WIN32
         ts3plugin_init();
     #else
@@ -440,13 +825,201 @@ static void print_and_free_bookmarks_list(struct PluginBookmarkList* list)
     ts3Functions.freeMemory(list);
 }
 
+#define RETURN_CODE_TIMEOUT_MS 10000
+#define GROUP_LIST_RETRY_MS    60000 // an unknown group does not request the group list again before
+
+// Runs ReturnCodeExpire at the earliest deadline, so a request the server never answers still gets its timeout
+static void ArmReturnCodeTimer(void)
+{
+    uint64 deadline = ReturnCodeNextDeadline(&returnCodes);
+    uint64 now      = GetMonotonicTimeMs();
+
+    if (deadline != 0 && eventLoopRunning)
+        EventTimerStart(&eventLoop, &returnCodeTimer, deadline > now ? deadline - now : 0);
+}
+
+static void OnReturnCodeTimer(void* arg)
+{
+    ReturnCodeExpire(&returnCodes, GetMonotonicTimeMs());
+    ArmReturnCodeTimer();
+}
+
+// Creates a return code for an asynchronous client function and remembers the continuation to run when the
+// server answers (or the request times out). Returns NULL if no return code could be created, the client
+// function should then be called without return code.
+static const char* CreateTrackedReturnCode(uint64 serverConnectionHandlerID, char* returnCode, size_t size, RETURN_CODE_CALLBACK callback, void* userData)
+{
+    if (pluginID == NULL)
+        return NULL;
+
+    ts3Functions.createReturnCode(pluginID, returnCode, size);
+    if (!ReturnCodeRegister(&returnCodes, returnCode, serverConnectionHandlerID, RETURN_CODE_TIMEOUT_MS, callback, userData)) {
+        printf("PLUGIN: too many pending requests, sending without return code\n");
+        return NULL;
+    }
+    ArmReturnCodeTimer();
+    return returnCode;
+}
+
+static void OnJoinChannelResult(uint64 serverConnectionHandlerID, unsigned int error, const char* errorMessage, const char* extraMessage, void* userData)
+{
+    char msg[256];
+
+    if (error == ERROR_ok)
+        return;
+
+    if (error == RETURN_CODE_CANCELLED)
+        return; // the plugin was unloaded meanwhile
+    if (error == RETURN_CODE_TIMEOUT)
+        snprintf(msg, sizeof(msg), "Channelwechsel: keine Antwort vom Server");
+    else
+        snprintf(msg, sizeof(msg), "Channelwechsel fehlgeschlagen: %s (%u) %s", errorMessage, error, extraMessage ? extraMessage : "");
+    ts3Functions.logMessage(msg, LogLevel_WARNING, "Plugin lh2mqtt", serverConnectionHandlerID);
+}
+
+// Continuation of the channel (un)subscribe commands, userData is the name of the request
+static void OnSubscribeResult(uint64 serverConnectionHandlerID, unsigned int error, const char* errorMessage, const char* extraMessage, void* userData)
+{
+    char msg[256];
+
+    if (error == ERROR_ok || error == RETURN_CODE_CANCELLED)
+        return;
+
+    if (error == RETURN_CODE_TIMEOUT)
+        snprintf(msg, sizeof(msg), "%s: keine Antwort vom Server", (const char*)userData);
+    else
+        snprintf(msg, sizeof(msg), "%s fehlgeschlagen: %s (%u) %s", (const char*)userData, errorMessage, error, extraMessage ? extraMessage : "");
+    ts3Functions.logMessage(msg, LogLevel_WARNING, "Plugin lh2mqtt", serverConnectionHandlerID);
+}
+
+// Continuation of a group list request, the names themselves arrive as onServerGroupListEvent or
+// onChannelGroupListEvent and go into the group cache. userData is the GROUP_KIND_*.
+static void OnGroupListResult(uint64 serverConnectionHandlerID, unsigned int error, const char* errorMessage, const char* extraMessage, void* userData)
+{
+    char        msg[256];
+    const char* what = (intptr_t)userData == GROUP_KIND_SERVER ? "Servergruppen" : "Channelgruppen";
+
+    if (error == ERROR_ok || error == RETURN_CODE_CANCELLED)
+        return;
+
+    if (error == RETURN_CODE_TIMEOUT)
+        snprintf(msg, sizeof(msg), "%s abfragen: keine Antwort vom Server", what);
+    else
+        snprintf(msg, sizeof(msg), "%s abfragen fehlgeschlagen: %s (%u) %s", what, errorMessage, error, extraMessage ? extraMessage : "");
+    ts3Functions.logMessage(msg, LogLevel_WARNING, "Plugin lh2mqtt", serverConnectionHandlerID);
+}
+
+// Asks the server for the group list of a kind without waiting for it, the requests of several tabs and kinds run
+// in parallel. Caller must hold cacheLock.
+static void RequestGroupList(SERVER_SHARD* shard, int kind)
+{
+    uint64       serverConnectionHandlerID = shard->serverConnectionHandlerID;
+    uint64       now                       = GetMonotonicTimeMs();
+    char         returnCode[RETURNCODE_BUFSIZE];
+    const char*  trackedCode;
+    unsigned int error;
+
+    if (shard->groupListRequestedMs[kind] != 0 && now - shard->groupListRequestedMs[kind] < GROUP_LIST_RETRY_MS)
+        return;
+    shard->groupListRequestedMs[kind] = now;
+
+    trackedCode = CreateTrackedReturnCode(serverConnectionHandlerID, returnCode, sizeof(returnCode), OnGroupListResult, (void*)(intptr_t)kind);
+    if (kind == GROUP_KIND_SERVER)
+        error = ts3Functions.requestServerGroupList(serverConnectionHandlerID, trackedCode);
+    else
+        error = ts3Functions.requestChannelGroupList(serverConnectionHandlerID, trackedCode);
+    if (error != ERROR_ok && trackedCode != NULL)
+        ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, trackedCode, error, "", "");
+}
+
+// Prints the metrics of the event loop, the daemon, the sinks, the allocator and the publish lanes to the current tab
+static void PrintStats(void)
+{
+    char msg[BIG_BUFSIZE];
+    char host[HOST_LEN];
+
+    if (eventLoopRunning) {
+        EVENT_LOOP_STATS stats;
+
+        EventLoopGetStats(&eventLoop, &stats);
+        snprintf(msg, sizeof(msg), "Event loop: backend=%s, timers=%u, writes=%llu, write syscalls=%llu", stats.backend, stats.timers,
+                 (unsigned long long)stats.writes, (unsigned long long)stats.writeSyscalls);
+        ts3Functions.printMessageToCurrentTab(msg);
+    }
+    MutexLock(&shmRingLock);
+    if (shmRingOpen) {
+        SHM_RING_HEADER* h = shmRing.header;
+
+        snprintf(msg, sizeof(msg), "Daemon: alive=%d, depth=%llu bytes, dropped=%llu, published=%llu, failed=%llu", ShmRingConsumerAlive(&shmRing),
+                 (unsigned long long)(h->tail - h->head), (unsigned long long)h->dropped, (unsigned long long)h->published, (unsigned long long)h->failed);
+        ts3Functions.printMessageToCurrentTab(msg);
+        if (ShmRingConsumerAlive(&shmRing) && GetBrokerHost(1, host, sizeof(host))) {
+            snprintf(msg, sizeof(msg), "Broker failovers: %u", h->failovers);
+            ts3Functions.printMessageToCurrentTab(msg);
+            for (int i = 0; i < SHM_RING_BROKERS && GetBrokerHost(i, host, sizeof(host)); i++) {
+                if (h->brokerRttMs[i] >= 0)
+                    snprintf(msg, sizeof(msg), "Broker %s: %s, rtt=%d ms%s", host, h->brokerHealthy[i] ? "up" : "down", h->brokerRttMs[i],
+                             h->activeBroker == i ? ", active" : "");
+                else
+                    snprintf(msg, sizeof(msg), "Broker %s: %s%s", host, h->brokerHealthy[i] ? "up" : "down", h->activeBroker == i ? ", active" : "");
+                ts3Functions.printMessageToCurrentTab(msg);
+            }
+        }
+    }
+    MutexUnlock(&shmRingLock);
+    if (AtomicLoad64(&rateLimiter.intervalUs) > 0) {
+        snprintf(msg, sizeof(msg), "Rate limit: suppressed=%llu, untracked=%llu", (unsigned long long)AtomicLoad64(&rateLimiter.suppressedTotal),
+                 (unsigned long long)AtomicLoad64(&rateLimiter.untracked));
+        ts3Functions.printMessageToCurrentTab(msg);
+    }
+    snprintf(msg, sizeof(msg), "Startup: init=%llu ms, first publish=%llu ms", (unsigned long long)initDurationMs, (unsigned long long)firstPublishMs);
+    ts3Functions.printMessageToCurrentTab(msg);
+    for (int i = 0; i < SINK_MAX; i++) {
+        SINK_STATS stats;
+
+        if (!SinkGetStats(&sinks, i, &stats))
+            break;
+        snprintf(msg, sizeof(msg), "Sink %s: depth=%u (max %u), published=%llu (%llu/s), dropped=%llu, busy=%llu ms, p99 high=%llu ms, bulk=%llu ms%s", stats.name,
+                 stats.depth, stats.maxDepth, (unsigned long long)stats.published, (unsigned long long)stats.perSecond, (unsigned long long)stats.dropped,
+                 (unsigned long long)stats.busyMs, (unsigned long long)stats.p99Ms[SINK_PRIORITY_HIGH], (unsigned long long)stats.p99Ms[SINK_PRIORITY_BULK],
+                 stats.held ? ", held" : "");
+        ts3Functions.printMessageToCurrentTab(msg);
+    }
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        SLAB_STATS stats;
+
+        SlabGetStats(i, &stats);
+        snprintf(msg, sizeof(msg), "Slab %u bytes: reserved=%llu, free=%llu, refills=%llu, returns=%llu", (unsigned int)stats.objectSize,
+                 stats.reserved, stats.free, stats.refills, stats.returns);
+        ts3Functions.printMessageToCurrentTab(msg);
+    }
+    snprintf(msg, sizeof(msg), "Slab large allocations: %llu", SlabGetLargeCount());
+    ts3Functions.printMessageToCurrentTab(msg);
+    if (!dispatchRunning)
+        return;
+    for (int i = 0; i < DISPATCH_LANE_COUNT; i++) {
+        DISPATCH_LANE_STATS stats;
+        char                name[16];
+
+        if (i == DISPATCH_PRIORITY_LANE)
+            snprintf(name, sizeof(name), "priority");
+        else
+            snprintf(name, sizeof(name), "%d", i);
+        DispatchGetStats(&dispatcher, i, &stats);
+        snprintf(msg, sizeof(msg), "Lane %s: depth=%u (max %u), sent=%llu, dropped=%llu, wait avg=%llu ms, max=%llu ms, head=%llu ms, p99=%llu ms", name, stats.depth,
+                 stats.maxDepth, (unsigned long long)stats.done, (unsigned long long)stats.dropped, (unsigned long long)stats.waitAvgMs,
+                 (unsigned long long)stats.waitMaxMs, (unsigned long long)stats.headWaitMs, (unsigned long long)stats.p99Ms);
+        ts3Functions.printMessageToCurrentTab(msg);
+    }
+}
+
 /* Plugin processes console command. Return 0 if plugin handled the command, 1 if not handled. */
 int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* command)
 {
     char  buf[COMMAND_BUFSIZE];
     char *s, *param1 = NULL, *param2 = NULL;
     int   i                                                                                                                                                                                                = 0;
-    enum { CMD_NONE = 0, CMD_JOIN, CMD_COMMAND, CMD_SERVERINFO, CMD_CHANNELINFO, CMD_AVATAR, CMD_ENABLEMENU, CMD_SUBSCRIBE, CMD_UNSUBSCRIBE, CMD_SUBSCRIBEALL, CMD_UNSUBSCRIBEALL, CMD_BOOKMARKSLIST } cmd = CMD_NONE;
+    enum { CMD_NONE = 0, CMD_JOIN, CMD_COMMAND, CMD_SERVERINFO, CMD_CHANNELINFO, CMD_AVATAR, CMD_ENABLEMENU, CMD_SUBSCRIBE, CMD_UNSUBSCRIBE, CMD_SUBSCRIBEALL, CMD_UNSUBSCRIBEALL, CMD_BOOKMARKSLIST, CMD_STATS } cmd = CMD_NONE;
 #ifdef _WIN32
     char* context = NULL;
 #endif
@@ -483,6 +1056,8 @@ int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* comma
                 cmd = CMD_UNSUBSCRIBEALL;
             } else if (!strcmp(s, "bookmarkslist")) {
                 cmd = CMD_BOOKMARKSLIST;
+            } else if (!strcmp(s, "stats")) {
+                cmd = CMD_STATS;
             }
         } else if (i == 1) {
             param1 = s;
@@ -513,18 +1088,17 @@ int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* comma
                     break;
                 }
 
-                /* Create return code for requestClientMove function call. If creation fails, returnCode will be NULL, which can be
-				 * passed into the client functions meaning no return code is used.
+                /* Create return code for requestClientMove function call. If creation fails, the request is sent without return code.
 				 * Note: To use return codes, the plugin needs to register a plugin ID using ts3plugin_registerPluginID */
-                ts3Functions.createReturnCode(pluginID, returnCode, RETURNCODE_BUFSIZE);
-
-                /* In a real world plugin, the returnCode should be remembered (e.g. in a dynamic STL vector, if it's a C++ plugin).
-				 * onServerErrorEvent can then check the received returnCode, compare with the remembered ones and thus identify
-				 * which function call has triggered the event and react accordingly. */
+                const char* trackedCode = CreateTrackedReturnCode(serverConnectionHandlerID, returnCode, RETURNCODE_BUFSIZE, OnJoinChannelResult, NULL);
 
-                /* Request joining specified channel using above created return code */
-                if (ts3Functions.requestClientMove(serverConnectionHandlerID, myID, channelID, password, returnCode) != ERROR_ok) {
+                /* Request joining specified channel, OnJoinChannelResult runs when the server answers */
+                unsigned int error = ts3Functions.requestClientMove(serverConnectionHandlerID, myID, channelID, password, trackedCode);
+                if (error != ERROR_ok) {
                     ts3Functions.logMessage("Error requesting client move", LogLevel_INFO, "Plugin", serverConnectionHandlerID);
+                    /* request was not sent, the server will never answer */
+                    if (trackedCode)
+                        ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, trackedCode, error, "", "");
                 }
             } else {
                 ts3Functions.printMessageToCurrentTab("Missing channel ID parameter.");
@@ -634,9 +1208,12 @@ int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* comma
                 uint64 channelIDArray[2];
                 channelIDArray[0] = (uint64)atoi(param1);
                 channelIDArray[1] = 0;
-                ts3Functions.createReturnCode(pluginID, returnCode, RETURNCODE_BUFSIZE);
-                if (ts3Functions.requestChannelSubscribe(serverConnectionHandlerID, channelIDArray, returnCode) != ERROR_ok) {
+                const char*  trackedCode = CreateTrackedReturnCode(serverConnectionHandlerID, returnCode, RETURNCODE_BUFSIZE, OnSubscribeResult, "Channel abonnieren");
+                unsigned int error       = ts3Functions.requestChannelSubscribe(serverConnectionHandlerID, channelIDArray, trackedCode);
+                if (error != ERROR_ok) {
                     ts3Functions.logMessage("Error subscribing channel", LogLevel_INFO, "Plugin", serverConnectionHandlerID);
+                    if (trackedCode)
+                        ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, trackedCode, error, "", "");
                 }
             }
             break;
@@ -646,25 +1223,34 @@ int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* comma
                 uint64 channelIDArray[2];
                 channelIDArray[0] = (uint64)atoi(param1);
                 channelIDArray[1] = 0;
-                ts3Functions.createReturnCode(pluginID, returnCode, RETURNCODE_BUFSIZE);
-                if (ts3Functions.requestChannelUnsubscribe(serverConnectionHandlerID, channelIDArray, NULL) != ERROR_ok) {
+                const char*  trackedCode = CreateTrackedReturnCode(serverConnectionHandlerID, returnCode, RETURNCODE_BUFSIZE, OnSubscribeResult, "Channel abbestellen");
+                unsigned int error       = ts3Functions.requestChannelUnsubscribe(serverConnectionHandlerID, channelIDArray, trackedCode);
+                if (error != ERROR_ok) {
                     ts3Functions.logMessage("Error unsubscribing channel", LogLevel_INFO, "Plugin", serverConnectionHandlerID);
+                    if (trackedCode)
+                        ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, trackedCode, error, "", "");
                 }
             }
             break;
         case CMD_SUBSCRIBEALL: { /* /test subscribeall */
-            char returnCode[RETURNCODE_BUFSIZE];
-            ts3Functions.createReturnCode(pluginID, returnCode, RETURNCODE_BUFSIZE);
-            if (ts3Functions.requestChannelSubscribeAll(serverConnectionHandlerID, returnCode) != ERROR_ok) {
+            char         returnCode[RETURNCODE_BUFSIZE];
+            const char*  trackedCode = CreateTrackedReturnCode(serverConnectionHandlerID, returnCode, RETURNCODE_BUFSIZE, OnSubscribeResult, "Alle Channels abonnieren");
+            unsigned int error       = ts3Functions.requestChannelSubscribeAll(serverConnectionHandlerID, trackedCode);
+            if (error != ERROR_ok) {
                 ts3Functions.logMessage("Error subscribing channel", LogLevel_INFO, "Plugin", serverConnectionHandlerID);
+                if (trackedCode)
+                    ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, trackedCode, error, "", "");
             }
             break;
         }
         case CMD_UNSUBSCRIBEALL: { /* /test unsubscribeall */
-            char returnCode[RETURNCODE_BUFSIZE];
-            ts3Functions.createReturnCode(pluginID, returnCode, RETURNCODE_BUFSIZE);
-            if (ts3Functions.requestChannelUnsubscribeAll(serverConnectionHandlerID, returnCode) != ERROR_ok) {
+            char         returnCode[RETURNCODE_BUFSIZE];
+            const char*  trackedCode = CreateTrackedReturnCode(serverConnectionHandlerID, returnCode, RETURNCODE_BUFSIZE, OnSubscribeResult, "Alle Channels abbestellen");
+            unsigned int error       = ts3Functions.requestChannelUnsubscribeAll(serverConnectionHandlerID, trackedCode);
+            if (error != ERROR_ok) {
                 ts3Functions.logMessage("Error subscribing channel", LogLevel_INFO, "Plugin", serverConnectionHandlerID);
+                if (trackedCode)
+                    ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, trackedCode, error, "", "");
             }
             break;
         }
@@ -678,6 +1264,9 @@ int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* comma
             }
             break;
         }
+        case CMD_STATS: /* /lh2mqtt stats */
+            PrintStats();
+            break;
     }
 
     return 0; /* Plugin handled command */
@@ -896,123 +1485,193 @@ void ts3plugin_initHotkeys(struct PluginHotkey*** hotkeys)
 
 /* Clientlib */
 
-void ts3plugin_onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber)
+// Returns the cache shard of a server tab, created on first use. Caller must hold cacheLock.
+static SERVER_SHARD* GetShard(uint64 serverConnectionHandlerID)
 {
-    /* Some example code following to show how to use the information query functions. */
+    SERVER_SHARD* shard = ServerShardGet(&shards, serverConnectionHandlerID);
+    char*         uid;
+
+    // virtual server UID is used for per server topics, it is known once the connection is established
+    if (shard != NULL && shard->uniqueIdentifier[0] == '\0' &&
+        ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_UNIQUE_IDENTIFIER, &uid) == ERROR_ok) {
+        _strcpy(shard->uniqueIdentifier, sizeof(shard->uniqueIdentifier), uid);
+        ts3Functions.freeMemory(uid);
+    }
+    return shard;
+}
 
-    if (newStatus == STATUS_CONNECTION_ESTABLISHED) { /* connection established and we have client and channels available */
-        char*        s;
-        char         msg[1024];
-        anyID        myID;
-        uint64*      ids;
-        size_t       i;
-        unsigned int error;
-
-        /* Print clientlib version */
-        if (ts3Functions.getClientLibVersion(&s) == ERROR_ok) {
-            printf("PLUGIN: Client lib version: %s\n", s);
-            ts3Functions.freeMemory(s); /* Release string */
-        } else {
-            ts3Functions.logMessage("Error querying client lib version", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-            return;
-        }
+// Caches name and parent of a channel, returns 0 if the client lib does not know the channel
+static int CacheChannelFromClientLib(uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    uint64 parentID;
+    char*  name;
 
-        /* Write plugin name and version to log */
-        snprintf(msg, sizeof(msg), "Plugin %s, Version %s, Author: %s", ts3plugin_name(), ts3plugin_version(), ts3plugin_author());
-        ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin", serverConnectionHandlerID);
+    if (ts3Functions.getParentChannelOfChannel(serverConnectionHandlerID, channelID, &parentID) != ERROR_ok)
+        return 0;
+    if (ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, channelID, CHANNEL_NAME, &name) != ERROR_ok)
+        return 0;
 
-        /* Print virtual server name */
-        if ((error = ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_NAME, &s)) != ERROR_ok) {
-            if (error != ERROR_not_connected) { /* Don't spam error in this case (failed to connect) */
-                ts3Functions.logMessage("Error querying server name", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-            }
-            return;
-        }
-        printf("PLUGIN: Server name: %s\n", s);
-        ts3Functions.freeMemory(s);
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+    if (shard != NULL)
+        ChannelCacheSet(&shard->channels, serverConnectionHandlerID, channelID, parentID, name);
+    MutexUnlock(&cacheLock);
+    ts3Functions.freeMemory(name);
+    return 1;
+}
 
-        /* Print virtual server welcome message */
-        if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_WELCOMEMESSAGE, &s) != ERROR_ok) {
-            ts3Functions.logMessage("Error querying server welcome message", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-            return;
-        }
-        printf("PLUGIN: Server welcome message: %s\n", s);
-        ts3Functions.freeMemory(s); /* Release string */
+// Returns the full path of a channel like "Lobby/Ops/Night", empty string if unknown.
+// Caller must hold cacheLock while using the returned path.
+static const char* GetChannelPath(uint64 serverConnectionHandlerID, uint64 channelID)
+{
+    SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+    const char*   path;
 
-        /* Print own client ID and nickname on this server */
-        if (ts3Functions.getClientID(serverConnectionHandlerID, &myID) != ERROR_ok) {
-            ts3Functions.logMessage("Error querying client ID", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-            return;
-        }
-        if (ts3Functions.getClientSelfVariableAsString(serverConnectionHandlerID, CLIENT_NICKNAME, &s) != ERROR_ok) {
-            ts3Functions.logMessage("Error querying client nickname", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-            return;
-        }
-        printf("PLUGIN: My client ID = %d, nickname = %s\n", myID, s);
-        ts3Functions.freeMemory(s);
+    if (shard == NULL)
+        return "";
 
-        /* Print list of all channels on this server */
-        if (ts3Functions.getChannelList(serverConnectionHandlerID, &ids) != ERROR_ok) {
-            ts3Functions.logMessage("Error getting channel list", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-            return;
-        }
-        printf("PLUGIN: Available channels:\n");
-        for (i = 0; ids[i]; i++) {
-            /* Query channel name */
-            if (ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, ids[i], CHANNEL_NAME, &s) != ERROR_ok) {
-                ts3Functions.logMessage("Error querying channel name", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-                return;
-            }
-            printf("PLUGIN: Channel ID = %llu, name = %s\n", (long long unsigned int)ids[i], s);
-            ts3Functions.freeMemory(s);
-        }
-        ts3Functions.freeMemory(ids); /* Release array */
+    path = ChannelCacheGetPath(&shard->channels, serverConnectionHandlerID, channelID);
+    if (path != NULL)
+        return path;
 
-        /* Print list of existing server connection handlers */
-        printf("PLUGIN: Existing server connection handlers:\n");
-        if (ts3Functions.getServerConnectionHandlerList(&ids) != ERROR_ok) {
-            ts3Functions.logMessage("Error getting server list", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-            return;
-        }
-        for (i = 0; ids[i]; i++) {
-            if ((error = ts3Functions.getServerVariableAsString(ids[i], VIRTUALSERVER_NAME, &s)) != ERROR_ok) {
-                if (error != ERROR_not_connected) { /* Don't spam error in this case (failed to connect) */
-                    ts3Functions.logMessage("Error querying server name", LogLevel_ERROR, "Plugin", serverConnectionHandlerID);
-                }
-                continue;
-            }
-            printf("- %llu - %s\n", (long long unsigned int)ids[i], s);
-            ts3Functions.freeMemory(s);
+    // channel or one of its parents not cached yet (e.g. plugin loaded while connected), fetch them once
+    for (int i = 0; i < CHANNEL_MAX_DEPTH; i++) {
+        uint64 missing = ChannelCacheFirstMissing(&shard->channels, serverConnectionHandlerID, channelID);
+        if (missing == 0)
+            break;
+        if (!CacheChannelFromClientLib(serverConnectionHandlerID, missing))
+            return "";
+    }
+
+    path = ChannelCacheGetPath(&shard->channels, serverConnectionHandlerID, channelID);
+    return path != NULL ? path : "";
+}
+
+void ts3plugin_onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber)
+{
+    if (newStatus == STATUS_DISCONNECTED) {
+        char          topic[PATH_BUFSIZE];
+        char          message[BIG_BUFSIZE];
+        BOOL          publish = FALSE;
+        SERVER_SHARD* shard;
+
+        MutexLock(&cacheLock);
+        // nobody is talking anymore, tell the consumers before the shard is dropped
+        shard = ServerShardFind(&shards, serverConnectionHandlerID);
+        if (shard != NULL && shard->speakers.count > 0) {
+            shard->speakers.count = 0;
+            shard->speakers.sequence++;
+            publish = FormatSpeakerSnapshot(shard, topic, sizeof(topic), message, sizeof(message));
         }
-        ts3Functions.freeMemory(ids);
+        ServerShardRemove(&shards, serverConnectionHandlerID);
+        TalkSessionsRemoveServer(&talkSessions, serverConnectionHandlerID);
+        if (stateFileOpen)
+            StateFileRemoveServer(&stateFile, serverConnectionHandlerID);
+        CancelSnapshot(serverConnectionHandlerID);
+        MutexUnlock(&cacheLock);
+        ReturnCodeCancelServer(&returnCodes, serverConnectionHandlerID, ERROR_connection_lost);
+        if (publish)
+            PublishMqttMessage(topic, message, serverConnectionHandlerID, 0, SINK_PRIORITY_BULK);
+        return;
+    }
+
+    if (newStatus == STATUS_CONNECTION_ESTABLISHED) { /* connection established and we have client and channels available */
+        MutexLock(&cacheLock);
+        QueueSnapshot(serverConnectionHandlerID);
+        MutexUnlock(&cacheLock);
     }
 }
 
-void ts3plugin_onNewChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID) {}
+void ts3plugin_onNewChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID)
+{
+    CacheChannelFromClientLib(serverConnectionHandlerID, channelID);
+}
 
-void ts3plugin_onNewChannelCreatedEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {}
+void ts3plugin_onNewChannelCreatedEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier)
+{
+    CacheChannelFromClientLib(serverConnectionHandlerID, channelID);
+}
 
-void ts3plugin_onDelChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {}
+void ts3plugin_onDelChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier)
+{
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = ServerShardFind(&shards, serverConnectionHandlerID);
+    if (shard != NULL)
+        ChannelCacheRemove(&shard->channels, serverConnectionHandlerID, channelID);
+    MutexUnlock(&cacheLock);
+}
 
-void ts3plugin_onChannelMoveEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newChannelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {}
+void ts3plugin_onChannelMoveEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newChannelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier)
+{
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = ServerShardFind(&shards, serverConnectionHandlerID);
+    if (shard == NULL || !ChannelCacheMove(&shard->channels, serverConnectionHandlerID, channelID, newChannelParentID))
+        CacheChannelFromClientLib(serverConnectionHandlerID, channelID);
+    MutexUnlock(&cacheLock);
+}
 
 void ts3plugin_onUpdateChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID) {}
 
-void ts3plugin_onUpdateChannelEditedEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {}
+void ts3plugin_onUpdateChannelEditedEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier)
+{
+    char* name;
+    BOOL  cached;
+
+    // channel may have been renamed. One that is not cached yet is read with its path on the next lookup.
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = ServerShardFind(&shards, serverConnectionHandlerID);
+    cached              = shard != NULL && ChannelCacheContains(&shard->channels, serverConnectionHandlerID, channelID);
+    MutexUnlock(&cacheLock);
+    if (!cached || ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, channelID, CHANNEL_NAME, &name) != ERROR_ok)
+        return;
+
+    MutexLock(&cacheLock);
+    shard = ServerShardFind(&shards, serverConnectionHandlerID);
+    if (shard != NULL)
+        ChannelCacheRename(&shard->channels, serverConnectionHandlerID, channelID, name);
+    MutexUnlock(&cacheLock);
+    ts3Functions.freeMemory(name);
+}
 
-void ts3plugin_onUpdateClientEvent(uint64 serverConnectionHandlerID, anyID clientID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {}
+void ts3plugin_onUpdateClientEvent(uint64 serverConnectionHandlerID, anyID clientID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier)
+{
+    // nickname or other variables may have changed, re-read them on next talk event
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = ServerShardFind(&shards, serverConnectionHandlerID);
+    if (shard != NULL)
+        ClientCacheInvalidate(&shard->clients, serverConnectionHandlerID, clientID);
+    MutexUnlock(&cacheLock);
+}
 
-void ts3plugin_onClientMoveEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* moveMessage) {}
+void ts3plugin_onClientMoveEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* moveMessage)
+{
+    ClientChannelChanged(serverConnectionHandlerID, clientID, newChannelID, FALSE);
+}
 
-void ts3plugin_onClientMoveSubscriptionEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility) {}
+void ts3plugin_onClientMoveSubscriptionEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility)
+{
+    ClientChannelChanged(serverConnectionHandlerID, clientID, newChannelID, FALSE);
+}
 
-void ts3plugin_onClientMoveTimeoutEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* timeoutMessage) {}
+void ts3plugin_onClientMoveTimeoutEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* timeoutMessage)
+{
+    ClientChannelChanged(serverConnectionHandlerID, clientID, newChannelID, FALSE);
+}
 
-void ts3plugin_onClientMoveMovedEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID moverID, const char* moverName, const char* moverUniqueIdentifier, const char* moveMessage) {}
+void ts3plugin_onClientMoveMovedEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID moverID, const char* moverName, const char* moverUniqueIdentifier, const char* moveMessage)
+{
+    ClientChannelChanged(serverConnectionHandlerID, clientID, newChannelID, FALSE);
+}
 
-void ts3plugin_onClientKickFromChannelEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage) {}
+void ts3plugin_onClientKickFromChannelEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage)
+{
+    ClientChannelChanged(serverConnectionHandlerID, clientID, newChannelID, FALSE);
+}
 
-void ts3plugin_onClientKickFromServerEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage) {}
+void ts3plugin_onClientKickFromServerEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage)
+{
+    ClientChannelChanged(serverConnectionHandlerID, clientID, 0, TRUE);
+}
 
 void ts3plugin_onClientIDsEvent(uint64 serverConnectionHandlerID, const char* uniqueClientIdentifier, anyID clientID, const char* clientName) {}
 
@@ -1026,7 +1685,8 @@ int ts3plugin_onServerErrorEvent(uint64 serverConnectionHandlerID, const char* e
 {
     printf("PLUGIN: onServerErrorEvent %llu %s %d %s\n", (long long unsigned int)serverConnectionHandlerID, errorMessage, error, (returnCode ? returnCode : ""));
     if (returnCode) {
-        /* A plugin could now check the returnCode with previously (when calling a function) remembered returnCodes and react accordingly */
+        /* Run the continuation remembered when the request was sent */
+        ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, returnCode, error, errorMessage, extraMessage);
         /* In case of using a a plugin return code, the plugin can return:
 		 * 0: Client will continue handling this error (print to chat tab)
 		 * 1: Client will ignore this error, the plugin announces it has handled it */
@@ -1067,140 +1727,1403 @@ int ts3plugin_onTextMessageEvent(uint64 serverConnectionHandlerID, anyID targetM
     return 0; /* 0 = handle normally, 1 = client will ignore the text message */
 }
 
-void ts3plugin_onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int status, int isReceivedWhisper, anyID clientID)
+// Reads display name, anonymized name, UID, channel and groups of a client from the client lib into a cleared record.
+// Returns 0 if the client is not known (anymore), otherwise the caller owns the string references of the record.
+static int ReadClientFromClientLib(uint64 serverConnectionHandlerID, anyID clientID, CLIENT_CACHE_ENTRY* entry)
 {
-    /* Demonstrate usage of getClientDisplayName */
-    char name[512];
-
     /// checkChar is the char that name needs to contain, so that name will be anonymized
     const char checkChar = '*';
-    size_t anonymizedSize = 512;
-    // if name contains checkChar, then name is anonymized via anonymize_name(), otherwise it is simply the unmodified name
-    char nameAnonymized[anonymizedSize]; 
-    snprintf(nameAnonymized, PATH_BUFSIZE, "(anonym)");
+    char       name[CLIENT_NAME_LEN];
+    char       nameAnonymized[CLIENT_NAME_LEN];
+    char*      uid;
+    char*      groups;
 
-    /* Query channel path and password of current server tab.
-     * The password parameter can be NULL if the plugin does not want to receive the channel password.
-     * Note: Channel password is only available if the user has actually used it when entering the channel. If a user has
-     * entered a channel with the permission to ignore passwords (b_channel_join_ignore_password) and the password,
-     * was not entered, it will not be available.
-     * getChannelConnectInfo returns 0 on success, 1 on error or if current server tab is disconnected. */
-    // char path[CHANNELINFO_BUFSIZE];
-    /*char password[CHANNELINFO_BUFSIZE];*/
-    // char* password = NULL; /* Don't receive channel password */
+    if (ts3Functions.getClientDisplayName(serverConnectionHandlerID, clientID, name, sizeof(name)) != ERROR_ok)
+        return 0;
 
-    /* Get own clientID and channelID */
-    // anyID  myID;
-    // uint64 myChannelID;
+    entry->serverConnectionHandlerID = serverConnectionHandlerID;
+    entry->clientID                  = clientID;
+    entry->name                      = StringPoolIntern(&strings, name);
 
-    char msg[BIG_BUFSIZE];
-    char msgShell[SHELL_BUFSIZE];
-    char colorStart[PATH_BUFSIZE] = "";
-    char colorStop[PATH_BUFSIZE]  = "";
-    char prefix[PATH_BUFSIZE]     = "";
-    if (ts3Functions.getClientDisplayName(serverConnectionHandlerID, clientID, name, 512) == ERROR_ok) {
+    // if name contains checkChar, then name is anonymized via anonymize_name(), otherwise it is simply the unmodified name
+    anonymize_name(name, checkChar, "(anonym)", nameAnonymized, sizeof(nameAnonymized));
+    entry->nameAnonymized = StringPoolIntern(&strings, nameAnonymized);
 
-        // anonymyze if checkChar is recognized in name
-        anonymize_name(name, checkChar, "(anonym)", nameAnonymized, anonymizedSize);
+    if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, clientID, CLIENT_UNIQUE_IDENTIFIER, &uid) == ERROR_ok) {
+        entry->uniqueIdentifier = StringPoolIntern(&strings, uid);
+        ts3Functions.freeMemory(uid);
+    }
 
-        if (status == STATUS_TALKING) {
-            printf("PLUGIN: --> %s is currently SENDING\n", name);
+    if (ts3Functions.getChannelOfClient(serverConnectionHandlerID, clientID, &entry->channelID) != ERROR_ok)
+        entry->channelID = 0;
+
+    // group memberships are known locally for every client in view, later changes arrive as events
+    if (ts3Functions.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, CLIENT_DATABASE_ID, &entry->databaseID) != ERROR_ok)
+        entry->databaseID = 0;
+    if (ts3Functions.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, CLIENT_CHANNEL_GROUP_ID, &entry->channelGroupID) != ERROR_ok)
+        entry->channelGroupID = 0;
+    if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, clientID, CLIENT_SERVERGROUPS, &groups) == ERROR_ok) {
+        for (char* p = groups; *p != '\0';) {
+            char*  end;
+            uint64 groupID = strtoull(p, &end, 10);
+            if (end == p)
+                break;
+            ClientCacheAddServerGroup(entry, groupID);
+            p = (*end == ',') ? end + 1 : end;
+        }
+        ts3Functions.freeMemory(groups);
+    }
 
-            if (atoi(configLhShowStart) == 1) {
-                if (strlen(configLhColorStart) > 0) {
-                    snprintf(colorStart, PATH_BUFSIZE, "[color=%s]", configLhColorStart);
-                    snprintf(colorStop, PATH_BUFSIZE, "[/color]");
-                } else {
-                    snprintf(colorStart, PATH_BUFSIZE, "[color=#5472CA]");
-                    snprintf(colorStop, PATH_BUFSIZE, "[/color]");
-                }
+    return 1;
+}
 
-                if (strlen(configLhPrefixStart) > 0)
-                    snprintf(prefix, PATH_BUFSIZE, "%s -> ", configLhPrefixStart);
-                else
-                    prefix[0] = '\0';
+// Returns the cached client, only a cache miss queries the client lib, a repeating speaker costs a single hash lookup.
+// Caller must hold cacheLock while using the returned entry.
+static CLIENT_CACHE_ENTRY* GetCachedClient(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    SERVER_SHARD*       shard = GetShard(serverConnectionHandlerID);
+    CLIENT_CACHE_ENTRY* entry;
+    CLIENT_CACHE_ENTRY  data;
 
-                char* timeStr = GetCurrDate("%H:%M:%S");
-                if (timeStr != NULL) {
-                    snprintf(msg, sizeof(msg), "%s[b]<%s> *** %s%s[/b]%s", colorStart, timeStr, prefix, name, colorStop);
-                    free(timeStr);
-                }
-                //ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", serverConnectionHandlerID);
-                ts3Functions.printMessage(serverConnectionHandlerID, msg, PLUGIN_MESSAGE_TARGET_CHANNEL);
-            }
+    if (shard == NULL)
+        return NULL;
 
-            if (atoi(configMqttSendStart) == 1) {
+    entry = ClientCacheLookup(&shard->clients, serverConnectionHandlerID, clientID);
+    if (entry != NULL)
+        return entry;
 
-                char mqttPort[PATH_BUFSIZE]   = "";
-                char mqttQos[PATH_BUFSIZE]    = "";
-                char mqttCafile[PATH_BUFSIZE] = "";
+    memset(&data, 0, sizeof(data));
+    if (!ReadClientFromClientLib(serverConnectionHandlerID, clientID, &data)) {
+        ClientCacheReleaseEntry(&strings, &data);
+        return NULL;
+    }
+    entry = ClientCacheStore(&shard->clients, &data);
+    ClientCacheReleaseEntry(&strings, &data);
+    return entry;
+}
 
-                if (strlen(configMqttPort) > 0)
-                    snprintf(mqttPort, sizeof(mqttPort), "-p %s", configMqttPort);
+// Appends a placeholder value, replacing control characters by '_'. The message is escaped for the shell as a whole
+// in FormatPublishCommand, topics additionally must not contain the wildcards + and # nor quotes, $ and `.
+static size_t AppendTemplateValue(char* out, size_t outSize, size_t len, const char* value, BOOL isTopic)
+{
+    for (; *value != '\0' && len + 1 < outSize; value++) {
+        unsigned char c      = (unsigned char)*value;
+        BOOL          unsafe = c < 0x20 || (isTopic && (c == '"' || c == '\\' || c == '$' || c == '`' || c == '+' || c == '#'));
+        out[len++]           = unsafe ? '_' : (char)c;
+    }
+    return len;
+}
 
-                if (strlen(configMqttQos) > 0)
-                    snprintf(mqttQos, sizeof(mqttQos), "-q %s", configMqttQos);
+// Returns the name of a group, asking the client library (no server round trip) if it did not arrive as event yet.
+// A group the client library does not know either is requested from the server, it is empty until the answer came.
+static const char* GetGroupName(uint64 serverConnectionHandlerID, int kind, uint64 groupID)
+{
+    SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+    const char*   name;
+    char          buf[GROUP_NAME_LEN];
+    unsigned int  error;
 
-                if (strlen(configMqttCafile) > 0)
-                    snprintf(mqttCafile, sizeof(mqttCafile), "--cafile \"%s\"", configMqttCafile);
+    if (shard == NULL)
+        return "";
 
-                if (strlen(configMqttUser) > 0)
-                    snprintf(msgShell, sizeof(msgShell), "\"%s\" -h %s %s -u %s -P %s -t %s %s -m \"%s\" %s", configMqttExe, configMqttHost, mqttPort, configMqttUser, configMqttPassword, configMqttTopicStart, mqttQos, nameAnonymized, mqttCafile);
-                else
-                    snprintf(msgShell, sizeof(msgShell), "\"%s\" -h %s %s -t %s %s -m \"%s\" %s", configMqttExe, configMqttHost, mqttPort, configMqttTopicStart, mqttQos, nameAnonymized, mqttCafile);
+    name = GroupCacheGetName(&shard->groups, serverConnectionHandlerID, kind, groupID);
+    if (name != NULL)
+        return name;
 
-                ExecuteCommandInBackground(msgShell, nameAnonymized, serverConnectionHandlerID); //modifiedString
-            }
+    if (kind == GROUP_KIND_SERVER)
+        error = ts3Functions.getServerGroupNameByID(serverConnectionHandlerID, (unsigned int)groupID, buf, sizeof(buf));
+    else
+        error = ts3Functions.getChannelGroupNameByID(serverConnectionHandlerID, (unsigned int)groupID, buf, sizeof(buf));
+    if (error != ERROR_ok) {
+        RequestGroupList(shard, kind);
+        return "";
+    }
+
+    GroupCacheSet(&shard->groups, serverConnectionHandlerID, kind, groupID, buf);
+    name = GroupCacheGetName(&shard->groups, serverConnectionHandlerID, kind, groupID);
+    return name != NULL ? name : "";
+}
 
+// Builds a topic or message from a configured template, supported placeholders:
+// {server} virtual server UID, {name} speaker name, {channel} full channel path,
+// {servergroups} comma separated server groups, {channelgroup} channel group.
+// client may be NULL for messages not related to a speaker, its placeholders are left empty then.
+// Caller must hold cacheLock.
+static void ExpandTemplate(const char* templ, uint64 serverConnectionHandlerID, const CLIENT_CACHE_ENTRY* client, const TALK_INFO* talk, BOOL isTopic, char* out, size_t outSize)
+{
+    size_t len = 0;
+    char   number[24];
+
+    for (const char* p = templ; *p != '\0' && len + 1 < outSize;) {
+        if (strncmp(p, "{server}", 8) == 0) {
+            SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+            // the UID is base64, '/' would add a topic level
+            for (const char* u = shard != NULL ? shard->uniqueIdentifier : ""; *u != '\0' && len + 1 < outSize; u++)
+                out[len++] = (*u == '/' || *u == '+') ? '_' : *u;
+            p += 8;
+        } else if (strncmp(p, "{name}", 6) == 0) {
+            if (client != NULL)
+                len = AppendTemplateValue(out, outSize, len, StringPoolGet(&strings, client->nameAnonymized), isTopic);
+            p += 6;
+        } else if (strncmp(p, "{channel}", 9) == 0) {
+            if (client != NULL)
+                len = AppendTemplateValue(out, outSize, len, GetChannelPath(serverConnectionHandlerID, client->channelID), isTopic);
+            p += 9;
+        } else if (strncmp(p, "{servergroups}", 14) == 0) {
+            for (int i = 0; client != NULL && i < client->serverGroupCount; i++) {
+                if (i > 0)
+                    len = AppendTemplateValue(out, outSize, len, ",", isTopic);
+                len = AppendTemplateValue(out, outSize, len, GetGroupName(serverConnectionHandlerID, GROUP_KIND_SERVER, client->serverGroups[i]), isTopic);
+            }
+            p += 14;
+        } else if (strncmp(p, "{channelgroup}", 14) == 0) {
+            if (client != NULL && client->channelGroupID != 0)
+                len = AppendTemplateValue(out, outSize, len, GetGroupName(serverConnectionHandlerID, GROUP_KIND_CHANNEL, client->channelGroupID), isTopic);
+            p += 14;
+        } else if (strncmp(p, "{duration}", 10) == 0) {
+            if (talk != NULL) {
+                snprintf(number, sizeof(number), "%llu", (unsigned long long)talk->durationMs);
+                len = AppendTemplateValue(out, outSize, len, number, isTopic);
+            }
+            p += 10;
+        } else if (strncmp(p, "{bursts}", 8) == 0) {
+            if (talk != NULL) {
+                snprintf(number, sizeof(number), "%u", talk->bursts);
+                len = AppendTemplateValue(out, outSize, len, number, isTopic);
+            }
+            p += 8;
         } else {
-            printf("PLUGIN: --> %s has STOPPED sending\n", name);
+            out[len++] = *p++;
+        }
+    }
+    out[len] = '\0';
+}
 
-            if (atoi(configLhShowStop) == 1) {
-                if (strlen(configLhColorStop) > 0) {
-                    snprintf(colorStart, PATH_BUFSIZE, "[color=%s]", configLhColorStop);
-                    snprintf(colorStop, PATH_BUFSIZE, "[/color]");
+// Appends ,"key":"value" with the value JSON escaped, or the raw value if quote is FALSE (numbers, arrays).
+// A field that does not fit completely is left out, one byte stays free for the closing brace.
+static size_t AppendJsonField(char* out, size_t outSize, size_t len, const char* key, const char* value, BOOL quote)
+{
+    char escaped[BIG_BUFSIZE];
+    int  n;
+
+    if (quote)
+        EscapeJsonString(value, escaped, sizeof(escaped));
+    n = snprintf(out + len, outSize - len, "%s\"%s\":%s%s%s", len > 1 ? "," : "", key, quote ? "\"" : "", quote ? escaped : value, quote ? "\"" : "");
+    if (n < 0 || (size_t)n + 1 >= outSize - len) {
+        out[len] = '\0';
+        return len;
+    }
+    return len + (size_t)n;
+}
+
+// Talk event as JSON object for PAYLOAD=json, caller must hold cacheLock
+static void FormatJsonMessage(uint64 serverConnectionHandlerID, const CLIENT_CACHE_ENTRY* client, const TALK_INFO* talk, BOOL talking, char* out, size_t outSize)
+{
+    SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+    char          number[24];
+    char          groups[BIG_BUFSIZE];
+    size_t        groupsLen = 1;
+    size_t        len       = 1;
+
+    if (outSize < 3) {
+        out[0] = '\0';
+        return;
+    }
+    out[0] = '{';
+    out[1] = '\0';
+
+    len = AppendJsonField(out, outSize, len, "event", talking ? "start" : "stop", TRUE);
+    len = AppendJsonField(out, outSize, len, "server", shard != NULL ? shard->uniqueIdentifier : "", TRUE);
+    snprintf(number, sizeof(number), "%u", (unsigned int)client->clientID);
+    len = AppendJsonField(out, outSize, len, "client", number, FALSE);
+    len = AppendJsonField(out, outSize, len, "name", StringPoolGet(&strings, client->nameAnonymized), TRUE);
+    len = AppendJsonField(out, outSize, len, "channel", GetChannelPath(serverConnectionHandlerID, client->channelID), TRUE);
+
+    groups[0] = '[';
+    for (int i = 0; i < client->serverGroupCount; i++) {
+        char escaped[GROUP_NAME_LEN * 2];
+        int  n;
+
+        EscapeJsonString(GetGroupName(serverConnectionHandlerID, GROUP_KIND_SERVER, client->serverGroups[i]), escaped, sizeof(escaped));
+        n = snprintf(groups + groupsLen, sizeof(groups) - groupsLen, "%s\"%s\"", i > 0 ? "," : "", escaped);
+        if (n < 0 || (size_t)n + 1 >= sizeof(groups) - groupsLen)
+            break;
+        groupsLen += (size_t)n;
+    }
+    groups[groupsLen++] = ']';
+    groups[groupsLen]   = '\0';
+    len = AppendJsonField(out, outSize, len, "servergroups", groups, FALSE);
+
+    if (client->channelGroupID != 0)
+        len = AppendJsonField(out, outSize, len, "channelgroup", GetGroupName(serverConnectionHandlerID, GROUP_KIND_CHANNEL, client->channelGroupID), TRUE);
+    snprintf(number, sizeof(number), "%u", talk->bursts);
+    len = AppendJsonField(out, outSize, len, "bursts", number, FALSE);
+    if (!talking) {
+        snprintf(number, sizeof(number), "%llu", (unsigned long long)talk->durationMs);
+        len = AppendJsonField(out, outSize, len, "duration_ms", number, FALSE);
+    }
+    out[len++] = '}';
+    out[len]   = '\0';
+}
+
+// Hands the message to lh2mqttd, FALSE if the daemon is not configured, not running or its ring is full
+static BOOL PublishViaDaemon(const char* topic, const char* message, uint64 serverConnectionHandlerID)
+{
+    BOOL pushed = FALSE;
+
+    MutexLock(&shmRingLock);
+    if (shmRingOpen && ShmRingConsumerAlive(&shmRing))
+        pushed = ShmRingPush(&shmRing, serverConnectionHandlerID, topic, message) ? TRUE : FALSE;
+    MutexUnlock(&shmRingLock);
+
+    if (pushed)
+        NotePublished();
+    if (pushed && atoi(configLogMqttMsg) == 1) {
+        char msg[CHANNELINFO_BUFSIZE];
+        snprintf(msg, sizeof(msg), "[MQTT] Topic=%s, Msg=%s", topic, message);
+        ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", serverConnectionHandlerID);
+        printf("PLUGIN: LOG MQTT MSG: %s\n", msg);
+    }
+    return pushed;
+}
+
+// Copies the broker at index of the HOST list (comma separated), FALSE if the list is shorter
+static BOOL GetBrokerHost(int index, char* host, size_t hostSize)
+{
+    const char* p = configMqttHost;
+
+    for (; index > 0 && p != NULL; index--) {
+        p = strchr(p, ',');
+        if (p != NULL)
+            p++;
+    }
+    if (p == NULL)
+        return FALSE;
+    p += strspn(p, " \t");
+    snprintf(host, hostSize, "%.*s", (int)strcspn(p, ", \t"), p);
+    return strlen(host) > 0;
+}
+
+// Builds the mosquitto_pub command line for one broker, FALSE if it did not fit into command
+static BOOL FormatPublishCommand(const char* host, const char* port, const char* user, const char* password, const char* qos, const char* cafile,
+                                 const char* topic, const char* message, char* command, size_t commandSize)
+{
+    char topicArg[BIG_BUFSIZE];
+    char messageArg[SHELL_BUFSIZE / 2];
+    char hostArg[PATH_BUFSIZE - 16];
+    char userArg[PATH_BUFSIZE / 2];
+    char passwordArg[PATH_BUFSIZE / 2];
+    char valueArg[PATH_BUFSIZE - 16];
+    char exeArg[PATH_BUFSIZE];
+    int  len;
+    char mqttHost[PATH_BUFSIZE]   = "";
+    char mqttPort[PATH_BUFSIZE]   = "";
+    char mqttQos[PATH_BUFSIZE]    = "";
+    char mqttCafile[PATH_BUFSIZE] = "";
+    BOOL unixSocket               = strncmp(host, UNIX_HOST_PREFIX, strlen(UNIX_HOST_PREFIX)) == 0;
+
+    // every value of the config file is quoted and escaped like the topic, none may break out of its argument.
+    // A local socket has no port and needs no TLS.
+    if (unixSocket) {
+        EscapeShellArgument(host + strlen(UNIX_HOST_PREFIX), hostArg, sizeof(hostArg));
+        snprintf(mqttHost, sizeof(mqttHost), "--unix \"%s\"", hostArg);
+    } else {
+        EscapeShellArgument(host, hostArg, sizeof(hostArg));
+        snprintf(mqttHost, sizeof(mqttHost), "-h \"%s\"", hostArg);
+    }
+
+    if (strlen(port) > 0 && !unixSocket) {
+        EscapeShellArgument(port, valueArg, sizeof(valueArg));
+        snprintf(mqttPort, sizeof(mqttPort), "-p \"%s\"", valueArg);
+    }
+
+    if (strlen(qos) > 0) {
+        EscapeShellArgument(qos, valueArg, sizeof(valueArg));
+        snprintf(mqttQos, sizeof(mqttQos), "-q \"%s\"", valueArg);
+    }
+
+    if (strlen(cafile) > 0 && !unixSocket) {
+        EscapeShellArgument(cafile, valueArg, sizeof(valueArg));
+        snprintf(mqttCafile, sizeof(mqttCafile), "--cafile \"%s\"", valueArg);
+    }
+
+    // nicknames and JSON payloads may contain quotes, they must not end the argument
+    EscapeShellArgument(topic, topicArg, sizeof(topicArg));
+    EscapeShellArgument(message, messageArg, sizeof(messageArg));
+    EscapeShellArgument(configMqttExe, exeArg, sizeof(exeArg));
+
+    if (strlen(user) > 0) {
+        EscapeShellArgument(user, userArg, sizeof(userArg));
+        EscapeShellArgument(password, passwordArg, sizeof(passwordArg));
+        len = snprintf(command, commandSize, "\"%s\" %s %s -u \"%s\" -P \"%s\" -t \"%s\" %s -m \"%s\" %s", exeArg, mqttHost, mqttPort, userArg, passwordArg,
+                       topicArg, mqttQos, messageArg, mqttCafile);
+    } else
+        len = snprintf(command, commandSize, "\"%s\" %s %s -t \"%s\" %s -m \"%s\" %s", exeArg, mqttHost, mqttPort, topicArg, mqttQos, messageArg, mqttCafile);
+    // a cut off command could end inside an argument
+    return len >= 0 && (size_t)len < commandSize;
+}
+
+// Sends a message via lh2mqttd if it runs, otherwise via mosquitto_pub on the worker lane of the client, clientID 0
+// for messages of the server tab. Messages of one lane are sent in order, so a STOP never overtakes its START.
+// SINK_PRIORITY_HIGH messages use the priority lane. FALSE only if the publish queue was full.
+static BOOL SendMqttMessage(const char* topic, const char* message, uint64 serverConnectionHandlerID, anyID clientID, int priority)
+{
+    char msgShell[SHELL_BUFSIZE];
+    char mqttHost[HOST_LEN] = "";
+
+    if (PublishViaDaemon(topic, message, serverConnectionHandlerID))
+        return TRUE;
+
+    // only lh2mqttd fails over, mosquitto_pub always gets the first broker
+    GetBrokerHost(0, mqttHost, sizeof(mqttHost));
+    if (!FormatPublishCommand(mqttHost, configMqttPort, configMqttUser, configMqttPassword, configMqttQos, configMqttCafile, topic, message,
+                              msgShell, sizeof(msgShell))) {
+        printf("PLUGIN: ERROR: command line too long, message dropped: %s\n", topic);
+        return TRUE;
+    }
+
+    if (!DispatchSubmit(&dispatcher, serverConnectionHandlerID, clientID, priority == SINK_PRIORITY_HIGH, msgShell, topic, message)) {
+        printf("PLUGIN: ERROR: publish queue full, message dropped: %s\n", topic);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Fans a message out to the broker and the other sinks taking MQTT messages, see ConfigureSinks
+static void QueueMqttMessage(const char* topic, const char* message, uint64 serverConnectionHandlerID, anyID clientID, int priority)
+{
+    if (SinkPublish(&sinks, SINK_EVENT_MQTT, priority, serverConnectionHandlerID, clientID, topic, message) > 0)
+        printf("PLUGIN: ERROR: sink queue full, message dropped: %s\n", topic);
+}
+
+// Messages over RATE_LIMIT are held back, OnRateLimitTimer sends a summary of them
+static void PublishMqttMessage(const char* topic, const char* message, uint64 serverConnectionHandlerID, anyID clientID, int priority)
+{
+    if (RateLimitAllow(&rateLimiter, serverConnectionHandlerID, clientID, topic, message))
+        QueueMqttMessage(topic, message, serverConnectionHandlerID, clientID, priority);
+}
+
+// Number of suppressed messages and the latest one, e.g. the final state of a stuck push-to-talk key
+static void PublishSuppressedSummary(const RATE_LIMIT_EVENT* latest, uint64 suppressed, void* arg)
+{
+    char topic[BIG_BUFSIZE];
+    char message[SHELL_BUFSIZE];
+    char escaped[SHELL_BUFSIZE / 2];
+
+    snprintf(topic, sizeof(topic), "%s/suppressed", latest->topic);
+    if (strcmp(configMqttPayload, "json") != 0) {
+        snprintf(message, sizeof(message), "suppressed=%llu;latest=%s", (unsigned long long)suppressed, latest->message);
+    } else if (latest->message[0] == '{' || latest->message[0] == '[') {
+        snprintf(message, sizeof(message), "{\"suppressed\":%llu,\"latest\":%s}", (unsigned long long)suppressed, latest->message);
+    } else {
+        EscapeJsonString(latest->message, escaped, sizeof(escaped));
+        snprintf(message, sizeof(message), "{\"suppressed\":%llu,\"latest\":\"%s\"}", (unsigned long long)suppressed, escaped);
+    }
+    QueueMqttMessage(topic, message, latest->serverConnectionHandlerID, latest->clientID, SINK_PRIORITY_BULK);
+}
+
+// Runs on the event loop every RATE_SUMMARY_MS while RATE_LIMIT is set
+static void OnRateLimitTimer(void* arg)
+{
+    RateLimitCollect(&rateLimiter, PublishSuppressedSummary, NULL);
+    if (AtomicLoad64(&rateLimiter.intervalUs) > 0)
+        EventTimerStart(&eventLoop, &rateLimitTimer, RATE_SUMMARY_MS);
+}
+
+static void MqttSinkPublish(void* arg, const SINK_EVENT* event)
+{
+    SendMqttMessage(event->topic, event->message, event->serverConnectionHandlerID, event->clientID, event->priority);
+}
+
+// Synchronous sink, printMessage is only called on the callback thread which raised the event
+static void ChannelTabSinkPublish(void* arg, const SINK_EVENT* event)
+{
+    ts3Functions.printMessage(event->serverConnectionHandlerID, event->message, PLUGIN_MESSAGE_TARGET_CHANNEL);
+}
+
+static int FileSinkInit(void* arg)
+{
+    logFile = fopen(configLogFile, "a");
+    if (logFile == NULL) {
+        char msg[TS3LOG_BUFSIZE];
+        snprintf(msg, sizeof(msg), "Log-Datei konnte nicht geoeffnet werden: %s", configLogFile);
+        ts3Functions.logMessage(msg, LogLevel_ERROR, "Plugin lh2mqtt", 0);
+        printf("PLUGIN: ERROR: log file could not be opened: %s\n", configLogFile);
+    }
+    return logFile != NULL;
+}
+
+// One line per message: time, server tab, topic and message. Collected until the queue ran empty.
+static void FileSinkPublish(void* arg, const SINK_EVENT* event)
+{
+    char*  timeStr = GetCurrDate("%Y-%m-%d %H:%M:%S");
+    size_t need    = strlen(event->topic) + strlen(event->message) + 64 + (timeStr != NULL ? strlen(timeStr) : 0);
+    int    len;
+
+    if (logLinesLen + need > logLinesSize) {
+        char* lines = (char*)realloc(logLines, (logLinesLen + need) * 2);
+
+        if (lines == NULL) {
+            printf("PLUGIN: ERROR: out of memory, log line dropped: %s\n", event->topic);
+            SlabFree(timeStr);
+            return;
+        }
+        logLines     = lines;
+        logLinesSize = (logLinesLen + need) * 2;
+    }
+    len = snprintf(logLines + logLinesLen, logLinesSize - logLinesLen, "%s %llu %s %s\n", timeStr != NULL ? timeStr : "-",
+                   (unsigned long long)event->serverConnectionHandlerID, event->topic, event->message);
+    if (len > 0)
+        logLinesLen += (size_t)len;
+    SlabFree(timeStr);
+}
+
+// Called whenever the queue ran empty, a burst of messages costs one write. It is queued on the event loop, which
+// submits the writes of all its streams together, so the sink's worker never waits for the disk.
+static void FileSinkFlush(void* arg)
+{
+    if (logLinesLen == 0)
+        return;
+#ifndef _WIN32
+    if (!eventLoopRunning || !EventLoopWrite(&eventLoop, fileno(logFile), logLines, logLinesLen, NULL, NULL))
+#endif
+    {
+        fwrite(logLines, 1, logLinesLen, logFile);
+        fflush(logFile);
+    }
+    logLinesLen = 0;
+}
+
+// Last write of a log file, the lines queued before it went out
+static void CloseLogFile(int fd, int error, void* arg)
+{
+    fclose((FILE*)arg);
+}
+
+static void FileSinkShutdown(void* arg)
+{
+    FileSinkFlush(arg);
+#ifndef _WIN32
+    if (!eventLoopRunning || !EventLoopWrite(&eventLoop, fileno(logFile), "", 0, CloseLogFile, logFile))
+#endif
+        fclose(logFile);
+    logFile = NULL;
+    free(logLines);
+    logLines     = NULL;
+    logLinesLen  = 0;
+    logLinesSize = 0;
+}
+
+// [BROKER1] .. [BROKER4], every section is a sink of its own, so a slow broker only fills its own queue
+typedef struct {
+    BROKER_SECTION section;
+    int            index;
+#ifndef _WIN32
+    MQTT_CLIENT     client;      // connection kept by the sink's worker, plain TCP or Unix socket
+    uint64          reconnectMs; // no connect attempt before, the broker was unreachable
+    volatile uint64 stopMs;      // deadline of SinkRemoveAll, the client stops waiting for the broker then
+#endif
+} EXTRA_BROKER;
+
+static EXTRA_BROKER extraBrokers[BROKER_SECTIONS];
+static SINK_OPS     extraBrokerSinks[BROKER_SECTIONS];
+
+#ifndef _WIN32
+// Publishes over the connection of the section, which is opened on the first message and kept. A connection idle
+// for half the keepalive is checked with a ping first, the broker may have dropped it meanwhile.
+static BOOL ExtraBrokerPublishDirect(EXTRA_BROKER* broker, const char* topic, const char* message)
+{
+    char   clientId[48];
+    uint64 now = GetMonotonicTimeMs();
+
+    if (broker->client.fd >= 0 && now - broker->client.lastSendMs >= EXTRA_BROKER_KEEPALIVE_SEC * 1000 / 2)
+        MqttPing(&broker->client);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (broker->client.fd < 0) {
+            if (now < broker->reconnectMs)
+                return FALSE;
+            snprintf(clientId, sizeof(clientId), "lh2mqtt-%d-broker%d", (int)getpid(), broker->index + 1);
+            if (!MqttConnect(&broker->client, broker->section.HOST, broker->section.PORT, clientId, broker->section.USER, broker->section.PASSWORD,
+                             EXTRA_BROKER_KEEPALIVE_SEC)) {
+                printf("PLUGIN: ERROR: could not connect to broker %s\n", broker->section.NAME);
+                broker->reconnectMs = GetMonotonicTimeMs() + EXTRA_BROKER_RECONNECT_MS;
+                return FALSE;
+            }
+        }
+        // a failed publish closed the connection, one new one is tried
+        if (MqttPublish(&broker->client, topic, message, atoi(broker->section.QOS)))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+// Wait hook of the client, a connect or acknowledgement still outstanding at the deadline is given up
+static int ExtraBrokerWait(void* arg)
+{
+    uint64 stopMs = AtomicLoad64(&((EXTRA_BROKER*)arg)->stopMs);
+
+    return stopMs == 0 || GetMonotonicTimeMs() < stopMs;
+}
+
+static int ExtraBrokerSinkInit(void* arg)
+{
+    EXTRA_BROKER* broker = (EXTRA_BROKER*)arg;
+
+    MqttInit(&broker->client);
+    broker->client.resolver = &brokerResolver;
+    broker->client.wait     = ExtraBrokerWait;
+    broker->client.waitArg  = broker;
+    broker->reconnectMs     = 0;
+    AtomicExchange64(&broker->stopMs, 0);
+    return 1;
+}
+
+static void ExtraBrokerSinkStop(void* arg, uint64 deadlineMs)
+{
+    AtomicExchange64(&((EXTRA_BROKER*)arg)->stopMs, deadlineMs);
+}
+
+static void ExtraBrokerSinkShutdown(void* arg)
+{
+    MqttDisconnect(&((EXTRA_BROKER*)arg)->client);
+}
+#endif
+
+// Runs on the worker of the broker's sink, waiting for the broker delays no other broker. Only a broker with CAFILE
+// gets mosquitto_pub, the built-in client has no TLS.
+static void ExtraBrokerSinkPublish(void* arg, const SINK_EVENT* event)
+{
+    EXTRA_BROKER*         broker  = (EXTRA_BROKER*)arg;
+    const BROKER_SECTION* section = &broker->section;
+    char                  topic[BIG_BUFSIZE];
+    char                  command[SHELL_BUFSIZE];
+
+    snprintf(topic, sizeof(topic), "%s%s", section->TOPIC_PREFIX, event->topic);
+#ifndef _WIN32
+    if (strlen(section->CAFILE) == 0 || MqttIsUnixHost(section->HOST)) {
+        if (!ExtraBrokerPublishDirect(broker, topic, event->message))
+            printf("PLUGIN: ERROR: message to broker %s dropped: %s\n", section->NAME, topic);
+        return;
+    }
+#endif
+    if (!FormatPublishCommand(section->HOST, section->PORT, section->USER, section->PASSWORD, section->QOS, section->CAFILE, topic, event->message,
+                              command, sizeof(command))) {
+        printf("PLUGIN: ERROR: command line too long, message to broker %s dropped: %s\n", section->NAME, topic);
+        return;
+    }
+    ExecuteCommandInBackground(command, topic, event->message, event->serverConnectionHandlerID);
+}
+
+// Reads [BROKERn] and adds its sink if a HOST is set, the old sinks must be removed already
+static void ConfigureExtraBroker(int index)
+{
+    BROKER_SECTION broker;
+    SINK_OPS*      ops = &extraBrokerSinks[index];
+    char           sectionName[16];
+    char           msg1[TS3LOG_BUFSIZE];
+    char           msg2[TS3LOG_BUFSIZE];
+
+    snprintf(sectionName, sizeof(sectionName), "BROKER%d", index + 1);
+    ReadIniValue(configIniFileName, sectionName, "NAME", broker.NAME, sizeof(broker.NAME), FALSE);
+    ReadIniValue(configIniFileName, sectionName, "HOST", broker.HOST, sizeof(broker.HOST), FALSE);
+    if (strlen(broker.HOST) == 0)
+        return;
+    ReadIniValue(configIniFileName, sectionName, "PORT", broker.PORT, sizeof(broker.PORT), FALSE);
+    ReadIniValue(configIniFileName, sectionName, "USER", broker.USER, sizeof(broker.USER), FALSE);
+    ReadIniValue(configIniFileName, sectionName, "PASSWORD", broker.PASSWORD, sizeof(broker.PASSWORD), TRUE);
+    ReadIniValue(configIniFileName, sectionName, "QOS", broker.QOS, sizeof(broker.QOS), FALSE);
+    ReadIniValue(configIniFileName, sectionName, "CAFILE", broker.CAFILE, sizeof(broker.CAFILE), FALSE);
+    ReadIniValue(configIniFileName, sectionName, "TOPIC_PREFIX", broker.TOPIC_PREFIX, sizeof(broker.TOPIC_PREFIX), FALSE);
+    if (strlen(broker.NAME) == 0)
+        snprintf(broker.NAME, sizeof(broker.NAME), "%s", sectionName);
+
+    extraBrokers[index].section = broker;
+    extraBrokers[index].index   = index;
+    memset(ops, 0, sizeof(*ops));
+    ops->name    = extraBrokers[index].section.NAME;
+    ops->kinds   = SINK_EVENT_MQTT;
+    ops->publish = ExtraBrokerSinkPublish;
+#ifndef _WIN32
+    ops->init     = ExtraBrokerSinkInit;
+    ops->shutdown = ExtraBrokerSinkShutdown;
+    ops->stop     = ExtraBrokerSinkStop;
+    if (!brokerResolverStarted) {
+        if (!ResolverStart(&brokerResolver, NULL))
+            printf("PLUGIN: ERROR: resolver worker could not be started, brokers are resolved on connect\n");
+        brokerResolverStarted = TRUE;
+    }
+    // resolved in the background, the first message does not wait for DNS if it comes later
+    if (strlen(broker.CAFILE) == 0 && !MqttIsUnixHost(broker.HOST))
+        ResolverLookup(&brokerResolver, broker.HOST, strlen(broker.PORT) > 0 ? broker.PORT : MQTT_DEFAULT_PORT, NULL, 0, 0);
+#endif
+    if (!SinkAdd(&sinks, ops, &extraBrokers[index])) {
+        printf("PLUGIN: ERROR: broker sink could not be added: %s\n", broker.NAME);
+        return;
+    }
+
+    snprintf(msg1, sizeof(msg1), "[INI-%s|1] Host=%s, Port=%s, User=%s, Password=***, Qos=%s, Cafile=%s",
+        sectionName, broker.HOST, broker.PORT, broker.USER, broker.QOS, broker.CAFILE);
+    ts3Functions.logMessage(msg1, LogLevel_INFO, "Plugin lh2mqtt", 0);
+
+    snprintf(msg2, sizeof(msg2), "[INI-%s|2] Name=%s, TopicPrefix=%s", sectionName, broker.NAME, broker.TOPIC_PREFIX);
+    ts3Functions.logMessage(msg2, LogLevel_INFO, "Plugin lh2mqtt", 0);
+}
+
+static const SINK_OPS mqttSink       = { "mqtt", SINK_EVENT_MQTT, NULL, MqttSinkPublish, NULL, NULL, 1 }; // hands on to lh2mqttd or a publish lane, both queue
+static const SINK_OPS channelTabSink = { "channeltab", SINK_EVENT_TEXT, NULL, ChannelTabSinkPublish, NULL, NULL, 1 }; // client lib call, stays on the callback thread
+static const SINK_OPS fileSink       = { "file", SINK_EVENT_MQTT, FileSinkInit, FileSinkPublish, FileSinkFlush, FileSinkShutdown };
+
+// (Re)creates the sinks from the configuration. Queued events of the old ones are published first, for at most
+// RELOAD_DRAIN_MS since the TeamSpeak thread waits. Broker messages left then are spooled, ts3plugin_init replays them.
+static void ConfigureSinks(void)
+{
+    SPOOL spool;
+
+    SpoolOpen(&spool, spoolFileName);
+    SinkRemoveAll(&sinks, GetMonotonicTimeMs() + RELOAD_DRAIN_MS, SpillSinkEvent, &spool);
+    SpoolClose(&spool);
+    if (spool.count > 0)
+        printf("PLUGIN: %u messages not sent before the reload, spooled to %s\n", spool.count, spoolFileName);
+    if (!SinkAdd(&sinks, &mqttSink, NULL))
+        printf("PLUGIN: ERROR: mqtt sink could not be added\n");
+    if (!SinkAdd(&sinks, &channelTabSink, NULL))
+        printf("PLUGIN: ERROR: channel tab sink could not be added\n");
+    if (strlen(configLogFile) > 0 && !SinkAdd(&sinks, &fileSink, NULL))
+        printf("PLUGIN: ERROR: file sink could not be added\n");
+    for (int i = 0; i < BROKER_SECTIONS; i++)
+        ConfigureExtraBroker(i);
+
+    if (eventLoopRunning && shmRingOpen && !DaemonAttached()) {
+        SinkHold(&sinks, &mqttSink, 1);
+        daemonWaitStartMs = GetMonotonicTimeMs();
+        EventTimerStart(&eventLoop, &daemonWaitTimer, DAEMON_WAIT_POLL_MS);
+    }
+}
+
+// Only broker messages are spooled, lines for the channel tab or the log file are stale on the next start
+static void SpillSinkEvent(const SINK_OPS* ops, const SINK_EVENT* event, void* arg)
+{
+    if (ops == &mqttSink)
+        SpoolWrite((SPOOL*)arg, event->topic, event->message);
+}
+
+static void SpillJob(const char* topic, const char* message, void* arg)
+{
+    SpoolWrite((SPOOL*)arg, topic, message);
+}
+
+// Goes straight to the broker, the other sinks already had the message before the shutdown. A message which finds
+// the publish queue full stays spooled for the next start.
+static int ReplaySpooled(const char* topic, const char* message, void* arg)
+{
+    return SendMqttMessage(topic, message, 0, 0, SINK_PRIORITY_BULK);
+}
+
+// Topic of the active speakers with "/delta" or "/snapshot" appended, FALSE if TOPIC_SPEAKERS is empty.
+// Caller must hold cacheLock.
+static BOOL GetSpeakersTopic(uint64 serverConnectionHandlerID, const char* suffix, char* topic, size_t topicSize)
+{
+    size_t len;
+
+    if (strlen(configMqttTopicSpeakers) == 0)
+        return FALSE;
+    ExpandTemplate(configMqttTopicSpeakers, serverConnectionHandlerID, NULL, NULL, TRUE, topic, topicSize);
+    len = strlen(topic);
+    snprintf(topic + len, topicSize - len, "/%s", suffix);
+    return TRUE;
+}
+
+// Complete list of the active speakers like "seq=12;count=3;speakers=4:7,9|12:3", grouped by channel.
+// Deltas with a sequence up to seq are contained in the list, count tells if the list had to be cut off.
+// Caller must hold cacheLock.
+static BOOL FormatSpeakerSnapshot(SERVER_SHARD* shard, char* topic, size_t topicSize, char* message, size_t messageSize)
+{
+    int len;
+
+    if (!GetSpeakersTopic(shard->serverConnectionHandlerID, "snapshot", topic, topicSize))
+        return FALSE;
+    len = snprintf(message, messageSize, "seq=%u;count=%d;speakers=", shard->speakers.sequence, shard->speakers.count);
+    if (len > 0 && (size_t)len < messageSize)
+        ActiveSpeakersFormat(&shard->speakers, message + len, messageSize - len);
+    return TRUE;
+}
+
+// Single change of the active speakers like "seq=13;op=add;channel=4;client=7;name=Ben", op is add, remove or move.
+// Caller must hold cacheLock.
+static BOOL FormatSpeakerDelta(SERVER_SHARD* shard, const char* op, uint64 channelID, anyID clientID, char* topic, size_t topicSize, char* message, size_t messageSize)
+{
+    CLIENT_CACHE_ENTRY* client = ClientCacheFind(&shard->clients, shard->serverConnectionHandlerID, clientID);
+    int                 len;
+
+    if (!GetSpeakersTopic(shard->serverConnectionHandlerID, "delta", topic, topicSize))
+        return FALSE;
+    len = snprintf(message, messageSize, "seq=%u;op=%s;channel=%llu;client=%u;name=", shard->speakers.sequence, op, (unsigned long long)channelID, (unsigned int)clientID);
+    if (len < 0 || (size_t)len >= messageSize)
+        return TRUE;
+    len = (int)AppendTemplateValue(message, messageSize, len, client != NULL ? StringPoolGet(&strings, client->name) : "", FALSE);
+    message[len] = '\0';
+    return TRUE;
+}
+
+// Keeps cache and active speakers in sync when a client switches channels or leaves the server
+static void ClientChannelChanged(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID, BOOL leftServer)
+{
+    char   topic[PATH_BUFSIZE];
+    char   message[PATH_BUFSIZE];
+    BOOL   publish = FALSE;
+    uint64 oldChannelID;
+
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = ServerShardFind(&shards, serverConnectionHandlerID);
+    if (shard != NULL) {
+        // a speaker leaving the server (or the visible area) does not send a talk stop event
+        if (leftServer || newChannelID == 0) {
+            if (ActiveSpeakersRemove(&shard->speakers, clientID, &oldChannelID))
+                publish = FormatSpeakerDelta(shard, "remove", oldChannelID, clientID, topic, sizeof(topic), message, sizeof(message));
+            TalkSessionsRemove(&talkSessions, serverConnectionHandlerID, clientID);
+        } else if (ActiveSpeakersMove(&shard->speakers, clientID, newChannelID)) {
+            publish = FormatSpeakerDelta(shard, "move", newChannelID, clientID, topic, sizeof(topic), message, sizeof(message));
+        }
+
+        if (leftServer)
+            ClientCacheInvalidate(&shard->clients, serverConnectionHandlerID, clientID);
+        else
+            ClientCacheUpdateChannel(&shard->clients, serverConnectionHandlerID, clientID, newChannelID);
+    }
+    MutexUnlock(&cacheLock);
+
+    if (publish)
+        PublishMqttMessage(topic, message, serverConnectionHandlerID, 0, SINK_PRIORITY_BULK);
+}
+
+// Milliseconds between two complete speaker lists, 0 if disabled. Caller must hold cacheLock.
+static uint64 GetSpeakersIntervalMs(void)
+{
+    if (strlen(configMqttTopicSpeakers) == 0)
+        return 0;
+    if (strlen(configMqttSpeakersInterval) == 0)
+        return SPEAKERS_INTERVAL_DEFAULT * 1000;
+    return atoi(configMqttSpeakersInterval) > 0 ? (uint64)atoi(configMqttSpeakersInterval) * 1000 : 0;
+}
+
+static uint64 GetShutdownTimeoutMs(void)
+{
+    if (strlen(configMqttShutdownTimeout) == 0)
+        return SHUTDOWN_TIMEOUT_DEFAULT * 1000;
+    return atoi(configMqttShutdownTimeout) > 0 ? (uint64)atoi(configMqttShutdownTimeout) * 1000 : 0;
+}
+
+// Publishes the complete list of the active speakers of every server tab, so consumers can resync
+static void PublishSpeakerSnapshots(void)
+{
+    uint64 ids[SERVER_SHARD_MAX];
+    int    count;
+
+    MutexLock(&cacheLock);
+    count = shards.count;
+    for (int i = 0; i < count; i++)
+        ids[i] = shards.shards[i]->serverConnectionHandlerID;
+    MutexUnlock(&cacheLock);
+
+    for (int i = 0; i < count; i++) {
+        char topic[PATH_BUFSIZE];
+        char message[BIG_BUFSIZE];
+        BOOL publish = FALSE;
+
+        MutexLock(&cacheLock);
+        SERVER_SHARD* shard = ServerShardFind(&shards, ids[i]);
+        if (shard != NULL)
+            publish = FormatSpeakerSnapshot(shard, topic, sizeof(topic), message, sizeof(message));
+        MutexUnlock(&cacheLock);
+
+        if (publish)
+            PublishMqttMessage(topic, message, ids[i], 0, SINK_PRIORITY_BULK);
+    }
+}
+
+// Runs on the event loop, the timer is re-armed until the interval is set to 0
+static void OnSpeakersTimer(void* arg)
+{
+    uint64 interval = GetSpeakersIntervalMs();
+
+    PublishSpeakerSnapshots();
+    if (interval > 0)
+        EventTimerStart(&eventLoop, &speakersTimer, interval);
+}
+
+// Opens the ring of lh2mqttd and passes the broker settings, or closes it when DAEMON was removed from the INI file
+static void UpdateDaemon(void)
+{
+    SHM_RING_CONFIG config;
+    char            name[64];
+
+    MutexLock(&shmRingLock);
+    if (strlen(configMqttDaemon) == 0) {
+        if (shmRingOpen) {
+            ShmRingClose(&shmRing);
+            shmRingOpen = FALSE;
+        }
+    } else {
+        if (!shmRingOpen) {
+            ShmRingName(name, sizeof(name));
+            shmRingOpen = ShmRingCreate(&shmRing, name) ? TRUE : FALSE;
+            if (!shmRingOpen)
+                printf("PLUGIN: ERROR: shared memory %s for lh2mqttd could not be created or is used by another client, publishing directly\n", name);
+        }
+        if (shmRingOpen) {
+            memset(&config, 0, sizeof(config));
+            snprintf(config.exe, sizeof(config.exe), "%s", configMqttExe);
+            snprintf(config.host, sizeof(config.host), "%s", configMqttHost);
+            snprintf(config.port, sizeof(config.port), "%s", configMqttPort);
+            snprintf(config.user, sizeof(config.user), "%s", configMqttUser);
+            snprintf(config.password, sizeof(config.password), "%s", configMqttPassword);
+            snprintf(config.qos, sizeof(config.qos), "%s", configMqttQos);
+            snprintf(config.cafile, sizeof(config.cafile), "%s", configMqttCafile);
+            ShmRingSetConfig(&shmRing, &config);
+        }
+    }
+    MutexUnlock(&shmRingLock);
+
+    if (!eventLoopRunning)
+        return;
+    daemonCheckMs = DAEMON_CHECK_MS;
+    if (shmRingOpen)
+        EventTimerStart(&eventLoop, &daemonTimer, 0);
+    else
+        EventTimerCancel(&eventLoop, &daemonTimer);
+}
+
+// (Re)opens STATE_FILE, which clears what a previous instance left in it, or closes it when the key was emptied.
+// A reload with the same path keeps the file, its slots still match the server shards.
+static void UpdateStateFile(void)
+{
+    MutexLock(&cacheLock);
+    if (stateFileOpen && strcmp(stateFilePath, configMqttStateFile) == 0) {
+        MutexUnlock(&cacheLock);
+        return;
+    }
+    if (stateFileOpen) {
+        StateFileClose(&stateFile);
+        stateFileOpen = FALSE;
+    }
+    if (strlen(configMqttStateFile) > 0) {
+        stateFileOpen = StateFileOpen(&stateFile, configMqttStateFile) ? TRUE : FALSE;
+        snprintf(stateFilePath, sizeof(stateFilePath), "%s", configMqttStateFile);
+        if (!stateFileOpen)
+            printf("PLUGIN: ERROR: state file %s could not be opened\n", configMqttStateFile);
+    }
+    MutexUnlock(&cacheLock);
+}
+
+// Writes the current speaker of a server tab into STATE_FILE after a talk status change. The latest client to start
+// talking is the current speaker, when it stops one of the others still talking takes over. Caller must hold cacheLock.
+static void UpdateStateSpeaker(SERVER_SHARD* shard, anyID clientID, int status, uint64 now)
+{
+    uint64              serverConnectionHandlerID = shard->serverConnectionHandlerID;
+    anyID               speakerID                 = clientID;
+    CLIENT_CACHE_ENTRY* speaker;
+
+    if (!stateFileOpen)
+        return;
+    if (status != STATUS_TALKING) {
+        if (StateFileGetSpeaker(&stateFile, serverConnectionHandlerID) != clientID) {
+            StateFileSetTalkers(&stateFile, serverConnectionHandlerID, (unsigned int)shard->speakers.count);
+            return;
+        }
+        speakerID = shard->speakers.count > 0 ? shard->speakers.speakers[0].clientID : 0;
+    }
+    speaker = speakerID != 0 ? GetCachedClient(serverConnectionHandlerID, speakerID) : NULL;
+    if (speaker != NULL)
+        StateFileSetSpeaker(&stateFile, serverConnectionHandlerID, shard->uniqueIdentifier, speakerID, StringPoolGet(&strings, speaker->name),
+                            StringPoolGet(&strings, speaker->uniqueIdentifier), (unsigned int)shard->speakers.count, now);
+    else
+        StateFileSetSpeaker(&stateFile, serverConnectionHandlerID, shard->uniqueIdentifier, 0, "", "", (unsigned int)shard->speakers.count, now);
+}
+
+static BOOL DaemonAttached(void)
+{
+    BOOL alive;
+
+    MutexLock(&shmRingLock);
+    alive = shmRingOpen && ShmRingConsumerAlive(&shmRing);
+    MutexUnlock(&shmRingLock);
+    return alive;
+}
+
+// Releases the broker messages held back by ConfigureSinks once lh2mqttd attached, or publishes them directly when
+// it did not come up in time
+static void OnDaemonWaitTimer(void* arg)
+{
+    uint64 waitedMs = GetMonotonicTimeMs() - daemonWaitStartMs;
+
+    if (DaemonAttached()) {
+        printf("PLUGIN: lh2mqttd attached after %llu ms\n", (unsigned long long)waitedMs);
+    } else if (waitedMs >= DAEMON_WAIT_MS) {
+        printf("PLUGIN: lh2mqttd did not attach within %d ms, publishing directly\n", DAEMON_WAIT_MS);
+    } else {
+        EventTimerStart(&eventLoop, &daemonWaitTimer, DAEMON_WAIT_POLL_MS);
+        return;
+    }
+    SinkHold(&sinks, &mqttSink, 0);
+}
+
+// Logs how long it took from loading the plugin until the first message left it
+static void NotePublished(void)
+{
+    uint64 elapsedMs;
+    char   msg[TS3LOG_BUFSIZE];
+
+    if (firstPublishMs != 0)
+        return;
+    MutexLock(&cacheLock);
+    elapsedMs = GetMonotonicTimeMs() - initStartMs;
+    if (firstPublishMs != 0) {
+        MutexUnlock(&cacheLock);
+        return;
+    }
+    firstPublishMs = elapsedMs > 0 ? elapsedMs : 1;
+    MutexUnlock(&cacheLock);
+
+    printf("PLUGIN: first message published %llu ms after init\n", (unsigned long long)elapsedMs);
+    snprintf(msg, sizeof(msg), "Erste Nachricht %llu ms nach dem Laden gesendet", (unsigned long long)elapsedMs);
+    ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", 0);
+}
+
+// Starts lh2mqttd when it is not attached to the ring, e.g. after a crash. Checks less often while starting fails.
+static void OnDaemonTimer(void* arg)
+{
+    char pathArg[PATH_BUFSIZE];
+    char name[64];
+    char command[SHELL_BUFSIZE];
+    BOOL alive;
+
+    MutexLock(&shmRingLock);
+    alive = shmRingOpen && ShmRingConsumerAlive(&shmRing);
+    MutexUnlock(&shmRingLock);
+
+    if (alive) {
+        daemonCheckMs = DAEMON_CHECK_MS;
+    } else {
+#ifndef _WIN32
+        ShmRingName(name, sizeof(name));
+        EscapeShellArgument(configMqttDaemon, pathArg, sizeof(pathArg));
+        snprintf(command, sizeof(command), "\"%s\" %s > /dev/null 2>&1 &", pathArg, name);
+        printf("PLUGIN: starting lh2mqttd\n");
+        if (system(command) != 0)
+            printf("PLUGIN: ERROR: lh2mqttd could not be started: %s\n", configMqttDaemon);
+#else
+        (void)pathArg;
+        (void)name;
+        (void)command;
+#endif
+        daemonCheckMs = daemonCheckMs * 2 < DAEMON_CHECK_MAX_MS ? daemonCheckMs * 2 : DAEMON_CHECK_MAX_MS;
+    }
+    EventTimerStart(&eventLoop, &daemonTimer, daemonCheckMs);
+}
+
+typedef struct {
+    uint64 channelID;
+    uint64 parentID;
+    char   name[CHANNEL_NAME_LEN];
+} SNAPSHOT_CHANNEL;
+
+typedef struct {
+    int    kind;
+    uint64 groupID;
+    char   name[GROUP_NAME_LEN];
+} SNAPSHOT_GROUP;
+
+// State of one server tab, collected by the worker without holding cacheLock
+typedef struct {
+    SNAPSHOT_CHANNEL*   channels;
+    size_t              channelCount;
+    CLIENT_CACHE_ENTRY* clients;
+    size_t              clientCount;
+    SNAPSHOT_GROUP*     groups;
+    size_t              groupCount;
+    size_t              groupCapacity;
+    int                 serverGroupCount;
+    int                 channelGroupCount;
+    char                serverName[TS3_MAX_SIZE_VIRTUALSERVER_NAME * 4 + 1];
+} SERVER_SNAPSHOT;
+
+static void SnapshotAddGroup(SERVER_SNAPSHOT* snap, uint64 serverConnectionHandlerID, int kind, uint64 groupID)
+{
+    unsigned int error;
+
+    if (groupID == 0)
+        return;
+    for (size_t i = 0; i < snap->groupCount; i++) {
+        if (snap->groups[i].kind == kind && snap->groups[i].groupID == groupID)
+            return;
+    }
+
+    if (snap->groupCount == snap->groupCapacity) {
+        size_t          capacity = snap->groupCapacity ? snap->groupCapacity * 2 : 32;
+        SNAPSHOT_GROUP* groups   = (SNAPSHOT_GROUP*)realloc(snap->groups, capacity * sizeof(SNAPSHOT_GROUP));
+        if (groups == NULL)
+            return;
+        snap->groups        = groups;
+        snap->groupCapacity = capacity;
+    }
+
+    SNAPSHOT_GROUP* g = &snap->groups[snap->groupCount];
+    g->kind           = kind;
+    g->groupID        = groupID;
+    if (kind == GROUP_KIND_SERVER)
+        error = ts3Functions.getServerGroupNameByID(serverConnectionHandlerID, (unsigned int)groupID, g->name, sizeof(g->name));
+    else
+        error = ts3Functions.getChannelGroupNameByID(serverConnectionHandlerID, (unsigned int)groupID, g->name, sizeof(g->name));
+    if (error != ERROR_ok)
+        return;
+
+    snap->groupCount++;
+    if (kind == GROUP_KIND_SERVER)
+        snap->serverGroupCount++;
+    else
+        snap->channelGroupCount++;
+}
+
+// One pass over channels and clients of a server tab, returns 0 if the server tab is not connected
+static int CollectSnapshot(uint64 serverConnectionHandlerID, SERVER_SNAPSHOT* snap)
+{
+    uint64* channelIDs;
+    anyID*  clientIDs;
+    char*   s;
+    size_t  count;
+
+    if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_NAME, &s) != ERROR_ok)
+        return 0;
+    _strcpy(snap->serverName, sizeof(snap->serverName), s);
+    ts3Functions.freeMemory(s);
+
+    if (ts3Functions.getChannelList(serverConnectionHandlerID, &channelIDs) == ERROR_ok) {
+        for (count = 0; channelIDs[count]; count++)
+            ;
+        snap->channels = (SNAPSHOT_CHANNEL*)calloc(count ? count : 1, sizeof(SNAPSHOT_CHANNEL));
+        for (size_t i = 0; snap->channels != NULL && i < count; i++) {
+            SNAPSHOT_CHANNEL* c = &snap->channels[snap->channelCount];
+            if (ts3Functions.getParentChannelOfChannel(serverConnectionHandlerID, channelIDs[i], &c->parentID) != ERROR_ok)
+                continue;
+            if (ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, channelIDs[i], CHANNEL_NAME, &s) != ERROR_ok)
+                continue;
+            c->channelID = channelIDs[i];
+            _strcpy(c->name, sizeof(c->name), s);
+            ts3Functions.freeMemory(s);
+            snap->channelCount++;
+        }
+        ts3Functions.freeMemory(channelIDs);
+    }
+
+    if (ts3Functions.getClientList(serverConnectionHandlerID, &clientIDs) == ERROR_ok) {
+        for (count = 0; clientIDs[count]; count++)
+            ;
+        snap->clients = (CLIENT_CACHE_ENTRY*)calloc(count ? count : 1, sizeof(CLIENT_CACHE_ENTRY));
+        for (size_t i = 0; snap->clients != NULL && i < count; i++) {
+            CLIENT_CACHE_ENTRY* c = &snap->clients[snap->clientCount];
+            if (!ReadClientFromClientLib(serverConnectionHandlerID, clientIDs[i], c))
+                continue;
+            for (int g = 0; g < c->serverGroupCount; g++)
+                SnapshotAddGroup(snap, serverConnectionHandlerID, GROUP_KIND_SERVER, c->serverGroups[g]);
+            SnapshotAddGroup(snap, serverConnectionHandlerID, GROUP_KIND_CHANNEL, c->channelGroupID);
+            snap->clientCount++;
+        }
+        ts3Functions.freeMemory(clientIDs);
+    }
+    return 1;
+}
+
+// Collects, stores and publishes the state of a freshly connected server tab
+static void RunSnapshot(uint64 serverConnectionHandlerID)
+{
+    SERVER_SNAPSHOT snap;
+    uint64          start = GetMonotonicTimeMs();
+    uint64          duration;
+    BOOL            applied = FALSE;
+
+    memset(&snap, 0, sizeof(snap));
+    if (CollectSnapshot(serverConnectionHandlerID, &snap)) {
+        MutexLock(&cacheLock);
+        // server tab may have been disconnected meanwhile
+        SERVER_SHARD* shard = (!snapshotCancelled && !snapshotStop) ? GetShard(serverConnectionHandlerID) : NULL;
+        if (shard != NULL) {
+            for (size_t i = 0; i < snap.channelCount; i++)
+                ChannelCacheSet(&shard->channels, serverConnectionHandlerID, snap.channels[i].channelID, snap.channels[i].parentID, snap.channels[i].name);
+            for (size_t i = 0; i < snap.groupCount; i++)
+                GroupCacheSet(&shard->groups, serverConnectionHandlerID, snap.groups[i].kind, snap.groups[i].groupID, snap.groups[i].name);
+            for (size_t i = 0; i < snap.clientCount; i++)
+                ClientCacheStore(&shard->clients, &snap.clients[i]);
+            applied = TRUE;
+        }
+        duration               = GetMonotonicTimeMs() - start;
+        lastSnapshotDurationMs = duration;
+        MutexUnlock(&cacheLock);
+
+        if (applied) {
+            char msg[TS3LOG_BUFSIZE];
+            snprintf(msg, sizeof(msg), "Uebersicht erstellt: %u Channels, %u Clients, %d Servergruppen, %d Channelgruppen in %llu ms",
+                (unsigned int)snap.channelCount, (unsigned int)snap.clientCount, snap.serverGroupCount, snap.channelGroupCount, (unsigned long long)duration);
+            ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", serverConnectionHandlerID);
+
+            if (strlen(configMqttTopicSnapshot) > 0) {
+                char   topic[PATH_BUFSIZE];
+                char   message[PATH_BUFSIZE];
+                size_t len;
+
+                MutexLock(&cacheLock);
+                ExpandTemplate(configMqttTopicSnapshot, serverConnectionHandlerID, NULL, NULL, TRUE, topic, sizeof(topic));
+                MutexUnlock(&cacheLock);
+
+                len = AppendTemplateValue(message, sizeof(message), 0, "server=", FALSE);
+                len = AppendTemplateValue(message, sizeof(message), len, snap.serverName, FALSE);
+                message[len] = '\0';
+                snprintf(message + len, sizeof(message) - len, ";channels=%u;clients=%u;servergroups=%d;channelgroups=%d;duration_ms=%llu",
+                    (unsigned int)snap.channelCount, (unsigned int)snap.clientCount, snap.serverGroupCount, snap.channelGroupCount, (unsigned long long)duration);
+                PublishMqttMessage(topic, message, serverConnectionHandlerID, 0, SINK_PRIORITY_BULK);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < snap.clientCount; i++)
+        ClientCacheReleaseEntry(&strings, &snap.clients[i]);
+    free(snap.channels);
+    free(snap.clients);
+    free(snap.groups);
+}
+
+// Caller must hold cacheLock
+static void QueueSnapshot(uint64 serverConnectionHandlerID)
+{
+    for (int i = 0; i < snapshotQueueCount; i++) {
+        if (snapshotQueue[i] == serverConnectionHandlerID)
+            return;
+    }
+    if (snapshotQueueCount == SNAPSHOT_QUEUE_LEN) {
+        printf("PLUGIN: snapshot queue full, server tab %llu is cached on demand\n", (unsigned long long)serverConnectionHandlerID);
+        return;
+    }
+    snapshotQueue[snapshotQueueCount++] = serverConnectionHandlerID;
+    CondSignal(&snapshotCond);
+}
+
+// Caller must hold cacheLock
+static void CancelSnapshot(uint64 serverConnectionHandlerID)
+{
+    for (int i = 0; i < snapshotQueueCount; i++) {
+        if (snapshotQueue[i] == serverConnectionHandlerID) {
+            memmove(&snapshotQueue[i], &snapshotQueue[i + 1], (snapshotQueueCount - i - 1) * sizeof(uint64));
+            snapshotQueueCount--;
+            break;
+        }
+    }
+    if (snapshotBusy == serverConnectionHandlerID)
+        snapshotCancelled = TRUE;
+}
+
+static void SnapshotWorker(void* arg)
+{
+    MutexLock(&cacheLock);
+    for (;;) {
+        while (!snapshotStop && snapshotQueueCount == 0)
+            CondWait(&snapshotCond, &cacheLock);
+        if (snapshotStop)
+            break;
+
+        snapshotBusy      = snapshotQueue[0];
+        snapshotCancelled = FALSE;
+        memmove(&snapshotQueue[0], &snapshotQueue[1], (snapshotQueueCount - 1) * sizeof(uint64));
+        snapshotQueueCount--;
+
+        MutexUnlock(&cacheLock);
+        RunSnapshot(snapshotBusy);
+        MutexLock(&cacheLock);
+
+        snapshotBusy = 0;
+    }
+    MutexUnlock(&cacheLock);
+    SlabThreadFlush();
+}
+
+// Drops the interned PRIORITY_CLIENTS, caller must hold cacheLock
+static void ReleasePriorityClients(void)
+{
+    for (int i = 0; i < priorityClientCount; i++)
+        StringPoolRelease(&strings, priorityClients[i]);
+    priorityClientCount = 0;
+}
+
+// Splits PRIORITY_CLIENTS at the commas and interns the trimmed entries, so a talk event only compares handles
+static void ConfigurePriorityClients(void)
+{
+    const char* p = configMqttPriorityClients;
+
+    MutexLock(&cacheLock);
+    ReleasePriorityClients();
+    while (*p != '\0') {
+        char   entry[CLIENTS_LEN];
+        size_t len;
+
+        p  += strspn(p, " \t");
+        len = strcspn(p, ",");
+        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t'))
+            len--;
+        if (len > 0 && priorityClientCount < PRIORITY_CLIENTS_MAX) {
+            memcpy(entry, p, len);
+            entry[len] = '\0';
+            priorityClients[priorityClientCount] = StringPoolIntern(&strings, entry);
+            if (priorityClients[priorityClientCount] != STRING_HANDLE_NONE)
+                priorityClientCount++;
+        } else if (len > 0) {
+            printf("PLUGIN: more than %d PRIORITY_CLIENTS, the rest is ignored\n", PRIORITY_CLIENTS_MAX);
+            break;
+        }
+        p += strcspn(p, ",");
+        if (*p == ',')
+            p++;
+    }
+    MutexUnlock(&cacheLock);
+}
+
+// TRUE if the nickname or the unique identifier of the client is listed in PRIORITY_CLIENTS. Caller must hold cacheLock.
+static BOOL IsPriorityClient(const CLIENT_CACHE_ENTRY* client)
+{
+    for (int i = 0; i < priorityClientCount; i++) {
+        if (priorityClients[i] == client->name || priorityClients[i] == client->uniqueIdentifier)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+void ts3plugin_onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int status, int isReceivedWhisper, anyID clientID)
+{
+    SERVER_SHARD*       shard;
+    CLIENT_CACHE_ENTRY* client;
+    STRING_HANDLE       speaker = STRING_HANDLE_NONE; // name, kept referenced until the event is done
+    TALK_INFO           talk;
+    uint64              now       = GetMonotonicTimeMs();
+    BOOL                found     = FALSE;
+    BOOL                sendMqtt  = atoi(status == STATUS_TALKING ? configMqttSendStart : configMqttSendStop) == 1;
+    BOOL                sendDelta = FALSE;
+    int                 priority  = SINK_PRIORITY_BULK;
+    char                topic[PATH_BUFSIZE];
+    char                message[BIG_BUFSIZE];
+    char                deltaTopic[PATH_BUFSIZE];
+    char                deltaMessage[PATH_BUFSIZE];
+
+    // all cache accesses are done under the lock, the expanded strings are used after releasing it
+    MutexLock(&cacheLock);
+    shard  = GetShard(serverConnectionHandlerID);
+    client = shard != NULL ? GetCachedClient(serverConnectionHandlerID, clientID) : NULL;
+    if (client != NULL) {
+        uint64 channelID;
+
+        speaker = StringPoolRetain(&strings, client->name);
+        found   = TRUE;
+        // the own client and PRIORITY_CLIENTS go ahead of the queued events of everybody else
+        if (shard->ownClientID == 0 && ts3Functions.getClientID(serverConnectionHandlerID, &shard->ownClientID) != ERROR_ok)
+            shard->ownClientID = 0;
+        if (clientID == shard->ownClientID || IsPriorityClient(client))
+            priority = SINK_PRIORITY_HIGH;
+        // duration and burst count in O(1), the epoch tells a reused client ID from the previous owner
+        if (status == STATUS_TALKING)
+            TalkSessionsStart(&talkSessions, serverConnectionHandlerID, clientID, shard->epoch, now, &talk);
+        else
+            TalkSessionsStop(&talkSessions, serverConnectionHandlerID, clientID, shard->epoch, now, &talk);
+
+        if (sendMqtt) {
+            const char* messageTemplate = (status != STATUS_TALKING && strlen(configMqttMessageStop) > 0) ? configMqttMessageStop : configMqttMessage;
+            ExpandTemplate(status == STATUS_TALKING ? configMqttTopicStart : configMqttTopicStop, serverConnectionHandlerID, client, &talk, TRUE, topic, sizeof(topic));
+            if (strcmp(configMqttPayload, "json") == 0)
+                FormatJsonMessage(serverConnectionHandlerID, client, &talk, status == STATUS_TALKING, message, sizeof(message));
+            else
+                ExpandTemplate(messageTemplate, serverConnectionHandlerID, client, &talk, FALSE, message, sizeof(message));
+        }
+
+        if (status == STATUS_TALKING) {
+            if (ActiveSpeakersAdd(&shard->speakers, clientID, client->channelID)) {
+                sendDelta = FormatSpeakerDelta(shard, "add", client->channelID, clientID, deltaTopic, sizeof(deltaTopic), deltaMessage, sizeof(deltaMessage));
+                UpdateStateSpeaker(shard, clientID, status, now);
+            }
+        } else if (ActiveSpeakersRemove(&shard->speakers, clientID, &channelID)) {
+            sendDelta = FormatSpeakerDelta(shard, "remove", channelID, clientID, deltaTopic, sizeof(deltaTopic), deltaMessage, sizeof(deltaMessage));
+            UpdateStateSpeaker(shard, clientID, status, now);
+        }
+    }
+    MutexUnlock(&cacheLock);
+
+    // deltas and snapshots of a tab share one lane at one priority, a prioritized speaker must not reorder their seq
+    if (sendDelta)
+        PublishMqttMessage(deltaTopic, deltaMessage, serverConnectionHandlerID, 0, SINK_PRIORITY_BULK);
+
+    char msg[BIG_BUFSIZE];
+    msg[0] = '\0'; // only written when a timestamp was available
+    char colorStart[PATH_BUFSIZE] = "";
+    char colorStop[PATH_BUFSIZE]  = "";
+    char prefix[PATH_BUFSIZE]     = "";
+    if (found) {
+        const char* name = StringPoolGet(&strings, speaker);
+        char        nameBBCode[CLIENT_NAME_LEN * 2];
+
+        // a nickname like "[b]x" must not open tags in the channel tab
+        EscapeBBCode(name, nameBBCode, sizeof(nameBBCode));
+
+        if (status == STATUS_TALKING) {
+            printf("PLUGIN: --> %s is currently SENDING\n", name);
+
+            if (atoi(configLhShowStart) == 1) {
+                if (strlen(configLhColorStart) > 0) {
+                    snprintf(colorStart, PATH_BUFSIZE, "[color=%s]", configLhColorStart);
+                    snprintf(colorStop, PATH_BUFSIZE, "[/color]");
                 } else {
                     snprintf(colorStart, PATH_BUFSIZE, "[color=#5472CA]");
                     snprintf(colorStop, PATH_BUFSIZE, "[/color]");
                 }
 
-                if (strlen(configLhPrefixStop) > 0)
-                    snprintf(prefix, PATH_BUFSIZE, "%s -> ", configLhPrefixStop);
+                if (strlen(configLhPrefixStart) > 0)
+                    snprintf(prefix, PATH_BUFSIZE, "%s -> ", configLhPrefixStart);
                 else
                     prefix[0] = '\0';
 
                 char* timeStr = GetCurrDate("%H:%M:%S");
                 if (timeStr != NULL) {
-                    snprintf(msg, sizeof(msg), "%s[b]<%s> *** %s%s[/b]%s", colorStart, timeStr, prefix, name, colorStop);
-                    free(timeStr);
+                    snprintf(msg, sizeof(msg), "%s[b]<%s> *** %s%s[/b]%s", colorStart, timeStr, prefix, nameBBCode, colorStop);
+                    SlabFree(timeStr);
+                    SinkPublish(&sinks, SINK_EVENT_TEXT, priority, serverConnectionHandlerID, clientID, "", msg);
                 }
-                //ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", serverConnectionHandlerID);
-                ts3Functions.printMessage(serverConnectionHandlerID, msg, PLUGIN_MESSAGE_TARGET_CHANNEL);
             }
 
-            if (atoi(configMqttSendStop) == 1) {
+            if (sendMqtt)
+                PublishMqttMessage(topic, message, serverConnectionHandlerID, clientID, priority);
 
-                char mqttPort[PATH_BUFSIZE]   = "";
-                char mqttQos[PATH_BUFSIZE]    = "";
-                char mqttCafile[PATH_BUFSIZE] = "";
-
-                if (strlen(configMqttPort) > 0)
-                    snprintf(mqttPort, sizeof(mqttPort), "-p %s", configMqttPort);
-
-                if (strlen(configMqttQos) > 0)
-                    snprintf(mqttQos, sizeof(mqttQos), "-q %s", configMqttQos);
+        } else {
+            printf("PLUGIN: --> %s has STOPPED sending\n", name);
 
-                if (strlen(configMqttCafile) > 0)
-                    snprintf(mqttCafile, sizeof(mqttCafile), "--cafile \"%s\"", configMqttCafile);
+            if (atoi(configLhShowStop) == 1) {
+                if (strlen(configLhColorStop) > 0) {
+                    snprintf(colorStart, PATH_BUFSIZE, "[color=%s]", configLhColorStop);
+                    snprintf(colorStop, PATH_BUFSIZE, "[/color]");
+                } else {
+                    snprintf(colorStart, PATH_BUFSIZE, "[color=#5472CA]");
+                    snprintf(colorStop, PATH_BUFSIZE, "[/color]");
+                }
 
-                if (strlen(configMqttUser) > 0)
-                    snprintf(msgShell, sizeof(msgShell), "\"%s\" -h %s %s -u %s -P %s -t %s %s -m \"%s\" %s", configMqttExe, configMqttHost, mqttPort, configMqttUser, configMqttPassword, configMqttTopicStop, mqttQos, nameAnonymized, mqttCafile);
+                if (strlen(configLhPrefixStop) > 0)
+                    snprintf(prefix, PATH_BUFSIZE, "%s -> ", configLhPrefixStop);
                 else
-                    snprintf(msgShell, sizeof(msgShell), "\"%s\" -h %s %s -t %s %s -m \"%s\" %s", configMqttExe, configMqttHost, mqttPort, configMqttTopicStop, mqttQos, nameAnonymized, mqttCafile);
+                    prefix[0] = '\0';
 
-                ExecuteCommandInBackground(msgShell, nameAnonymized, serverConnectionHandlerID); //modifiedString
+                char* timeStr = GetCurrDate("%H:%M:%S");
+                if (timeStr != NULL) {
+                    snprintf(msg, sizeof(msg), "%s[b]<%s> *** %s%s[/b]%s", colorStart, timeStr, prefix, nameBBCode, colorStop);
+                    SlabFree(timeStr);
+                    SinkPublish(&sinks, SINK_EVENT_TEXT, priority, serverConnectionHandlerID, clientID, "", msg);
+                }
             }
+
+            if (sendMqtt)
+                PublishMqttMessage(topic, message, serverConnectionHandlerID, clientID, priority);
         }
+        StringPoolRelease(&strings, speaker);
     }
 }
 
@@ -1243,6 +3166,7 @@ void ts3plugin_onUserLoggingMessageEvent(const char* logMessage, int logLevel, c
 void ts3plugin_onClientBanFromServerEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, uint64 time,
                                           const char* kickMessage)
 {
+    ClientChannelChanged(serverConnectionHandlerID, clientID, 0, TRUE);
 }
 
 int ts3plugin_onClientPokeEvent(uint64 serverConnectionHandlerID, anyID fromClientID, const char* pokerName, const char* pokerUniqueIdentity, const char* message, int ffIgnored)
@@ -1278,11 +3202,27 @@ void ts3plugin_onFileListFinishedEvent(uint64 serverConnectionHandlerID, uint64
 
 void ts3plugin_onFileInfoEvent(uint64 serverConnectionHandlerID, uint64 channelID, const char* name, uint64 size, uint64 datetime) {}
 
-void ts3plugin_onServerGroupListEvent(uint64 serverConnectionHandlerID, uint64 serverGroupID, const char* name, int type, int iconID, int saveDB) {}
+void ts3plugin_onServerGroupListEvent(uint64 serverConnectionHandlerID, uint64 serverGroupID, const char* name, int type, int iconID, int saveDB)
+{
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+    if (shard != NULL)
+        GroupCacheSet(&shard->groups, serverConnectionHandlerID, GROUP_KIND_SERVER, serverGroupID, name);
+    MutexUnlock(&cacheLock);
+}
 
 void ts3plugin_onServerGroupListFinishedEvent(uint64 serverConnectionHandlerID) {}
 
-void ts3plugin_onServerGroupByClientIDEvent(uint64 serverConnectionHandlerID, const char* name, uint64 serverGroupList, uint64 clientDatabaseID) {}
+void ts3plugin_onServerGroupByClientIDEvent(uint64 serverConnectionHandlerID, const char* name, uint64 serverGroupList, uint64 clientDatabaseID)
+{
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+    if (shard != NULL) {
+        GroupCacheSet(&shard->groups, serverConnectionHandlerID, GROUP_KIND_SERVER, serverGroupList, name);
+        ClientCacheAddServerGroupByDatabaseID(&shard->clients, serverConnectionHandlerID, clientDatabaseID, serverGroupList);
+    }
+    MutexUnlock(&cacheLock);
+}
 
 void ts3plugin_onServerGroupPermListEvent(uint64 serverConnectionHandlerID, uint64 serverGroupID, unsigned int permissionID, int permissionValue, int permissionNegated, int permissionSkip) {}
 
@@ -1290,7 +3230,14 @@ void ts3plugin_onServerGroupPermListFinishedEvent(uint64 serverConnectionHandler
 
 void ts3plugin_onServerGroupClientListEvent(uint64 serverConnectionHandlerID, uint64 serverGroupID, uint64 clientDatabaseID, const char* clientNameIdentifier, const char* clientUniqueID) {}
 
-void ts3plugin_onChannelGroupListEvent(uint64 serverConnectionHandlerID, uint64 channelGroupID, const char* name, int type, int iconID, int saveDB) {}
+void ts3plugin_onChannelGroupListEvent(uint64 serverConnectionHandlerID, uint64 channelGroupID, const char* name, int type, int iconID, int saveDB)
+{
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = GetShard(serverConnectionHandlerID);
+    if (shard != NULL)
+        GroupCacheSet(&shard->groups, serverConnectionHandlerID, GROUP_KIND_CHANNEL, channelGroupID, name);
+    MutexUnlock(&cacheLock);
+}
 
 void ts3plugin_onChannelGroupListFinishedEvent(uint64 serverConnectionHandlerID) {}
 
@@ -1310,10 +3257,20 @@ void ts3plugin_onChannelClientPermListEvent(uint64 serverConnectionHandlerID, ui
 
 void ts3plugin_onChannelClientPermListFinishedEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 clientDatabaseID) {}
 
-void ts3plugin_onClientChannelGroupChangedEvent(uint64 serverConnectionHandlerID, uint64 channelGroupID, uint64 channelID, anyID clientID, anyID invokerClientID, const char* invokerName, const char* invokerUniqueIdentity) {}
+void ts3plugin_onClientChannelGroupChangedEvent(uint64 serverConnectionHandlerID, uint64 channelGroupID, uint64 channelID, anyID clientID, anyID invokerClientID, const char* invokerName, const char* invokerUniqueIdentity)
+{
+    MutexLock(&cacheLock);
+    SERVER_SHARD*       shard  = ServerShardFind(&shards, serverConnectionHandlerID);
+    CLIENT_CACHE_ENTRY* client = shard != NULL ? ClientCacheFind(&shard->clients, serverConnectionHandlerID, clientID) : NULL;
+    if (client != NULL)
+        client->channelGroupID = channelGroupID;
+    MutexUnlock(&cacheLock);
+}
 
 int ts3plugin_onServerPermissionErrorEvent(uint64 serverConnectionHandlerID, const char* errorMessage, unsigned int error, const char* returnCode, unsigned int failedPermissionID)
 {
+    if (returnCode && ReturnCodeDispatch(&returnCodes, serverConnectionHandlerID, returnCode, error, errorMessage, ""))
+        return 1;
     return 0; /* See onServerErrorEvent for return code description */
 }
 
@@ -1333,11 +3290,23 @@ void ts3plugin_onPermissionOverviewFinishedEvent(uint64 serverConnectionHandlerI
 void ts3plugin_onServerGroupClientAddedEvent(uint64 serverConnectionHandlerID, anyID clientID, const char* clientName, const char* clientUniqueIdentity, uint64 serverGroupID, anyID invokerClientID, const char* invokerName,
                                              const char* invokerUniqueIdentity)
 {
+    MutexLock(&cacheLock);
+    SERVER_SHARD*       shard  = ServerShardFind(&shards, serverConnectionHandlerID);
+    CLIENT_CACHE_ENTRY* client = shard != NULL ? ClientCacheFind(&shard->clients, serverConnectionHandlerID, clientID) : NULL;
+    if (client != NULL)
+        ClientCacheAddServerGroup(client, serverGroupID);
+    MutexUnlock(&cacheLock);
 }
 
 void ts3plugin_onServerGroupClientDeletedEvent(uint64 serverConnectionHandlerID, anyID clientID, const char* clientName, const char* clientUniqueIdentity, uint64 serverGroupID, anyID invokerClientID, const char* invokerName,
                                                const char* invokerUniqueIdentity)
 {
+    MutexLock(&cacheLock);
+    SERVER_SHARD*       shard  = ServerShardFind(&shards, serverConnectionHandlerID);
+    CLIENT_CACHE_ENTRY* client = shard != NULL ? ClientCacheFind(&shard->clients, serverConnectionHandlerID, clientID) : NULL;
+    if (client != NULL)
+        ClientCacheRemoveServerGroup(client, serverGroupID);
+    MutexUnlock(&cacheLock);
 }
 
 void ts3plugin_onClientNeededPermissionsEvent(uint64 serverConnectionHandlerID, unsigned int permissionID, int permissionValue) {}
@@ -1432,7 +3401,7 @@ void ts3plugin_onMenuItemEvent(uint64 serverConnectionHandlerID, enum PluginMenu
                     #else
                         snprintf(command, sizeof(command), "xdg-open \"%slh2mqtt.ini\"", pluginPath);
                     #endif
-                    ExecuteCommandInBackground(command, "", serverConnectionHandlerID);
+                    ExecuteCommandInBackground(command, "", "", serverConnectionHandlerID);
 
                     #ifndef _WIN32
                         if (strcmp(configGeneralLanguage, "DE") == 0)
@@ -1481,7 +3450,7 @@ void ts3plugin_onMenuItemEvent(uint64 serverConnectionHandlerID, enum PluginMenu
                             ts3Functions.printMessageToCurrentTab(content);
                         #endif
 
-                        free(currentYear); // release memory
+                        SlabFree(currentYear); // release memory
                     }
                     break;
                 default:
@@ -1553,10 +3522,17 @@ const char* ts3plugin_keyPrefix()
 }
 
 /* Called when client custom nickname changed */
-void ts3plugin_onClientDisplayNameChanged(uint64 serverConnectionHandlerID, anyID clientID, const char* displayName, const char* uniqueClientIdentifier) {}
+void ts3plugin_onClientDisplayNameChanged(uint64 serverConnectionHandlerID, anyID clientID, const char* displayName, const char* uniqueClientIdentifier)
+{
+    MutexLock(&cacheLock);
+    SERVER_SHARD* shard = ServerShardFind(&shards, serverConnectionHandlerID);
+    if (shard != NULL)
+        ClientCacheInvalidate(&shard->clients, serverConnectionHandlerID, clientID);
+    MutexUnlock(&cacheLock);
+}
 
-// Execute the command in a shell/terminal in background
-void ExecuteCommandInBackground(const char* command, const char* name, uint64 serverConnectionHandlerID)
+// Execute the command in a shell/terminal in background. Returns FALSE if it was killed at the shutdown deadline.
+BOOL ExecuteCommandInBackground(const char* command, const char* topic, const char* name, uint64 serverConnectionHandlerID)
 {
 #ifdef _WIN32
     STARTUPINFO         si;
@@ -1570,15 +3546,27 @@ void ExecuteCommandInBackground(const char* command, const char* name, uint64 se
 
     // execute command in background
     if (CreateProcess(NULL, wideStr, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        WaitForSingleObject(pi.hProcess, INFINITE);
+        while (WaitForSingleObject(pi.hProcess, 50) == WAIT_TIMEOUT) {
+            if (commandDeadlineMs != 0 && GetMonotonicTimeMs() >= commandDeadlineMs) {
+                TerminateProcess(pi.hProcess, 1);
+                WaitForSingleObject(pi.hProcess, INFINITE);
+                CloseHandle(pi.hProcess);
+                CloseHandle(pi.hThread);
+                FreeWideString(wideStr);
+                printf("PLUGIN EXEC: command aborted at shutdown deadline\n");
+                return FALSE;
+            }
+        }
         CloseHandle(pi.hProcess);
         CloseHandle(pi.hThread);
+        if (strlen(name) > 0)
+            NotePublished();
         //ts3Functions.logMessage(command, LogLevel_INFO, "Plugin lh2mqtt", serverConnectionHandlerID);
         char msg[CHANNELINFO_BUFSIZE];
         if (strlen(name) > 0) {
             if (atoi(configLogMqttMsg) == 1)
             {
-                snprintf(msg, sizeof(msg), "[MQTT] Topic=%s, Msg=%s", configMqttTopicStart, name);
+                snprintf(msg, sizeof(msg), "[MQTT] Topic=%s, Msg=%s", topic, name);
                 ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", serverConnectionHandlerID);
                 printf("PLUGIN: LOG MQTT MSG: %s\n",msg);
             }
@@ -1597,16 +3585,44 @@ void ExecuteCommandInBackground(const char* command, const char* name, uint64 se
     FreeWideString(wideStr);
 #else
     //printf("PLUGIN EXEC: %s\n", command);    // do NOT output, otherwise MQTT password might be leaked
-    int ret = system(command);
+    int    ret     = -1;
+    int    sleepMs = 1;
+    pid_t  pid     = fork();
+
+    if (pid == 0) {
+        // own process group, so a kill at the deadline also hits the programs the shell started
+        setpgid(0, 0);
+        execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        _exit(127);
+    }
+    if (pid > 0) {
+        setpgid(pid, pid); // the child may not have run yet
+        for (;;) {
+            pid_t done = waitpid(pid, &ret, WNOHANG);
+            if (done == pid || (done < 0 && errno != EINTR))
+                break;
+            if (commandDeadlineMs != 0 && GetMonotonicTimeMs() >= commandDeadlineMs) {
+                kill(-pid, SIGKILL);
+                while (waitpid(pid, &ret, 0) < 0 && errno == EINTR)
+                    ;
+                printf("PLUGIN EXEC: command aborted at shutdown deadline\n");
+                return FALSE;
+            }
+            usleep(sleepMs * 1000);
+            sleepMs = sleepMs < 20 ? sleepMs * 2 : 20;
+        }
+    }
     if (ret != 0) {
         printf("PLUGIN EXEC: ERROR: shell command execution failed, code: %d\n",ret);
+    } else if (strlen(name) > 0) {
+        NotePublished();
     }
     
     char msg[CHANNELINFO_BUFSIZE];
     if (strlen(name) > 0) {
         if (atoi(configLogMqttMsg) == 1)
         {
-            snprintf(msg, sizeof(msg), "[MQTT] Topic=%s, Msg=%s", configMqttTopicStart, name);
+            snprintf(msg, sizeof(msg), "[MQTT] Topic=%s, Msg=%s", topic, name);
             ts3Functions.logMessage(msg, LogLevel_INFO, "Plugin lh2mqtt", serverConnectionHandlerID);
             printf("PLUGIN: LOG MQTT MSG: %s\n",msg);
         }
@@ -1616,6 +3632,7 @@ void ExecuteCommandInBackground(const char* command, const char* name, uint64 se
         }
     }
 #endif
+    return TRUE;
 }
 
 // Reads a value out of an INI file, bHideLog suppresses output to TS3 console
@@ -1710,12 +3727,37 @@ void CreateDefaultIniFile(const char* fileName)
                 fprintf(datei, ";   siehe: whereis mosquitto_pub\n");
             #endif
             fprintf(datei, "; HOST kann eine IP-Adresse oder ein Hostname (FQDN) sein\n");
+            fprintf(datei, "; mehrere Broker durch Komma getrennt: mit DAEMON wird der schnellste erreichbare genutzt, sonst immer der erste\n");
             fprintf(datei, ";   also 127.0.0.1 oder meine-broker-fqdn\n");
+            fprintf(datei, ";   oder unix:/pfad/zum/socket fuer einen lokalen Broker (ohne TCP, PORT und CAFILE werden ignoriert)\n");
             fprintf(datei, "; PORT des Brokers (anzugeben, falls abweichend von 1883)\n");
             fprintf(datei, "; USER/PASSWORD/QOS sind optional\n");
             fprintf(datei, "; CAFILE: kompletter Pfad und Dateiname des Server-CA-Bundles (SSL)\n");
             fprintf(datei, "; SEND_START/SEND_STOP: 1 gibt an, dass die Info via MQTT gesendet wird\n");
             fprintf(datei, "; TOPIC_START/TOPIC_STOP: Topic auf dem die Info veroeffentlicht wird\n");
+            fprintf(datei, ";   {channel} im Topic wird durch den kompletten Channel-Pfad des Sprechers ersetzt\n");
+            fprintf(datei, ";   {server} im Topic wird durch die UID des Servers ersetzt (bei mehreren Server-Tabs)\n");
+            fprintf(datei, "; TOPIC_SNAPSHOT: Topic fuer die Uebersicht nach dem Verbinden (leer = aus)\n");
+            fprintf(datei, "; MESSAGE: Inhalt der MQTT-Message, Platzhalter:\n");
+            fprintf(datei, ";   {name} Name des Sprechers, {channel} Channel-Pfad,\n");
+            fprintf(datei, ";   {servergroups} Servergruppen (kommagetrennt), {channelgroup} Channelgruppe\n");
+            fprintf(datei, "; MESSAGE_STOP: Inhalt der MQTT-Message bei Sprech-Ende (leer = wie MESSAGE), zusaetzlich:\n");
+            fprintf(datei, ";   {duration} Sprechdauer in ms, {bursts} Anzahl der Wortmeldungen seit Betreten des Servers\n");
+            fprintf(datei, "; PAYLOAD: text = MESSAGE/MESSAGE_STOP verwenden, json = JSON-Objekt mit allen Angaben zum Sprecher\n");
+            fprintf(datei, "; TOPIC_SPEAKERS: Topic fuer die aktuell sprechenden Clients (leer = aus)\n");
+            fprintf(datei, ";   Aenderungen gehen an <Topic>/delta, die komplette Liste an <Topic>/snapshot\n");
+            fprintf(datei, "; SPEAKERS_INTERVAL: Sekunden zwischen zwei kompletten Listen (0 = nur Aenderungen)\n");
+            fprintf(datei, "; DAEMON: Pfad zu lh2mqttd (nur Linux), sendet ausserhalb des TeamSpeak-Clients (leer = aus)\n");
+            fprintf(datei, "; SHUTDOWN_TIMEOUT: Sekunden, die beim Beenden noch gesendet wird, der Rest wird beim naechsten Start nachgeholt\n");
+            fprintf(datei, "; RATE_LIMIT: hoechstens so viele MQTT-Messages pro Minute und Topic (leer oder 0 = unbegrenzt)\n");
+            fprintf(datei, ";   weitere Messages werden unterdrueckt und alle 10 Sekunden als Zusammenfassung\n");
+            fprintf(datei, ";   (Anzahl und letzte Message) auf <Topic>/suppressed gesendet\n");
+            fprintf(datei, "; RATE_BURST: so viele Messages duerfen kurz hintereinander gesendet werden (Standard 10)\n");
+            fprintf(datei, "; RATE_PER_SPEAKER: 1 = das Limit gilt je Topic und Sprecher\n");
+            fprintf(datei, "; PRIORITY_CLIENTS: Nicknames oder eindeutige IDs, durch Komma getrennt, deren Messages wie die\n");
+            fprintf(datei, ";   eigenen vor allen anderen gesendet werden (z.B. fuer eine On-Air-Lampe)\n");
+            fprintf(datei, "; STATE_FILE: Datei, in der der aktuelle Sprecher jedes Servers steht, fuer lokale Programme wie ein Overlay\n");
+            fprintf(datei, ";   ohne Broker (leer = aus), Beispiel zum Lesen: lh2mqtt-state\n");
             fprintf(datei, ";\n");
             fprintf(datei, ";-------------------------------------------------------------------------------\n");
             fprintf(datei, "; CHANNELTAB:\n");
@@ -1731,6 +3773,18 @@ void CreateDefaultIniFile(const char* fileName)
             fprintf(datei, "; LOGGING:\n");
             fprintf(datei, ";-------------------------------------------------------------------------------\n");
             fprintf(datei, "; LOG_MQTT_MSG: 1 gibt an, dass die gesendete MQTT-Message mitgeloggt wird\n");
+            fprintf(datei, "; LOG_FILE: Datei, an die jede MQTT-Message als Zeile angehaengt wird (leer = aus)\n");
+            fprintf(datei, ";\n");
+            fprintf(datei, ";-------------------------------------------------------------------------------\n");
+            fprintf(datei, "; BROKER1 bis BROKER4 (optional):\n");
+            fprintf(datei, ";-------------------------------------------------------------------------------\n");
+            fprintf(datei, "; Weitere Broker, die jede MQTT-Message zusaetzlich zu [MQTT] erhalten.\n");
+            fprintf(datei, "; Jeder Broker hat eine eigene Warteschlange, ein langsamer Broker bremst die anderen nicht.\n");
+            fprintf(datei, "; NAME: Bezeichnung in Log und Statistik\n");
+            fprintf(datei, "; HOST/PORT/USER/PASSWORD/QOS/CAFILE: wie in [MQTT] (leerer HOST = aus)\n");
+            fprintf(datei, ";   ohne CAFILE haelt das Plugin (Linux) eine eigene Verbindung zum Broker offen,\n");
+            fprintf(datei, ";   mit CAFILE (TLS) wird wie bisher mosquitto_pub je Message aufgerufen\n");
+            fprintf(datei, "; TOPIC_PREFIX: wird jedem Topic fuer diesen Broker vorangestellt (z.B. analytics/)\n");
             fprintf(datei, ";\n");
             fprintf(datei, ";-------------------------------------------------------------------------------\n");
             fprintf(datei, "; Diese Config wird automatisch beim Programmstart von TeamSpeak 3\n");
@@ -1763,9 +3817,24 @@ void CreateDefaultIniFile(const char* fileName)
                 fprintf(datei, "%s", topicStart);
                 snprintf(topicStop, sizeof(topicStop), "TOPIC_STOP=lh2mqtt/%s/stop\n", random_hex);
                 fprintf(datei, "%s", topicStop);
-                free(random_hex);
             }
+            if (random_hex != NULL)
+                fprintf(datei, "TOPIC_SNAPSHOT=lh2mqtt/%s/snapshot\n", random_hex);
+            fprintf(datei, "MESSAGE={name}\n");
+            fprintf(datei, "MESSAGE_STOP={name};duration_ms={duration};bursts={bursts}\n");
+            fprintf(datei, "PAYLOAD=text\n");
+            if (random_hex != NULL)
+                fprintf(datei, "TOPIC_SPEAKERS=lh2mqtt/%s/speakers\n", random_hex);
+            fprintf(datei, "SPEAKERS_INTERVAL=%d\n", SPEAKERS_INTERVAL_DEFAULT);
+            fprintf(datei, "DAEMON=\n");
+            fprintf(datei, "SHUTDOWN_TIMEOUT=%d\n", SHUTDOWN_TIMEOUT_DEFAULT);
+            fprintf(datei, "RATE_LIMIT=0\n");
+            fprintf(datei, "RATE_BURST=%d\n", RATE_BURST_DEFAULT);
+            fprintf(datei, "RATE_PER_SPEAKER=0\n");
+            fprintf(datei, "PRIORITY_CLIENTS=\n");
+            fprintf(datei, "STATE_FILE=\n");
             fprintf(datei, "\n");
+            SlabFree(random_hex);
 
             fprintf(datei, "[CHANNELTAB]\n");
             fprintf(datei, "SHOW_START=1\n");
@@ -1778,6 +3847,7 @@ void CreateDefaultIniFile(const char* fileName)
 
             fprintf(datei, "[LOGGING]\n");
             fprintf(datei, "LOG_MQTT_MSG=1\n");
+            fprintf(datei, "LOG_FILE=\n");
             fprintf(datei, "\n");
 
             fprintf(datei, "[GENERAL]\n");
@@ -1797,7 +3867,7 @@ void CreateDefaultIniFile(const char* fileName)
 }
 
 // Get's the current date/time according to format parameter
-// Caller needs to free returning string's memory
+// Caller needs to release returning string's memory with SlabFree
 char* GetCurrDate(const char* format)
 {
     time_t    currentTime;
@@ -1814,11 +3884,11 @@ char* GetCurrDate(const char* format)
     }
 
     // get date/time according to format parameter in a char*
-    dateStr = (char*)malloc(64); // plenty of buffer size
+    dateStr = (char*)SlabAlloc(64); // plenty of buffer size, one object of the smallest slab class
     if (dateStr != NULL) {
         if (strftime(dateStr, 64, format, &timeInfo) == 0) {
             // error in strftime
-            free(dateStr);
+            SlabFree(dateStr);
             return NULL;
         }
     }
@@ -1827,14 +3897,14 @@ char* GetCurrDate(const char* format)
 }
 
 // Get a rondom hex number with given length
-// Caller needs to free returning string's memory
+// Caller needs to release returning string's memory with SlabFree
 char* GetRandomHex(int length) {
     if (length <= 0) {
         return NULL;
     }
 
     char hex_chars[] = "0123456789ABCDEF";
-    char* hex_string = (char*)malloc((length + 1) * sizeof(char));
+    char* hex_string = (char*)SlabAlloc((length + 1) * sizeof(char));
 
     if (hex_string == NULL) {
         return NULL; // Error
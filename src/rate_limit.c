@@ -0,0 +1,138 @@
+#include "rate_limit.h"
+#include "slab.h"
+
+#include <string.h>
+
+// FNV-1a of the topic, the speaker is mixed in for per speaker buckets. Never 0, that marks a free slot.
+static uint64 RateLimitKey(const char* topic, uint64 serverConnectionHandlerID, anyID clientID, int perSpeaker)
+{
+    uint64 hash = 14695981039346656037ULL;
+
+    for (const unsigned char* p = (const unsigned char*)topic; *p != '\0'; p++)
+        hash = (hash ^ *p) * 1099511628211ULL;
+    if (perSpeaker) {
+        hash = (hash ^ serverConnectionHandlerID) * 1099511628211ULL;
+        hash = (hash ^ clientID) * 1099511628211ULL;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// Returns the bucket of key, a free slot is claimed for a new key. NULL if all probed slots belong to other keys.
+static RATE_LIMIT_SLOT* RateLimitFind(RATE_LIMITER* limiter, uint64 key)
+{
+    unsigned int first = (unsigned int)(key & (RATE_LIMIT_SLOTS - 1));
+
+    for (unsigned int i = 0; i < RATE_LIMIT_PROBES; i++) {
+        RATE_LIMIT_SLOT* slot = &limiter->slots[(first + i) & (RATE_LIMIT_SLOTS - 1)];
+
+        if (AtomicLoad64(&slot->key) == key)
+            return slot;
+    }
+    // slots are freed by RateLimitCollect, so the chain may have gaps and the key may be anywhere in it
+    for (unsigned int i = 0; i < RATE_LIMIT_PROBES; i++) {
+        RATE_LIMIT_SLOT* slot = &limiter->slots[(first + i) & (RATE_LIMIT_SLOTS - 1)];
+
+        // another thread may have claimed it for the same key
+        if (AtomicCompareExchange64(&slot->key, 0, key) || AtomicLoad64(&slot->key) == key)
+            return slot;
+    }
+    return NULL;
+}
+
+void RateLimitInit(RATE_LIMITER* limiter)
+{
+    memset(limiter, 0, sizeof(*limiter));
+}
+
+void RateLimitFree(RATE_LIMITER* limiter)
+{
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++)
+        SlabFree(AtomicExchangePointer((void* volatile*)&limiter->slots[i].latest, NULL));
+}
+
+// perMinute 0 turns the limit off, burst is the number of messages which may follow each other without delay
+void RateLimitConfigure(RATE_LIMITER* limiter, unsigned int perMinute, unsigned int burst, int perSpeaker)
+{
+    uint64 intervalUs = perMinute > 0 ? 60000000ULL / perMinute : 0;
+
+    if (burst == 0)
+        burst = 1;
+    AtomicExchange64(&limiter->perSpeaker, perSpeaker ? 1 : 0);
+    AtomicExchange64(&limiter->toleranceUs, intervalUs * (burst - 1));
+    AtomicExchange64(&limiter->intervalUs, intervalUs);
+}
+
+// Returns 1 if the message may be published. Otherwise it is counted and kept as the latest one of its bucket.
+int RateLimitAllow(RATE_LIMITER* limiter, uint64 serverConnectionHandlerID, anyID clientID, const char* topic, const char* message)
+{
+    uint64            intervalUs = AtomicLoad64(&limiter->intervalUs);
+    uint64            limitUs    = AtomicLoad64(&limiter->toleranceUs) + intervalUs;
+    uint64            nowUs      = GetMonotonicTimeMs() * 1000;
+    RATE_LIMIT_SLOT*  slot;
+    RATE_LIMIT_EVENT* event;
+    size_t            topicSize;
+    size_t            messageSize;
+
+    if (intervalUs == 0)
+        return 1;
+    slot = RateLimitFind(limiter, RateLimitKey(topic, serverConnectionHandlerID, clientID, (int)AtomicLoad64(&limiter->perSpeaker)));
+    if (slot == NULL) {
+        AtomicAdd64(&limiter->untracked, 1);
+        return 1;
+    }
+    for (;;) {
+        uint64 tatUs    = AtomicLoad64(&slot->tatUs);
+        uint64 newTatUs = (tatUs > nowUs ? tatUs : nowUs) + intervalUs;
+
+        if (newTatUs - nowUs > limitUs)
+            break; // bucket is empty
+        if (AtomicCompareExchange64(&slot->tatUs, tatUs, newTatUs))
+            return 1;
+    }
+
+    topicSize   = strlen(topic) + 1;
+    messageSize = strlen(message) + 1;
+    event       = (RATE_LIMIT_EVENT*)SlabAlloc(sizeof(RATE_LIMIT_EVENT) + topicSize + messageSize);
+    if (event != NULL) {
+        event->serverConnectionHandlerID = serverConnectionHandlerID;
+        event->clientID                  = clientID;
+        event->topic                     = (char*)(event + 1);
+        event->message                   = event->topic + topicSize;
+        memcpy(event->topic, topic, topicSize);
+        memcpy(event->message, message, messageSize);
+        SlabFree(AtomicExchangePointer((void* volatile*)&slot->latest, event));
+    }
+    AtomicAdd64(&slot->suppressed, 1);
+    AtomicAdd64(&limiter->suppressedTotal, 1);
+    return 0;
+}
+
+// Hands the latest suppressed message and the number of suppressed ones of every bucket to summary and frees the
+// buckets which are full again. Returns the number of summaries.
+int RateLimitCollect(RATE_LIMITER* limiter, RATE_LIMIT_SUMMARY_FUNC summary, void* arg)
+{
+    uint64 nowUs = GetMonotonicTimeMs() * 1000;
+    int    count = 0;
+
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++) {
+        RATE_LIMIT_SLOT*  slot = &limiter->slots[i];
+        uint64            key  = AtomicLoad64(&slot->key);
+        RATE_LIMIT_EVENT* latest;
+        uint64            suppressed;
+
+        if (key == 0)
+            continue;
+        latest = (RATE_LIMIT_EVENT*)AtomicExchangePointer((void* volatile*)&slot->latest, NULL);
+        if (latest != NULL) {
+            // a message suppressed right now may not be counted yet, it shows up in the next summary
+            suppressed = AtomicExchange64(&slot->suppressed, 0);
+            summary(latest, suppressed > 0 ? suppressed : 1, arg);
+            SlabFree(latest);
+            count++;
+        } else if (AtomicLoad64(&slot->tatUs) <= nowUs && AtomicLoad64(&slot->suppressed) == 0) {
+            // idle and refilled, a new message of this key starts with a full bucket anyway
+            AtomicCompareExchange64(&slot->key, key, 0);
+        }
+    }
+    return count;
+}
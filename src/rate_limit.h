@@ -0,0 +1,52 @@
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RATE_LIMIT_SLOTS  1024 // buckets of topics (and speakers), a power of two
+#define RATE_LIMIT_PROBES 8    // slots searched for a bucket, a key without a free one is not limited
+
+// Latest suppressed message of a bucket, one allocation like SINK_EVENT
+typedef struct {
+    uint64 serverConnectionHandlerID;
+    anyID  clientID;
+    char*  topic;
+    char*  message;
+} RATE_LIMIT_EVENT;
+
+typedef struct {
+    volatile uint64            key;        // hash of topic (and speaker), 0 = free
+    volatile uint64            tatUs;      // theoretical arrival time of the next message (GCRA)
+    volatile uint64            suppressed; // since the last summary
+    RATE_LIMIT_EVENT* volatile latest;     // NULL = nothing suppressed since the last summary
+} RATE_LIMIT_SLOT;
+
+// Token bucket per topic, optionally per topic and speaker, as GCRA: a bucket is a single timestamp which is advanced
+// by compare and swap, so a check takes no lock and a constant number of steps. Messages over the limit are counted,
+// the latest one is kept for a summary which RateLimitCollect hands out periodically.
+typedef struct {
+    volatile uint64 intervalUs;  // time one message takes from the bucket, 0 = no limit
+    volatile uint64 toleranceUs; // burst - 1 messages
+    volatile uint64 perSpeaker;
+    volatile uint64 suppressedTotal;
+    volatile uint64 untracked; // messages of keys which found no free slot
+    RATE_LIMIT_SLOT slots[RATE_LIMIT_SLOTS];
+} RATE_LIMITER;
+
+typedef void (*RATE_LIMIT_SUMMARY_FUNC)(const RATE_LIMIT_EVENT* latest, uint64 suppressed, void* arg);
+
+void RateLimitInit(RATE_LIMITER* limiter);
+void RateLimitFree(RATE_LIMITER* limiter);
+void RateLimitConfigure(RATE_LIMITER* limiter, unsigned int perMinute, unsigned int burst, int perSpeaker);
+int  RateLimitAllow(RATE_LIMITER* limiter, uint64 serverConnectionHandlerID, anyID clientID, const char* topic, const char* message);
+int  RateLimitCollect(RATE_LIMITER* limiter, RATE_LIMIT_SUMMARY_FUNC summary, void* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RATE_LIMIT_H
@@ -0,0 +1,266 @@
+#include "resolver.h"
+
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+static int ParseAddress(const char* str, unsigned short port, RESOLVER_ADDR* out)
+{
+    struct sockaddr_in6* in6 = (struct sockaddr_in6*)&out->addr;
+    struct sockaddr_in*  in4 = (struct sockaddr_in*)&out->addr;
+
+    memset(out, 0, sizeof(*out));
+    if (inet_pton(AF_INET6, str, &in6->sin6_addr) == 1) {
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port   = htons(port);
+        out->len         = sizeof(*in6);
+    } else if (inet_pton(AF_INET, str, &in4->sin_addr) == 1) {
+        in4->sin_family = AF_INET;
+        in4->sin_port   = htons(port);
+        out->len        = sizeof(*in4);
+    } else {
+        return 0;
+    }
+    out->family = out->addr.ss_family;
+    return 1;
+}
+
+// Lines as in /etc/hosts: address, then the names, "#" starts a comment
+static int ResolveFromHostsFile(const char* path, const char* host, const char* port, RESOLVER_ADDR* addrs, int maxAddrs)
+{
+    FILE* file;
+    char  line[512];
+    int   count = 0;
+
+    if (path == NULL || path[0] == '\0' || (file = fopen(path, "r")) == NULL)
+        return 0;
+    while (count < maxAddrs && fgets(line, sizeof(line), file) != NULL) {
+        char* save;
+        char* address;
+        char* name;
+
+        line[strcspn(line, "#\r\n")] = '\0';
+        address = strtok_r(line, " \t", &save);
+        if (address == NULL)
+            continue;
+        while ((name = strtok_r(NULL, " \t", &save)) != NULL) {
+            if (strcasecmp(name, host) == 0) {
+                count += ParseAddress(address, (unsigned short)atoi(port), &addrs[count]);
+                break;
+            }
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+// Alternates the address families, starting with the family of the first answer (RFC 8305 section 4). getaddrinfo
+// already sorted the answers by RFC 6724, so an IPv6 address usually comes first.
+static void InterleaveFamilies(RESOLVER_ADDR* addrs, int count)
+{
+    RESOLVER_ADDR sorted[RESOLVER_MAX_ADDRS];
+    int           first = count > 0 ? addrs[0].family : 0;
+    int           n     = 0;
+    int           a     = 0; // next address of the first family
+    int           b     = 0; // next address of the other family
+    int           turn  = 0;
+
+    while (n < count) {
+        if (turn == 0) {
+            while (a < count && addrs[a].family != first)
+                a++;
+            if (a < count)
+                sorted[n++] = addrs[a++];
+        } else {
+            while (b < count && addrs[b].family == first)
+                b++;
+            if (b < count)
+                sorted[n++] = addrs[b++];
+        }
+        turn = !turn;
+    }
+    memcpy(addrs, sorted, sizeof(RESOLVER_ADDR) * count);
+}
+
+// Resolves right away on the calling thread, the hosts file (may be NULL) is checked first.
+// Returns the number of addresses, in connect order.
+int ResolveHost(const char* hostsFile, const char* host, const char* port, RESOLVER_ADDR* addrs, int maxAddrs)
+{
+    struct addrinfo  hints;
+    struct addrinfo* list;
+    int              count;
+
+    if (maxAddrs > RESOLVER_MAX_ADDRS)
+        maxAddrs = RESOLVER_MAX_ADDRS;
+    count = ResolveFromHostsFile(hostsFile, host, port, addrs, maxAddrs);
+    if (count == 0) {
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags    = AI_ADDRCONFIG;
+        if (getaddrinfo(host, port, &hints, &list) != 0)
+            return 0;
+        for (struct addrinfo* ai = list; ai != NULL && count < maxAddrs; ai = ai->ai_next) {
+            if (ai->ai_addrlen > sizeof(addrs[count].addr))
+                continue;
+            memset(&addrs[count], 0, sizeof(addrs[count]));
+            memcpy(&addrs[count].addr, ai->ai_addr, ai->ai_addrlen);
+            addrs[count].len    = ai->ai_addrlen;
+            addrs[count].family = ai->ai_family;
+            count++;
+        }
+        freeaddrinfo(list);
+    }
+    InterleaveFamilies(addrs, count);
+    return count;
+}
+
+static uint64 EntryTtlMs(const RESOLVER_ENTRY* entry)
+{
+    return entry->count > 0 ? RESOLVER_TTL_MS : RESOLVER_NEGATIVE_TTL_MS;
+}
+
+static void ResolverWorker(void* arg)
+{
+    RESOLVER*     resolver = (RESOLVER*)arg;
+    RESOLVER_ADDR addrs[RESOLVER_MAX_ADDRS];
+    char          host[sizeof(resolver->entries[0].host)];
+    char          port[sizeof(resolver->entries[0].port)];
+
+    MutexLock(&resolver->lock);
+    while (!resolver->stop) {
+        RESOLVER_ENTRY* entry = NULL;
+        int             count;
+
+        for (int i = 0; i < resolver->count && entry == NULL; i++) {
+            if (resolver->entries[i].pending)
+                entry = &resolver->entries[i];
+        }
+        if (entry == NULL) {
+            CondWait(&resolver->cond, &resolver->lock);
+            continue;
+        }
+        memcpy(host, entry->host, sizeof(host));
+        memcpy(port, entry->port, sizeof(port));
+        MutexUnlock(&resolver->lock);
+
+        count = ResolveHost(resolver->hostsFile, host, port, addrs, RESOLVER_MAX_ADDRS);
+
+        // pending entries are never evicted, so entry still belongs to host
+        MutexLock(&resolver->lock);
+        entry->pending    = 0;
+        entry->resolvedMs = GetMonotonicTimeMs();
+        if (count > 0) {
+            memcpy(entry->addrs, addrs, sizeof(RESOLVER_ADDR) * count);
+            entry->count = count;
+        } else if (entry->count > 0) {
+            // keep the last good answer while DNS fails, it is tried again after the negative TTL
+            entry->resolvedMs -= RESOLVER_TTL_MS - RESOLVER_NEGATIVE_TTL_MS;
+        }
+        CondBroadcast(&resolver->done);
+    }
+    MutexUnlock(&resolver->lock);
+}
+
+// Starts the lookup worker, hostsFile may be NULL. Returns 0 if it could not be started, lookups are then
+// resolved on the caller.
+int ResolverStart(RESOLVER* resolver, const char* hostsFile)
+{
+    memset(resolver, 0, sizeof(*resolver));
+    snprintf(resolver->hostsFile, sizeof(resolver->hostsFile), "%s", hostsFile != NULL ? hostsFile : "");
+    MutexInit(&resolver->lock);
+    CondInit(&resolver->cond);
+    CondInit(&resolver->done);
+    resolver->running = ThreadStart(&resolver->thread, ResolverWorker, resolver);
+    return resolver->running;
+}
+
+// Waits for a lookup in progress, getaddrinfo cannot be cancelled
+void ResolverStop(RESOLVER* resolver)
+{
+    if (resolver->running) {
+        MutexLock(&resolver->lock);
+        resolver->stop = 1;
+        CondSignal(&resolver->cond);
+        MutexUnlock(&resolver->lock);
+        ThreadJoin(&resolver->thread);
+        resolver->running = 0;
+    }
+    CondDestroy(&resolver->done);
+    CondDestroy(&resolver->cond);
+    MutexDestroy(&resolver->lock);
+}
+
+// Returns the entry of host and port, a new one replaces the oldest answer. NULL if the name does not fit or all
+// entries are being resolved.
+static RESOLVER_ENTRY* ResolverFind(RESOLVER* resolver, const char* host, const char* port)
+{
+    RESOLVER_ENTRY* entry = NULL;
+
+    if (strlen(host) >= sizeof(entry->host) || strlen(port) >= sizeof(entry->port))
+        return NULL;
+    for (int i = 0; i < resolver->count; i++) {
+        if (strcmp(resolver->entries[i].host, host) == 0 && strcmp(resolver->entries[i].port, port) == 0)
+            return &resolver->entries[i];
+    }
+    if (resolver->count < RESOLVER_CACHE_LEN) {
+        entry = &resolver->entries[resolver->count++];
+    } else {
+        for (int i = 0; i < resolver->count; i++) {
+            RESOLVER_ENTRY* e = &resolver->entries[i];
+            if (!e->pending && (entry == NULL || e->resolvedMs < entry->resolvedMs))
+                entry = e;
+        }
+        if (entry == NULL)
+            return NULL;
+    }
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->host, sizeof(entry->host), "%s", host);
+    snprintf(entry->port, sizeof(entry->port), "%s", port);
+    return entry;
+}
+
+// Copies the cached addresses of host and port. An expired answer is still returned and refreshed in the background.
+// Without an answer yet it waits up to timeoutMs for the worker, 0 only queues the lookup (prefetch).
+// Returns the number of addresses, 0 if the name could not be resolved, -1 if no answer came within timeoutMs.
+int ResolverLookup(RESOLVER* resolver, const char* host, const char* port, RESOLVER_ADDR* addrs, int maxAddrs, uint64 timeoutMs)
+{
+    uint64 deadlineMs = GetMonotonicTimeMs() + timeoutMs;
+    int    count      = 0;
+
+    if (!resolver->running)
+        return maxAddrs > 0 ? ResolveHost(resolver->hostsFile, host, port, addrs, maxAddrs) : 0;
+
+    MutexLock(&resolver->lock);
+    for (;;) {
+        RESOLVER_ENTRY* entry = ResolverFind(resolver, host, port);
+        uint64          now   = GetMonotonicTimeMs();
+
+        if (entry == NULL) {
+            MutexUnlock(&resolver->lock);
+            return maxAddrs > 0 ? ResolveHost(resolver->hostsFile, host, port, addrs, maxAddrs) : 0;
+        }
+        if (!entry->pending && (entry->resolvedMs == 0 || now - entry->resolvedMs >= EntryTtlMs(entry))) {
+            entry->pending = 1;
+            CondSignal(&resolver->cond);
+        }
+        // a stale answer is better than waiting, a failed one is only final until it expired
+        if (entry->resolvedMs != 0 && (entry->count > 0 || !entry->pending)) {
+            count = entry->count < maxAddrs ? entry->count : maxAddrs;
+            if (count > 0)
+                memcpy(addrs, entry->addrs, sizeof(RESOLVER_ADDR) * count);
+            break;
+        }
+        if (now >= deadlineMs) {
+            count = -1;
+            break;
+        }
+        CondWaitTimeout(&resolver->done, &resolver->lock, deadlineMs - now);
+    }
+    MutexUnlock(&resolver->lock);
+    return count;
+}
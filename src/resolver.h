@@ -0,0 +1,56 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <sys/socket.h>
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESOLVER_TTL_MS          300000 // getaddrinfo returns no TTL, answers are refreshed after this
+#define RESOLVER_NEGATIVE_TTL_MS 10000  // failed lookups are retried after this
+#define RESOLVER_MAX_ADDRS       16
+#define RESOLVER_CACHE_LEN       8
+
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t               len;
+    int                     family;
+} RESOLVER_ADDR;
+
+typedef struct {
+    char          host[128];
+    char          port[16];
+    RESOLVER_ADDR addrs[RESOLVER_MAX_ADDRS]; // in connect order, address families interleaved
+    int           count;
+    uint64        resolvedMs; // 0 = never resolved
+    int           pending;    // queued for the worker
+} RESOLVER_ENTRY;
+
+// Cache of resolved broker addresses. Lookups run on a worker thread, callers get the cached answer right away and
+// an expired answer is refreshed in the background. A hosts file (same format as /etc/hosts) is checked before DNS,
+// e.g. to point a test at a local broker.
+typedef struct {
+    PLATFORM_THREAD thread;
+    PLATFORM_MUTEX  lock;
+    PLATFORM_COND   cond; // work for the worker
+    PLATFORM_COND   done; // a lookup finished
+    int             running;
+    int             stop;
+    char            hostsFile[256];
+    RESOLVER_ENTRY  entries[RESOLVER_CACHE_LEN];
+    int             count;
+} RESOLVER;
+
+int  ResolveHost(const char* hostsFile, const char* host, const char* port, RESOLVER_ADDR* addrs, int maxAddrs);
+int  ResolverStart(RESOLVER* resolver, const char* hostsFile);
+void ResolverStop(RESOLVER* resolver);
+int  ResolverLookup(RESOLVER* resolver, const char* host, const char* port, RESOLVER_ADDR* addrs, int maxAddrs, uint64 timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RESOLVER_H
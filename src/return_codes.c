@@ -0,0 +1,158 @@
+#include "return_codes.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Removes a pending request by moving the last one into its slot, returns the removed entry. Caller holds the lock.
+static RETURN_CODE_ENTRY ReturnCodeTake(RETURN_CODE_TABLE* table, int idx)
+{
+    RETURN_CODE_ENTRY entry = table->pending[idx];
+
+    table->count--;
+    if (idx != table->count)
+        table->pending[idx] = table->pending[table->count];
+    return entry;
+}
+
+void ReturnCodeInit(RETURN_CODE_TABLE* table)
+{
+    memset(table, 0, sizeof(*table));
+    MutexInit(&table->lock);
+}
+
+// Fails what is still pending, see ReturnCodeCancelAll
+void ReturnCodeFree(RETURN_CODE_TABLE* table)
+{
+    ReturnCodeCancelAll(table);
+    MutexDestroy(&table->lock);
+}
+
+// Remembers a return code created with ts3Functions.createReturnCode together with its continuation.
+// Returns 0 if too many requests are pending, the request should then be sent without return code.
+int ReturnCodeRegister(RETURN_CODE_TABLE* table, const char* returnCode, uint64 serverConnectionHandlerID, unsigned int timeoutMs, RETURN_CODE_CALLBACK callback, void* userData)
+{
+    uint64             now = GetMonotonicTimeMs();
+    RETURN_CODE_ENTRY* e;
+
+    ReturnCodeExpire(table, now);
+
+    MutexLock(&table->lock);
+    if (table->count == RETURN_CODE_MAX_PENDING) {
+        table->rejected++;
+        MutexUnlock(&table->lock);
+        return 0;
+    }
+
+    e = &table->pending[table->count++];
+    snprintf(e->returnCode, sizeof(e->returnCode), "%s", returnCode);
+    e->serverConnectionHandlerID = serverConnectionHandlerID;
+    e->deadline                  = now + timeoutMs;
+    e->callback                  = callback;
+    e->userData                  = userData;
+    MutexUnlock(&table->lock);
+    return 1;
+}
+
+// Called from onServerErrorEvent, runs the continuation of a matching request.
+// Returns 0 if the return code is unknown, e.g. because the request already timed out.
+int ReturnCodeDispatch(RETURN_CODE_TABLE* table, uint64 serverConnectionHandlerID, const char* returnCode, unsigned int error, const char* errorMessage, const char* extraMessage)
+{
+    RETURN_CODE_ENTRY entry;
+    int               found = 0;
+
+    MutexLock(&table->lock);
+    for (int i = 0; i < table->count; i++) {
+        if (table->pending[i].serverConnectionHandlerID == serverConnectionHandlerID && strcmp(table->pending[i].returnCode, returnCode) == 0) {
+            // take the entry out first, so the continuation may register follow-up requests
+            entry = ReturnCodeTake(table, i);
+            table->completed++;
+            found = 1;
+            break;
+        }
+    }
+    MutexUnlock(&table->lock);
+    if (found && entry.callback != NULL)
+        entry.callback(serverConnectionHandlerID, error, errorMessage, extraMessage, entry.userData);
+
+    ReturnCodeExpire(table, GetMonotonicTimeMs());
+    return found;
+}
+
+// Runs the continuations of all requests whose deadline has passed with RETURN_CODE_TIMEOUT
+void ReturnCodeExpire(RETURN_CODE_TABLE* table, uint64 now)
+{
+    for (;;) {
+        RETURN_CODE_ENTRY entry;
+        int               found = 0;
+
+        MutexLock(&table->lock);
+        for (int i = 0; i < table->count; i++) {
+            if (table->pending[i].deadline <= now) {
+                entry = ReturnCodeTake(table, i);
+                table->timeouts++;
+                found = 1;
+                break;
+            }
+        }
+        MutexUnlock(&table->lock);
+        if (!found)
+            return;
+        if (entry.callback != NULL)
+            entry.callback(entry.serverConnectionHandlerID, RETURN_CODE_TIMEOUT, "timeout", "", entry.userData);
+    }
+}
+
+// Earliest deadline of the pending requests, 0 if there are none
+uint64 ReturnCodeNextDeadline(RETURN_CODE_TABLE* table)
+{
+    uint64 deadline = 0;
+
+    MutexLock(&table->lock);
+    for (int i = 0; i < table->count; i++) {
+        if (deadline == 0 || table->pending[i].deadline < deadline)
+            deadline = table->pending[i].deadline;
+    }
+    MutexUnlock(&table->lock);
+    return deadline;
+}
+
+// Fails all pending requests of a server tab, e.g. after disconnecting
+void ReturnCodeCancelServer(RETURN_CODE_TABLE* table, uint64 serverConnectionHandlerID, unsigned int error)
+{
+    for (;;) {
+        RETURN_CODE_ENTRY entry;
+        int               found = 0;
+
+        MutexLock(&table->lock);
+        for (int i = 0; i < table->count; i++) {
+            if (table->pending[i].serverConnectionHandlerID == serverConnectionHandlerID) {
+                entry = ReturnCodeTake(table, i);
+                found = 1;
+                break;
+            }
+        }
+        MutexUnlock(&table->lock);
+        if (!found)
+            return;
+        if (entry.callback != NULL)
+            entry.callback(serverConnectionHandlerID, error, "disconnected", "", entry.userData);
+    }
+}
+
+// Fails all pending requests with RETURN_CODE_CANCELLED, so no continuation is dropped without a result
+void ReturnCodeCancelAll(RETURN_CODE_TABLE* table)
+{
+    for (;;) {
+        RETURN_CODE_ENTRY entry;
+
+        MutexLock(&table->lock);
+        if (table->count == 0) {
+            MutexUnlock(&table->lock);
+            return;
+        }
+        entry = ReturnCodeTake(table, table->count - 1);
+        MutexUnlock(&table->lock);
+        if (entry.callback != NULL)
+            entry.callback(entry.serverConnectionHandlerID, RETURN_CODE_CANCELLED, "cancelled", "", entry.userData);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef RETURN_CODES_H
+#define RETURN_CODES_H
+
+#include "teamspeak/public_definitions.h"
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RETURN_CODE_LEN         128
+#define RETURN_CODE_MAX_PENDING 256
+
+// Passed as error to a continuation if the server did not answer within the timeout
+#define RETURN_CODE_TIMEOUT 0xFFFFFFFFu
+// Passed as error to a continuation if the plugin dropped the request, e.g. on reload or unload
+#define RETURN_CODE_CANCELLED 0xFFFFFFFEu
+
+// Continuation of an asynchronous request. error is ERROR_ok if the server accepted the request.
+typedef void (*RETURN_CODE_CALLBACK)(uint64 serverConnectionHandlerID, unsigned int error, const char* errorMessage, const char* extraMessage, void* userData);
+
+typedef struct {
+    char                 returnCode[RETURN_CODE_LEN];
+    uint64               serverConnectionHandlerID;
+    uint64               deadline; // monotonic time in ms
+    RETURN_CODE_CALLBACK callback;
+    void*                userData;
+} RETURN_CODE_ENTRY;
+
+// Continuations run without the lock held, so they may register follow-up requests
+typedef struct {
+    PLATFORM_MUTEX    lock; // requests come from the client threads, timeouts from the event loop
+    RETURN_CODE_ENTRY pending[RETURN_CODE_MAX_PENDING];
+    int               count;
+
+    unsigned long long completed;
+    unsigned long long timeouts;
+    unsigned long long rejected; // table full
+} RETURN_CODE_TABLE;
+
+void   ReturnCodeInit(RETURN_CODE_TABLE* table);
+void   ReturnCodeFree(RETURN_CODE_TABLE* table);
+int    ReturnCodeRegister(RETURN_CODE_TABLE* table, const char* returnCode, uint64 serverConnectionHandlerID, unsigned int timeoutMs, RETURN_CODE_CALLBACK callback, void* userData);
+int    ReturnCodeDispatch(RETURN_CODE_TABLE* table, uint64 serverConnectionHandlerID, const char* returnCode, unsigned int error, const char* errorMessage, const char* extraMessage);
+void   ReturnCodeExpire(RETURN_CODE_TABLE* table, uint64 now);
+uint64 ReturnCodeNextDeadline(RETURN_CODE_TABLE* table);
+void   ReturnCodeCancelServer(RETURN_CODE_TABLE* table, uint64 serverConnectionHandlerID, unsigned int error);
+void   ReturnCodeCancelAll(RETURN_CODE_TABLE* table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RETURN_CODES_H
@@ -0,0 +1,95 @@
+#include "server_shard.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int ServerShardIndex(SERVER_SHARD_TABLE* table, uint64 serverConnectionHandlerID)
+{
+    if (table->lastHit < table->count && table->shards[table->lastHit]->serverConnectionHandlerID == serverConnectionHandlerID)
+        return table->lastHit;
+
+    for (int i = 0; i < table->count; i++) {
+        if (table->shards[i]->serverConnectionHandlerID == serverConnectionHandlerID) {
+            table->lastHit = i;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void ServerShardFree(SERVER_SHARD* shard)
+{
+    ClientCacheFree(&shard->clients);
+    ChannelCacheFree(&shard->channels);
+    GroupCacheFree(&shard->groups);
+    free(shard);
+}
+
+void ServerShardInit(SERVER_SHARD_TABLE* table, STRING_POOL* strings)
+{
+    memset(table, 0, sizeof(*table));
+    table->strings = strings;
+}
+
+// Returns NULL if nothing is cached for the server tab
+SERVER_SHARD* ServerShardFind(SERVER_SHARD_TABLE* table, uint64 serverConnectionHandlerID)
+{
+    int idx = ServerShardIndex(table, serverConnectionHandlerID);
+
+    return idx >= 0 ? table->shards[idx] : NULL;
+}
+
+// Returns the shard of the server tab, creating an empty one on first use. NULL if out of memory or too many tabs.
+SERVER_SHARD* ServerShardGet(SERVER_SHARD_TABLE* table, uint64 serverConnectionHandlerID)
+{
+    SERVER_SHARD* shard = ServerShardFind(table, serverConnectionHandlerID);
+
+    if (shard != NULL)
+        return shard;
+    if (table->count == SERVER_SHARD_MAX) {
+        printf("PLUGIN: too many server tabs, tab %llu is not cached\n", (unsigned long long)serverConnectionHandlerID);
+        return NULL;
+    }
+
+    shard = (SERVER_SHARD*)malloc(sizeof(SERVER_SHARD));
+    if (shard == NULL)
+        return NULL;
+    shard->serverConnectionHandlerID = serverConnectionHandlerID;
+    shard->uniqueIdentifier[0]       = '\0';
+    shard->epoch                     = ++table->nextEpoch;
+    shard->groupListRequestedMs[0]   = 0;
+    shard->groupListRequestedMs[1]   = 0;
+    shard->ownClientID               = 0;
+    ClientCacheInit(&shard->clients, table->strings);
+    ChannelCacheInit(&shard->channels);
+    GroupCacheInit(&shard->groups);
+    ActiveSpeakersInit(&shard->speakers);
+
+    table->lastHit                = table->count;
+    table->shards[table->count++] = shard;
+    return shard;
+}
+
+// Drops everything cached for a server tab, cost depends only on the size of this shard
+void ServerShardRemove(SERVER_SHARD_TABLE* table, uint64 serverConnectionHandlerID)
+{
+    int idx = ServerShardIndex(table, serverConnectionHandlerID);
+
+    if (idx < 0)
+        return;
+
+    ServerShardFree(table->shards[idx]);
+    table->shards[idx] = table->shards[--table->count];
+    table->lastHit     = 0;
+}
+
+void ServerShardRemoveAll(SERVER_SHARD_TABLE* table)
+{
+    unsigned int nextEpoch = table->nextEpoch;
+
+    for (int i = 0; i < table->count; i++)
+        ServerShardFree(table->shards[i]);
+    ServerShardInit(table, table->strings);
+    table->nextEpoch = nextEpoch;
+}
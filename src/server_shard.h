@@ -0,0 +1,48 @@
+#ifndef SERVER_SHARD_H
+#define SERVER_SHARD_H
+
+#include "teamspeak/public_definitions.h"
+#include "client_cache.h"
+#include "channel_cache.h"
+#include "group_cache.h"
+#include "active_speakers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SERVER_SHARD_MAX 32 // more server tabs than this are not cached
+#define SERVER_UID_LEN   64
+
+// All cached state of one server tab, dropped as a whole when the tab disconnects
+typedef struct {
+    uint64          serverConnectionHandlerID;
+    char            uniqueIdentifier[SERVER_UID_LEN]; // virtual server UID, empty until known
+    unsigned int    epoch;                            // differs for every connection of the server tab
+    CLIENT_CACHE    clients;
+    CHANNEL_CACHE   channels;
+    GROUP_CACHE     groups;
+    ACTIVE_SPEAKERS speakers;
+    uint64          groupListRequestedMs[2]; // last group list request by GROUP_KIND_*, 0 = never
+    anyID           ownClientID;             // own client on this tab, 0 until asked for on the first talk event
+} SERVER_SHARD;
+
+typedef struct {
+    SERVER_SHARD* shards[SERVER_SHARD_MAX];
+    int           count;
+    int           lastHit;   // index of the last found shard, events mostly come from the same tab
+    unsigned int  nextEpoch; // kept across ServerShardRemoveAll, epochs are never handed out twice
+    STRING_POOL*  strings;   // shared by the client caches of all shards
+} SERVER_SHARD_TABLE;
+
+void          ServerShardInit(SERVER_SHARD_TABLE* table, STRING_POOL* strings);
+SERVER_SHARD* ServerShardFind(SERVER_SHARD_TABLE* table, uint64 serverConnectionHandlerID);
+SERVER_SHARD* ServerShardGet(SERVER_SHARD_TABLE* table, uint64 serverConnectionHandlerID);
+void          ServerShardRemove(SERVER_SHARD_TABLE* table, uint64 serverConnectionHandlerID);
+void          ServerShardRemoveAll(SERVER_SHARD_TABLE* table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERVER_SHARD_H
@@ -0,0 +1,430 @@
+#include "shm_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SHM_RING_MASK        (SHM_RING_DATA_SIZE - 1)
+#define SHM_RING_DATA_OFFSET ((sizeof(SHM_RING_HEADER) + 63) & ~(size_t)63)
+#define SHM_RING_ALIGN(n)    (((n) + 7) & ~(size_t)7)
+#define SHM_RING_MAX_RECORD  (SHM_RING_DATA_SIZE / 4)
+
+#ifdef _WIN32
+// -------------------- Windows --------------------
+// The daemon is not available on Windows, the plugin keeps publishing in-process there.
+
+int ShmRingCreate(SHM_RING* ring, const char* name)
+{
+    (void)name;
+    memset(ring, 0, sizeof(*ring));
+    return 0;
+}
+
+void ShmRingClose(SHM_RING* ring)
+{
+    memset(ring, 0, sizeof(*ring));
+}
+
+int ShmRingPush(SHM_RING* ring, uint64 serverConnectionHandlerID, const char* topic, const char* message)
+{
+    (void)ring;
+    (void)serverConnectionHandlerID;
+    (void)topic;
+    (void)message;
+    return 0;
+}
+
+void ShmRingSetConfig(SHM_RING* ring, const SHM_RING_CONFIG* config)
+{
+    (void)ring;
+    (void)config;
+}
+
+int ShmRingConsumerAlive(SHM_RING* ring)
+{
+    (void)ring;
+    return 0;
+}
+
+int ShmRingAttach(SHM_RING* ring, const char* name)
+{
+    (void)name;
+    memset(ring, 0, sizeof(*ring));
+    return 0;
+}
+
+int ShmRingPeek(SHM_RING* ring, const SHM_RING_RECORD** record, const char** topic, const char** message)
+{
+    (void)ring;
+    (void)record;
+    (void)topic;
+    (void)message;
+    return 0;
+}
+
+void ShmRingConsume(SHM_RING* ring, const SHM_RING_RECORD* record)
+{
+    (void)ring;
+    (void)record;
+}
+
+void ShmRingWait(SHM_RING* ring, uint64 timeoutMs)
+{
+    (void)ring;
+    Sleep((DWORD)timeoutMs);
+}
+
+void ShmRingHeartbeat(SHM_RING* ring)
+{
+    (void)ring;
+}
+
+int ShmRingGetConfig(SHM_RING* ring, SHM_RING_CONFIG* config, unsigned int* generation)
+{
+    (void)ring;
+    (void)config;
+    (void)generation;
+    return 0;
+}
+
+int ShmRingProducerAlive(SHM_RING* ring)
+{
+    (void)ring;
+    return 0;
+}
+
+void ShmRingName(char* name, size_t size)
+{
+    snprintf(name, size, "lh2mqtt");
+}
+
+#else
+// -------------------- Linux / Unix --------------------
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static int ProcessAlive(int pid)
+{
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+static void FutexWait(unsigned int* word, unsigned int expected, uint64 timeoutMs)
+{
+#ifdef __linux__
+    struct timespec ts;
+
+    ts.tv_sec  = (time_t)(timeoutMs / 1000);
+    ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+    // shared futex, producer and consumer are different processes
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, &ts, NULL, 0);
+#else
+    (void)word;
+    (void)expected;
+    usleep((useconds_t)(timeoutMs < 100 ? timeoutMs : 100) * 1000);
+#endif
+}
+
+static void FutexWake(unsigned int* word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+static int ShmRingMap(SHM_RING* ring, int fd)
+{
+    ring->mapSize = SHM_RING_DATA_OFFSET + SHM_RING_DATA_SIZE;
+    ring->header  = (SHM_RING_HEADER*)mmap(NULL, ring->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if ((void*)ring->header == MAP_FAILED) {
+        ring->header = NULL;
+        return 0;
+    }
+    ring->data = (char*)ring->header + SHM_RING_DATA_OFFSET;
+    ring->fd   = fd;
+    return 1;
+}
+
+// Name of the shared memory object, one per user
+void ShmRingName(char* name, size_t size)
+{
+    snprintf(name, size, "/lh2mqtt-%u", (unsigned int)getuid());
+}
+
+// Marks a ring of another layout as closed, so a daemon still attached to it exits
+static void ShmRingRetire(int fd, size_t size)
+{
+    SHM_RING_HEADER* h;
+
+    if (size < sizeof(unsigned int) * 4)
+        return;
+    h = (SHM_RING_HEADER*)mmap(NULL, sizeof(unsigned int) * 4, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if ((void*)h == MAP_FAILED)
+        return;
+    __atomic_store_n(&h->closed, 1, __ATOMIC_RELEASE);
+    munmap(h, sizeof(unsigned int) * 4);
+}
+
+// Opens the ring as producer. An existing ring of a previous plugin instance is taken over together with
+// the records the daemon has not sent yet. Returns 0 on error or if another running process produces into the ring.
+int ShmRingCreate(SHM_RING* ring, const char* name)
+{
+    struct stat st;
+    int         fd;
+
+    memset(ring, 0, sizeof(*ring));
+    fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0 || fstat(fd, &st) != 0)
+        goto fail;
+
+    if (st.st_size == 0 && ftruncate(fd, (off_t)(SHM_RING_DATA_OFFSET + SHM_RING_DATA_SIZE)) != 0)
+        goto fail;
+    if ((st.st_size == 0 || (size_t)st.st_size == SHM_RING_DATA_OFFSET + SHM_RING_DATA_SIZE) && ShmRingMap(ring, fd)) {
+        SHM_RING_HEADER* h = ring->header;
+
+        if (h->magic == 0) {
+            // new object, ftruncate filled it with zeros
+            h->version  = SHM_RING_VERSION;
+            h->dataSize = SHM_RING_DATA_SIZE;
+            __atomic_store_n(&h->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+        }
+        if (h->magic == SHM_RING_MAGIC && h->version == SHM_RING_VERSION && !h->closed) {
+            int owner = __atomic_load_n(&h->producerPid, __ATOMIC_ACQUIRE);
+
+            // a ring has one producer, the one of a running client (e.g. a second instance) stays with it
+            if ((owner == (int)getpid() || !ProcessAlive(owner))
+                && __atomic_compare_exchange_n(&h->producerPid, &owner, (int)getpid(), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                return 1;
+            munmap(ring->header, ring->mapSize);
+            goto fail;
+        }
+        munmap(ring->header, ring->mapSize);
+        memset(ring, 0, sizeof(*ring));
+    }
+
+    // left over by another version, replaced by a new object
+    ShmRingRetire(fd, (size_t)st.st_size);
+    close(fd);
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || ftruncate(fd, (off_t)(SHM_RING_DATA_OFFSET + SHM_RING_DATA_SIZE)) != 0 || !ShmRingMap(ring, fd))
+        goto fail;
+    ring->header->version  = SHM_RING_VERSION;
+    ring->header->dataSize = SHM_RING_DATA_SIZE;
+    __atomic_store_n(&ring->header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->header->producerPid, (int)getpid(), __ATOMIC_RELEASE);
+    return 1;
+
+fail:
+    if (fd >= 0)
+        close(fd);
+    memset(ring, 0, sizeof(*ring));
+    return 0;
+}
+
+// Opens an existing ring as consumer, returns 0 if there is none or another daemon is already attached
+int ShmRingAttach(SHM_RING* ring, const char* name)
+{
+    struct stat st;
+    int         fd;
+    int         owner;
+
+    memset(ring, 0, sizeof(*ring));
+    fd = shm_open(name, O_RDWR, 0600);
+    if (fd < 0)
+        return 0;
+    // a shorter object would raise SIGBUS on access
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != SHM_RING_DATA_OFFSET + SHM_RING_DATA_SIZE || !ShmRingMap(ring, fd)) {
+        close(fd);
+        return 0;
+    }
+    if (__atomic_load_n(&ring->header->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC || ring->header->version != SHM_RING_VERSION) {
+        ShmRingClose(ring);
+        return 0;
+    }
+
+    // the consumer slot of a crashed daemon is taken over
+    owner = __atomic_load_n(&ring->header->consumerPid, __ATOMIC_ACQUIRE);
+    if (owner != 0 && owner != (int)getpid() && ProcessAlive(owner))
+        goto busy;
+    if (!__atomic_compare_exchange_n(&ring->header->consumerPid, &owner, (int)getpid(), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        goto busy;
+    ring->header->consumerHeartbeatMs = GetMonotonicTimeMs();
+    return 1;
+
+busy:
+    munmap(ring->header, ring->mapSize);
+    close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    return 0;
+}
+
+// Unmaps the ring, the shared memory object stays for the other side
+void ShmRingClose(SHM_RING* ring)
+{
+    if (ring->header != NULL) {
+        int self = (int)getpid();
+        // give up whichever side this process had
+        __atomic_compare_exchange_n(&ring->header->producerPid, &self, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        self = (int)getpid();
+        __atomic_compare_exchange_n(&ring->header->consumerPid, &self, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        munmap(ring->header, ring->mapSize);
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+}
+
+// Appends a publish record without blocking and wakes the daemon if it sleeps. Returns 0 if the ring is full.
+int ShmRingPush(SHM_RING* ring, uint64 serverConnectionHandlerID, const char* topic, const char* message)
+{
+    SHM_RING_HEADER* h           = ring->header;
+    size_t           topicSize   = strlen(topic) + 1;
+    size_t           messageSize = strlen(message) + 1;
+    size_t           need        = SHM_RING_ALIGN(sizeof(SHM_RING_RECORD) + topicSize + messageSize);
+    uint64           tail        = h->tail;
+    uint64           head        = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+    size_t           pos         = (size_t)(tail & SHM_RING_MASK);
+    size_t           pad         = pos + need > SHM_RING_DATA_SIZE ? SHM_RING_DATA_SIZE - pos : 0;
+    SHM_RING_RECORD* r;
+
+    if (need > SHM_RING_MAX_RECORD || SHM_RING_DATA_SIZE - (tail - head) < pad + need) {
+        __atomic_add_fetch(&h->dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    // a record never wraps, the rest of the data area is skipped instead
+    if (pad > 0) {
+        r       = (SHM_RING_RECORD*)(ring->data + pos);
+        r->size = (unsigned int)pad;
+        r->type = SHM_RING_RECORD_PAD;
+        tail += pad;
+        pos = 0;
+    }
+
+    r                            = (SHM_RING_RECORD*)(ring->data + pos);
+    r->size                      = (unsigned int)need;
+    r->type                      = SHM_RING_RECORD_PUBLISH;
+    r->serverConnectionHandlerID = serverConnectionHandlerID;
+    memcpy((char*)(r + 1), topic, topicSize);
+    memcpy((char*)(r + 1) + topicSize, message, messageSize);
+    __atomic_store_n(&h->tail, tail + need, __ATOMIC_RELEASE);
+
+    // only a sleeping daemon costs a system call. The fence orders the tail store before the load of the flag,
+    // ShmRingWait does the same the other way round, so one of both sides always sees the other.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&h->consumerWaiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&h->wakeup, 1, __ATOMIC_SEQ_CST);
+        FutexWake(&h->wakeup);
+    }
+    return 1;
+}
+
+// Copies the broker settings into the ring, seqlock style so the daemon never reads a half written config
+void ShmRingSetConfig(SHM_RING* ring, const SHM_RING_CONFIG* config)
+{
+    SHM_RING_HEADER* h = ring->header;
+
+    __atomic_add_fetch(&h->configGeneration, 1, __ATOMIC_ACQ_REL);
+    memcpy(&h->config, config, sizeof(*config));
+    __atomic_add_fetch(&h->configGeneration, 1, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&h->wakeup, 1, __ATOMIC_SEQ_CST);
+    FutexWake(&h->wakeup);
+}
+
+// Returns 1 and the config if it differs from *generation, which is updated
+int ShmRingGetConfig(SHM_RING* ring, SHM_RING_CONFIG* config, unsigned int* generation)
+{
+    SHM_RING_HEADER* h = ring->header;
+    unsigned int     before;
+    unsigned int     after;
+
+    do {
+        before = __atomic_load_n(&h->configGeneration, __ATOMIC_ACQUIRE);
+        if (before == *generation)
+            return 0;
+        memcpy(config, &h->config, sizeof(*config));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&h->configGeneration, __ATOMIC_RELAXED);
+    } while ((before & 1) != 0 || before != after);
+
+    *generation = before;
+    return 1;
+}
+
+int ShmRingConsumerAlive(SHM_RING* ring)
+{
+    SHM_RING_HEADER* h   = ring->header;
+    int              pid = __atomic_load_n(&h->consumerPid, __ATOMIC_ACQUIRE);
+
+    return ProcessAlive(pid) && GetMonotonicTimeMs() - __atomic_load_n(&h->consumerHeartbeatMs, __ATOMIC_RELAXED) < SHM_RING_DEAD_MS;
+}
+
+int ShmRingProducerAlive(SHM_RING* ring)
+{
+    return ProcessAlive(__atomic_load_n(&ring->header->producerPid, __ATOMIC_ACQUIRE));
+}
+
+// Returns the oldest unsent record without removing it, 0 if the ring is empty
+int ShmRingPeek(SHM_RING* ring, const SHM_RING_RECORD** record, const char** topic, const char** message)
+{
+    SHM_RING_HEADER* h = ring->header;
+
+    for (;;) {
+        uint64                 head = h->head;
+        const SHM_RING_RECORD* r;
+
+        if (head == __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE))
+            return 0;
+
+        r = (const SHM_RING_RECORD*)(ring->data + (head & SHM_RING_MASK));
+        if (r->type == SHM_RING_RECORD_PAD) {
+            __atomic_store_n(&h->head, head + r->size, __ATOMIC_RELEASE);
+            continue;
+        }
+        *record  = r;
+        *topic   = (const char*)(r + 1);
+        *message = *topic + strlen(*topic) + 1;
+        return 1;
+    }
+}
+
+// Removes the record returned by ShmRingPeek, its space may be reused by the producer afterwards
+void ShmRingConsume(SHM_RING* ring, const SHM_RING_RECORD* record)
+{
+    __atomic_store_n(&ring->header->head, ring->header->head + record->size, __ATOMIC_RELEASE);
+}
+
+// Sleeps until the producer appends a record or changes the config, at most timeoutMs. Updates the heartbeat.
+void ShmRingWait(SHM_RING* ring, uint64 timeoutMs)
+{
+    SHM_RING_HEADER* h = ring->header;
+    unsigned int     seen;
+
+    h->consumerHeartbeatMs = GetMonotonicTimeMs();
+    __atomic_store_n(&h->consumerWaiting, 1, __ATOMIC_SEQ_CST);
+    seen = __atomic_load_n(&h->wakeup, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    // a record published between the last peek and the flag would otherwise be missed
+    if (h->head == __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE))
+        FutexWait(&h->wakeup, seen, timeoutMs);
+    __atomic_store_n(&h->consumerWaiting, 0, __ATOMIC_SEQ_CST);
+    h->consumerHeartbeatMs = GetMonotonicTimeMs();
+}
+
+// Tells the plugin the daemon is still working, needed while a publish takes long
+void ShmRingHeartbeat(SHM_RING* ring)
+{
+    __atomic_store_n(&ring->header->consumerHeartbeatMs, GetMonotonicTimeMs(), __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHM_RING_MAGIC        0x6D32686Cu // "lh2m"
+#define SHM_RING_VERSION      2
+#define SHM_RING_DATA_SIZE    (1 << 20) // power of two
+#define SHM_RING_HEARTBEAT_MS 1000      // the daemon updates its heartbeat at least this often
+#define SHM_RING_DEAD_MS      5000      // a side without heartbeat for this long counts as dead
+#define SHM_RING_BROKERS      4         // brokers of the HOST list with stats in the header
+
+#define SHM_RING_RECORD_PAD     0 // fills the end of the data area, the next record starts at offset 0
+#define SHM_RING_RECORD_PUBLISH 1
+
+// Broker settings, written by the plugin and picked up by the daemon when the generation changes
+typedef struct {
+    char exe[256]; // mosquitto_pub, used by the daemon for TLS connections
+    char host[256]; // comma separated list, see broker_set.h
+    char port[16];
+    char user[128];
+    char password[128];
+    char qos[8];
+    char cafile[256];
+} SHM_RING_CONFIG;
+
+// Layout of the shared memory object. Producer (plugin) and consumer (daemon) fields are on separate cache lines,
+// the data area follows at offset sizeof(SHM_RING_HEADER).
+typedef struct {
+    unsigned int    magic;
+    unsigned int    version;
+    unsigned int    dataSize;
+    unsigned int    closed; // set when the object was replaced, the daemon exits
+    char            pad0[48];
+
+    uint64          tail; // bytes ever written, stored with release semantics after the record is complete
+    int             producerPid;
+    unsigned int    wakeup; // futex word, incremented by the producer
+    uint64          dropped; // records which did not fit
+    char            pad1[40];
+
+    uint64          head; // bytes ever consumed
+    int             consumerPid;
+    unsigned int    consumerWaiting; // consumer sleeps on the futex
+    uint64          consumerHeartbeatMs;
+    uint64          published;
+    uint64          failed;
+    char            pad2[24];
+
+    unsigned int    configGeneration; // odd while the plugin writes the config
+    SHM_RING_CONFIG config;
+
+    // broker failover stats, written by the daemon
+    int             activeBroker; // index in the HOST list, -1 = none
+    unsigned int    failovers;
+    int             brokerHealthy[SHM_RING_BROKERS];
+    int             brokerRttMs[SHM_RING_BROKERS]; // -1 = no sample yet
+} SHM_RING_HEADER;
+
+// Record header, records are 8 byte aligned. A publish record is followed by topic and message, both NUL terminated.
+typedef struct {
+    unsigned int size; // including this header and the padding
+    unsigned int type;
+    uint64       serverConnectionHandlerID;
+} SHM_RING_RECORD;
+
+typedef struct {
+    SHM_RING_HEADER* header;
+    char*            data;
+    size_t           mapSize;
+    int              fd;
+} SHM_RING;
+
+// Plugin side (single producer, callers serialize pushes themselves)
+int  ShmRingCreate(SHM_RING* ring, const char* name);
+void ShmRingClose(SHM_RING* ring);
+int  ShmRingPush(SHM_RING* ring, uint64 serverConnectionHandlerID, const char* topic, const char* message);
+void ShmRingSetConfig(SHM_RING* ring, const SHM_RING_CONFIG* config);
+int  ShmRingConsumerAlive(SHM_RING* ring);
+
+// Daemon side (single consumer)
+int  ShmRingAttach(SHM_RING* ring, const char* name);
+int  ShmRingPeek(SHM_RING* ring, const SHM_RING_RECORD** record, const char** topic, const char** message);
+void ShmRingConsume(SHM_RING* ring, const SHM_RING_RECORD* record);
+void ShmRingWait(SHM_RING* ring, uint64 timeoutMs);
+void ShmRingHeartbeat(SHM_RING* ring);
+int  ShmRingGetConfig(SHM_RING* ring, SHM_RING_CONFIG* config, unsigned int* generation);
+int  ShmRingProducerAlive(SHM_RING* ring);
+
+void ShmRingName(char* name, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHM_RING_H
@@ -0,0 +1,315 @@
+#include "sink.h"
+#include "slab.h"
+
+#include <string.h>
+
+static unsigned int SinkDepth(const SINK* sink)
+{
+    unsigned int depth = 0;
+
+    for (int i = 0; i < SINK_PRIORITIES; i++)
+        depth += sink->count[i];
+    return depth;
+}
+
+// Queue to publish from next, -1 if there is nothing to publish. Only the high queue is published while held.
+static int SinkNextQueue(const SINK* sink)
+{
+    for (int i = 0; i < SINK_PRIORITIES; i++) {
+        if (sink->count[i] > 0 && (i == SINK_PRIORITY_HIGH || !sink->held || sink->stop))
+            return i;
+    }
+    return -1;
+}
+
+static void SinkWorker(void* arg)
+{
+    SINK* sink  = (SINK*)arg;
+    int   dirty = 0; // something was published since the last flush
+
+    MutexLock(&sink->lock);
+    for (;;) {
+        SINK_EVENT* event;
+        uint64      start;
+        uint64      queuedMs;
+        int         queue;
+
+        if (SinkDepth(sink) == 0 && dirty) {
+            dirty = 0;
+            if (sink->ops->flush != NULL) {
+                MutexUnlock(&sink->lock);
+                start = GetMonotonicTimeMs();
+                sink->ops->flush(sink->arg);
+                MutexLock(&sink->lock);
+                sink->busyMs += GetMonotonicTimeMs() - start;
+            }
+            continue;
+        }
+        while ((queue = SinkNextQueue(sink)) < 0 && !sink->stop)
+            CondWait(&sink->cond, &sink->lock);
+        // queued events are still published when stopping, unless the deadline passed
+        if (queue < 0 || (sink->stop && sink->deadlineMs != 0 && GetMonotonicTimeMs() >= sink->deadlineMs))
+            break;
+
+        event             = sink->queue[queue][sink->head[queue]];
+        sink->head[queue] = (sink->head[queue] + 1) % SINK_QUEUE_LEN;
+        sink->count[queue]--;
+        MutexUnlock(&sink->lock);
+
+        start = GetMonotonicTimeMs();
+        sink->ops->publish(sink->arg, event);
+        queuedMs = event->queuedMs;
+        SlabFree(event);
+        dirty = 1;
+
+        MutexLock(&sink->lock);
+        sink->busyMs += GetMonotonicTimeMs() - start;
+        sink->published++;
+        LatencyRecord(&sink->latency[queue], GetMonotonicTimeMs() - queuedMs);
+    }
+    MutexUnlock(&sink->lock);
+    SlabThreadFlush();
+}
+
+// Publishes the queued events of a sink without worker on the calling thread, until deadlineMs (0 = all of them).
+// The caller holds the set lock, so no new event can overtake the queued ones.
+static void SinkDrainQueued(SINK* sink, uint64 deadlineMs)
+{
+    int published = 0;
+    int queue;
+
+    MutexLock(&sink->lock);
+    while ((queue = SinkNextQueue(sink)) >= 0 && (deadlineMs == 0 || GetMonotonicTimeMs() < deadlineMs)) {
+        SINK_EVENT* event = sink->queue[queue][sink->head[queue]];
+        uint64      queuedMs;
+
+        sink->head[queue] = (sink->head[queue] + 1) % SINK_QUEUE_LEN;
+        sink->count[queue]--;
+        MutexUnlock(&sink->lock);
+
+        sink->ops->publish(sink->arg, event);
+        queuedMs = event->queuedMs;
+        SlabFree(event);
+        published = 1;
+
+        MutexLock(&sink->lock);
+        sink->published++;
+        LatencyRecord(&sink->latency[queue], GetMonotonicTimeMs() - queuedMs);
+    }
+    MutexUnlock(&sink->lock);
+    if (published && sink->ops->flush != NULL)
+        sink->ops->flush(sink->arg);
+}
+
+void SinkSetInit(SINK_SET* set)
+{
+    memset(set, 0, sizeof(*set));
+    MutexInit(&set->lock);
+}
+
+void SinkSetFree(SINK_SET* set)
+{
+    SinkRemoveAll(set, 0, NULL, NULL);
+    MutexDestroy(&set->lock);
+}
+
+// Stops the intake, events published afterwards are ignored. Queued events are still published.
+void SinkClose(SINK_SET* set)
+{
+    MutexLock(&set->lock);
+    set->closed = 1;
+    MutexUnlock(&set->lock);
+}
+
+// Holds back the events of the sinks with these ops while their output is not ready yet, e.g. during startup. They
+// stay queued (up to SINK_QUEUE_LEN) and are published in order once released, stopping releases them too. Events
+// of SINK_PRIORITY_HIGH are not held back. A sink without worker publishes the held events on the releasing thread.
+void SinkHold(SINK_SET* set, const SINK_OPS* ops, int held)
+{
+    MutexLock(&set->lock);
+    for (int i = 0; i < set->count; i++) {
+        SINK* sink = &set->sinks[i];
+
+        if (sink->ops != ops)
+            continue;
+        MutexLock(&sink->lock);
+        sink->held = held;
+        CondSignal(&sink->cond);
+        MutexUnlock(&sink->lock);
+        if (!held && !sink->running)
+            SinkDrainQueued(sink, 0);
+    }
+    MutexUnlock(&set->lock);
+}
+
+// Starts the worker of a new sink, returns 0 if the list is full or init failed
+int SinkAdd(SINK_SET* set, const SINK_OPS* ops, void* arg)
+{
+    SINK* sink;
+
+    if (ops->init != NULL && !ops->init(arg))
+        return 0;
+
+    MutexLock(&set->lock);
+    if (set->count == SINK_MAX) {
+        MutexUnlock(&set->lock);
+        if (ops->shutdown != NULL)
+            ops->shutdown(arg);
+        return 0;
+    }
+    sink = &set->sinks[set->count];
+    memset(sink, 0, sizeof(*sink));
+    sink->ops     = ops;
+    sink->arg     = arg;
+    sink->startMs = GetMonotonicTimeMs();
+    MutexInit(&sink->lock);
+    CondInit(&sink->cond);
+    sink->running = ops->synchronous ? 0 : ThreadStart(&sink->thread, SinkWorker, sink);
+    set->count++;
+    MutexUnlock(&set->lock);
+    return 1;
+}
+
+// Publishes what is queued until deadlineMs (monotonic, 0 = no deadline), ends the workers and shuts the sinks down.
+// Events which were not published are handed to spill (may be NULL).
+void SinkRemoveAll(SINK_SET* set, uint64 deadlineMs, SINK_SPILL_FUNC spill, void* arg)
+{
+    MutexLock(&set->lock);
+    // all sinks drain in parallel
+    for (int i = 0; i < set->count; i++) {
+        SINK* sink = &set->sinks[i];
+
+        MutexLock(&sink->lock);
+        sink->stop       = 1;
+        sink->deadlineMs = deadlineMs;
+        CondSignal(&sink->cond);
+        MutexUnlock(&sink->lock);
+        if (sink->ops->stop != NULL)
+            sink->ops->stop(sink->arg, deadlineMs);
+    }
+    for (int i = 0; i < set->count; i++) {
+        SINK* sink = &set->sinks[i];
+
+        if (sink->running) {
+            ThreadJoin(&sink->thread);
+            sink->running = 0;
+        } else {
+            SinkDrainQueued(sink, deadlineMs);
+        }
+        for (int q = 0; q < SINK_PRIORITIES; q++) {
+            for (; sink->count[q] > 0; sink->count[q]--) {
+                SINK_EVENT* event = sink->queue[q][sink->head[q]];
+                if (spill != NULL)
+                    spill(sink->ops, event, arg);
+                SlabFree(event);
+                sink->head[q] = (sink->head[q] + 1) % SINK_QUEUE_LEN;
+            }
+        }
+        if (sink->ops->shutdown != NULL)
+            sink->ops->shutdown(sink->arg);
+        CondDestroy(&sink->cond);
+        MutexDestroy(&sink->lock);
+    }
+    set->count = 0;
+    MutexUnlock(&set->lock);
+}
+
+static SINK_EVENT* SinkCopyEvent(int kind, int priority, uint64 serverConnectionHandlerID, anyID clientID, const char* topic, const char* message)
+{
+    size_t      topicSize   = strlen(topic) + 1;
+    size_t      messageSize = strlen(message) + 1;
+    SINK_EVENT* event       = (SINK_EVENT*)SlabAlloc(sizeof(SINK_EVENT) + topicSize + messageSize);
+
+    if (event == NULL)
+        return NULL;
+    event->serverConnectionHandlerID = serverConnectionHandlerID;
+    event->clientID                  = clientID;
+    event->kind                      = kind;
+    event->priority                  = priority;
+    event->queuedMs                  = GetMonotonicTimeMs();
+    event->topic                     = (char*)(event + 1);
+    event->message                   = event->topic + topicSize;
+    memcpy(event->topic, topic, topicSize);
+    memcpy(event->message, message, messageSize);
+    return event;
+}
+
+// Queues a copy of the event for every sink which takes its kind, in the queue of its priority. Sinks without worker
+// publish it right away unless they are held. Returns the number of sinks which had to drop the event.
+int SinkPublish(SINK_SET* set, int kind, int priority, uint64 serverConnectionHandlerID, anyID clientID, const char* topic, const char* message)
+{
+    int dropped = 0;
+
+    if (priority < 0 || priority >= SINK_PRIORITIES)
+        priority = SINK_PRIORITY_BULK;
+
+    MutexLock(&set->lock);
+    for (int i = 0; i < set->count && !set->closed; i++) {
+        SINK*       sink = &set->sinks[i];
+        SINK_EVENT* event;
+
+        if ((sink->ops->kinds & (unsigned int)kind) == 0)
+            continue;
+        event = SinkCopyEvent(kind, priority, serverConnectionHandlerID, clientID, topic, message);
+
+        MutexLock(&sink->lock);
+        if (event == NULL || sink->count[priority] == SINK_QUEUE_LEN) {
+            sink->dropped++;
+            MutexUnlock(&sink->lock);
+            SlabFree(event);
+            dropped++;
+            continue;
+        }
+        if (!sink->running && (!sink->held || priority == SINK_PRIORITY_HIGH)) {
+            uint64 queuedMs = event->queuedMs;
+
+            MutexUnlock(&sink->lock);
+            sink->ops->publish(sink->arg, event);
+            if (sink->ops->flush != NULL)
+                sink->ops->flush(sink->arg);
+            SlabFree(event);
+            MutexLock(&sink->lock);
+            sink->published++;
+            LatencyRecord(&sink->latency[priority], GetMonotonicTimeMs() - queuedMs);
+            MutexUnlock(&sink->lock);
+            continue;
+        }
+        sink->queue[priority][(sink->head[priority] + sink->count[priority]) % SINK_QUEUE_LEN] = event;
+        sink->count[priority]++;
+        if (SinkDepth(sink) > sink->maxDepth)
+            sink->maxDepth = SinkDepth(sink);
+        CondSignal(&sink->cond);
+        MutexUnlock(&sink->lock);
+    }
+    MutexUnlock(&set->lock);
+    return dropped;
+}
+
+// Returns 0 if there is no sink with this index
+int SinkGetStats(SINK_SET* set, int index, SINK_STATS* stats)
+{
+    SINK*  sink;
+    uint64 elapsedMs;
+
+    MutexLock(&set->lock);
+    if (index >= set->count) {
+        MutexUnlock(&set->lock);
+        return 0;
+    }
+    sink = &set->sinks[index];
+    MutexLock(&sink->lock);
+    elapsedMs         = GetMonotonicTimeMs() - sink->startMs;
+    stats->name       = sink->ops->name;
+    stats->depth      = SinkDepth(sink);
+    stats->maxDepth   = sink->maxDepth;
+    stats->published  = sink->published;
+    stats->dropped    = sink->dropped;
+    stats->perSecond  = elapsedMs > 0 ? sink->published * 1000 / elapsedMs : 0;
+    stats->busyMs     = sink->busyMs;
+    stats->held       = sink->held;
+    for (int i = 0; i < SINK_PRIORITIES; i++)
+        stats->p99Ms[i] = LatencyPercentile(&sink->latency[i], 99);
+    MutexUnlock(&sink->lock);
+    MutexUnlock(&set->lock);
+    return 1;
+}
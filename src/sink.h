@@ -0,0 +1,110 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include "platform.h"
+#include "latency.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SINK_MAX       8   // configured sinks
+#define SINK_QUEUE_LEN 256 // queued events per sink and priority
+
+// Priority classes, every sink has a queue per class and publishes the high one first. High events are also
+// published while the sink is held.
+#define SINK_PRIORITY_HIGH 0 // latency critical, e.g. the own client talking
+#define SINK_PRIORITY_BULK 1
+#define SINK_PRIORITIES    2
+
+// Kinds of events, a sink only receives the kinds it asked for
+#define SINK_EVENT_MQTT 1 // topic and message for the broker
+#define SINK_EVENT_TEXT 2 // BBCode line for the channel tab, in message
+
+typedef struct {
+    uint64 serverConnectionHandlerID;
+    anyID  clientID; // 0 for events of the server tab
+    int    kind;
+    int    priority; // SINK_PRIORITY_*
+    uint64 queuedMs;
+    char*  topic; // "" for text events
+    char*  message;
+} SINK_EVENT;
+
+// Hooks of one output. init runs on the caller of SinkAdd, publish and flush on the sink's worker, shutdown after the
+// worker ended. flush is called whenever the queue ran empty, e.g. to write out buffered lines. Hooks may be NULL,
+// except publish. A synchronous sink has no worker, publish and flush run on the thread calling SinkPublish, for
+// outputs which must stay on the TeamSpeak callback threads or which only hand the event on to a queue of their own.
+// stop runs on the caller of SinkRemoveAll before it waits
+// for the worker, a publish blocked on I/O has to give up at the deadline.
+typedef struct {
+    const char*  name;
+    unsigned int kinds; // SINK_EVENT_* mask
+    int  (*init)(void* arg); // returns 0 if the sink cannot work, it is not added then
+    void (*publish)(void* arg, const SINK_EVENT* event);
+    void (*flush)(void* arg);
+    void (*shutdown)(void* arg);
+    int          synchronous;
+    void (*stop)(void* arg, uint64 deadlineMs); // deadline of SinkRemoveAll, 0 = none
+} SINK_OPS;
+
+// Receives the events which were not published before the deadline of SinkRemoveAll
+typedef void (*SINK_SPILL_FUNC)(const SINK_OPS* ops, const SINK_EVENT* event, void* arg);
+
+typedef struct {
+    const             SINK_OPS* ops;
+    void*             arg;
+    PLATFORM_THREAD   thread;
+    PLATFORM_MUTEX    lock;
+    PLATFORM_COND     cond;
+    int               running; // worker started, otherwise events are published by SinkPublish directly
+    int               stop;
+    int               held;       // SinkHold, events are buffered in the queue until the sink is released
+    uint64            deadlineMs; // with stop, no event is published after this point, 0 = publish all queued events
+    SINK_EVENT*       queue[SINK_PRIORITIES][SINK_QUEUE_LEN]; // ring buffers
+    unsigned int      head[SINK_PRIORITIES];
+    unsigned int      count[SINK_PRIORITIES];
+
+    unsigned int      maxDepth;
+    uint64            published;
+    uint64            dropped; // queue was full
+    uint64            busyMs;  // time spent in publish and flush
+    uint64            startMs;
+    LATENCY_HISTOGRAM latency[SINK_PRIORITIES]; // from SinkPublish until publish returned
+} SINK;
+
+// Every published event fans out to all sinks which take its kind. Each sink has its own bounded queue and worker,
+// so a slow sink only drops its own events and never delays the others.
+typedef struct {
+    SINK           sinks[SINK_MAX];
+    int            count;
+    int            closed; // SinkClose was called, new events are ignored
+    PLATFORM_MUTEX lock;   // guards the list, not the queues
+} SINK_SET;
+
+typedef struct {
+    const char*  name;
+    unsigned int depth;
+    unsigned int maxDepth;
+    uint64       published;
+    uint64       dropped;
+    uint64       perSecond; // average throughput since the sink was added
+    uint64       busyMs;
+    int          held;
+    uint64       p99Ms[SINK_PRIORITIES]; // within a factor of two, see latency.h
+} SINK_STATS;
+
+void SinkSetInit(SINK_SET* set);
+void SinkSetFree(SINK_SET* set);
+int  SinkAdd(SINK_SET* set, const SINK_OPS* ops, void* arg);
+void SinkClose(SINK_SET* set);
+void SinkHold(SINK_SET* set, const SINK_OPS* ops, int held);
+void SinkRemoveAll(SINK_SET* set, uint64 deadlineMs, SINK_SPILL_FUNC spill, void* arg);
+int  SinkPublish(SINK_SET* set, int kind, int priority, uint64 serverConnectionHandlerID, anyID clientID, const char* topic, const char* message);
+int  SinkGetStats(SINK_SET* set, int index, SINK_STATS* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SINK_H
@@ -0,0 +1,276 @@
+#include "slab.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define SLAB_THREAD_LOCAL __declspec(thread)
+#else
+#define SLAB_THREAD_LOCAL __thread
+#endif
+
+#define SLAB_LARGE SLAB_CLASSES // class of objects which came from malloc
+
+// Precedes every object, keeps the object 16 byte aligned
+typedef struct {
+    unsigned int sizeClass;
+    unsigned int generation; // of the chunk, objects of released pools are ignored by SlabFree
+    uint64       pad;
+} SLAB_HEADER;
+
+// Link of a free object, stored in the object itself
+typedef struct SLAB_OBJECT {
+    struct SLAB_OBJECT* next;
+} SLAB_OBJECT;
+
+typedef struct {
+    PLATFORM_MUTEX     lock;
+    size_t             objectSize;
+    SLAB_OBJECT*       free;
+    unsigned long long freeCount;
+    void*              chunks; // each chunk starts with the pointer to the next one
+    unsigned long long reserved;
+    unsigned long long refills;
+    unsigned long long returns;
+} SLAB_CLASS;
+
+typedef struct {
+    SLAB_OBJECT* head;
+    unsigned int count;
+} SLAB_CACHE;
+
+static SLAB_CLASS         classes[SLAB_CLASSES];
+static unsigned long long largeCount  = 0;
+static unsigned int       generation  = 0; // changes with every SlabInit/SlabShutdown, stale thread caches are dropped
+static int                initialized = 0;
+
+static SLAB_THREAD_LOCAL SLAB_CACHE   threadCache[SLAB_CLASSES];
+static SLAB_THREAD_LOCAL unsigned int threadGeneration = 0;
+
+void SlabInit(void)
+{
+    size_t size = 64;
+
+    for (int i = 0; i < SLAB_CLASSES; i++, size *= 4) {
+        memset(&classes[i], 0, sizeof(classes[i]));
+        MutexInit(&classes[i].lock);
+        classes[i].objectSize = size;
+    }
+    largeCount = 0;
+    generation++;
+    initialized = 1;
+}
+
+// Releases the chunks of every class whose objects are all back in the global pool or the cache of the calling
+// thread. A class with objects still owned elsewhere (or cached by a thread which did not call SlabThreadFlush) keeps
+// its chunks, a late SlabFree of such an object sees the old generation and ignores it.
+void SlabShutdown(void)
+{
+    if (!initialized)
+        return;
+    initialized = 0;
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        SLAB_CLASS*        c      = &classes[i];
+        unsigned long long cached = threadGeneration == generation ? threadCache[i].count : 0;
+        void*              chunk  = c->chunks;
+
+        if (c->reserved != c->freeCount + cached) {
+            printf("PLUGIN: %llu objects of %u bytes not freed before shutdown, their memory is left allocated\n",
+                   c->reserved - c->freeCount - cached, (unsigned int)c->objectSize);
+            chunk = NULL;
+        }
+        while (chunk != NULL) {
+            void* next = *(void**)chunk;
+            free(chunk);
+            chunk = next;
+        }
+        MutexDestroy(&c->lock);
+        memset(c, 0, sizeof(*c));
+    }
+    generation++;
+}
+
+static SLAB_CACHE* SlabThreadCache(int sizeClass)
+{
+    if (threadGeneration != generation) {
+        memset(threadCache, 0, sizeof(threadCache));
+        threadGeneration = generation;
+    }
+    return &threadCache[sizeClass];
+}
+
+// Carves a new chunk into free objects. Caller must hold the class lock.
+static int SlabGrow(SLAB_CLASS* c, int sizeClass)
+{
+    size_t stride = sizeof(SLAB_HEADER) + c->objectSize;
+    char*  chunk  = (char*)malloc(SLAB_CHUNK_SIZE);
+
+    if (chunk == NULL)
+        return 0;
+    *(void**)chunk = c->chunks;
+    c->chunks      = chunk;
+    for (char* p = chunk + sizeof(SLAB_HEADER); p + stride <= chunk + SLAB_CHUNK_SIZE; p += stride) {
+        SLAB_HEADER* h = (SLAB_HEADER*)p;
+        SLAB_OBJECT* o = (SLAB_OBJECT*)(h + 1);
+
+        h->sizeClass  = (unsigned int)sizeClass;
+        h->generation = generation;
+        o->next       = c->free;
+        c->free       = o;
+        c->freeCount++;
+        c->reserved++;
+    }
+    return 1;
+}
+
+// Moves up to one batch from the global pool into the thread cache
+static void SlabRefill(SLAB_CACHE* cache, int sizeClass)
+{
+    SLAB_CLASS* c = &classes[sizeClass];
+
+    MutexLock(&c->lock);
+    if (c->free == NULL)
+        SlabGrow(c, sizeClass);
+    while (c->free != NULL && cache->count < SLAB_BATCH) {
+        SLAB_OBJECT* o = c->free;
+        c->free        = o->next;
+        c->freeCount--;
+        o->next     = cache->head;
+        cache->head = o;
+        cache->count++;
+    }
+    c->refills++;
+    MutexUnlock(&c->lock);
+}
+
+// Gives count objects from the front of the thread cache back to the global pool in one splice
+static void SlabReturn(SLAB_CACHE* cache, int sizeClass, unsigned int count)
+{
+    SLAB_CLASS*  c     = &classes[sizeClass];
+    SLAB_OBJECT* first = cache->head;
+    SLAB_OBJECT* last  = first;
+
+    if (count == 0 || first == NULL)
+        return;
+    for (unsigned int i = 1; i < count && last->next != NULL; i++)
+        last = last->next;
+    cache->head = last->next;
+    cache->count -= count;
+
+    MutexLock(&c->lock);
+    last->next = c->free;
+    c->free    = first;
+    c->freeCount += count;
+    c->returns++;
+    MutexUnlock(&c->lock);
+}
+
+void* SlabAlloc(size_t size)
+{
+    SLAB_HEADER* h;
+    int          sizeClass = 0;
+
+    while (sizeClass < SLAB_CLASSES && ((size_t)64 << (2 * sizeClass)) < size)
+        sizeClass++;
+
+    if (initialized && sizeClass < SLAB_CLASSES) {
+        SLAB_CACHE*  cache = SlabThreadCache(sizeClass);
+        SLAB_OBJECT* o;
+
+        if (cache->head == NULL)
+            SlabRefill(cache, sizeClass);
+        o = cache->head;
+        if (o != NULL) {
+            cache->head = o->next;
+            cache->count--;
+            return o;
+        }
+    }
+
+    // larger than the biggest class, before SlabInit or out of chunks
+    h = (SLAB_HEADER*)malloc(sizeof(SLAB_HEADER) + size);
+    if (h == NULL)
+        return NULL;
+    h->sizeClass = SLAB_LARGE;
+    if (initialized) {
+        MutexLock(&classes[SLAB_CLASSES - 1].lock);
+        largeCount++;
+        MutexUnlock(&classes[SLAB_CLASSES - 1].lock);
+    }
+    return h + 1;
+}
+
+void SlabFree(void* ptr)
+{
+    SLAB_HEADER* h;
+    SLAB_CACHE*  cache;
+    SLAB_OBJECT* o = (SLAB_OBJECT*)ptr;
+
+    if (ptr == NULL)
+        return;
+    h = (SLAB_HEADER*)ptr - 1;
+    if (h->sizeClass == SLAB_LARGE) {
+        free(h);
+        return;
+    }
+    // the pool of the object was shut down meanwhile
+    if (!initialized || h->generation != generation)
+        return;
+
+    cache       = SlabThreadCache((int)h->sizeClass);
+    o->next     = cache->head;
+    cache->head = o;
+    cache->count++;
+    // a thread which frees more than it allocates (e.g. a lane worker) hands the surplus back
+    if (cache->count >= 2 * SLAB_BATCH)
+        SlabReturn(cache, (int)h->sizeClass, SLAB_BATCH);
+}
+
+char* SlabStrdup(const char* str)
+{
+    size_t size = strlen(str) + 1;
+    char*  copy = (char*)SlabAlloc(size);
+
+    if (copy != NULL)
+        memcpy(copy, str, size);
+    return copy;
+}
+
+void SlabThreadFlush(void)
+{
+    if (!initialized)
+        return;
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        SLAB_CACHE* cache = SlabThreadCache(i);
+        SlabReturn(cache, i, cache->count);
+    }
+}
+
+void SlabGetStats(int sizeClass, SLAB_STATS* stats)
+{
+    SLAB_CLASS* c = &classes[sizeClass];
+
+    memset(stats, 0, sizeof(*stats));
+    if (!initialized)
+        return;
+    MutexLock(&c->lock);
+    stats->objectSize = c->objectSize;
+    stats->reserved   = c->reserved;
+    stats->free       = c->freeCount;
+    stats->refills    = c->refills;
+    stats->returns    = c->returns;
+    MutexUnlock(&c->lock);
+}
+
+unsigned long long SlabGetLargeCount(void)
+{
+    unsigned long long count = 0;
+
+    if (!initialized)
+        return 0;
+    MutexLock(&classes[SLAB_CLASSES - 1].lock);
+    count = largeCount;
+    MutexUnlock(&classes[SLAB_CLASSES - 1].lock);
+    return count;
+}
@@ -0,0 +1,44 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SLAB_CLASSES    4     // object sizes 64, 256, 1024 and 4096 bytes
+#define SLAB_CHUNK_SIZE 65536 // objects of a class are carved from chunks of this size
+#define SLAB_BATCH      32    // objects moved between a thread cache and the global pool at once
+
+typedef struct {
+    size_t             objectSize;
+    unsigned long long reserved; // objects carved from chunks so far
+    unsigned long long free;     // objects in the global pool, objects cached by threads are not included
+    unsigned long long refills;  // batches handed to thread caches
+    unsigned long long returns;  // batches given back by thread caches
+} SLAB_STATS;
+
+// Fixed size object pools for event records, payload buffers and cache strings. Every thread keeps a small free list
+// per size class, so most allocations are a pointer pop without lock. Larger requests fall back to malloc.
+// SlabInit must run before the first allocation, SlabShutdown releases the chunks of every size class whose objects
+// were all freed. Freeing an object of a pool which was shut down meanwhile is ignored.
+void  SlabInit(void);
+void  SlabShutdown(void);
+void* SlabAlloc(size_t size);
+void  SlabFree(void* ptr);
+char* SlabStrdup(const char* str);
+
+// Gives the objects cached by the calling thread back to the global pool, called by worker threads before they exit
+void SlabThreadFlush(void);
+
+void               SlabGetStats(int sizeClass, SLAB_STATS* stats);
+unsigned long long SlabGetLargeCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SLAB_H
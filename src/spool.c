@@ -0,0 +1,141 @@
+#include "spool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SPOOL_LINE_LEN 8192 // initial size of the read buffer, grows with longer lines
+
+void SpoolOpen(SPOOL* spool, const char* path)
+{
+    memset(spool, 0, sizeof(*spool));
+    snprintf(spool->path, sizeof(spool->path), "%s", path);
+}
+
+static void SpoolWriteEscaped(FILE* file, const char* str)
+{
+    for (; *str != '\0'; str++) {
+        switch (*str) {
+        case '\\': fputs("\\\\", file); break;
+        case '\t': fputs("\\t", file); break;
+        case '\n': fputs("\\n", file); break;
+        case '\r': fputs("\\r", file); break;
+        default:   fputc(*str, file); break;
+        }
+    }
+}
+
+// Appends one message, returns 0 if the spool file could not be written
+int SpoolWrite(SPOOL* spool, const char* topic, const char* message)
+{
+    if (spool->file == NULL) {
+        spool->file = fopen(spool->path, "a");
+        if (spool->file == NULL)
+            return 0;
+    }
+    SpoolWriteEscaped(spool->file, topic);
+    fputc('\t', spool->file);
+    SpoolWriteEscaped(spool->file, message);
+    fputc('\n', spool->file);
+    spool->count++;
+    return 1;
+}
+
+void SpoolClose(SPOOL* spool)
+{
+    if (spool->file != NULL)
+        fclose(spool->file);
+    spool->file = NULL;
+}
+
+static void SpoolUnescape(char* str)
+{
+    char* out = str;
+
+    for (; *str != '\0'; str++) {
+        if (*str == '\\' && str[1] != '\0') {
+            str++;
+            *out++ = *str == 't' ? '\t' : *str == 'n' ? '\n' : *str == 'r' ? '\r' : *str;
+        } else {
+            *out++ = *str;
+        }
+    }
+    *out = '\0';
+}
+
+// Reads one line into *line without the line break, growing the buffer as needed. Returns 0 at the end of the file
+// and -1 if the buffer could not grow, the rest of that line is skipped then.
+static int SpoolReadLine(FILE* file, char** line, size_t* size)
+{
+    size_t len = 0;
+
+    for (;;) {
+        if (fgets(*line + len, (int)(*size - len), file) == NULL) {
+            if (len == 0)
+                return 0;
+            break;
+        }
+        len += strlen(*line + len);
+        if (len > 0 && (*line)[len - 1] == '\n')
+            break;
+        if (len + 1 < *size)
+            break; // last line without line break
+        char* grown = (char*)realloc(*line, *size * 2);
+        if (grown == NULL) {
+            int c;
+            while ((c = fgetc(file)) != EOF && c != '\n')
+                ;
+            return -1;
+        }
+        *line = grown;
+        *size *= 2;
+    }
+    (*line)[strcspn(*line, "\r\n")] = '\0';
+    return 1;
+}
+
+// Hands every spooled message to func in the order they were written. Messages func did not take are written back
+// in their order, the file is removed if none are left. Returns the number of messages taken.
+int SpoolReplay(const char* path, SPOOL_FUNC func, void* arg)
+{
+    FILE*  file = fopen(path, "r");
+    SPOOL  kept;
+    char   keptPath[sizeof(kept.path)];
+    char*  line;
+    size_t size  = SPOOL_LINE_LEN;
+    int    count = 0;
+    int    read;
+
+    if (file == NULL)
+        return 0;
+    line = (char*)malloc(size);
+    if (line == NULL) {
+        fclose(file);
+        return 0;
+    }
+    snprintf(keptPath, sizeof(keptPath), "%s.tmp", path);
+    SpoolOpen(&kept, keptPath);
+    remove(keptPath);
+    while ((read = SpoolReadLine(file, &line, &size)) != 0) {
+        char* tab = read > 0 ? strchr(line, '\t') : NULL;
+
+        if (tab == NULL) {
+            if (read < 0)
+                printf("PLUGIN: ERROR: out of memory, spooled message dropped\n");
+            continue;
+        }
+        *tab = '\0';
+        SpoolUnescape(line);
+        SpoolUnescape(tab + 1);
+        if (func(line, tab + 1, arg))
+            count++;
+        else
+            SpoolWrite(&kept, line, tab + 1);
+    }
+    free(line);
+    fclose(file);
+    SpoolClose(&kept);
+    remove(path);
+    if (kept.count > 0 && rename(keptPath, path) != 0)
+        printf("PLUGIN: ERROR: %u spooled messages could not be written back to %s\n", kept.count, path);
+    return count;
+}
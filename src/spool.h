@@ -0,0 +1,32 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <stdio.h>
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Called for every spooled message by SpoolReplay, returns 0 if the message could not be taken and stays spooled
+typedef int (*SPOOL_FUNC)(const char* topic, const char* message, void* arg);
+
+// Messages which could not be sent before the plugin was unloaded. One line per message, topic and message are
+// separated by a tab, tabs, line breaks and backslashes inside them are escaped. Lines have no length limit.
+typedef struct {
+    FILE*        file; // opened with the first message
+    char         path[512];
+    unsigned int count;
+} SPOOL;
+
+void SpoolOpen(SPOOL* spool, const char* path);
+int  SpoolWrite(SPOOL* spool, const char* topic, const char* message);
+void SpoolClose(SPOOL* spool);
+int  SpoolReplay(const char* path, SPOOL_FUNC func, void* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPOOL_H
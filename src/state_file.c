@@ -0,0 +1,311 @@
+#include "state_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define STATE_FILE_READ_RETRIES 1000 // a writer which died within an update leaves the slot odd forever
+
+#ifdef _WIN32
+// -------------------- Windows --------------------
+
+static int StateFileMap(STATE_FILE* file, const char* path, int writable)
+{
+    file->mapSize = sizeof(STATE_FILE_HEADER);
+    file->file    = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file->file == INVALID_HANDLE_VALUE) {
+        file->file = NULL;
+        return 0;
+    }
+    // a writable mapping grows the file to the size of the layout
+    if (!writable && GetFileSize(file->file, NULL) != (DWORD)file->mapSize)
+        return 0;
+    file->mapping = CreateFileMappingA(file->file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, (DWORD)file->mapSize, NULL);
+    if (file->mapping == NULL)
+        return 0;
+    file->header = (STATE_FILE_HEADER*)MapViewOfFile(file->mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, file->mapSize);
+    return file->header != NULL;
+}
+
+static void StateFileUnmap(STATE_FILE* file)
+{
+    if (file->header != NULL)
+        UnmapViewOfFile(file->header);
+    if (file->mapping != NULL)
+        CloseHandle(file->mapping);
+    if (file->file != NULL)
+        CloseHandle(file->file);
+    memset(file, 0, sizeof(*file));
+}
+
+static int StateFilePid(void)
+{
+    return (int)GetCurrentProcessId();
+}
+
+// the mapping of a reader is read only, an interlocked instruction would fault on it
+static uint64 LoadAcquire(const volatile uint64* value)
+{
+    uint64 result = *value;
+
+    MemoryBarrier();
+    return result;
+}
+
+static void FenceAcquire(void)
+{
+    MemoryBarrier();
+}
+
+#else
+// -------------------- Linux / Unix --------------------
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static int StateFileMap(STATE_FILE* file, const char* path, int writable)
+{
+    struct stat st;
+
+    file->mapSize = sizeof(STATE_FILE_HEADER);
+    // readable for everybody, overlays often run as another user
+    file->fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (file->fd < 0 || fstat(file->fd, &st) != 0)
+        return 0;
+    if ((size_t)st.st_size != file->mapSize) {
+        // a shorter file would raise SIGBUS on access
+        if (!writable || ftruncate(file->fd, (off_t)file->mapSize) != 0)
+            return 0;
+    }
+    file->header = (STATE_FILE_HEADER*)mmap(NULL, file->mapSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file->fd, 0);
+    if ((void*)file->header == MAP_FAILED) {
+        file->header = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void StateFileUnmap(STATE_FILE* file)
+{
+    if (file->header != NULL)
+        munmap(file->header, file->mapSize);
+    if (file->fd >= 0)
+        close(file->fd);
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+}
+
+static int StateFilePid(void)
+{
+    return (int)getpid();
+}
+
+static uint64 LoadAcquire(const volatile uint64* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void FenceAcquire(void)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+#endif // !_WIN32
+
+// Starts the update of a slot, the sequence turns odd. The full barrier keeps the writes below after it.
+static void SlotBegin(STATE_FILE_SERVER* slot)
+{
+    AtomicAdd64(&slot->sequence, 1);
+}
+
+static void SlotEnd(STATE_FILE* file, STATE_FILE_SERVER* slot)
+{
+    AtomicAdd64(&slot->sequence, 1);
+    AtomicAdd64(&file->header->updates, 1);
+}
+
+// Empties a slot, the sequence keeps counting so a reader copying it meanwhile notices
+static void SlotClear(STATE_FILE_SERVER* slot)
+{
+    memset((char*)slot + sizeof(slot->sequence), 0, sizeof(*slot) - sizeof(slot->sequence));
+}
+
+// Creates or takes over the state file, the slots of a previous plugin instance are cleared. Returns 0 on error.
+int StateFileOpen(STATE_FILE* file, const char* path)
+{
+    STATE_FILE_HEADER* h;
+
+    memset(file, 0, sizeof(*file));
+    if (!StateFileMap(file, path, 1)) {
+        StateFileUnmap(file);
+        return 0;
+    }
+    h = file->header;
+    for (int i = 0; i < STATE_FILE_SERVERS; i++) {
+        STATE_FILE_SERVER* slot = &h->slots[i];
+
+        // a writer which died within an update left the sequence odd, round up instead of flipping the parity
+        AtomicExchange64(&slot->sequence, (AtomicLoad64(&slot->sequence) | 1) + 1);
+        SlotBegin(slot);
+        SlotClear(slot);
+        AtomicAdd64(&slot->sequence, 1);
+    }
+    h->version   = STATE_FILE_VERSION;
+    h->servers   = STATE_FILE_SERVERS;
+    h->slotSize  = sizeof(STATE_FILE_SERVER);
+    h->writerPid = StateFilePid();
+    AtomicAdd64(&h->updates, 1);
+    // readers check the magic first, it is stored last
+    AtomicExchange64(&h->magic, STATE_FILE_MAGIC);
+    return 1;
+}
+
+// Clears all slots, so readers see that nobody talks while the plugin is not running. The file stays.
+void StateFileClose(STATE_FILE* file)
+{
+    if (file->header != NULL) {
+        for (int i = 0; i < STATE_FILE_SERVERS; i++) {
+            STATE_FILE_SERVER* slot = &file->header->slots[i];
+
+            if (slot->serverConnectionHandlerID != 0) {
+                SlotBegin(slot);
+                SlotClear(slot);
+                SlotEnd(file, slot);
+            }
+        }
+        file->header->writerPid = 0;
+        AtomicAdd64(&file->header->updates, 1);
+    }
+    StateFileUnmap(file);
+}
+
+// Returns the slot of the server tab, a free one is taken for a new tab. NULL if all are in use.
+static STATE_FILE_SERVER* StateFileSlot(STATE_FILE* file, uint64 serverConnectionHandlerID, int create)
+{
+    STATE_FILE_SERVER* free = NULL;
+
+    for (int i = 0; i < STATE_FILE_SERVERS; i++) {
+        STATE_FILE_SERVER* slot = &file->header->slots[i];
+
+        if (slot->serverConnectionHandlerID == serverConnectionHandlerID)
+            return slot;
+        if (free == NULL && slot->serverConnectionHandlerID == 0)
+            free = slot;
+    }
+    return create ? free : NULL;
+}
+
+// Sets the current speaker of a server tab, clientID 0 when nobody talks anymore
+void StateFileSetSpeaker(STATE_FILE* file, uint64 serverConnectionHandlerID, const char* serverUid, anyID clientID, const char* speaker,
+                         const char* speakerUid, unsigned int talkers, uint64 sinceMs)
+{
+    STATE_FILE_SERVER* slot;
+
+    if (file->header == NULL || serverConnectionHandlerID == 0)
+        return;
+    slot = StateFileSlot(file, serverConnectionHandlerID, 1);
+    if (slot == NULL)
+        return;
+    SlotBegin(slot);
+    slot->serverConnectionHandlerID = serverConnectionHandlerID;
+    slot->sinceMs                   = sinceMs;
+    slot->clientID                  = clientID;
+    slot->talkers                   = talkers;
+    snprintf(slot->serverUid, sizeof(slot->serverUid), "%s", serverUid);
+    snprintf(slot->speakerUid, sizeof(slot->speakerUid), "%s", speakerUid);
+    snprintf(slot->speaker, sizeof(slot->speaker), "%s", speaker);
+    SlotEnd(file, slot);
+}
+
+// Only the number of talking clients changed, the current speaker stays
+void StateFileSetTalkers(STATE_FILE* file, uint64 serverConnectionHandlerID, unsigned int talkers)
+{
+    STATE_FILE_SERVER* slot;
+
+    if (file->header == NULL || serverConnectionHandlerID == 0)
+        return;
+    slot = StateFileSlot(file, serverConnectionHandlerID, 0);
+    if (slot == NULL || slot->talkers == talkers)
+        return;
+    SlotBegin(slot);
+    slot->talkers = talkers;
+    SlotEnd(file, slot);
+}
+
+// Current speaker of a server tab as written before, 0 if nobody talks. The writer reads its own slots without the seqlock.
+anyID StateFileGetSpeaker(STATE_FILE* file, uint64 serverConnectionHandlerID)
+{
+    STATE_FILE_SERVER* slot;
+
+    if (file->header == NULL || serverConnectionHandlerID == 0)
+        return 0;
+    slot = StateFileSlot(file, serverConnectionHandlerID, 0);
+    return slot != NULL ? (anyID)slot->clientID : 0;
+}
+
+void StateFileRemoveServer(STATE_FILE* file, uint64 serverConnectionHandlerID)
+{
+    STATE_FILE_SERVER* slot;
+
+    if (file->header == NULL || serverConnectionHandlerID == 0)
+        return;
+    slot = StateFileSlot(file, serverConnectionHandlerID, 0);
+    if (slot == NULL)
+        return;
+    SlotBegin(slot);
+    SlotClear(slot);
+    SlotEnd(file, slot);
+}
+
+// Maps the state file read only. Returns 0 if it does not exist or has another layout.
+int StateFileAttach(STATE_FILE* file, const char* path)
+{
+    const STATE_FILE_HEADER* h;
+
+    memset(file, 0, sizeof(*file));
+    if (!StateFileMap(file, path, 0)) {
+        StateFileUnmap(file);
+        return 0;
+    }
+    h = file->header;
+    if (LoadAcquire(&h->magic) != STATE_FILE_MAGIC || h->version != STATE_FILE_VERSION || h->servers != STATE_FILE_SERVERS || h->slotSize != sizeof(STATE_FILE_SERVER)) {
+        StateFileUnmap(file);
+        return 0;
+    }
+    return 1;
+}
+
+void StateFileDetach(STATE_FILE* file)
+{
+    StateFileUnmap(file);
+}
+
+// Changes whenever a slot changed, one load
+uint64 StateFileUpdates(const STATE_FILE* file)
+{
+    return LoadAcquire(&file->header->updates);
+}
+
+// Copies a consistent snapshot of slot index. Returns 0 if the slot is free or the writer left it half written.
+int StateFileRead(const STATE_FILE* file, int index, STATE_FILE_SERVER* slot)
+{
+    const STATE_FILE_SERVER* shared = &file->header->slots[index];
+
+    for (int i = 0; i < STATE_FILE_READ_RETRIES; i++) {
+        uint64 before = LoadAcquire(&shared->sequence);
+
+        if ((before & 1) != 0)
+            continue;
+        memcpy(slot, (const void*)shared, sizeof(*slot));
+        FenceAcquire();
+        if (LoadAcquire(&shared->sequence) == before) {
+            // the copied strings were complete, but stay on the safe side for foreign writers
+            slot->serverUid[sizeof(slot->serverUid) - 1]   = '\0';
+            slot->speakerUid[sizeof(slot->speakerUid) - 1] = '\0';
+            slot->speaker[sizeof(slot->speaker) - 1]       = '\0';
+            return slot->serverConnectionHandlerID != 0;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef STATE_FILE_H
+#define STATE_FILE_H
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATE_FILE_MAGIC    0x7473326Cu // "l2st"
+#define STATE_FILE_VERSION  1
+#define STATE_FILE_SERVERS  32 // server tabs, like SERVER_SHARD_MAX
+#define STATE_FILE_NAME_LEN 128
+#define STATE_FILE_UID_LEN  64
+
+// Current speaker of one server tab. A slot is a seqlock of its own: sequence is odd while the plugin writes it,
+// a reader copies the slot and retries if sequence was odd or changed meanwhile. 512 bytes, so slots do not share
+// cache lines.
+typedef struct {
+    volatile uint64 sequence;
+    uint64          serverConnectionHandlerID; // 0 = slot free
+    uint64          sinceMs;                   // when the speaker became the current one, GetMonotonicTimeMs() of the plugin
+    unsigned int    clientID;                  // 0 = nobody talks
+    unsigned int    talkers;                   // clients talking right now, the speaker is the latest one
+    char            serverUid[STATE_FILE_UID_LEN];
+    char            speakerUid[STATE_FILE_UID_LEN];
+    char            speaker[STATE_FILE_NAME_LEN];
+    char            pad[224];
+} STATE_FILE_SERVER;
+
+// Layout of the state file. Only fixed size fields, so readers in any language can map it.
+typedef struct {
+    volatile uint64   magic; // STATE_FILE_MAGIC, stored last when the plugin sets up the file
+    unsigned int      version;
+    unsigned int      servers;   // STATE_FILE_SERVERS
+    unsigned int      slotSize;  // sizeof(STATE_FILE_SERVER)
+    int               writerPid; // 0 = the plugin is not running
+    volatile uint64   updates;   // incremented after every change, a reader only looks at the slots when it moved
+    char              pad[32];
+    STATE_FILE_SERVER slots[STATE_FILE_SERVERS];
+} STATE_FILE_HEADER;
+
+typedef struct {
+    STATE_FILE_HEADER* header;
+    size_t             mapSize;
+#ifdef _WIN32
+    HANDLE             file;
+    HANDLE             mapping;
+#else
+    int                fd;
+#endif
+} STATE_FILE;
+
+// Plugin side (single writer, callers serialize the updates themselves)
+int   StateFileOpen(STATE_FILE* file, const char* path);
+void  StateFileClose(STATE_FILE* file);
+void  StateFileSetSpeaker(STATE_FILE* file, uint64 serverConnectionHandlerID, const char* serverUid, anyID clientID, const char* speaker,
+                          const char* speakerUid, unsigned int talkers, uint64 sinceMs);
+void  StateFileSetTalkers(STATE_FILE* file, uint64 serverConnectionHandlerID, unsigned int talkers);
+anyID StateFileGetSpeaker(STATE_FILE* file, uint64 serverConnectionHandlerID);
+void  StateFileRemoveServer(STATE_FILE* file, uint64 serverConnectionHandlerID);
+
+// Reader side, never blocks the writer and needs no system call after StateFileAttach
+int    StateFileAttach(STATE_FILE* file, const char* path);
+void   StateFileDetach(STATE_FILE* file);
+uint64 StateFileUpdates(const STATE_FILE* file);
+int    StateFileRead(const STATE_FILE* file, int index, STATE_FILE_SERVER* slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATE_FILE_H
@@ -0,0 +1,150 @@
+#include "string_pool.h"
+#include "slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STRING_POOL_MIN_CAPACITY 256
+
+// FNV-1a
+static unsigned int StringPoolHash(const char* str)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *str != '\0'; str++) {
+        hash ^= (unsigned char)*str;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void StringPoolInit(STRING_POOL* pool)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->used = 1; // handle 0 is the empty string
+    MutexInit(&pool->lock);
+}
+
+void StringPoolFree(STRING_POOL* pool)
+{
+    for (unsigned int i = 1; i < pool->used; i++)
+        SlabFree(pool->entries[i].str);
+    free(pool->entries);
+    MutexDestroy(&pool->lock);
+    memset(pool, 0, sizeof(*pool));
+}
+
+// Returns a referenced handle for the string, STRING_HANDLE_NONE for "" or if out of memory
+STRING_HANDLE StringPoolIntern(STRING_POOL* pool, const char* str)
+{
+    unsigned int       hash;
+    unsigned int       bucket;
+    unsigned int       idx;
+    size_t             size;
+    STRING_POOL_ENTRY* e;
+
+    if (str == NULL || *str == '\0')
+        return STRING_HANDLE_NONE;
+
+    hash   = StringPoolHash(str);
+    bucket = hash & (STRING_POOL_BUCKETS - 1);
+
+    MutexLock(&pool->lock);
+    pool->interned++;
+    for (idx = pool->buckets[bucket]; idx != 0; idx = pool->entries[idx].next) {
+        e = &pool->entries[idx];
+        if (e->hash == hash && strcmp(e->str, str) == 0) {
+            e->refs++;
+            pool->shared++;
+            MutexUnlock(&pool->lock);
+            return idx;
+        }
+    }
+
+    if (pool->freeList != 0) {
+        idx            = pool->freeList;
+        pool->freeList = pool->entries[idx].next;
+    } else {
+        if (pool->used >= pool->capacity) {
+            unsigned int       capacity = pool->capacity ? pool->capacity * 2 : STRING_POOL_MIN_CAPACITY;
+            STRING_POOL_ENTRY* entries  = (STRING_POOL_ENTRY*)realloc(pool->entries, capacity * sizeof(STRING_POOL_ENTRY));
+            if (entries == NULL) {
+                MutexUnlock(&pool->lock);
+                return STRING_HANDLE_NONE;
+            }
+            pool->entries  = entries;
+            pool->capacity = capacity;
+        }
+        idx = pool->used++;
+    }
+
+    // every string has its own allocation, so pointers stay valid when the entry array grows
+    size   = strlen(str) + 1;
+    e      = &pool->entries[idx];
+    e->str = (char*)SlabAlloc(size);
+    if (e->str == NULL) {
+        e->next        = pool->freeList;
+        pool->freeList = idx;
+        MutexUnlock(&pool->lock);
+        return STRING_HANDLE_NONE;
+    }
+    memcpy(e->str, str, size);
+    e->hash               = hash;
+    e->refs               = 1;
+    e->next               = pool->buckets[bucket];
+    pool->buckets[bucket] = idx;
+    pool->count++;
+    pool->bytes += size;
+    MutexUnlock(&pool->lock);
+    return idx;
+}
+
+// Adds a reference, e.g. when a record holding the handle is copied
+STRING_HANDLE StringPoolRetain(STRING_POOL* pool, STRING_HANDLE handle)
+{
+    if (handle == STRING_HANDLE_NONE)
+        return handle;
+    MutexLock(&pool->lock);
+    pool->entries[handle].refs++;
+    MutexUnlock(&pool->lock);
+    return handle;
+}
+
+// Drops a reference, the string is freed with the last one and its handle may be handed out again
+void StringPoolRelease(STRING_POOL* pool, STRING_HANDLE handle)
+{
+    STRING_POOL_ENTRY* e;
+
+    if (handle == STRING_HANDLE_NONE)
+        return;
+
+    MutexLock(&pool->lock);
+    e = &pool->entries[handle];
+    if (--e->refs == 0) {
+        unsigned int* link = &pool->buckets[e->hash & (STRING_POOL_BUCKETS - 1)];
+        while (*link != handle)
+            link = &pool->entries[*link].next;
+        *link = e->next;
+
+        pool->count--;
+        pool->bytes -= strlen(e->str) + 1;
+        SlabFree(e->str);
+        e->str         = NULL;
+        e->next        = pool->freeList;
+        pool->freeList = handle;
+    }
+    MutexUnlock(&pool->lock);
+}
+
+// The returned string stays valid as long as the caller holds a reference to the handle
+const char* StringPoolGet(STRING_POOL* pool, STRING_HANDLE handle)
+{
+    const char* str;
+
+    if (handle == STRING_HANDLE_NONE)
+        return "";
+    MutexLock(&pool->lock);
+    str = pool->entries[handle].str;
+    MutexUnlock(&pool->lock);
+    return str;
+}
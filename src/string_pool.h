@@ -0,0 +1,51 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STRING_POOL_BUCKETS 1024 // power of two
+
+// 4 byte reference to an interned string, equal strings have equal handles
+typedef unsigned int STRING_HANDLE;
+
+#define STRING_HANDLE_NONE 0 // the empty string, needs no reference
+
+typedef struct {
+    char*        str;
+    unsigned int hash;
+    unsigned int refs;
+    unsigned int next; // hash chain, or free list while unused
+} STRING_POOL_ENTRY;
+
+// Refcounted pool of nicknames and UIDs shared by all caches. Thread safe, it has its own lock
+// which is always taken after cacheLock, never before.
+typedef struct {
+    STRING_POOL_ENTRY* entries; // indexed by handle, entry 0 is never used
+    unsigned int       capacity;
+    unsigned int       used;     // entries handed out so far, including freed ones
+    unsigned int       freeList;
+    unsigned int       buckets[STRING_POOL_BUCKETS];
+    PLATFORM_MUTEX     lock;
+
+    unsigned int       count; // live strings
+    unsigned long long bytes; // memory of the live strings
+    unsigned long long interned;
+    unsigned long long shared; // interns which found the string already in the pool
+} STRING_POOL;
+
+void          StringPoolInit(STRING_POOL* pool);
+void          StringPoolFree(STRING_POOL* pool);
+STRING_HANDLE StringPoolIntern(STRING_POOL* pool, const char* str);
+STRING_HANDLE StringPoolRetain(STRING_POOL* pool, STRING_HANDLE handle);
+void          StringPoolRelease(STRING_POOL* pool, STRING_HANDLE handle);
+const char*   StringPoolGet(STRING_POOL* pool, STRING_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STRING_POOL_H
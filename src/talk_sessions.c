@@ -0,0 +1,146 @@
+#include "talk_sessions.h"
+
+#include <string.h>
+
+#define TALK_SESSIONS_MASK     (TALK_SESSIONS_CAPACITY - 1)
+#define TALK_SESSIONS_MAX_LOAD (TALK_SESSIONS_CAPACITY / 4 * 3) // keeps probe sequences short
+
+static unsigned int TalkSessionsHash(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    uint64 key = (serverConnectionHandlerID << 16) ^ clientID;
+
+    // 64 bit finalizer (splitmix64), spreads consecutive client IDs over all slots
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (unsigned int)(key & TALK_SESSIONS_MASK);
+}
+
+// Linear probing, returns the slot of the client or the empty slot where it has to be inserted
+static unsigned int TalkSessionsSearch(const TALK_SESSIONS* table, uint64 serverConnectionHandlerID, anyID clientID, int* found)
+{
+    unsigned int idx = TalkSessionsHash(serverConnectionHandlerID, clientID);
+
+    // the load limit guarantees an empty slot, so the loop always ends
+    while (table->slots[idx].serverConnectionHandlerID != 0) {
+        if (table->slots[idx].serverConnectionHandlerID == serverConnectionHandlerID && table->slots[idx].clientID == clientID) {
+            *found = 1;
+            return idx;
+        }
+        idx = (idx + 1) & TALK_SESSIONS_MASK;
+    }
+    *found = 0;
+    return idx;
+}
+
+// Backward shift deletion, moves following entries of the probe sequence up instead of leaving tombstones
+static void TalkSessionsRemoveAt(TALK_SESSIONS* table, unsigned int idx)
+{
+    unsigned int next = idx;
+
+    for (;;) {
+        unsigned int home;
+
+        next = (next + 1) & TALK_SESSIONS_MASK;
+        if (table->slots[next].serverConnectionHandlerID == 0)
+            break;
+
+        // the entry stays if its home slot lies cyclically in (idx, next]
+        home = TalkSessionsHash(table->slots[next].serverConnectionHandlerID, table->slots[next].clientID);
+        if (idx <= next ? (idx < home && home <= next) : (idx < home || home <= next))
+            continue;
+
+        table->slots[idx] = table->slots[next];
+        idx               = next;
+    }
+    table->slots[idx].serverConnectionHandlerID = 0;
+    table->count--;
+}
+
+void TalkSessionsInit(TALK_SESSIONS* table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+// Starts a talk burst, returns 0 if the client is already talking or the table is full.
+// An entry of an earlier connection epoch belongs to a client which had the same ID before and is reset.
+int TalkSessionsStart(TALK_SESSIONS* table, uint64 serverConnectionHandlerID, anyID clientID, unsigned int epoch, uint64 nowMs, TALK_INFO* info)
+{
+    int           found;
+    unsigned int  idx = TalkSessionsSearch(table, serverConnectionHandlerID, clientID, &found);
+    TALK_SESSION* s   = &table->slots[idx];
+
+    info->durationMs = 0;
+    info->bursts     = 0;
+
+    if (!found) {
+        if (table->count >= TALK_SESSIONS_MAX_LOAD)
+            return 0;
+        s->serverConnectionHandlerID = serverConnectionHandlerID;
+        s->clientID                  = clientID;
+        s->epoch                     = epoch;
+        s->startMs                   = 0;
+        s->bursts                    = 0;
+        table->count++;
+    } else if (s->epoch != epoch) {
+        s->epoch   = epoch;
+        s->startMs = 0;
+        s->bursts  = 0;
+    }
+
+    info->bursts = s->bursts;
+    if (s->startMs != 0)
+        return 0;
+
+    s->startMs   = nowMs != 0 ? nowMs : 1;
+    info->bursts = ++s->bursts;
+    return 1;
+}
+
+// Ends the running talk burst, returns 0 if no burst of this connection epoch was running
+int TalkSessionsStop(TALK_SESSIONS* table, uint64 serverConnectionHandlerID, anyID clientID, unsigned int epoch, uint64 nowMs, TALK_INFO* info)
+{
+    int           found;
+    unsigned int  idx = TalkSessionsSearch(table, serverConnectionHandlerID, clientID, &found);
+    TALK_SESSION* s   = &table->slots[idx];
+
+    info->durationMs = 0;
+    info->bursts     = 0;
+
+    if (!found || s->epoch != epoch || s->startMs == 0)
+        return 0;
+
+    info->durationMs = nowMs > s->startMs ? nowMs - s->startMs : 0;
+    info->bursts     = s->bursts;
+    s->startMs       = 0;
+    return 1;
+}
+
+// The client left the server, its ID may be handed out again
+void TalkSessionsRemove(TALK_SESSIONS* table, uint64 serverConnectionHandlerID, anyID clientID)
+{
+    int          found;
+    unsigned int idx = TalkSessionsSearch(table, serverConnectionHandlerID, clientID, &found);
+
+    if (found)
+        TalkSessionsRemoveAt(table, idx);
+}
+
+// Frees all slots of a disconnected server tab, walks the whole table and is meant for rare events only
+void TalkSessionsRemoveServer(TALK_SESSIONS* table, uint64 serverConnectionHandlerID)
+{
+    unsigned int idx = 0;
+
+    if (serverConnectionHandlerID == 0)
+        return;
+
+    while (idx < TALK_SESSIONS_CAPACITY) {
+        // a removal may shift the next entry into this slot, so check it again
+        if (table->slots[idx].serverConnectionHandlerID == serverConnectionHandlerID)
+            TalkSessionsRemoveAt(table, idx);
+        else
+            idx++;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef TALK_SESSIONS_H
+#define TALK_SESSIONS_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Slots of the open addressing table, power of two. Clients that never talked take no slot.
+#define TALK_SESSIONS_CAPACITY 4096
+
+// Talk state of one client while it stays on the server, keyed by (server tab, client ID)
+typedef struct {
+    uint64       serverConnectionHandlerID; // 0 = empty slot
+    uint64       startMs;                   // monotonic start of the running burst, 0 = not talking
+    unsigned int epoch;                     // connection epoch of the server tab the entry belongs to
+    unsigned int bursts;                    // talk bursts since the client was first heard
+    anyID        clientID;
+} TALK_SESSION;
+
+typedef struct {
+    TALK_SESSION slots[TALK_SESSIONS_CAPACITY];
+    int          count;
+} TALK_SESSIONS;
+
+// Result of a start or stop event
+typedef struct {
+    uint64       durationMs; // length of the finished burst, 0 on start
+    unsigned int bursts;     // number of the current or finished burst
+} TALK_INFO;
+
+void TalkSessionsInit(TALK_SESSIONS* table);
+int  TalkSessionsStart(TALK_SESSIONS* table, uint64 serverConnectionHandlerID, anyID clientID, unsigned int epoch, uint64 nowMs, TALK_INFO* info);
+int  TalkSessionsStop(TALK_SESSIONS* table, uint64 serverConnectionHandlerID, anyID clientID, unsigned int epoch, uint64 nowMs, TALK_INFO* info);
+void TalkSessionsRemove(TALK_SESSIONS* table, uint64 serverConnectionHandlerID, anyID clientID);
+void TalkSessionsRemoveServer(TALK_SESSIONS* table, uint64 serverConnectionHandlerID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TALK_SESSIONS_H
@@ -0,0 +1,247 @@
+#include "text_escape.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_ESCAPE_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#define ESCAPE_JSON   0
+#define ESCAPE_BBCODE 1
+#define ESCAPE_SHELL  2
+
+static const char replacementChar[] = "\xEF\xBF\xBD"; // U+FFFD
+static const char zeroWidthSpace[]  = "\xE2\x80\x8B"; // U+200B
+
+static int IsSpecial(unsigned char c, int mode)
+{
+    switch (mode) {
+    case ESCAPE_JSON:
+        return c < 0x20 || c >= 0x80 || c == '"' || c == '\\';
+    case ESCAPE_BBCODE:
+        return c < 0x20 || c >= 0x80 || c == '[';
+    default:
+        return c < 0x20 || c == '"' || c == '\\' || c == '$' || c == '`';
+    }
+}
+
+#ifdef TEXT_ESCAPE_SSE2
+static unsigned int FirstBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+// One bit per byte of the 16 byte block which needs the slow path
+static unsigned int SpecialMask(const char* p, int mode)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    // signed compare, catches control characters and all bytes >= 0x80 at once
+    __m128i m = _mm_cmplt_epi8(v, _mm_set1_epi8(0x20));
+
+    switch (mode) {
+    case ESCAPE_JSON:
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        break;
+    case ESCAPE_BBCODE:
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('[')));
+        break;
+    default:
+        // UTF-8 passes the shell unchanged, keep only the control characters
+        m = _mm_and_si128(m, _mm_cmpgt_epi8(v, _mm_set1_epi8(-1)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('$')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('`')));
+        break;
+    }
+    return (unsigned int)_mm_movemask_epi8(m);
+}
+#endif
+
+// Length of the valid UTF-8 sequence at p, 0 if invalid (overlong, surrogate, above U+10FFFF or cut off)
+static size_t Utf8SequenceLength(const unsigned char* p, size_t n)
+{
+    size_t need;
+
+    if (p[0] >= 0xC2 && p[0] <= 0xDF)
+        need = 2;
+    else if (p[0] >= 0xE0 && p[0] <= 0xEF)
+        need = 3;
+    else if (p[0] >= 0xF0 && p[0] <= 0xF4)
+        need = 4;
+    else
+        return 0;
+
+    if (n < need)
+        return 0;
+    for (size_t k = 1; k < need; k++) {
+        if ((p[k] & 0xC0) != 0x80)
+            return 0;
+    }
+    if ((p[0] == 0xE0 && p[1] < 0xA0) || (p[0] == 0xED && p[1] > 0x9F) || (p[0] == 0xF0 && p[1] < 0x90) || (p[0] == 0xF4 && p[1] > 0x8F))
+        return 0;
+    return need;
+}
+
+// Appends bytes only if they fit completely, returns 0 otherwise
+static int Put(char* out, size_t outSize, size_t* len, const char* s, size_t n)
+{
+    if (*len + n >= outSize)
+        return 0;
+    memcpy(out + *len, s, n);
+    *len += n;
+    return 1;
+}
+
+// Writes the replacement for the special byte(s) at in[i], returns the number of input bytes consumed or 0 if the output is full
+static size_t EscapeSpecial(const char* in, size_t i, size_t n, char* out, size_t outSize, size_t* len, int mode)
+{
+    unsigned char c = (unsigned char)in[i];
+    char          buf[8];
+
+    if (c >= 0x80) {
+        size_t seq = Utf8SequenceLength((const unsigned char*)in + i, n - i);
+        if (seq == 0)
+            return Put(out, outSize, len, replacementChar, 3) ? 1 : 0;
+        return Put(out, outSize, len, in + i, seq) ? seq : 0;
+    }
+
+    if (mode == ESCAPE_JSON) {
+        switch (c) {
+        case '"':  return Put(out, outSize, len, "\\\"", 2);
+        case '\\': return Put(out, outSize, len, "\\\\", 2);
+        case '\b': return Put(out, outSize, len, "\\b", 2);
+        case '\f': return Put(out, outSize, len, "\\f", 2);
+        case '\n': return Put(out, outSize, len, "\\n", 2);
+        case '\r': return Put(out, outSize, len, "\\r", 2);
+        case '\t': return Put(out, outSize, len, "\\t", 2);
+        default:
+            buf[0] = '\\';
+            buf[1] = 'u';
+            buf[2] = '0';
+            buf[3] = '0';
+            buf[4] = "0123456789abcdef"[c >> 4];
+            buf[5] = "0123456789abcdef"[c & 0x0F];
+            return Put(out, outSize, len, buf, 6);
+        }
+    }
+
+    if (mode == ESCAPE_BBCODE) {
+        // TS3 has no BBCode escape, a zero width space after '[' keeps the text but breaks the tag
+        if (c == '[') {
+            if (*len + 4 >= outSize)
+                return 0;
+            out[(*len)++] = '[';
+            return Put(out, outSize, len, zeroWidthSpace, 3);
+        }
+        return Put(out, outSize, len, " ", 1);
+    }
+
+    if (c < 0x20)
+        return Put(out, outSize, len, "_", 1);
+#ifdef _WIN32
+    // CreateProcess rules: backslashes are literal unless they precede a quote (or the closing quote)
+    if (c == '\\') {
+        size_t run = 0;
+        while (i + run < n && in[i + run] == '\\')
+            run++;
+        size_t count = (i + run == n || in[i + run] == '"') ? run * 2 : run;
+        if (*len + count >= outSize)
+            return 0;
+        memset(out + *len, '\\', count);
+        *len += count;
+        return run;
+    }
+    if (c == '"')
+        return Put(out, outSize, len, "\\\"", 2);
+    buf[0] = (char)c; // $ and ` have no special meaning for CreateProcess
+    return Put(out, outSize, len, buf, 1);
+#else
+    buf[0] = '\\';
+    buf[1] = (char)c;
+    return Put(out, outSize, len, buf, 2);
+#endif
+}
+
+static size_t Escape(const char* in, char* out, size_t outSize, int mode)
+{
+    size_t n   = strlen(in);
+    size_t i   = 0;
+    size_t len = 0;
+
+    if (outSize == 0)
+        return 0;
+
+    while (i < n) {
+        size_t consumed;
+
+#ifdef TEXT_ESCAPE_SSE2
+        if (n - i >= 16) {
+            unsigned int mask = SpecialMask(in + i, mode);
+            size_t       run  = mask == 0 ? 16 : FirstBit(mask);
+
+            if (len + run >= outSize) {
+                memcpy(out + len, in + i, outSize - 1 - len);
+                len = outSize - 1;
+                break;
+            }
+            memcpy(out + len, in + i, run);
+            len += run;
+            i += run;
+            if (mask == 0)
+                continue;
+        } else
+#endif
+        {
+            // short names and the tail after the last block, the clean run is still copied at once
+            size_t run = 0;
+
+            while (i + run < n && !IsSpecial((unsigned char)in[i + run], mode))
+                run++;
+            if (run > 0) {
+                if (len + run >= outSize) {
+                    memcpy(out + len, in + i, outSize - 1 - len);
+                    len = outSize - 1;
+                    break;
+                }
+                memcpy(out + len, in + i, run);
+                len += run;
+                i += run;
+                continue;
+            }
+        }
+
+        consumed = EscapeSpecial(in, i, n, out, outSize, &len, mode);
+        if (consumed == 0)
+            break;
+        i += consumed;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+size_t EscapeJsonString(const char* in, char* out, size_t outSize)
+{
+    return Escape(in, out, outSize, ESCAPE_JSON);
+}
+
+size_t EscapeBBCode(const char* in, char* out, size_t outSize)
+{
+    return Escape(in, out, outSize, ESCAPE_BBCODE);
+}
+
+size_t EscapeShellArgument(const char* in, char* out, size_t outSize)
+{
+    return Escape(in, out, outSize, ESCAPE_SHELL);
+}
@@ -0,0 +1,27 @@
+#ifndef TEXT_ESCAPE_H
+#define TEXT_ESCAPE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// All functions write a NUL terminated result and return its length. If the output is too small the result
+// is cut off before the first escape or UTF-8 sequence that does not fit completely.
+// Clean runs of 16 bytes are copied in bulk (SSE2 where available), only special bytes take the slow path.
+
+// Content of a JSON string (without the surrounding quotes), invalid UTF-8 is replaced by U+FFFD
+size_t EscapeJsonString(const char* in, char* out, size_t outSize);
+
+// Text for the channel tab that cannot open BBCode tags, invalid UTF-8 is replaced by U+FFFD
+size_t EscapeBBCode(const char* in, char* out, size_t outSize);
+
+// Argument inside double quotes of a shell command (sh on Linux, CreateProcess on Windows)
+size_t EscapeShellArgument(const char* in, char* out, size_t outSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TEXT_ESCAPE_H
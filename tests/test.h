@@ -0,0 +1,31 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+// Minimal checks for the behaviour tests, a failed check is printed and the test goes on. main returns TEST_RESULT().
+static int testChecks   = 0;
+static int testFailures = 0;
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        testChecks++;                                                             \
+        if (!(cond)) {                                                            \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);       \
+            testFailures++;                                                       \
+        }                                                                         \
+    } while (0)
+
+#define CHECK_STR(actual, expected)                                                                        \
+    do {                                                                                                   \
+        testChecks++;                                                                                      \
+        if (strcmp((actual), (expected)) != 0) {                                                           \
+            printf("%s:%d: check failed: \"%s\" != \"%s\"\n", __FILE__, __LINE__, (actual), (expected));   \
+            testFailures++;                                                                                \
+        }                                                                                                  \
+    } while (0)
+
+#define TEST_RESULT() (printf("%s: %d checks, %d failed\n", __FILE__, testChecks, testFailures), testFailures != 0)
+
+#endif // TEST_H
@@ -0,0 +1,62 @@
+/*
+ * Behaviour of active_speakers.c: speakers kept sorted by channel and client, the sequence advancing only on real
+ * changes, channel switches while talking and the grouped format cut off after the last complete speaker.
+ */
+
+#include "test.h"
+#include "active_speakers.h"
+
+static void TestChanges(ACTIVE_SPEAKERS* set)
+{
+    char   out[64];
+    uint64 channelID = 0;
+
+    CHECK(ActiveSpeakersAdd(set, 7, 30));
+    CHECK(ActiveSpeakersAdd(set, 5, 12));
+    CHECK(ActiveSpeakersAdd(set, 2, 30));
+    CHECK(ActiveSpeakersAdd(set, 9, 12));
+    CHECK(!ActiveSpeakersAdd(set, 7, 12));
+    CHECK(set->sequence == 4);
+    ActiveSpeakersFormat(set, out, sizeof(out));
+    CHECK_STR(out, "12:5,9|30:2,7");
+
+    CHECK(ActiveSpeakersMove(set, 9, 30));
+    CHECK(!ActiveSpeakersMove(set, 9, 30));
+    CHECK(!ActiveSpeakersMove(set, 1, 30));
+    ActiveSpeakersFormat(set, out, sizeof(out));
+    CHECK_STR(out, "12:5|30:2,7,9");
+
+    CHECK(ActiveSpeakersRemove(set, 5, &channelID) && channelID == 12);
+    CHECK(!ActiveSpeakersRemove(set, 5, NULL));
+    CHECK(set->sequence == 6);
+    CHECK(ActiveSpeakersFormat(set, out, sizeof(out)) == strlen("30:2,7,9"));
+    CHECK_STR(out, "30:2,7,9");
+
+    // cut off after the last speaker that fits
+    CHECK(ActiveSpeakersFormat(set, out, 8) == 6);
+    CHECK_STR(out, "30:2,7");
+}
+
+static void TestFull(ACTIVE_SPEAKERS* set)
+{
+    ActiveSpeakersInit(set);
+    for (int i = 0; i < ACTIVE_SPEAKERS_MAX; i++)
+        CHECK(ActiveSpeakersAdd(set, (anyID)(ACTIVE_SPEAKERS_MAX - i), (uint64)(i % 3)));
+    CHECK(!ActiveSpeakersAdd(set, 1000, 1));
+    CHECK(set->count == ACTIVE_SPEAKERS_MAX);
+    for (int i = 1; i < set->count; i++) {
+        const ACTIVE_SPEAKER* a = &set->speakers[i - 1];
+        const ACTIVE_SPEAKER* b = &set->speakers[i];
+        CHECK(a->channelID < b->channelID || (a->channelID == b->channelID && a->clientID < b->clientID));
+    }
+}
+
+int main(void)
+{
+    ACTIVE_SPEAKERS set;
+
+    ActiveSpeakersInit(&set);
+    TestChanges(&set);
+    TestFull(&set);
+    return TEST_RESULT();
+}
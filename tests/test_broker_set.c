@@ -0,0 +1,216 @@
+/*
+ * Behaviour of broker_set.c: parsing of the HOST list, failover to the next healthy broker and round robin without
+ * one, switching to a clearly faster standby but not on jitter, a new list starting over, and the probe worker
+ * measuring a standby (a fake broker on the loopback) and marking an unreachable one unhealthy.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "test.h"
+#include "broker_set.h"
+
+typedef struct {
+    int listenFd;
+    int pings;
+} FAKE_BROKER;
+
+static int ReadFull(int fd, unsigned char* buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = recv(fd, buf, size, 0);
+        if (n <= 0)
+            return 0;
+        buf  += n;
+        size -= (size_t)n;
+    }
+    return 1;
+}
+
+// Accepts one client, acknowledges its CONNECT and answers every PINGREQ until the client hangs up
+static void FakeBrokerWorker(void* arg)
+{
+    FAKE_BROKER*  broker = (FAKE_BROKER*)arg;
+    unsigned char header;
+    unsigned char body[1024];
+    int           fd     = accept(broker->listenFd, NULL, NULL);
+
+    while (fd >= 0 && ReadFull(fd, &header, 1)) {
+        size_t        len   = 0;
+        int           shift = 0;
+        unsigned char byte;
+
+        do {
+            if (!ReadFull(fd, &byte, 1))
+                goto done;
+            len   |= (size_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while ((byte & 0x80) != 0 && shift < 28);
+        if (len > sizeof(body) || !ReadFull(fd, body, len))
+            break;
+        if (header == 0x10) {
+            static const unsigned char connack[] = { 0x20, 0x02, 0x00, 0x00 };
+            send(fd, connack, sizeof(connack), MSG_NOSIGNAL);
+        } else if (header == 0xC0) {
+            static const unsigned char pingresp[] = { 0xD0, 0x00 };
+            broker->pings++;
+            send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL);
+        }
+    }
+done:
+    if (fd >= 0)
+        close(fd);
+}
+
+static void TestConfigure(void)
+{
+    BROKER_SET   set;
+    BROKER_STATS stats;
+    char         host[128];
+
+    CHECK(BrokerSetStart(&set, NULL));
+    BrokerSetConfigure(&set, " alpha , beta,,\tgamma ,delta,epsilon", "1883", "", "", 0);
+    BrokerSetGetStats(&set, &stats);
+    CHECK(stats.count == BROKER_MAX && stats.active == -1);
+    CHECK_STR(set.brokers[0].host, "alpha");
+    CHECK_STR(set.brokers[2].host, "gamma");
+    CHECK_STR(set.brokers[3].host, "delta");
+
+    // the first broker is preferred while nothing is known, choosing it is not a failover
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+    CHECK_STR(host, "alpha");
+    BrokerSetGetStats(&set, &stats);
+    CHECK(stats.active == 0 && stats.failovers == 0);
+
+    BrokerSetConfigure(&set, "", "1883", "", "", 0);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == -1);
+    BrokerSetStop(&set);
+}
+
+static void TestFailover(void)
+{
+    BROKER_SET   set;
+    BROKER_STATS stats;
+    char         host[128];
+
+    CHECK(BrokerSetStart(&set, NULL));
+    BrokerSetConfigure(&set, "a,b,c", "1883", "", "", 0);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+    BrokerSetReport(&set, 0, 0, BROKER_NO_RTT);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 1);
+    CHECK_STR(host, "b");
+
+    // a healthy active broker is kept even when an earlier one recovers
+    BrokerSetReport(&set, 0, 1, BROKER_NO_RTT);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 1);
+
+    // without any healthy broker the list is tried round robin
+    for (int i = 0; i < 3; i++)
+        BrokerSetReport(&set, i, 0, BROKER_NO_RTT);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 2);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+    BrokerSetGetStats(&set, &stats);
+    CHECK(stats.failovers == 3);
+    CHECK(!stats.healthy[0] && !stats.healthy[1] && !stats.healthy[2]);
+
+    // reports out of range are ignored
+    BrokerSetReport(&set, 3, 1, 5);
+    BrokerSetReport(&set, -1, 1, 5);
+    BrokerSetGetStats(&set, &stats);
+    CHECK(!stats.healthy[0] && !stats.healthy[1] && !stats.healthy[2]);
+    BrokerSetStop(&set);
+}
+
+static void TestFasterStandby(void)
+{
+    BROKER_SET   set;
+    BROKER_STATS stats;
+    char         host[128];
+
+    CHECK(BrokerSetStart(&set, NULL));
+    BrokerSetConfigure(&set, "a,b", "1883", "", "", 0);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+    BrokerSetReport(&set, 0, 1, 100);
+
+    // jitter: not below BROKER_SWITCH_PCT of the active RTT
+    BrokerSetReport(&set, 1, 1, 60);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+
+    // the RTT is smoothed, (3 * 60 + 4) / 4 = 46
+    BrokerSetReport(&set, 1, 1, 4);
+    BrokerSetGetStats(&set, &stats);
+    CHECK(stats.rttMs[1] == 46);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 1);
+    CHECK_STR(host, "b");
+
+    // fast brokers: the share alone is not enough without BROKER_SWITCH_MIN_MS
+    BrokerSetConfigure(&set, "a,b", "1883", "", "", 0);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+    BrokerSetReport(&set, 0, 1, 12);
+    BrokerSetReport(&set, 1, 1, 4);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+    BrokerSetGetStats(&set, &stats);
+    CHECK(stats.failovers == 1);
+    BrokerSetStop(&set);
+}
+
+static void TestProbe(void)
+{
+    FAKE_BROKER        fake;
+    PLATFORM_THREAD    thread;
+    BROKER_SET         set;
+    BROKER_STATS       stats;
+    struct sockaddr_in addr;
+    socklen_t          addrLen = sizeof(addr);
+    char               port[16];
+    char               hosts[128];
+    char               host[128];
+    uint64             until;
+
+    memset(&fake, 0, sizeof(fake));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fake.listenFd        = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(fake.listenFd >= 0);
+    CHECK(bind(fake.listenFd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    CHECK(listen(fake.listenFd, 4) == 0);
+    CHECK(getsockname(fake.listenFd, (struct sockaddr*)&addr, &addrLen) == 0);
+    snprintf(port, sizeof(port), "%d", ntohs(addr.sin_port));
+    CHECK(ThreadStart(&thread, FakeBrokerWorker, &fake));
+
+    // the active broker is left to the daemon, the standbys are probed right away
+    snprintf(hosts, sizeof(hosts), "primary,127.0.0.1,unix:/tmp/lh2mqtt-missing-%d", (int)getpid());
+    CHECK(BrokerSetStart(&set, NULL));
+    BrokerSetConfigure(&set, hosts, port, "", "", 1);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 0);
+    until = GetMonotonicTimeMs() + 5000;
+    do {
+        usleep(10000);
+        BrokerSetGetStats(&set, &stats);
+    } while ((stats.rttMs[1] == BROKER_NO_RTT || stats.healthy[2]) && GetMonotonicTimeMs() < until);
+    CHECK(stats.healthy[0] && stats.rttMs[0] == BROKER_NO_RTT);
+    CHECK(stats.healthy[1] && stats.rttMs[1] != BROKER_NO_RTT);
+    CHECK(!stats.healthy[2]);
+    CHECK(fake.pings >= 1);
+
+    // the measured standby takes over from the failed active broker
+    BrokerSetReport(&set, 0, 0, BROKER_NO_RTT);
+    CHECK(BrokerSetSelect(&set, host, sizeof(host)) == 1);
+    CHECK_STR(host, "127.0.0.1");
+    BrokerSetStop(&set);
+
+    ThreadJoin(&thread);
+    close(fake.listenFd);
+}
+
+int main(void)
+{
+    TestConfigure();
+    TestFailover();
+    TestFasterStandby();
+    TestProbe();
+    return TEST_RESULT();
+}
@@ -0,0 +1,79 @@
+/*
+ * Behaviour of channel_cache.c: full paths built from the cached parents, stale paths after a rename or move,
+ * missing parents, removal with tombstones and growth of the open addressed table, channels of different server
+ * tabs kept apart.
+ */
+
+#include "test.h"
+#include "channel_cache.h"
+#include "slab.h"
+
+static void TestPaths(CHANNEL_CACHE* cache)
+{
+    ChannelCacheSet(cache, 1, 1, 0, "Lobby");
+    ChannelCacheSet(cache, 1, 2, 1, "Ops");
+    ChannelCacheSet(cache, 1, 3, 2, "Night");
+    ChannelCacheSet(cache, 2, 3, 0, "Other");
+    CHECK_STR(ChannelCacheGetPath(cache, 1, 3), "Lobby/Ops/Night");
+    CHECK_STR(ChannelCacheGetPath(cache, 2, 3), "Other");
+    CHECK(ChannelCacheGetPath(cache, 2, 1) == NULL);
+
+    CHECK(ChannelCacheRename(cache, 1, 2, "Ops & Admin"));
+    CHECK_STR(ChannelCacheGetPath(cache, 1, 3), "Lobby/Ops & Admin/Night");
+    CHECK(!ChannelCacheRename(cache, 1, 9, "x"));
+
+    ChannelCacheSet(cache, 1, 4, 0, "Afk");
+    CHECK(ChannelCacheMove(cache, 1, 2, 4));
+    CHECK_STR(ChannelCacheGetPath(cache, 1, 3), "Afk/Ops & Admin/Night");
+    CHECK(!ChannelCacheMove(cache, 1, 9, 4));
+}
+
+static void TestMissing(CHANNEL_CACHE* cache)
+{
+    ChannelCacheSet(cache, 3, 12, 11, "Leaf");
+    ChannelCacheSet(cache, 3, 11, 10, "Middle");
+    CHECK(ChannelCacheGetPath(cache, 3, 12) == NULL);
+    CHECK(ChannelCacheFirstMissing(cache, 3, 12) == 10);
+    ChannelCacheSet(cache, 3, 10, 0, "Root");
+    CHECK(ChannelCacheFirstMissing(cache, 3, 12) == 0);
+    CHECK_STR(ChannelCacheGetPath(cache, 3, 12), "Root/Middle/Leaf");
+
+    // a parent loop ends at the depth limit instead of hanging
+    ChannelCacheSet(cache, 4, 20, 21, "A");
+    ChannelCacheSet(cache, 4, 21, 20, "B");
+    CHECK(ChannelCacheGetPath(cache, 4, 20) == NULL);
+}
+
+static void TestRemoveAndGrow(CHANNEL_CACHE* cache)
+{
+    unsigned int count = cache->count;
+
+    ChannelCacheRemove(cache, 1, 3);
+    CHECK(!ChannelCacheContains(cache, 1, 3));
+    CHECK(ChannelCacheContains(cache, 2, 3));
+    CHECK(cache->count == count - 1);
+
+    // enough channels to resize several times, all stay reachable across the tombstone
+    for (uint64 id = 100; id < 1100; id++)
+        ChannelCacheSet(cache, 5, id, id > 100 ? 100 : 0, "c");
+    CHECK(cache->count == count - 1 + 1000);
+    CHECK(cache->count * 4 <= cache->capacity * 3);
+    for (uint64 id = 100; id < 1100; id++)
+        CHECK(ChannelCacheContains(cache, 5, id));
+    CHECK(ChannelCacheContains(cache, 1, 2));
+    CHECK_STR(ChannelCacheGetPath(cache, 5, 1099), "c/c");
+}
+
+int main(void)
+{
+    CHANNEL_CACHE cache;
+
+    SlabInit();
+    ChannelCacheInit(&cache);
+    TestPaths(&cache);
+    TestMissing(&cache);
+    TestRemoveAndGrow(&cache);
+    ChannelCacheFree(&cache);
+    SlabShutdown();
+    return TEST_RESULT();
+}
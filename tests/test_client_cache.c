@@ -0,0 +1,113 @@
+/*
+ * Behaviour of client_cache.c: lookups per server tab and client, eviction of the least recently used client once
+ * the cache is full, channel updates and removal, server groups and the string references an entry holds.
+ */
+
+#include "test.h"
+#include "client_cache.h"
+#include "slab.h"
+
+static void TestLookup(CLIENT_CACHE* cache)
+{
+    CLIENT_CACHE_ENTRY* e = ClientCacheInsert(cache, 1, 7);
+
+    e->channelID = 42;
+    CHECK(ClientCacheLookup(cache, 1, 7) == e);
+    CHECK(ClientCacheLookup(cache, 2, 7) == NULL);
+    CHECK(ClientCacheLookup(cache, 1, 8) == NULL);
+    CHECK(cache->hits == 1 && cache->misses == 2);
+
+    // inserting again clears the entry
+    e = ClientCacheInsert(cache, 1, 7);
+    CHECK(e->channelID == 0 && cache->count == 1);
+
+    ClientCacheInvalidate(cache, 1, 7);
+    CHECK(ClientCacheFind(cache, 1, 7) == NULL && cache->count == 0);
+}
+
+static void TestEviction(CLIENT_CACHE* cache)
+{
+    for (int i = 0; i < CLIENT_CACHE_CAPACITY; i++)
+        ClientCacheInsert(cache, 1, (anyID)(i + 1));
+    CHECK(cache->count == CLIENT_CACHE_CAPACITY && cache->evictions == 0);
+
+    // client 1 was used last, client 2 is the oldest now
+    CHECK(ClientCacheLookup(cache, 1, 1) != NULL);
+    ClientCacheInsert(cache, 1, 1000);
+    CHECK(cache->evictions == 1 && cache->count == CLIENT_CACHE_CAPACITY);
+    CHECK(ClientCacheFind(cache, 1, 2) == NULL);
+    CHECK(ClientCacheFind(cache, 1, 1) != NULL);
+    CHECK(ClientCacheFind(cache, 1, 3) != NULL);
+
+    // Find does not refresh, so client 3 goes next
+    ClientCacheInsert(cache, 1, 1001);
+    CHECK(ClientCacheFind(cache, 1, 3) == NULL);
+    ClientCacheFree(cache);
+    CHECK(cache->count == 0);
+}
+
+static void TestChannelAndGroups(CLIENT_CACHE* cache)
+{
+    CLIENT_CACHE_ENTRY* a = ClientCacheInsert(cache, 1, 7);
+    CLIENT_CACHE_ENTRY* b = ClientCacheInsert(cache, 1, 8);
+    CLIENT_CACHE_ENTRY* c = ClientCacheInsert(cache, 2, 9);
+
+    a->databaseID = b->databaseID = c->databaseID = 55;
+    ClientCacheUpdateChannel(cache, 1, 7, 11);
+    CHECK(a->channelID == 11);
+
+    ClientCacheAddServerGroup(a, 6);
+    ClientCacheAddServerGroup(a, 6);
+    ClientCacheAddServerGroup(a, 9);
+    CHECK(a->serverGroupCount == 2);
+    ClientCacheRemoveServerGroup(a, 6);
+    CHECK(a->serverGroupCount == 1 && a->serverGroups[0] == 9);
+
+    // the same database ID on another server tab is another identity
+    ClientCacheAddServerGroupByDatabaseID(cache, 1, 55, 12);
+    CHECK(a->serverGroupCount == 2 && b->serverGroupCount == 1 && c->serverGroupCount == 0);
+
+    // channel 0 means the client left
+    ClientCacheUpdateChannel(cache, 1, 7, 0);
+    CHECK(ClientCacheFind(cache, 1, 7) == NULL && cache->count == 2);
+    ClientCacheFree(cache);
+}
+
+static void TestStrings(CLIENT_CACHE* cache, STRING_POOL* strings)
+{
+    CLIENT_CACHE_ENTRY  data;
+    CLIENT_CACHE_ENTRY* e;
+
+    memset(&data, 0, sizeof(data));
+    data.serverConnectionHandlerID = 1;
+    data.clientID                  = 7;
+    data.name                      = StringPoolIntern(strings, "Alice");
+    data.uniqueIdentifier          = StringPoolIntern(strings, "uid=");
+
+    e = ClientCacheStore(cache, &data);
+    ClientCacheReleaseEntry(strings, &data);
+    CHECK_STR(StringPoolGet(strings, e->name), "Alice");
+    CHECK_STR(StringPoolGet(strings, e->nameAnonymized), "");
+    CHECK(strings->count == 2);
+
+    ClientCacheInvalidate(cache, 1, 7);
+    CHECK(strings->count == 0);
+}
+
+int main(void)
+{
+    static STRING_POOL  strings;
+    static CLIENT_CACHE cache;
+
+    SlabInit();
+    StringPoolInit(&strings);
+    ClientCacheInit(&cache, &strings);
+    TestLookup(&cache);
+    TestEviction(&cache);
+    TestChannelAndGroups(&cache);
+    TestStrings(&cache, &strings);
+    ClientCacheFree(&cache);
+    StringPoolFree(&strings);
+    SlabShutdown();
+    return TEST_RESULT();
+}
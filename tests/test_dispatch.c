@@ -0,0 +1,214 @@
+/*
+ * Behaviour of dispatch.c: jobs of one key run in the order they were queued, a slow job only holds up its own
+ * lane, priority jobs never wait behind bulk jobs, a full lane drops, and jobs not run before the stop deadline are
+ * spilled in their order, the job aborted at the deadline first. Also the percentiles of latency.c.
+ */
+
+#include <unistd.h>
+
+#include "test.h"
+#include "dispatch.h"
+#include "slab.h"
+
+#define RECORD_MAX 512
+
+static PLATFORM_MUTEX  recordLock;
+static char            recorded[RECORD_MAX][32];
+static int             recordCount;
+static volatile int    blocked;   // jobs with topic "slow" wait while set
+static volatile uint64 abortAtMs; // a waiting "slow" job gives up then and returns 0, like at the stop deadline
+static char            spilled[RECORD_MAX][32];
+static int             spillCount;
+
+static int RecordJob(const char* command, const char* topic, const char* message, uint64 serverConnectionHandlerID)
+{
+    if (strcmp(topic, "slow") == 0) {
+        while (blocked) {
+            if (abortAtMs != 0 && GetMonotonicTimeMs() >= abortAtMs)
+                return 0;
+            usleep(1000);
+        }
+    }
+    MutexLock(&recordLock);
+    if (recordCount < RECORD_MAX)
+        snprintf(recorded[recordCount++], sizeof(recorded[0]), "%s", message);
+    MutexUnlock(&recordLock);
+    return 1;
+}
+
+static void RecordSpill(const char* topic, const char* message, void* arg)
+{
+    if (spillCount < RECORD_MAX)
+        snprintf(spilled[spillCount++], sizeof(spilled[0]), "%s", message);
+}
+
+static int RecordCount(void)
+{
+    int count;
+
+    MutexLock(&recordLock);
+    count = recordCount;
+    MutexUnlock(&recordLock);
+    return count;
+}
+
+static int WaitForCount(int count)
+{
+    for (int i = 0; i < 2000 && RecordCount() < count; i++)
+        usleep(1000);
+    return RecordCount() >= count;
+}
+
+static void Reset(void)
+{
+    recordCount = 0;
+    spillCount  = 0;
+    blocked     = 0;
+    abortAtMs   = 0;
+}
+
+static void TestOrder(void)
+{
+    DISPATCHER dispatcher;
+    char       message[16];
+    int        ordered = 1;
+
+    Reset();
+    CHECK(DispatchStart(&dispatcher, RecordJob) == DISPATCH_LANE_COUNT);
+    for (int i = 0; i < 200; i++) {
+        snprintf(message, sizeof(message), "%d", i);
+        CHECK(DispatchSubmit(&dispatcher, 1, 7, 0, "cmd", "t", message));
+    }
+    CHECK(WaitForCount(200));
+    for (int i = 0; i < 200; i++) {
+        snprintf(message, sizeof(message), "%d", i);
+        ordered &= strcmp(recorded[i], message) == 0;
+    }
+    CHECK(ordered);
+    DispatchStop(&dispatcher, 0, NULL, NULL);
+}
+
+static void TestParallel(void)
+{
+    DISPATCHER          dispatcher;
+    DISPATCH_LANE_STATS stats;
+    int                 waiting = 0;
+
+    Reset();
+    DispatchStart(&dispatcher, RecordJob);
+    blocked = 1;
+    DispatchSubmit(&dispatcher, 1, 7, 0, "cmd", "slow", "slow");
+    for (anyID client = 100; client < 132; client++)
+        DispatchSubmit(&dispatcher, 1, client, 0, "cmd", "t", "other");
+
+    // the clients sharing the lane of client 7 wait, all others are done
+    usleep(50000);
+    for (int i = 0; i < DISPATCH_LANES; i++) {
+        DispatchGetStats(&dispatcher, i, &stats);
+        waiting += (int)stats.depth;
+    }
+    CHECK(RecordCount() > 0);
+    CHECK(RecordCount() + waiting == 32);
+    blocked = 0;
+    CHECK(WaitForCount(33));
+    DispatchStop(&dispatcher, 0, NULL, NULL);
+}
+
+static void TestPriority(void)
+{
+    DISPATCHER          dispatcher;
+    DISPATCH_LANE_STATS stats;
+
+    Reset();
+    DispatchStart(&dispatcher, RecordJob);
+    blocked = 1;
+    for (anyID client = 1; client <= 16; client++)
+        DispatchSubmit(&dispatcher, 1, client, 0, "cmd", "slow", "bulk");
+    DispatchSubmit(&dispatcher, 1, 7, 1, "cmd", "t", "priority");
+    CHECK(WaitForCount(1));
+    CHECK_STR(recorded[0], "priority");
+    DispatchGetStats(&dispatcher, DISPATCH_PRIORITY_LANE, &stats);
+    CHECK(stats.done == 1 && stats.depth == 0);
+    blocked = 0;
+    CHECK(WaitForCount(17));
+    DispatchStop(&dispatcher, 0, NULL, NULL);
+}
+
+static void TestLatency(void)
+{
+    LATENCY_HISTOGRAM histogram;
+
+    memset(&histogram, 0, sizeof(histogram));
+    CHECK(LatencyPercentile(&histogram, 99) == 0);
+    for (int i = 0; i < 98; i++)
+        LatencyRecord(&histogram, 0);
+    LatencyRecord(&histogram, 5);
+    LatencyRecord(&histogram, 100000000);
+    CHECK(histogram.count == 100);
+    CHECK(LatencyPercentile(&histogram, 50) == 0);
+    CHECK(LatencyPercentile(&histogram, 99) == 7); // 5 ms lies in the bucket up to 7 ms
+    CHECK(LatencyPercentile(&histogram, 100) == ((uint64)1 << (LATENCY_BUCKETS - 1)) - 1);
+}
+
+static void TestFull(void)
+{
+    DISPATCHER          dispatcher;
+    DISPATCH_LANE_STATS stats;
+    int                 accepted = 0;
+    uint64              dropped  = 0;
+
+    Reset();
+    DispatchStart(&dispatcher, RecordJob);
+    blocked = 1;
+    DispatchSubmit(&dispatcher, 1, 7, 0, "cmd", "slow", "slow");
+    usleep(20000);
+    for (int i = 0; i < DISPATCH_LANE_LEN + 10; i++)
+        accepted += DispatchSubmit(&dispatcher, 1, 7, 0, "cmd", "t", "queued");
+    CHECK(accepted == DISPATCH_LANE_LEN);
+    for (int i = 0; i < DISPATCH_LANES; i++) {
+        DispatchGetStats(&dispatcher, i, &stats);
+        dropped += stats.dropped;
+    }
+    CHECK(dropped == 10);
+    blocked = 0;
+    CHECK(WaitForCount(DISPATCH_LANE_LEN + 1));
+    DispatchStop(&dispatcher, 0, NULL, NULL);
+}
+
+static void TestStopDeadline(void)
+{
+    DISPATCHER dispatcher;
+    char       message[16];
+
+    Reset();
+    DispatchStart(&dispatcher, RecordJob);
+    blocked = 1;
+    DispatchSubmit(&dispatcher, 1, 7, 0, "cmd", "slow", "first");
+    usleep(20000);
+    for (int i = 0; i < 5; i++) {
+        snprintf(message, sizeof(message), "%d", i);
+        DispatchSubmit(&dispatcher, 1, 7, 0, "cmd", "t", message);
+    }
+    abortAtMs = GetMonotonicTimeMs() + 20;
+    DispatchStop(&dispatcher, abortAtMs, RecordSpill, NULL);
+    CHECK(RecordCount() == 0);
+    CHECK(spillCount == 6);
+    CHECK_STR(spilled[0], "first");
+    CHECK_STR(spilled[1], "0");
+    CHECK_STR(spilled[5], "4");
+}
+
+int main(void)
+{
+    SlabInit();
+    MutexInit(&recordLock);
+    TestOrder();
+    TestParallel();
+    TestPriority();
+    TestFull();
+    TestStopDeadline();
+    TestLatency();
+    MutexDestroy(&recordLock);
+    SlabShutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,174 @@
+/*
+ * Behaviour of the timer wheel in event_loop.c: timers fire once in the order of their expiry and at most one tick
+ * (the timer resolution) before their delay, restarting moves a pending timer, cancelled timers (also by another
+ * callback of the same tick) stay silent, a timer one wheel revolution away shares a slot without firing early, and
+ * callbacks may restart their own timer.
+ */
+
+#include <unistd.h>
+
+#include "test.h"
+#include "event_loop.h"
+#include "slab.h"
+
+#define MANY_TIMERS 1000
+
+typedef struct {
+    EVENT_TIMER  timer;
+    int          fired;
+    uint64       firedMs;
+    int          order; // position among all fired timers
+    int          repeat; // restarts itself this many times
+    EVENT_TIMER* cancel; // cancelled by this callback
+} PROBE;
+
+static EVENT_LOOP loop;
+static volatile int firedTotal;
+
+static void OnProbe(void* arg)
+{
+    PROBE* probe = (PROBE*)arg;
+
+    probe->fired++;
+    probe->firedMs = GetMonotonicTimeMs();
+    probe->order   = __atomic_add_fetch(&firedTotal, 1, __ATOMIC_SEQ_CST);
+    if (probe->cancel != NULL)
+        EventTimerCancel(&loop, probe->cancel);
+    if (probe->repeat > 0) {
+        probe->repeat--;
+        EventTimerStart(&loop, &probe->timer, 10);
+    }
+}
+
+static void ProbeInit(PROBE* probe)
+{
+    memset(probe, 0, sizeof(*probe));
+    EventTimerInit(&probe->timer, OnProbe, probe);
+}
+
+static int WaitForTotal(int total, uint64 timeoutMs)
+{
+    uint64 until = GetMonotonicTimeMs() + timeoutMs;
+
+    while (firedTotal < total && GetMonotonicTimeMs() < until)
+        usleep(1000);
+    return firedTotal >= total;
+}
+
+static void TestOrder(void)
+{
+    PROBE  probes[3];
+    uint64 delays[3] = { 50, 20, 80 };
+    uint64 start     = GetMonotonicTimeMs();
+
+    firedTotal = 0;
+    for (int i = 0; i < 3; i++) {
+        ProbeInit(&probes[i]);
+        EventTimerStart(&loop, &probes[i].timer, delays[i]);
+    }
+    CHECK(EventTimerPending(&loop, &probes[0].timer));
+    CHECK(WaitForTotal(3, 1000));
+    CHECK(probes[1].order == 1 && probes[0].order == 2 && probes[2].order == 3);
+    for (int i = 0; i < 3; i++) {
+        CHECK(probes[i].fired == 1);
+        CHECK(probes[i].firedMs + EVENT_TICK_MS - start >= delays[i]);
+        CHECK(!EventTimerPending(&loop, &probes[i].timer));
+    }
+}
+
+static void TestRestartAndCancel(void)
+{
+    PROBE  moved;
+    PROBE  cancelled;
+    uint64 start = GetMonotonicTimeMs();
+
+    firedTotal = 0;
+    ProbeInit(&moved);
+    ProbeInit(&cancelled);
+    EventTimerStart(&loop, &moved.timer, 20);
+    EventTimerStart(&loop, &moved.timer, 100);
+    EventTimerStart(&loop, &cancelled.timer, 30);
+    EventTimerCancel(&loop, &cancelled.timer);
+    EventTimerCancel(&loop, &cancelled.timer);
+    CHECK(!EventTimerPending(&loop, &cancelled.timer));
+    CHECK(WaitForTotal(1, 1000));
+    usleep(50000);
+    CHECK(moved.fired == 1 && moved.firedMs + EVENT_TICK_MS - start >= 100);
+    CHECK(cancelled.fired == 0);
+}
+
+static void TestSameTick(void)
+{
+    PROBE a;
+    PROBE b;
+
+    // whichever fires first cancels the other one
+    firedTotal = 0;
+    ProbeInit(&a);
+    ProbeInit(&b);
+    a.cancel = &b.timer;
+    b.cancel = &a.timer;
+    EventTimerStart(&loop, &a.timer, 20);
+    EventTimerStart(&loop, &b.timer, 20);
+    CHECK(WaitForTotal(1, 1000));
+    usleep(50000);
+    CHECK(a.fired + b.fired == 1);
+}
+
+static void TestRevolution(void)
+{
+    PROBE near;
+    PROBE far;
+
+    // both hang in the same slot, the far one is a whole revolution later
+    firedTotal = 0;
+    ProbeInit(&near);
+    ProbeInit(&far);
+    EventTimerStart(&loop, &near.timer, 2 * EVENT_TICK_MS);
+    EventTimerStart(&loop, &far.timer, (2 + EVENT_WHEEL_SLOTS) * EVENT_TICK_MS);
+    CHECK((near.timer.expires & (EVENT_WHEEL_SLOTS - 1)) == (far.timer.expires & (EVENT_WHEEL_SLOTS - 1)));
+    CHECK(WaitForTotal(1, 1000));
+    usleep(50000);
+    CHECK(near.fired == 1 && far.fired == 0);
+    CHECK(EventTimerPending(&loop, &far.timer));
+    EventTimerCancel(&loop, &far.timer);
+}
+
+static void TestRepeatAndMany(void)
+{
+    static PROBE     probes[MANY_TIMERS];
+    PROBE            periodic;
+    EVENT_LOOP_STATS stats;
+    int              once = 1;
+
+    firedTotal = 0;
+    ProbeInit(&periodic);
+    periodic.repeat = 3;
+    EventTimerStart(&loop, &periodic.timer, 10);
+    for (int i = 0; i < MANY_TIMERS; i++) {
+        ProbeInit(&probes[i]);
+        EventTimerStart(&loop, &probes[i].timer, (uint64)(i * 7 % 200));
+    }
+    CHECK(WaitForTotal(MANY_TIMERS + 4, 2000));
+    usleep(50000);
+    CHECK(periodic.fired == 4);
+    for (int i = 0; i < MANY_TIMERS; i++)
+        once &= probes[i].fired == 1;
+    CHECK(once);
+    EventLoopGetStats(&loop, &stats);
+    CHECK(stats.timers == 0);
+}
+
+int main(void)
+{
+    SlabInit();
+    CHECK(EventLoopStart(&loop));
+    TestOrder();
+    TestRestartAndCancel();
+    TestSameTick();
+    TestRevolution();
+    TestRepeatAndMany();
+    EventLoopStop(&loop);
+    SlabShutdown();
+    return TEST_RESULT();
+}
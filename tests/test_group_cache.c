@@ -0,0 +1,61 @@
+/*
+ * Behaviour of group_cache.c: names per server tab and group kind, renames in place and the sorted table staying
+ * searchable while groups arrive in any order.
+ */
+
+#include "test.h"
+#include "group_cache.h"
+
+static void TestKinds(GROUP_CACHE* cache)
+{
+    GroupCacheSet(cache, 1, GROUP_KIND_SERVER, 6, "Admin");
+    GroupCacheSet(cache, 1, GROUP_KIND_CHANNEL, 6, "Channel Admin");
+    GroupCacheSet(cache, 2, GROUP_KIND_SERVER, 6, "Other Admin");
+    CHECK_STR(GroupCacheGetName(cache, 1, GROUP_KIND_SERVER, 6), "Admin");
+    CHECK_STR(GroupCacheGetName(cache, 1, GROUP_KIND_CHANNEL, 6), "Channel Admin");
+    CHECK_STR(GroupCacheGetName(cache, 2, GROUP_KIND_SERVER, 6), "Other Admin");
+    CHECK(GroupCacheGetName(cache, 2, GROUP_KIND_CHANNEL, 6) == NULL);
+    CHECK(GroupCacheGetName(cache, 1, GROUP_KIND_SERVER, 7) == NULL);
+
+    GroupCacheSet(cache, 1, GROUP_KIND_SERVER, 6, "Server Admin");
+    CHECK_STR(GroupCacheGetName(cache, 1, GROUP_KIND_SERVER, 6), "Server Admin");
+    CHECK(cache->count == 3);
+}
+
+static void TestOrder(GROUP_CACHE* cache)
+{
+    char name[16];
+    int  sorted = 1;
+
+    // descending and interleaved IDs, more than the first allocation holds
+    for (int i = 100; i > 0; i--) {
+        snprintf(name, sizeof(name), "g%d", i);
+        GroupCacheSet(cache, 3, i % 2 ? GROUP_KIND_SERVER : GROUP_KIND_CHANNEL, (uint64)i, name);
+    }
+    CHECK(cache->count == 103);
+    for (int i = 1; i <= 100; i++) {
+        snprintf(name, sizeof(name), "g%d", i);
+        CHECK_STR(GroupCacheGetName(cache, 3, i % 2 ? GROUP_KIND_SERVER : GROUP_KIND_CHANNEL, (uint64)i), name);
+    }
+    for (unsigned int i = 1; i < cache->count; i++) {
+        const GROUP_CACHE_ENTRY* a = &cache->entries[i - 1];
+        const GROUP_CACHE_ENTRY* b = &cache->entries[i];
+        if (a->serverConnectionHandlerID > b->serverConnectionHandlerID ||
+            (a->serverConnectionHandlerID == b->serverConnectionHandlerID &&
+             (a->kind > b->kind || (a->kind == b->kind && a->groupID >= b->groupID))))
+            sorted = 0;
+    }
+    CHECK(sorted);
+}
+
+int main(void)
+{
+    GROUP_CACHE cache;
+
+    GroupCacheInit(&cache);
+    TestKinds(&cache);
+    TestOrder(&cache);
+    GroupCacheFree(&cache);
+    CHECK(GroupCacheGetName(&cache, 1, GROUP_KIND_SERVER, 6) == NULL);
+    return TEST_RESULT();
+}
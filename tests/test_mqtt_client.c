@@ -0,0 +1,217 @@
+/*
+ * Behaviour of mqtt_client.c against a fake broker on a Unix domain socket: the CONNECT packet with credentials,
+ * QoS 0 and QoS 1 publishes on one kept connection (stray packets before the PUBACK are skipped), pings, a refused
+ * CONNACK, a broker hanging up, and the reachability check.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "test.h"
+#include "mqtt_client.h"
+
+#define FAKE_MAX_PACKETS 16
+
+typedef struct {
+    unsigned char type;
+    size_t        len;
+    unsigned char body[256];
+} FAKE_PACKET;
+
+typedef struct {
+    int           listenFd;
+    unsigned char connackCode; // 0 = accepted
+    int           hangUpAfter; // closes the connection after this many publishes, 0 = never
+    int           clients;     // connections served one after the other
+    int           count;
+    FAKE_PACKET   packets[FAKE_MAX_PACKETS];
+} FAKE_BROKER;
+
+static char socketPath[64];
+
+static int ReadFull(int fd, unsigned char* buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = recv(fd, buf, size, 0);
+        if (n <= 0)
+            return 0;
+        buf  += n;
+        size -= (size_t)n;
+    }
+    return 1;
+}
+
+static void Reply(int fd, const unsigned char* packet, size_t size)
+{
+    send(fd, packet, size, MSG_NOSIGNAL);
+}
+
+// Serves one client until it hangs up, records every packet
+static void FakeBrokerServe(FAKE_BROKER* broker, int fd)
+{
+    int           publishes = 0;
+    unsigned char header;
+
+    while (fd >= 0 && ReadFull(fd, &header, 1) && broker->count < FAKE_MAX_PACKETS) {
+        FAKE_PACKET*  packet = &broker->packets[broker->count];
+        size_t        len    = 0;
+        int           shift  = 0;
+        unsigned char byte;
+
+        do {
+            if (!ReadFull(fd, &byte, 1))
+                goto done;
+            len   |= (size_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while ((byte & 0x80) != 0 && shift < 28);
+        if (len > sizeof(packet->body) || !ReadFull(fd, packet->body, len))
+            break;
+        packet->type = header;
+        packet->len  = len;
+        broker->count++;
+
+        if (header == 0x10) {
+            unsigned char connack[] = { 0x20, 0x02, 0x00, broker->connackCode };
+            Reply(fd, connack, sizeof(connack));
+        } else if (header == 0xC0) {
+            static const unsigned char pingresp[] = { 0xD0, 0x00 };
+            Reply(fd, pingresp, sizeof(pingresp));
+        } else if ((header & 0xF0) == 0x30) {
+            if (broker->hangUpAfter > 0 && ++publishes >= broker->hangUpAfter)
+                break;
+            if ((header & 0x06) != 0) {
+                size_t        topicLen  = ((size_t)packet->body[0] << 8) | packet->body[1];
+                unsigned char noise[]   = { 0xD0, 0x00, 0x40, 0x02, 0xFF, 0xFF }; // late PINGRESP, PUBACK of another id
+                unsigned char puback[4] = { 0x40, 0x02, packet->body[2 + topicLen], packet->body[3 + topicLen] };
+                Reply(fd, noise, sizeof(noise));
+                Reply(fd, puback, sizeof(puback));
+            }
+        }
+    }
+done:
+    if (fd >= 0)
+        close(fd);
+}
+
+static void FakeBrokerWorker(void* arg)
+{
+    FAKE_BROKER* broker = (FAKE_BROKER*)arg;
+
+    for (int i = 0; i < broker->clients; i++)
+        FakeBrokerServe(broker, accept(broker->listenFd, NULL, NULL));
+}
+
+static int FakeBrokerStart(FAKE_BROKER* broker, PLATFORM_THREAD* thread)
+{
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socketPath);
+    unlink(socketPath);
+    broker->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (broker->listenFd < 0 || bind(broker->listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(broker->listenFd, 4) != 0)
+        return 0;
+    return ThreadStart(thread, FakeBrokerWorker, broker);
+}
+
+static void FakeBrokerStop(FAKE_BROKER* broker, PLATFORM_THREAD* thread)
+{
+    ThreadJoin(thread);
+    close(broker->listenFd);
+    unlink(socketPath);
+}
+
+static void TestSession(void)
+{
+    static FAKE_BROKER broker;
+    PLATFORM_THREAD    thread;
+    MQTT_CLIENT        client;
+    char               host[80];
+    const FAKE_PACKET* packet;
+
+    // the reachability check is a connection of its own
+    memset(&broker, 0, sizeof(broker));
+    broker.clients = 2;
+    CHECK(FakeBrokerStart(&broker, &thread));
+    snprintf(host, sizeof(host), "%s%s", MQTT_UNIX_PREFIX, socketPath);
+    MqttInit(&client);
+    CHECK(MqttReachable(&client, host, ""));
+    CHECK(MqttConnect(&client, host, "", "client-1", "user", "secret", 60));
+    CHECK(client.fd >= 0 && client.keepAliveSec == 60);
+    CHECK(MqttPublish(&client, "ts3/talk", "{\"on\":1}", 0));
+    CHECK(MqttPublish(&client, "ts3/talk", "second", 1));
+    CHECK(MqttPublish(&client, "ts3/talk", "third", 2));
+    CHECK(MqttPing(&client));
+    MqttDisconnect(&client);
+    CHECK(client.fd == -1);
+    FakeBrokerStop(&broker, &thread);
+
+    // CONNECT, 3 x PUBLISH, PINGREQ, DISCONNECT on the same connection
+    CHECK(broker.count == 6);
+    if (broker.count != 6)
+        return;
+    packet = &broker.packets[0];
+    CHECK(packet->type == 0x10 && packet->len == 10 + 10 + 6 + 8);
+    CHECK(memcmp(packet->body, "\0\4MQTT\4\xC2\0\x3C", 10) == 0);
+    CHECK(memcmp(packet->body + 10, "\0\10client-1\0\4user\0\6secret", 24) == 0);
+
+    packet = &broker.packets[1];
+    CHECK(packet->type == 0x30 && packet->len == 2 + 8 + 8);
+    CHECK(memcmp(packet->body, "\0\10ts3/talk{\"on\":1}", 18) == 0);
+
+    // QoS 2 is sent as QoS 1, the packet IDs count up
+    CHECK(broker.packets[2].type == 0x32 && memcmp(broker.packets[2].body + 10, "\0\1second", 8) == 0);
+    CHECK(broker.packets[3].type == 0x32 && memcmp(broker.packets[3].body + 10, "\0\2third", 7) == 0);
+    CHECK(broker.packets[4].type == 0xC0 && broker.packets[4].len == 0);
+    CHECK(broker.packets[5].type == 0xE0);
+}
+
+static void TestFailures(void)
+{
+    static FAKE_BROKER broker;
+    PLATFORM_THREAD    thread;
+    MQTT_CLIENT        client;
+    char               host[80];
+
+    snprintf(host, sizeof(host), "%s%s", MQTT_UNIX_PREFIX, socketPath);
+    MqttInit(&client);
+
+    // nobody listening
+    CHECK(!MqttReachable(&client, host, ""));
+    CHECK(!MqttConnect(&client, host, "", "client-1", "", "", 60));
+    CHECK(!MqttPublish(&client, "ts3/talk", "lost", 0));
+    CHECK(!MqttPing(&client));
+
+    // not authorized
+    memset(&broker, 0, sizeof(broker));
+    broker.connackCode = 5;
+    broker.clients     = 1;
+    CHECK(FakeBrokerStart(&broker, &thread));
+    CHECK(!MqttConnect(&client, host, "", "client-1", "user", "wrong", 60));
+    CHECK(client.fd == -1);
+    FakeBrokerStop(&broker, &thread);
+    CHECK(broker.count >= 1 && broker.packets[0].type == 0x10 && broker.packets[0].body[7] == 0x02 + 0x80 + 0x40);
+
+    // the broker goes away while a QoS 1 message waits for its acknowledgement
+    memset(&broker, 0, sizeof(broker));
+    broker.hangUpAfter = 2;
+    broker.clients     = 1;
+    CHECK(FakeBrokerStart(&broker, &thread));
+    CHECK(MqttConnect(&client, host, "", "client-1", "", "", 60));
+    CHECK(broker.count == 1 && broker.packets[0].body[7] == 0x02);
+    CHECK(MqttPublish(&client, "ts3/talk", "first", 1));
+    CHECK(!MqttPublish(&client, "ts3/talk", "second", 1));
+    CHECK(client.fd == -1);
+    FakeBrokerStop(&broker, &thread);
+}
+
+int main(void)
+{
+    snprintf(socketPath, sizeof(socketPath), "/tmp/lh2mqtt-broker-%d", (int)getpid());
+    TestSession();
+    TestFailures();
+    return TEST_RESULT();
+}
@@ -0,0 +1,154 @@
+/*
+ * Behaviour of rate_limit.c: burst and refill of a bucket, buckets per topic and per speaker, the summaries of
+ * suppressed messages and exactly burst messages passing when several threads share a bucket.
+ */
+
+#include <unistd.h>
+
+#include "test.h"
+#include "rate_limit.h"
+#include "slab.h"
+
+#define THREADS        4
+#define THREAD_BURST   100
+#define THREAD_ATTEMPT 1000
+
+typedef struct {
+    int    count;
+    uint64 suppressed;
+    char   topic[64];
+    char   message[64];
+} SUMMARY;
+
+static void OnSummary(const RATE_LIMIT_EVENT* latest, uint64 suppressed, void* arg)
+{
+    SUMMARY* summary = (SUMMARY*)arg;
+
+    summary->count++;
+    summary->suppressed += suppressed;
+    snprintf(summary->topic, sizeof(summary->topic), "%s", latest->topic);
+    snprintf(summary->message, sizeof(summary->message), "%s", latest->message);
+}
+
+static int UsedSlots(RATE_LIMITER* limiter)
+{
+    int used = 0;
+
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++)
+        used += limiter->slots[i].key != 0;
+    return used;
+}
+
+static void TestOff(RATE_LIMITER* limiter)
+{
+    RateLimitConfigure(limiter, 0, 0, 0);
+    for (int i = 0; i < 100; i++)
+        CHECK(RateLimitAllow(limiter, 1, 7, "off", "start"));
+    CHECK(UsedSlots(limiter) == 0);
+}
+
+// One message per minute with a burst of 3: three pass, the rest is summarized with the latest state
+static void TestBurst(RATE_LIMITER* limiter)
+{
+    SUMMARY summary;
+
+    RateLimitConfigure(limiter, 1, 3, 0);
+    CHECK(RateLimitAllow(limiter, 1, 7, "talk/7", "start"));
+    CHECK(RateLimitAllow(limiter, 1, 7, "talk/7", "stop"));
+    CHECK(RateLimitAllow(limiter, 1, 7, "talk/7", "start"));
+    CHECK(!RateLimitAllow(limiter, 1, 7, "talk/7", "stop"));
+    CHECK(!RateLimitAllow(limiter, 1, 7, "talk/7", "start"));
+    CHECK(!RateLimitAllow(limiter, 1, 7, "talk/7", "stop"));
+    // another topic has a bucket of its own
+    CHECK(RateLimitAllow(limiter, 1, 7, "talk/8", "start"));
+    CHECK(limiter->suppressedTotal == 3);
+
+    memset(&summary, 0, sizeof(summary));
+    CHECK(RateLimitCollect(limiter, OnSummary, &summary) == 1);
+    CHECK(summary.count == 1 && summary.suppressed == 3);
+    CHECK_STR(summary.topic, "talk/7");
+    CHECK_STR(summary.message, "stop");
+    // nothing suppressed since, and the buckets are still empty so they are kept
+    memset(&summary, 0, sizeof(summary));
+    CHECK(RateLimitCollect(limiter, OnSummary, &summary) == 0);
+    CHECK(UsedSlots(limiter) == 2);
+    CHECK(!RateLimitAllow(limiter, 1, 7, "talk/7", "start"));
+    RateLimitCollect(limiter, OnSummary, &summary);
+}
+
+static void TestPerSpeaker(RATE_LIMITER* limiter)
+{
+    RateLimitConfigure(limiter, 1, 1, 0);
+    CHECK(RateLimitAllow(limiter, 1, 10, "speaker", "start"));
+    CHECK(!RateLimitAllow(limiter, 1, 11, "speaker", "start"));
+
+    RateLimitConfigure(limiter, 1, 1, 1);
+    CHECK(RateLimitAllow(limiter, 1, 20, "speaker", "start"));
+    CHECK(!RateLimitAllow(limiter, 1, 20, "speaker", "stop"));
+    CHECK(RateLimitAllow(limiter, 1, 21, "speaker", "start"));
+    // same client on another server tab
+    CHECK(RateLimitAllow(limiter, 2, 20, "speaker", "start"));
+}
+
+// 10 ms per message: an empty bucket is full again after the interval, idle buckets are freed by the collection
+static void TestRefill(RATE_LIMITER* limiter)
+{
+    SUMMARY summary;
+
+    RateLimitFree(limiter);
+    RateLimitInit(limiter);
+    RateLimitConfigure(limiter, 6000, 1, 0);
+    CHECK(RateLimitAllow(limiter, 1, 7, "refill", "start"));
+    usleep(30000);
+    CHECK(RateLimitAllow(limiter, 1, 7, "refill", "stop"));
+    usleep(30000);
+    memset(&summary, 0, sizeof(summary));
+    CHECK(RateLimitCollect(limiter, OnSummary, &summary) == 0);
+    CHECK(UsedSlots(limiter) == 0);
+}
+
+static RATE_LIMITER* sharedLimiter;
+static volatile uint64 sharedAllowed;
+
+static void AllowWorker(void* arg)
+{
+    for (int i = 0; i < THREAD_ATTEMPT; i++) {
+        if (RateLimitAllow(sharedLimiter, 1, 7, "shared", "start"))
+            AtomicAdd64(&sharedAllowed, 1);
+    }
+    SlabThreadFlush();
+}
+
+static void TestThreads(RATE_LIMITER* limiter)
+{
+    PLATFORM_THREAD threads[THREADS];
+    SUMMARY         summary;
+
+    RateLimitConfigure(limiter, 1, THREAD_BURST, 0);
+    sharedLimiter = limiter;
+    for (int i = 0; i < THREADS; i++)
+        ThreadStart(&threads[i], AllowWorker, NULL);
+    for (int i = 0; i < THREADS; i++)
+        ThreadJoin(&threads[i]);
+    CHECK(sharedAllowed == THREAD_BURST);
+
+    memset(&summary, 0, sizeof(summary));
+    RateLimitCollect(limiter, OnSummary, &summary);
+    CHECK(summary.count == 1 && summary.suppressed == THREADS * THREAD_ATTEMPT - THREAD_BURST);
+}
+
+int main(void)
+{
+    static RATE_LIMITER limiter;
+
+    SlabInit();
+    RateLimitInit(&limiter);
+    TestOff(&limiter);
+    TestBurst(&limiter);
+    TestPerSpeaker(&limiter);
+    TestRefill(&limiter);
+    TestThreads(&limiter);
+    RateLimitFree(&limiter);
+    SlabShutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+/*
+ * Behaviour of resolver.c with a hosts file stand-in, so no DNS is needed: address families interleaved in the
+ * order of RFC 8305 starting with the first answer, the port, and answers served from the cache.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "test.h"
+#include "resolver.h"
+
+static char hostsFile[64];
+
+static void WriteHostsFile(const char* content)
+{
+    FILE* file = fopen(hostsFile, "w");
+
+    fputs(content, file);
+    fclose(file);
+}
+
+// Address and port of addr like "[2001:db8::1]:1883" or "192.0.2.1:1883"
+static const char* Format(const RESOLVER_ADDR* addr, char* buf, size_t size)
+{
+    char text[INET6_ADDRSTRLEN];
+
+    if (addr->family == AF_INET6) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)&addr->addr;
+        inet_ntop(AF_INET6, &in6->sin6_addr, text, sizeof(text));
+        snprintf(buf, size, "[%s]:%u", text, ntohs(in6->sin6_port));
+    } else {
+        const struct sockaddr_in* in4 = (const struct sockaddr_in*)&addr->addr;
+        inet_ntop(AF_INET, &in4->sin_addr, text, sizeof(text));
+        snprintf(buf, size, "%s:%u", text, ntohs(in4->sin_port));
+    }
+    return buf;
+}
+
+static void TestInterleave(void)
+{
+    RESOLVER_ADDR addrs[RESOLVER_MAX_ADDRS];
+    char          buf[64];
+    int           count;
+
+    // IPv6 first: one family after the other, the rest of the longer one at the end
+    count = ResolveHost(hostsFile, "broker", "1883", addrs, RESOLVER_MAX_ADDRS);
+    CHECK(count == 5);
+    if (count == 5) {
+        CHECK_STR(Format(&addrs[0], buf, sizeof(buf)), "[2001:db8::1]:1883");
+        CHECK_STR(Format(&addrs[1], buf, sizeof(buf)), "192.0.2.1:1883");
+        CHECK_STR(Format(&addrs[2], buf, sizeof(buf)), "[2001:db8::2]:1883");
+        CHECK_STR(Format(&addrs[3], buf, sizeof(buf)), "192.0.2.2:1883");
+        CHECK_STR(Format(&addrs[4], buf, sizeof(buf)), "[2001:db8::3]:1883");
+    }
+
+    // the family of the first answer starts, names match case insensitive
+    count = ResolveHost(hostsFile, "V4First", "8883", addrs, RESOLVER_MAX_ADDRS);
+    CHECK(count == 3);
+    if (count == 3) {
+        CHECK_STR(Format(&addrs[0], buf, sizeof(buf)), "192.0.2.10:8883");
+        CHECK_STR(Format(&addrs[1], buf, sizeof(buf)), "[2001:db8::10]:8883");
+        CHECK_STR(Format(&addrs[2], buf, sizeof(buf)), "192.0.2.11:8883");
+    }
+
+    // only one family
+    count = ResolveHost(hostsFile, "v6only", "1883", addrs, RESOLVER_MAX_ADDRS);
+    CHECK(count == 2 && addrs[0].family == AF_INET6 && addrs[1].family == AF_INET6);
+
+    count = ResolveHost(hostsFile, "broker", "1883", addrs, 2);
+    CHECK(count == 2);
+}
+
+// Answers come from the worker and stay cached until the TTL, a changed hosts file is not read again before
+static void TestCache(void)
+{
+    RESOLVER      resolver;
+    RESOLVER_ADDR addrs[RESOLVER_MAX_ADDRS];
+    char          buf[64];
+    int           count;
+
+    CHECK(ResolverStart(&resolver, hostsFile));
+    // a prefetch only queues the lookup
+    count = ResolverLookup(&resolver, "v4first", "1883", addrs, RESOLVER_MAX_ADDRS, 0);
+    CHECK(count == -1 || count == 3);
+    count = ResolverLookup(&resolver, "v4first", "1883", addrs, RESOLVER_MAX_ADDRS, 2000);
+    CHECK(count == 3);
+    count = ResolverLookup(&resolver, "broker", "1883", addrs, RESOLVER_MAX_ADDRS, 2000);
+    CHECK(count == 5);
+    if (count > 1)
+        CHECK_STR(Format(&addrs[1], buf, sizeof(buf)), "192.0.2.1:1883");
+
+    WriteHostsFile("192.0.2.99 broker\n");
+    count = ResolverLookup(&resolver, "broker", "1883", addrs, RESOLVER_MAX_ADDRS, 2000);
+    CHECK(count == 5);
+    ResolverStop(&resolver);
+}
+
+int main(void)
+{
+    int fd;
+
+    snprintf(hostsFile, sizeof(hostsFile), "/tmp/lh2mqtt-hosts-XXXXXX");
+    fd = mkstemp(hostsFile);
+    if (fd < 0) {
+        printf("%s: no temporary file\n", __FILE__);
+        return 1;
+    }
+    close(fd);
+    WriteHostsFile("# hosts file stand-in\n"
+                   "2001:db8::1  broker\n"
+                   "192.0.2.1    broker other\n"
+                   "2001:db8::2  broker\n"
+                   "2001:db8::3  broker # comment\n"
+                   "192.0.2.2    broker\n"
+                   "192.0.2.10   v4first\n"
+                   "2001:db8::10 v4first\n"
+                   "192.0.2.11   v4first\n"
+                   "2001:db8::20 v6only\n"
+                   "2001:db8::21 v6only\n");
+    TestInterleave();
+    TestCache();
+    unlink(hostsFile);
+    return TEST_RESULT();
+}
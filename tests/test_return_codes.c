@@ -0,0 +1,108 @@
+/*
+ * Behaviour of return_codes.c: a continuation runs once with the server's answer, a request without answer times out
+ * at its deadline, the earliest deadline for the expiry timer, cancelling by server tab and on unload, and a full
+ * table.
+ */
+
+#include "test.h"
+#include "return_codes.h"
+
+typedef struct {
+    int          calls;
+    unsigned int error;
+    uint64       serverConnectionHandlerID;
+} RESULT;
+
+static void OnResult(uint64 serverConnectionHandlerID, unsigned int error, const char* errorMessage, const char* extraMessage, void* userData)
+{
+    RESULT* result = (RESULT*)userData;
+
+    result->calls++;
+    result->error                     = error;
+    result->serverConnectionHandlerID = serverConnectionHandlerID;
+}
+
+static void TestDispatch(RETURN_CODE_TABLE* table)
+{
+    RESULT result = { 0 };
+
+    CHECK(ReturnCodeRegister(table, "rc1", 1, 10000, OnResult, &result));
+    // the same code of another server tab is not the request
+    CHECK(!ReturnCodeDispatch(table, 2, "rc1", 0, "ok", ""));
+    CHECK(result.calls == 0);
+    CHECK(ReturnCodeDispatch(table, 1, "rc1", 0, "ok", ""));
+    CHECK(result.calls == 1 && result.error == 0);
+    CHECK(!ReturnCodeDispatch(table, 1, "rc1", 0, "ok", ""));
+    CHECK(result.calls == 1);
+    CHECK(table->count == 0);
+}
+
+// The expiry timer of the plugin runs ReturnCodeExpire at ReturnCodeNextDeadline
+static void TestTimeout(RETURN_CODE_TABLE* table)
+{
+    RESULT early = { 0 };
+    RESULT late  = { 0 };
+    uint64 now   = GetMonotonicTimeMs();
+
+    CHECK(ReturnCodeNextDeadline(table) == 0);
+    CHECK(ReturnCodeRegister(table, "late", 1, 5000, OnResult, &late));
+    CHECK(ReturnCodeRegister(table, "early", 1, 100, OnResult, &early));
+    CHECK(ReturnCodeNextDeadline(table) >= now + 100 && ReturnCodeNextDeadline(table) < now + 5000);
+
+    ReturnCodeExpire(table, ReturnCodeNextDeadline(table) - 1);
+    CHECK(early.calls == 0);
+    ReturnCodeExpire(table, ReturnCodeNextDeadline(table));
+    CHECK(early.calls == 1 && early.error == RETURN_CODE_TIMEOUT);
+    CHECK(late.calls == 0);
+    CHECK(ReturnCodeNextDeadline(table) >= now + 5000);
+
+    // a late answer finds nothing
+    CHECK(!ReturnCodeDispatch(table, 1, "early", 0, "ok", ""));
+    CHECK(early.calls == 1);
+    ReturnCodeExpire(table, now + 5000);
+    CHECK(late.calls == 1 && late.error == RETURN_CODE_TIMEOUT);
+    CHECK(table->timeouts == 2);
+}
+
+static void TestCancel(RETURN_CODE_TABLE* table)
+{
+    RESULT first  = { 0 };
+    RESULT second = { 0 };
+
+    CHECK(ReturnCodeRegister(table, "a", 1, 10000, OnResult, &first));
+    CHECK(ReturnCodeRegister(table, "b", 2, 10000, OnResult, &second));
+    ReturnCodeCancelServer(table, 1, 1794);
+    CHECK(first.calls == 1 && first.error == 1794 && first.serverConnectionHandlerID == 1);
+    CHECK(second.calls == 0);
+    ReturnCodeCancelAll(table);
+    CHECK(second.calls == 1 && second.error == RETURN_CODE_CANCELLED);
+    CHECK(table->count == 0);
+}
+
+static void TestFull(RETURN_CODE_TABLE* table)
+{
+    RESULT result = { 0 };
+    char   code[16];
+
+    for (int i = 0; i < RETURN_CODE_MAX_PENDING; i++) {
+        snprintf(code, sizeof(code), "rc%d", i);
+        CHECK(ReturnCodeRegister(table, code, 1, 10000, OnResult, &result));
+    }
+    CHECK(!ReturnCodeRegister(table, "one more", 1, 10000, OnResult, &result));
+    CHECK(table->rejected == 1);
+    ReturnCodeCancelAll(table);
+    CHECK(result.calls == RETURN_CODE_MAX_PENDING);
+}
+
+int main(void)
+{
+    RETURN_CODE_TABLE table;
+
+    ReturnCodeInit(&table);
+    TestDispatch(&table);
+    TestTimeout(&table);
+    TestCancel(&table);
+    TestFull(&table);
+    ReturnCodeFree(&table);
+    return TEST_RESULT();
+}
@@ -0,0 +1,82 @@
+/*
+ * Behaviour of server_shard.c: one shard per server tab created on first use, epochs never handed out twice (also
+ * across ServerShardRemoveAll), removing a tab keeps the others and releases the strings of its clients, and the
+ * SERVER_SHARD_MAX limit.
+ */
+
+#include "test.h"
+#include "server_shard.h"
+#include "slab.h"
+
+static void TestGet(SERVER_SHARD_TABLE* table)
+{
+    SERVER_SHARD* a = ServerShardGet(table, 1);
+    SERVER_SHARD* b = ServerShardGet(table, 2);
+
+    CHECK(a != NULL && b != NULL && a != b);
+    CHECK(ServerShardGet(table, 1) == a);
+    CHECK(ServerShardFind(table, 2) == b);
+    CHECK(ServerShardFind(table, 3) == NULL);
+    CHECK(a->epoch != b->epoch);
+    CHECK(a->uniqueIdentifier[0] == '\0' && a->groupListRequestedMs[0] == 0);
+    CHECK(table->count == 2);
+}
+
+static void TestRemove(SERVER_SHARD_TABLE* table, STRING_POOL* strings)
+{
+    SERVER_SHARD*       a = ServerShardGet(table, 1);
+    SERVER_SHARD*       b = ServerShardGet(table, 2);
+    CLIENT_CACHE_ENTRY* e = ClientCacheInsert(&a->clients, 1, 7);
+    unsigned int        epoch;
+
+    e->name = StringPoolIntern(strings, "Alice");
+    ChannelCacheSet(&b->channels, 2, 1, 0, "Lobby");
+    CHECK(strings->count == 1);
+
+    ServerShardRemove(table, 1);
+    CHECK(strings->count == 0);
+    CHECK(ServerShardFind(table, 1) == NULL);
+    CHECK(ServerShardFind(table, 2) == b);
+    CHECK_STR(ChannelCacheGetPath(&b->channels, 2, 1), "Lobby");
+
+    // a reconnect of the tab is a new epoch
+    epoch = b->epoch;
+    a     = ServerShardGet(table, 1);
+    CHECK(a->epoch > epoch);
+    CHECK(ClientCacheFind(&a->clients, 1, 7) == NULL);
+
+    epoch = a->epoch;
+    ServerShardRemoveAll(table);
+    CHECK(table->count == 0 && ServerShardFind(table, 2) == NULL);
+    CHECK(ServerShardGet(table, 2)->epoch > epoch);
+    ServerShardRemoveAll(table);
+}
+
+static void TestLimit(SERVER_SHARD_TABLE* table)
+{
+    for (uint64 id = 1; id <= SERVER_SHARD_MAX; id++)
+        CHECK(ServerShardGet(table, id) != NULL);
+    CHECK(ServerShardGet(table, SERVER_SHARD_MAX + 1) == NULL);
+    CHECK(ServerShardFind(table, 1) != NULL);
+    ServerShardRemove(table, 5);
+    CHECK(ServerShardGet(table, SERVER_SHARD_MAX + 1) != NULL);
+    for (uint64 id = 1; id <= SERVER_SHARD_MAX + 1; id++)
+        CHECK((ServerShardFind(table, id) != NULL) == (id != 5));
+    ServerShardRemoveAll(table);
+}
+
+int main(void)
+{
+    static STRING_POOL        strings;
+    static SERVER_SHARD_TABLE table;
+
+    SlabInit();
+    StringPoolInit(&strings);
+    ServerShardInit(&table, &strings);
+    TestGet(&table);
+    TestRemove(&table, &strings);
+    TestLimit(&table);
+    StringPoolFree(&strings);
+    SlabShutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,163 @@
+/*
+ * Behaviour of shm_ring.c with producer and consumer in one process: order, records which would cross the end of
+ * the data area (pad record and restart at offset 0), a full ring, a dead consumer, the takeover by a new producer
+ * and the refusal while another process still produces into the ring.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "test.h"
+#include "shm_ring.h"
+
+static char name[64];
+
+// Consumes one record and checks it, returns its offset in the data area
+static size_t PopAndCheck(SHM_RING* consumer, uint64 serverConnectionHandlerID, const char* topic, const char* message)
+{
+    const SHM_RING_RECORD* record;
+    const char*            t;
+    const char*            m;
+    size_t                 offset;
+
+    if (!ShmRingPeek(consumer, &record, &t, &m)) {
+        CHECK(!"record missing");
+        return 0;
+    }
+    offset = (size_t)((const char*)record - consumer->data);
+    CHECK(record->serverConnectionHandlerID == serverConnectionHandlerID);
+    CHECK_STR(t, topic);
+    CHECK(strcmp(m, message) == 0);
+    // a record never crosses the end of the data area
+    CHECK(offset + record->size <= SHM_RING_DATA_SIZE);
+    ShmRingConsume(consumer, record);
+    return offset;
+}
+
+static void TestOrder(SHM_RING* producer, SHM_RING* consumer)
+{
+    const SHM_RING_RECORD* record;
+    const char*            t;
+    const char*            m;
+
+    CHECK(ShmRingPush(producer, 1, "a/start", "Ben"));
+    CHECK(ShmRingPush(producer, 2, "a/stop", ""));
+    CHECK(ShmRingPush(producer, 1, "b/start", "M\xC3\xBCller"));
+    PopAndCheck(consumer, 1, "a/start", "Ben");
+    PopAndCheck(consumer, 2, "a/stop", "");
+    PopAndCheck(consumer, 1, "b/start", "M\xC3\xBCller");
+    CHECK(!ShmRingPeek(consumer, &record, &t, &m));
+}
+
+// Large records until the ring wrapped twice, the one not fitting at the end must start at offset 0
+static void TestWrap(SHM_RING* producer, SHM_RING* consumer)
+{
+    size_t size    = 100000;
+    char*  message = (char*)malloc(size);
+    uint64 start   = producer->header->tail;
+    int    wrapped = 0;
+
+    for (int i = 0; producer->header->tail - start < 2 * (uint64)SHM_RING_DATA_SIZE; i++) {
+        uint64 tail = producer->header->tail;
+        size_t offset;
+
+        memset(message, 'a' + i % 26, size - 1);
+        message[size - 1] = '\0';
+        CHECK(ShmRingPush(producer, (uint64)i, "wrap", message));
+        offset = PopAndCheck(consumer, (uint64)i, "wrap", message);
+        if (offset < (size_t)(tail % SHM_RING_DATA_SIZE)) {
+            // skipped the rest of the data area
+            CHECK(offset == 0);
+            wrapped++;
+        }
+    }
+    CHECK(wrapped == 2);
+    CHECK(producer->header->head == producer->header->tail);
+    free(message);
+}
+
+static void TestFull(SHM_RING* producer, SHM_RING* consumer)
+{
+    size_t size    = SHM_RING_DATA_SIZE / 8;
+    char*  message = (char*)malloc(size);
+    uint64 dropped = producer->header->dropped;
+    int    pushed  = 0;
+
+    memset(message, 'x', size - 1);
+    message[size - 1] = '\0';
+    while (ShmRingPush(producer, 7, "full", message))
+        pushed++;
+    CHECK(pushed >= 6 && pushed <= 8);
+    CHECK(producer->header->dropped == dropped + 1);
+    // space of a consumed record is reused
+    PopAndCheck(consumer, 7, "full", message);
+    CHECK(ShmRingPush(producer, 7, "full", message));
+    for (int i = 0; i < pushed; i++)
+        PopAndCheck(consumer, 7, "full", message);
+    free(message);
+
+    // a record above a quarter of the data area is refused even in an empty ring
+    message = (char*)malloc(SHM_RING_DATA_SIZE / 2);
+    memset(message, 'y', SHM_RING_DATA_SIZE / 2 - 1);
+    message[SHM_RING_DATA_SIZE / 2 - 1] = '\0';
+    CHECK(!ShmRingPush(producer, 7, "big", message));
+    free(message);
+}
+
+static void TestConsumerAlive(SHM_RING* producer)
+{
+    CHECK(ShmRingConsumerAlive(producer));
+    producer->header->consumerHeartbeatMs = GetMonotonicTimeMs() - SHM_RING_DEAD_MS - 1;
+    CHECK(!ShmRingConsumerAlive(producer));
+    ShmRingHeartbeat(producer);
+    CHECK(ShmRingConsumerAlive(producer));
+}
+
+// A new plugin instance takes over the ring together with the records not sent yet
+static void TestTakeover(SHM_RING* producer, SHM_RING* consumer)
+{
+    CHECK(ShmRingPush(producer, 3, "left", "over"));
+    ShmRingClose(producer);
+    CHECK(ShmRingCreate(producer, name));
+    PopAndCheck(consumer, 3, "left", "over");
+}
+
+// A second client must not take over the ring of a running one, it publishes in-process instead
+static void TestOtherProducer(SHM_RING* producer)
+{
+    SHM_RING second;
+
+    producer->header->producerPid = (int)getppid();
+    CHECK(!ShmRingCreate(&second, name));
+    CHECK(second.header == NULL);
+    CHECK(producer->header->producerPid == (int)getppid());
+
+    producer->header->producerPid = (int)getpid();
+    CHECK(ShmRingCreate(&second, name));
+    ShmRingClose(&second);
+}
+
+int main(void)
+{
+    SHM_RING producer;
+    SHM_RING consumer;
+
+    snprintf(name, sizeof(name), "/lh2mqtt-test-%d", (int)getpid());
+    if (!ShmRingCreate(&producer, name) || !ShmRingAttach(&consumer, name)) {
+        printf("%s: shared memory not available\n", __FILE__);
+        shm_unlink(name);
+        return 1;
+    }
+    TestOrder(&producer, &consumer);
+    TestWrap(&producer, &consumer);
+    TestFull(&producer, &consumer);
+    TestConsumerAlive(&producer);
+    TestTakeover(&producer, &consumer);
+    TestOtherProducer(&producer);
+
+    ShmRingClose(&consumer);
+    ShmRingClose(&producer);
+    shm_unlink(name);
+    return TEST_RESULT();
+}
@@ -0,0 +1,193 @@
+/*
+ * Behaviour of sink.c: events fan out to the sinks taking their kind, high priority events go first, held sinks
+ * buffer bulk events until released (also sinks without worker), full queues drop only their own events and what is
+ * left at the deadline of SinkRemoveAll is spilled.
+ */
+
+#include <unistd.h>
+
+#include "test.h"
+#include "sink.h"
+#include "slab.h"
+
+#define RECORD_MAX 600
+
+typedef struct {
+    PLATFORM_MUTEX lock;
+    char           order[RECORD_MAX][16]; // messages in the order they were published
+    int            count;
+    int            flushes;
+    int            shutdowns;
+    volatile int   blocked; // publish waits while set
+    int            spilled;
+} RECORD;
+
+static void RecordPublish(void* arg, const SINK_EVENT* event)
+{
+    RECORD* record = (RECORD*)arg;
+
+    while (record->blocked)
+        usleep(1000);
+    MutexLock(&record->lock);
+    if (record->count < RECORD_MAX)
+        snprintf(record->order[record->count++], sizeof(record->order[0]), "%s", event->message);
+    MutexUnlock(&record->lock);
+}
+
+static void RecordFlush(void* arg)
+{
+    ((RECORD*)arg)->flushes++;
+}
+
+static void RecordShutdown(void* arg)
+{
+    ((RECORD*)arg)->shutdowns++;
+}
+
+static void RecordSpill(const SINK_OPS* ops, const SINK_EVENT* event, void* arg)
+{
+    ((RECORD*)arg)->spilled++;
+}
+
+static const SINK_OPS mqttOps = { "mqtt", SINK_EVENT_MQTT, NULL, RecordPublish, RecordFlush, RecordShutdown };
+static const SINK_OPS textOps = { "text", SINK_EVENT_TEXT, NULL, RecordPublish, RecordFlush, RecordShutdown, 1 };
+static const SINK_OPS syncOps = { "sync", SINK_EVENT_MQTT, NULL, RecordPublish, RecordFlush, RecordShutdown, 1 };
+
+static void RecordInit(RECORD* record)
+{
+    memset(record, 0, sizeof(*record));
+    MutexInit(&record->lock);
+}
+
+static int RecordCount(RECORD* record)
+{
+    int count;
+
+    MutexLock(&record->lock);
+    count = record->count;
+    MutexUnlock(&record->lock);
+    return count;
+}
+
+static int WaitForCount(RECORD* record, int count)
+{
+    for (int i = 0; i < 2000 && RecordCount(record) < count; i++)
+        usleep(1000);
+    return RecordCount(record) == count;
+}
+
+static void TestFanOut(void)
+{
+    SINK_SET set;
+    RECORD   mqtt;
+    RECORD   text;
+
+    RecordInit(&mqtt);
+    RecordInit(&text);
+    SinkSetInit(&set);
+    CHECK(SinkAdd(&set, &mqttOps, &mqtt));
+    CHECK(SinkAdd(&set, &textOps, &text));
+
+    CHECK(SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "ts/talk", "m1") == 0);
+    CHECK(SinkPublish(&set, SINK_EVENT_TEXT, SINK_PRIORITY_BULK, 1, 7, "", "t1") == 0);
+    // the synchronous sink published on this thread already
+    CHECK(text.count == 1 && text.flushes == 1);
+    CHECK_STR(text.order[0], "t1");
+    CHECK(WaitForCount(&mqtt, 1));
+    CHECK_STR(mqtt.order[0], "m1");
+
+    SinkClose(&set);
+    SinkPublish(&set, SINK_EVENT_TEXT, SINK_PRIORITY_BULK, 1, 7, "", "t2");
+    CHECK(text.count == 1);
+    SinkSetFree(&set);
+    CHECK(mqtt.shutdowns == 1 && text.shutdowns == 1);
+}
+
+static void TestPriority(void)
+{
+    SINK_SET set;
+    RECORD   mqtt;
+
+    RecordInit(&mqtt);
+    SinkSetInit(&set);
+    SinkAdd(&set, &mqttOps, &mqtt);
+
+    // the worker is stuck in the first publish while the others queue up
+    mqtt.blocked = 1;
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "t", "b0");
+    usleep(20000);
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "t", "b1");
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "t", "b2");
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_HIGH, 1, 8, "t", "h1");
+    mqtt.blocked = 0;
+    CHECK(WaitForCount(&mqtt, 4));
+    CHECK_STR(mqtt.order[0], "b0");
+    CHECK_STR(mqtt.order[1], "h1");
+    CHECK_STR(mqtt.order[2], "b1");
+    CHECK_STR(mqtt.order[3], "b2");
+    SinkSetFree(&set);
+}
+
+static void TestHold(const SINK_OPS* ops)
+{
+    SINK_SET   set;
+    RECORD     record;
+    SINK_STATS stats;
+
+    RecordInit(&record);
+    SinkSetInit(&set);
+    SinkAdd(&set, ops, &record);
+    SinkHold(&set, ops, 1);
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "t", "b1");
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_HIGH, 1, 7, "t", "h1");
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "t", "b2");
+    CHECK(WaitForCount(&record, 1));
+    usleep(20000);
+    CHECK(RecordCount(&record) == 1);
+    CHECK_STR(record.order[0], "h1");
+    SinkGetStats(&set, 0, &stats);
+    CHECK(stats.held && stats.depth == 2);
+
+    SinkHold(&set, ops, 0);
+    CHECK(WaitForCount(&record, 3));
+    CHECK_STR(record.order[1], "b1");
+    CHECK_STR(record.order[2], "b2");
+    SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "t", "b3");
+    CHECK(WaitForCount(&record, 4));
+    SinkSetFree(&set);
+}
+
+static void TestDropAndSpill(const SINK_OPS* ops)
+{
+    SINK_SET set;
+    RECORD   record;
+    int      dropped = 0;
+
+    RecordInit(&record);
+    SinkSetInit(&set);
+    SinkAdd(&set, ops, &record);
+    SinkHold(&set, ops, 1);
+    for (int i = 0; i < SINK_QUEUE_LEN + 10; i++)
+        dropped += SinkPublish(&set, SINK_EVENT_MQTT, SINK_PRIORITY_BULK, 1, 7, "t", "b");
+    CHECK(dropped == 10);
+
+    // a deadline in the past publishes nothing, every queued event is spilled
+    record.blocked = 1;
+    SinkRemoveAll(&set, 1, RecordSpill, &record);
+    CHECK(record.count == 0 && record.spilled == SINK_QUEUE_LEN);
+    CHECK(record.shutdowns == 1);
+    SinkSetFree(&set);
+}
+
+int main(void)
+{
+    SlabInit();
+    TestFanOut();
+    TestPriority();
+    TestHold(&mqttOps);
+    TestHold(&syncOps);
+    TestDropAndSpill(&mqttOps);
+    TestDropAndSpill(&syncOps);
+    SlabShutdown();
+    return TEST_RESULT();
+}
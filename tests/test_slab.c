@@ -0,0 +1,121 @@
+/*
+ * Behaviour of slab.c: size classes and the malloc fallback, reuse through the thread cache, objects of a worker
+ * thread going back to the global pool and objects freed after SlabShutdown being ignored instead of corrupting the
+ * released pool.
+ */
+
+#include <pthread.h>
+
+#include "test.h"
+#include "slab.h"
+
+#define WORKER_OBJECTS 200
+
+static void TestSizeClasses(void)
+{
+    SLAB_STATS stats;
+    void*      small;
+    void*      medium;
+    void*      large;
+
+    SlabInit();
+    small  = SlabAlloc(64);
+    medium = SlabAlloc(65);
+    large  = SlabAlloc(4097);
+    CHECK(small != NULL && medium != NULL && large != NULL);
+    CHECK(((size_t)small & 15) == 0 && ((size_t)medium & 15) == 0);
+
+    SlabGetStats(0, &stats);
+    CHECK(stats.objectSize == 64 && stats.reserved > 0);
+    SlabGetStats(1, &stats);
+    CHECK(stats.objectSize == 256 && stats.reserved > 0);
+    SlabGetStats(2, &stats);
+    CHECK(stats.reserved == 0);
+    CHECK(SlabGetLargeCount() == 1);
+
+    SlabFree(small);
+    SlabFree(medium);
+    SlabFree(large);
+    SlabShutdown();
+}
+
+static void TestReuse(void)
+{
+    void* first;
+    char* copy;
+
+    SlabInit();
+    first = SlabAlloc(32);
+    SlabFree(first);
+    CHECK(SlabAlloc(48) == first);
+    SlabFree(first);
+
+    copy = SlabStrdup("speaker");
+    CHECK_STR(copy, "speaker");
+    SlabFree(copy);
+    SlabShutdown();
+}
+
+static void* Worker(void* arg)
+{
+    void* objects[WORKER_OBJECTS];
+
+    (void)arg;
+    for (int i = 0; i < WORKER_OBJECTS; i++)
+        objects[i] = SlabAlloc(200);
+    for (int i = 0; i < WORKER_OBJECTS; i++)
+        SlabFree(objects[i]);
+    SlabThreadFlush();
+    return NULL;
+}
+
+static void TestThreadFlush(void)
+{
+    SLAB_STATS stats;
+    pthread_t  thread;
+
+    SlabInit();
+    pthread_create(&thread, NULL, Worker, NULL);
+    pthread_join(thread, NULL);
+    SlabGetStats(1, &stats);
+    CHECK(stats.reserved >= WORKER_OBJECTS);
+    CHECK(stats.free == stats.reserved);
+    CHECK(stats.refills > 0 && stats.returns > 0);
+    SlabShutdown();
+}
+
+static void TestFreeAfterShutdown(void)
+{
+    SLAB_STATS stats;
+    char*      kept;
+    void*      fresh;
+
+    SlabInit();
+    kept = (char*)SlabAlloc(100);
+    memset(kept, 'x', 100);
+    SlabShutdown();
+
+    // the chunk stays allocated because the object was not freed, freeing it now changes nothing
+    CHECK(kept[99] == 'x');
+    SlabFree(kept);
+    CHECK(kept[0] == 'x');
+
+    // a new pool does not pick up the object of the old one
+    SlabInit();
+    SlabFree(kept);
+    fresh = SlabAlloc(100);
+    CHECK(fresh != kept);
+    SlabGetStats(1, &stats);
+    CHECK(stats.reserved > 0 && stats.free + SLAB_BATCH - 1 <= stats.reserved);
+    SlabFree(fresh);
+    SlabShutdown();
+}
+
+int main(void)
+{
+    TestSizeClasses();
+    TestReuse();
+    TestThreadFlush();
+    TestFreeAfterShutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,129 @@
+/*
+ * Behaviour of spool.c: messages with tabs, line breaks and backslashes come back unchanged and in order, records
+ * longer than the read buffer stay whole, and messages the replay function refuses stay spooled for the next replay.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "spool.h"
+
+#define LONG_LEN 20000
+
+typedef struct {
+    int  count;
+    int  refuseFrom; // messages from this index on are refused
+    char topics[8][64];
+    char messages[8][64];
+    char longMessage[LONG_LEN + 1];
+} REPLAY;
+
+static int OnMessage(const char* topic, const char* message, void* arg)
+{
+    REPLAY* replay = (REPLAY*)arg;
+    int     index  = replay->count;
+
+    if (index >= replay->refuseFrom)
+        return 0;
+    replay->count++;
+    if (strlen(message) >= sizeof(replay->messages[index])) {
+        if (strlen(message) <= LONG_LEN)
+            memcpy(replay->longMessage, message, strlen(message) + 1);
+        snprintf(replay->messages[index], sizeof(replay->messages[index]), "long");
+    } else {
+        snprintf(replay->messages[index], sizeof(replay->messages[index]), "%s", message);
+    }
+    snprintf(replay->topics[index], sizeof(replay->topics[index]), "%s", topic);
+    return 1;
+}
+
+static void TestRoundTrip(const char* path)
+{
+    SPOOL  spool;
+    REPLAY replay;
+
+    SpoolOpen(&spool, path);
+    CHECK(SpoolWrite(&spool, "ts/talk", "start"));
+    CHECK(SpoolWrite(&spool, "ts/tab\tbed", "line\nbreak\r\\back"));
+    CHECK(SpoolWrite(&spool, "ts/empty", ""));
+    SpoolClose(&spool);
+    CHECK(spool.count == 3);
+
+    memset(&replay, 0, sizeof(replay));
+    replay.refuseFrom = 8;
+    CHECK(SpoolReplay(path, OnMessage, &replay) == 3);
+    CHECK_STR(replay.topics[0], "ts/talk");
+    CHECK_STR(replay.messages[0], "start");
+    CHECK_STR(replay.topics[1], "ts/tab\tbed");
+    CHECK_STR(replay.messages[1], "line\nbreak\r\\back");
+    CHECK_STR(replay.messages[2], "");
+    CHECK(access(path, F_OK) != 0);
+    CHECK(SpoolReplay(path, OnMessage, &replay) == 0);
+}
+
+static void TestLongRecord(const char* path)
+{
+    SPOOL   spool;
+    REPLAY* replay = (REPLAY*)calloc(1, sizeof(REPLAY));
+    char*   big    = (char*)malloc(LONG_LEN + 1);
+
+    memset(big, 'a', LONG_LEN);
+    big[LONG_LEN] = '\0';
+    big[9000]     = '\t';
+    SpoolOpen(&spool, path);
+    SpoolWrite(&spool, "ts/before", "1");
+    SpoolWrite(&spool, "ts/long", big);
+    SpoolWrite(&spool, "ts/after", "2");
+    SpoolClose(&spool);
+
+    replay->refuseFrom = 8;
+    CHECK(SpoolReplay(path, OnMessage, replay) == 3);
+    CHECK_STR(replay->topics[1], "ts/long");
+    CHECK(strcmp(replay->longMessage, big) == 0);
+    CHECK_STR(replay->topics[2], "ts/after");
+    CHECK_STR(replay->messages[2], "2");
+    free(big);
+    free(replay);
+}
+
+static void TestRefused(const char* path)
+{
+    SPOOL  spool;
+    REPLAY replay;
+
+    SpoolOpen(&spool, path);
+    for (int i = 0; i < 4; i++) {
+        char topic[16];
+        snprintf(topic, sizeof(topic), "ts/%d", i);
+        SpoolWrite(&spool, topic, "x\ty");
+    }
+    SpoolClose(&spool);
+
+    // the queue runs full after two messages, the other two stay in the file
+    memset(&replay, 0, sizeof(replay));
+    replay.refuseFrom = 2;
+    CHECK(SpoolReplay(path, OnMessage, &replay) == 2);
+    CHECK(access(path, F_OK) == 0);
+
+    memset(&replay, 0, sizeof(replay));
+    replay.refuseFrom = 8;
+    CHECK(SpoolReplay(path, OnMessage, &replay) == 2);
+    CHECK_STR(replay.topics[0], "ts/2");
+    CHECK_STR(replay.topics[1], "ts/3");
+    CHECK_STR(replay.messages[1], "x\ty");
+    CHECK(access(path, F_OK) != 0);
+}
+
+int main(void)
+{
+    char path[64];
+
+    snprintf(path, sizeof(path), "/tmp/test_spool_%d.txt", (int)getpid());
+    remove(path);
+    TestRoundTrip(path);
+    TestLongRecord(path);
+    TestRefused(path);
+    remove(path);
+    return TEST_RESULT();
+}
@@ -0,0 +1,147 @@
+/*
+ * Behaviour of state_file.c: what a reader sees of the slots, a slot left odd by a dead writer, and that a reader
+ * never copies a half written slot while the writer updates it all the time.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "state_file.h"
+
+#define READS 200000
+
+static char path[64];
+
+static void TestReadWrite(void)
+{
+    STATE_FILE        writer;
+    STATE_FILE        reader;
+    STATE_FILE_SERVER slot;
+    uint64            updates;
+
+    CHECK(StateFileOpen(&writer, path));
+    CHECK(StateFileAttach(&reader, path));
+    CHECK(writer.header->writerPid == (int)getpid());
+
+    updates = StateFileUpdates(&reader);
+    StateFileSetSpeaker(&writer, 5, "srv=", 7, "Little.Ben", "ben=", 1, 1234);
+    CHECK(StateFileUpdates(&reader) != updates);
+    CHECK(StateFileRead(&reader, 0, &slot));
+    CHECK(slot.serverConnectionHandlerID == 5 && slot.clientID == 7 && slot.talkers == 1 && slot.sinceMs == 1234);
+    CHECK_STR(slot.speaker, "Little.Ben");
+    CHECK_STR(slot.speakerUid, "ben=");
+    CHECK_STR(slot.serverUid, "srv=");
+    CHECK(StateFileGetSpeaker(&writer, 5) == 7);
+
+    // a second tab takes the next slot, only the talkers change
+    StateFileSetSpeaker(&writer, 6, "other=", 0, "", "", 0, 0);
+    StateFileSetTalkers(&writer, 5, 2);
+    CHECK(StateFileRead(&reader, 0, &slot) && slot.talkers == 2 && slot.clientID == 7);
+    CHECK(StateFileRead(&reader, 1, &slot) && slot.serverConnectionHandlerID == 6 && slot.clientID == 0);
+
+    StateFileRemoveServer(&writer, 5);
+    CHECK(!StateFileRead(&reader, 0, &slot));
+    CHECK(StateFileGetSpeaker(&writer, 5) == 0);
+
+    // closing the plugin leaves the file with free slots and no writer
+    StateFileClose(&writer);
+    CHECK(!StateFileRead(&reader, 1, &slot));
+    CHECK(reader.header->writerPid == 0);
+    StateFileDetach(&reader);
+}
+
+// A writer which died within an update left the sequence odd: readers give up, a new writer makes it usable again
+static void TestDeadWriter(void)
+{
+    STATE_FILE        writer;
+    STATE_FILE        reader;
+    STATE_FILE_SERVER slot;
+
+    CHECK(StateFileOpen(&writer, path));
+    StateFileSetSpeaker(&writer, 5, "srv=", 7, "Little.Ben", "ben=", 1, 0);
+    AtomicAdd64(&writer.header->slots[0].sequence, 1);
+    CHECK(StateFileAttach(&reader, path));
+    CHECK(!StateFileRead(&reader, 0, &slot));
+    StateFileDetach(&reader);
+
+    // the odd sequence is not closed here, the next instance takes the file over
+    StateFileDetach(&writer);
+    CHECK(StateFileOpen(&writer, path));
+    for (int i = 0; i < STATE_FILE_SERVERS; i++)
+        CHECK((writer.header->slots[i].sequence & 1) == 0);
+    StateFileSetSpeaker(&writer, 5, "srv=", 8, "Ben", "ben=", 1, 0);
+    CHECK(StateFileAttach(&reader, path));
+    CHECK(StateFileRead(&reader, 0, &slot) && slot.clientID == 8);
+    StateFileDetach(&reader);
+    StateFileClose(&writer);
+}
+
+static STATE_FILE   sharedWriter;
+static volatile int writerStop;
+
+// Alternates two speakers whose name consists of the digit of their clientID only
+static void WriterWorker(void* arg)
+{
+    char names[2][STATE_FILE_NAME_LEN];
+
+    memset(names[0], '1', sizeof(names[0]) - 1);
+    memset(names[1], '2', sizeof(names[1]) - 1);
+    names[0][sizeof(names[0]) - 1] = '\0';
+    names[1][sizeof(names[1]) - 1] = '\0';
+    for (unsigned int i = 0; !writerStop; i++)
+        StateFileSetSpeaker(&sharedWriter, 5, "srv=", (anyID)(1 + i % 2), names[i % 2], names[i % 2], i, i);
+}
+
+static void TestConcurrentReader(void)
+{
+    STATE_FILE        reader;
+    STATE_FILE_SERVER slot;
+    PLATFORM_THREAD   thread;
+    int               torn = 0;
+    int               read = 0;
+
+    CHECK(StateFileOpen(&sharedWriter, path));
+    StateFileSetSpeaker(&sharedWriter, 5, "srv=", 0, "", "", 0, 0);
+    CHECK(StateFileAttach(&reader, path));
+    writerStop = 0;
+    CHECK(ThreadStart(&thread, WriterWorker, NULL));
+    for (int i = 0; i < READS; i++) {
+        if (!StateFileRead(&reader, 0, &slot))
+            continue;
+        read++;
+        if (slot.clientID != 0) {
+            char digit = (char)('0' + slot.clientID);
+
+            for (size_t k = 0; k < sizeof(slot.speaker) - 1; k++)
+                torn += slot.speaker[k] != digit;
+            torn += slot.talkers != slot.sinceMs;
+        }
+    }
+    writerStop = 1;
+    ThreadJoin(&thread);
+    CHECK(torn == 0);
+    CHECK(read > 0);
+    StateFileDetach(&reader);
+    StateFileClose(&sharedWriter);
+}
+
+int main(void)
+{
+    STATE_FILE file;
+    FILE*      other;
+
+    snprintf(path, sizeof(path), "/tmp/lh2mqtt-state-%d", (int)getpid());
+    TestReadWrite();
+    TestDeadWriter();
+    TestConcurrentReader();
+
+    // a file of another layout is refused
+    other = fopen(path, "w");
+    fputs("no state file", other);
+    fclose(other);
+    CHECK(!StateFileAttach(&file, path));
+
+    unlink(path);
+    return TEST_RESULT();
+}
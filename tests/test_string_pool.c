@@ -0,0 +1,109 @@
+/*
+ * Behaviour of string_pool.c: equal strings share one handle, the string lives as long as a reference is held, freed
+ * handles are handed out again, the empty string needs no reference, and interning from several threads keeps the
+ * reference counts exact.
+ */
+
+#include "test.h"
+#include "string_pool.h"
+#include "slab.h"
+
+#define THREADS        4
+#define THREAD_INTERNS 1000
+
+static void TestShare(STRING_POOL* pool)
+{
+    STRING_HANDLE a = StringPoolIntern(pool, "Alice");
+    STRING_HANDLE b = StringPoolIntern(pool, "Alice");
+    STRING_HANDLE c = StringPoolIntern(pool, "Bob");
+
+    CHECK(a != STRING_HANDLE_NONE && a == b && a != c);
+    CHECK(pool->count == 2 && pool->shared == 1);
+    CHECK(pool->bytes == strlen("Alice") + 1 + strlen("Bob") + 1);
+    CHECK_STR(StringPoolGet(pool, a), "Alice");
+
+    StringPoolRelease(pool, a);
+    CHECK_STR(StringPoolGet(pool, b), "Alice");
+    StringPoolRetain(pool, b);
+    StringPoolRelease(pool, b);
+    StringPoolRelease(pool, b);
+    CHECK(pool->count == 1);
+
+    // the freed handle is reused for the next new string
+    CHECK(StringPoolIntern(pool, "Carol") == a);
+    CHECK_STR(StringPoolGet(pool, a), "Carol");
+    StringPoolRelease(pool, a);
+    StringPoolRelease(pool, c);
+    CHECK(pool->count == 0 && pool->bytes == 0);
+}
+
+static void TestEmpty(STRING_POOL* pool)
+{
+    CHECK(StringPoolIntern(pool, "") == STRING_HANDLE_NONE);
+    CHECK(StringPoolIntern(pool, NULL) == STRING_HANDLE_NONE);
+    CHECK(StringPoolRetain(pool, STRING_HANDLE_NONE) == STRING_HANDLE_NONE);
+    StringPoolRelease(pool, STRING_HANDLE_NONE);
+    CHECK_STR(StringPoolGet(pool, STRING_HANDLE_NONE), "");
+    CHECK(pool->count == 0);
+}
+
+static void TestGrow(STRING_POOL* pool)
+{
+    STRING_HANDLE handles[1000];
+    char          str[16];
+    int           same = 1;
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(str, sizeof(str), "uid%d=", i);
+        handles[i] = StringPoolIntern(pool, str);
+    }
+    CHECK(pool->count == 1000);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(str, sizeof(str), "uid%d=", i);
+        same &= strcmp(StringPoolGet(pool, handles[i]), str) == 0;
+        StringPoolRelease(pool, handles[i]);
+    }
+    CHECK(same);
+    CHECK(pool->count == 0);
+}
+
+static STRING_POOL* sharedPool;
+
+static void InternWorker(void* arg)
+{
+    for (int i = 0; i < THREAD_INTERNS; i++) {
+        STRING_HANDLE h = StringPoolIntern(sharedPool, i % 2 ? "Alice" : "Bob");
+        StringPoolRelease(sharedPool, h);
+    }
+    SlabThreadFlush();
+}
+
+static void TestThreads(STRING_POOL* pool)
+{
+    PLATFORM_THREAD threads[THREADS];
+    STRING_HANDLE   kept = StringPoolIntern(pool, "Alice");
+
+    sharedPool = pool;
+    for (int i = 0; i < THREADS; i++)
+        ThreadStart(&threads[i], InternWorker, NULL);
+    for (int i = 0; i < THREADS; i++)
+        ThreadJoin(&threads[i]);
+    CHECK(pool->entries[kept].refs == 1);
+    StringPoolRelease(pool, kept);
+    CHECK(pool->count == 0);
+}
+
+int main(void)
+{
+    static STRING_POOL pool;
+
+    SlabInit();
+    StringPoolInit(&pool);
+    TestShare(&pool);
+    TestEmpty(&pool);
+    TestGrow(&pool);
+    TestThreads(&pool);
+    StringPoolFree(&pool);
+    SlabShutdown();
+    return TEST_RESULT();
+}
@@ -0,0 +1,86 @@
+/*
+ * Behaviour of talk_sessions.c: duration and burst count of talk bursts, duplicate start and stop events, entries
+ * of an earlier connection epoch, and removal by client and by server tab keeping the probe sequences intact.
+ */
+
+#include "test.h"
+#include "talk_sessions.h"
+
+static void TestBursts(TALK_SESSIONS* table)
+{
+    TALK_INFO info;
+
+    CHECK(TalkSessionsStart(table, 1, 7, 1, 1000, &info) && info.bursts == 1);
+    CHECK(!TalkSessionsStart(table, 1, 7, 1, 1100, &info) && info.bursts == 1);
+    CHECK(TalkSessionsStop(table, 1, 7, 1, 1500, &info));
+    CHECK(info.durationMs == 500 && info.bursts == 1);
+    CHECK(!TalkSessionsStop(table, 1, 7, 1, 1600, &info) && info.durationMs == 0);
+
+    CHECK(TalkSessionsStart(table, 1, 7, 1, 2000, &info) && info.bursts == 2);
+    CHECK(TalkSessionsStop(table, 1, 7, 1, 2250, &info));
+    CHECK(info.durationMs == 250 && info.bursts == 2);
+
+    // the same client ID on another tab is another client
+    CHECK(TalkSessionsStart(table, 2, 7, 1, 3000, &info) && info.bursts == 1);
+    CHECK(table->count == 2);
+}
+
+static void TestEpoch(TALK_SESSIONS* table)
+{
+    TALK_INFO info;
+
+    // tab 1 reconnected, client 7 is someone else now
+    CHECK(TalkSessionsStart(table, 1, 7, 1, 4000, &info));
+    CHECK(!TalkSessionsStop(table, 1, 7, 2, 4100, &info));
+    CHECK(TalkSessionsStart(table, 1, 7, 2, 4200, &info) && info.bursts == 1);
+    CHECK(TalkSessionsStop(table, 1, 7, 2, 4300, &info) && info.durationMs == 100);
+}
+
+static void TestRemove(TALK_SESSIONS* table)
+{
+    TALK_INFO info;
+    int       found = 1;
+
+    TalkSessionsInit(table);
+    for (anyID id = 1; id <= 1000; id++) {
+        TalkSessionsStart(table, 1, id, 1, 10, &info);
+        TalkSessionsStart(table, 2, id, 1, 10, &info);
+    }
+    CHECK(table->count == 2000);
+
+    TalkSessionsRemove(table, 1, 500);
+    CHECK(table->count == 1999);
+    CHECK(TalkSessionsStart(table, 1, 500, 1, 20, &info) && info.bursts == 1);
+
+    TalkSessionsRemoveServer(table, 1);
+    CHECK(table->count == 1000);
+    // every client of tab 2 is still found after the backward shifts, its burst is still running
+    for (anyID id = 1; id <= 1000; id++)
+        found &= !TalkSessionsStart(table, 2, id, 1, 30, &info) && info.bursts == 1;
+    CHECK(found);
+    CHECK(!TalkSessionsStop(table, 1, 1, 1, 30, &info));
+}
+
+static void TestFull(TALK_SESSIONS* table)
+{
+    TALK_INFO info;
+    int       started = 0;
+
+    TalkSessionsInit(table);
+    for (int id = 1; id <= TALK_SESSIONS_CAPACITY; id++)
+        started += TalkSessionsStart(table, 3, (anyID)id, 1, 10, &info);
+    CHECK(started == TALK_SESSIONS_CAPACITY / 4 * 3);
+    CHECK(TalkSessionsStop(table, 3, 1, 1, 20, &info) && info.durationMs == 10);
+}
+
+int main(void)
+{
+    static TALK_SESSIONS table;
+
+    TalkSessionsInit(&table);
+    TestBursts(&table);
+    TestEpoch(&table);
+    TestRemove(&table);
+    TestFull(&table);
+    return TEST_RESULT();
+}
@@ -0,0 +1,100 @@
+/*
+ * Behaviour of text_escape.c: replacements, UTF-8 validation, cutting off and special bytes on both sides of the
+ * 16 byte blocks of the SSE2 path.
+ */
+
+#include "test.h"
+#include "text_escape.h"
+
+static void TestJson(void)
+{
+    char out[256];
+
+    EscapeJsonString("Little.Ben", out, sizeof(out));
+    CHECK_STR(out, "Little.Ben");
+    EscapeJsonString("a\"b\\c", out, sizeof(out));
+    CHECK_STR(out, "a\\\"b\\\\c");
+    EscapeJsonString("tab\there\nline\x01", out, sizeof(out));
+    CHECK_STR(out, "tab\\there\\nline\\u0001");
+    // valid UTF-8 stays, invalid bytes become U+FFFD
+    EscapeJsonString("M\xC3\xBCller", out, sizeof(out));
+    CHECK_STR(out, "M\xC3\xBCller");
+    EscapeJsonString("a\xFF" "b\xC0\xAF" "c", out, sizeof(out));
+    CHECK_STR(out, "a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD" "c");
+    // surrogate and cut off sequence
+    EscapeJsonString("\xED\xA0\x80", out, sizeof(out));
+    CHECK_STR(out, "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD");
+    EscapeJsonString("x\xE2\x82", out, sizeof(out));
+    CHECK_STR(out, "x\xEF\xBF\xBD\xEF\xBF\xBD");
+}
+
+static void TestBBCode(void)
+{
+    char out[256];
+
+    EscapeBBCode("[b]Ben[/b]", out, sizeof(out));
+    CHECK_STR(out, "[\xE2\x80\x8B" "b]Ben[\xE2\x80\x8B/b]");
+    EscapeBBCode("a\tb", out, sizeof(out));
+    CHECK_STR(out, "a b");
+    EscapeBBCode("\"quoted\" $name", out, sizeof(out));
+    CHECK_STR(out, "\"quoted\" $name");
+}
+
+static void TestShell(void)
+{
+    char out[256];
+
+    EscapeShellArgument("M\xC3\xBCller", out, sizeof(out));
+    CHECK_STR(out, "M\xC3\xBCller");
+#ifndef _WIN32
+    EscapeShellArgument("a\"b$c`d\\e", out, sizeof(out));
+    CHECK_STR(out, "a\\\"b\\$c\\`d\\\\e");
+#endif
+    EscapeShellArgument("x\ny", out, sizeof(out));
+    CHECK_STR(out, "x_y");
+}
+
+// A special byte at every position of a name longer than one block must be found
+static void TestBlockBoundaries(void)
+{
+    char in[48];
+    char out[256];
+    char expected[256];
+
+    for (int pos = 0; pos < 40; pos++) {
+        memset(in, 'a', 40);
+        in[40]  = '\0';
+        in[pos] = '"';
+        snprintf(expected, sizeof(expected), "%.*s\\\"%s", pos, in, in + pos + 1);
+        EscapeJsonString(in, out, sizeof(out));
+        CHECK_STR(out, expected);
+    }
+}
+
+// A result cut off holds no half escape or UTF-8 sequence and is always terminated
+static void TestCutOff(void)
+{
+    char   out[8];
+    size_t len;
+
+    len = EscapeJsonString("abcdefghijklmnopqrstuvwxyz", out, sizeof(out));
+    CHECK(len == 7);
+    CHECK_STR(out, "abcdefg");
+    len = EscapeJsonString("abcdef\"", out, sizeof(out));
+    CHECK_STR(out, "abcdef");
+    CHECK(len == 6);
+    len = EscapeJsonString("abcdef\xC3\xBC", out, sizeof(out));
+    CHECK_STR(out, "abcdef");
+    len = EscapeJsonString("abc", out, 1);
+    CHECK(len == 0 && out[0] == '\0');
+}
+
+int main(void)
+{
+    TestJson();
+    TestBBCode();
+    TestShell();
+    TestBlockBoundaries();
+    TestCutOff();
+    return TEST_RESULT();
+}